@@ -20,9 +20,9 @@
 // Include structures and functions for lighting.
 #include "LightingUtil.hlsl"
 
-Texture2D    gAlbedoMap    : register(t0);
-Texture2D    gRoughnessMap : register(t1);
-Texture2D    gMetalnessMap : register(t2);
+// Bindless table of every texture registered in DXRenderer (requires shader model 5.1).
+// Materials index it, DiffuseMapIndex + [0, 1, 2] are the albedo, roughness and metalness maps.
+Texture2D    gTextures[]   : register(t0, space1);
 
 SamplerState gsamLinear  : register(s0);
 
@@ -32,6 +32,12 @@ cbuffer cbPerObject : register(b0)
 {
     float4x4 gWorld;
     float4x4 gTexTransform;
+    // Dequantization of the 16-bit unorm positions.
+    float4 gPosQuantMin;
+    float4 gPosQuantExtent;
+    // Element of gMaterials.
+    uint  gMaterialIndex;
+    uint3 cbPerObjectPad0;
 };
 
 // Constant data that varies per material.
@@ -60,19 +66,27 @@ cbuffer cbPass : register(b1)
     Light gLights[MaxLights];
 };
 
-cbuffer cbMaterial : register(b2)
+// Parameters of all materials, the application reflects the layout of MaterialData.
+struct MaterialData
 {
-	float4 gDiffuseAlbedo;
-    float3 gFresnelR0;
-    float  gRoughness;
-    float4x4 gMatTransform;
+    float4   DiffuseAlbedo;
+    float3   FresnelR0;
+    float    Roughness;
+    float4x4 MatTransform;
+    uint     DiffuseMapIndex;
+    uint     MatPad0;
+    uint     MatPad1;
+    uint     MatPad2;
 };
 
+StructuredBuffer<MaterialData> gMaterials : register(t0, space2);
+
+// Compressed vertex (16 bytes), see Ubpa::VertexCompression::GenerateHLSL.
 struct VertexIn
 {
-	float3 PosL    : POSITION;
-    float3 NormalL : NORMAL;
-	float2 TexC    : TEXCOORD;
+	float4 PosQ    : POSITION; // R16G16B16A16_UNORM, quantized against the mesh bounds
+    float2 NormalQ : NORMAL;   // R16G16_SNORM, octahedral
+	float2 TexC    : TEXCOORD; // R16G16_FLOAT
 };
 
 struct VertexOut
@@ -83,23 +97,34 @@ struct VertexOut
 	float2 TexC    : TEXCOORD;
 };
 
+float3 OctDecode(float2 e)
+{
+    float3 n = float3(e, 1.0f - abs(e.x) - abs(e.y));
+    float t = saturate(-n.z);
+    n.xy += n.xy >= 0.0f ? -t : t;
+    return normalize(n);
+}
+
 VertexOut VS(VertexIn vin)
 {
 	VertexOut vout = (VertexOut)0.0f;
 	
+    float3 posL = gPosQuantMin.xyz + vin.PosQ.xyz * gPosQuantExtent.xyz;
+    float3 normalL = OctDecode(vin.NormalQ);
+
     // Transform to world space.
-    float4 posW = mul(float4(vin.PosL, 1.0f), gWorld);
+    float4 posW = mul(float4(posL, 1.0f), gWorld);
     vout.PosW = posW.xyz;
 
     // Assumes nonuniform scaling; otherwise, need to use inverse-transpose of world matrix.
-    vout.NormalW = mul(vin.NormalL, (float3x3)gWorld);
+    vout.NormalW = mul(normalL, (float3x3)gWorld);
 
     // Transform to homogeneous clip space.
     vout.PosH = mul(posW, gViewProj);
 	
 	// Output vertex attributes for interpolation across triangle.
     float4 texC = mul(float4(vin.TexC, 0.0f, 1.0f), gTexTransform);
-    vout.TexC = mul(texC, gMatTransform).xy;
+    vout.TexC = mul(texC, gMaterials[gMaterialIndex].MatTransform).xy;
 
     return vout;
 }
@@ -115,9 +140,10 @@ PixelOut PS(VertexOut pin)
 {
 	PixelOut pout;
 	
-    float3 albedo = gAlbedoMap.Sample(gsamLinear, pin.TexC).xyz;
-    float roughness = gRoughnessMap.Sample(gsamLinear, pin.TexC).x;
-    float metalness = gMetalnessMap.Sample(gsamLinear, pin.TexC).x;
+    uint diffuseMapIndex = gMaterials[gMaterialIndex].DiffuseMapIndex;
+    float3 albedo = gTextures[diffuseMapIndex].Sample(gsamLinear, pin.TexC).xyz;
+    float roughness = gTextures[diffuseMapIndex + 1].Sample(gsamLinear, pin.TexC).x;
+    float metalness = gTextures[diffuseMapIndex + 2].Sample(gsamLinear, pin.TexC).x;
 	
 	pout.gbuffer0 = float4(albedo, roughness);
 	pout.gbuffer1 = float4(normalize(pin.NormalW), metalness);
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Ubpa {
+	// [summary]
+	// monotonic clock, in nanoseconds
+	// timing code takes a Clock& so that it can run on a fake clock in tests
+	class Clock {
+	public:
+		virtual ~Clock() = default;
+
+		// monotonic, arbitrary epoch
+		virtual std::int64_t Now() const noexcept = 0;
+		// block the calling thread for about ns, it may oversleep
+		virtual void SleepFor(std::int64_t ns) = 0;
+		// one iteration of a busy-wait loop
+		virtual void Spin() noexcept {}
+
+		static constexpr double ToSeconds(std::int64_t ns) noexcept { return ns * 1e-9; }
+		static constexpr double ToMilliseconds(std::int64_t ns) noexcept { return ns * 1e-6; }
+		static constexpr std::int64_t FromSeconds(double s) noexcept { return static_cast<std::int64_t>(s * 1e9); }
+	};
+
+	// std::chrono::steady_clock
+	class SteadyClock final : public Clock {
+	public:
+		static SteadyClock& Instance() noexcept {
+			static SteadyClock instance;
+			return instance;
+		}
+
+		virtual std::int64_t Now() const noexcept override;
+		virtual void SleepFor(std::int64_t ns) override;
+		virtual void Spin() noexcept override;
+	};
+
+	// [summary]
+	// clock that only moves when told to, for deterministic tests
+	// SleepFor(ns) advances it by ns plus the configured oversleep, Spin() by spinStep
+	class ManualClock final : public Clock {
+	public:
+		explicit ManualClock(std::int64_t start = 0) noexcept : now{ start } {}
+
+		void Advance(std::int64_t ns) noexcept { now += ns; }
+		void SetOversleep(std::int64_t ns) noexcept { oversleep = ns; }
+		void SetSpinStep(std::int64_t ns) noexcept { spinStep = ns; }
+
+		virtual std::int64_t Now() const noexcept override { return now; }
+		virtual void SleepFor(std::int64_t ns) override { now += (ns > 0 ? ns : 0) + oversleep; }
+		virtual void Spin() noexcept override { now += spinStep; }
+
+	private:
+		std::int64_t now;
+		std::int64_t oversleep{ 0 };
+		std::int64_t spinStep{ 1000 };
+	};
+}
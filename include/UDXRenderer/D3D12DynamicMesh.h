@@ -0,0 +1,99 @@
+#pragma once
+
+#include "DirtyRanges.h"
+#include "MemoryTracker.h"
+
+#include <UDX12/UDX12.h>
+
+#include <string>
+#include <vector>
+
+namespace Ubpa {
+	// [summary]
+	// mesh rewritten by the CPU while frames in flight still draw older versions of it
+	// - copyNum copies of the vertex and index buffers in the upload heap, persistently mapped,
+	//   frame i writes and draws copy i % copyNum (e.g. one copy per frame resource)
+	// - the CPU writes into a shadow copy through MapVertices / MapIndices, which marks the range dirty
+	// - Commit() writes into the frame's copy the ranges dirtied in this frame plus the ones other
+	//   frames dirtied since the copy was last used (copied forward lazily, only when the copy is used again)
+	// - ranges are merged before copying (DirtyRanges), untouched ranges are never copied again,
+	//   the source is always the shadow, the write-combined copies are never read
+	// [usage]
+	// mesh.BeginFrame(frameIndex); // once the GPU is done with the frame that used this copy
+	// auto v = static_cast<Vertex*>(mesh.MapVertices(first, num)); write v[0, num)
+	// mesh.Commit(); // before the command lists drawing the mesh execute
+	// cmdList->IASetVertexBuffers(0, 1, &mesh.VertexBufferView());
+	class D3D12DynamicMesh {
+	public:
+		using Range = DirtyRanges::Range;
+
+		struct Stats {
+			size_t commitNum{ 0 };
+			UINT64 dirtyBytes{ 0 };  // mapped by the CPU
+			UINT64 copiedBytes{ 0 }; // written to the copies, dirtyBytes plus the ranges copied forward
+		};
+
+		// [arguments]
+		// - indexFormat: DXGI_FORMAT_R16_UINT or DXGI_FORMAT_R32_UINT
+		// - copyNum: frames that may be in flight (gNumFrameResources)
+		// - memoryTracker: optional, records the copies (Mesh) under name
+		D3D12DynamicMesh(ID3D12Device* device,
+			UINT vertexStride, UINT vertexCapacity,
+			DXGI_FORMAT indexFormat, UINT indexCapacity,
+			UINT copyNum,
+			MemoryTracker* memoryTracker = nullptr, std::string name = {});
+		~D3D12DynamicMesh();
+
+		D3D12DynamicMesh(const D3D12DynamicMesh&) = delete;
+		D3D12DynamicMesh& operator=(const D3D12DynamicMesh&) = delete;
+
+		// selects copy frameIndex % copyNum, the GPU must be done with it
+		void BeginFrame(UINT64 frameIndex);
+
+		// [summary]
+		// writable shadow memory of [first, first + num) (in vertices / indices), the range is dirty
+		// the shadow keeps the rest of the data, map only what changes
+		void* MapVertices(UINT first, UINT num);
+		void* MapIndices(UINT first, UINT num);
+		const void* GetVertices() const noexcept { return vertexShadow.data(); }
+		const void* GetIndices() const noexcept { return indexShadow.data(); }
+
+		// brings the current copy up to date
+		void Commit();
+
+		// of the current copy
+		D3D12_VERTEX_BUFFER_VIEW VertexBufferView() const noexcept;
+		D3D12_INDEX_BUFFER_VIEW IndexBufferView() const noexcept;
+
+		UINT GetVertexStride() const noexcept { return vertexStride; }
+		DXGI_FORMAT GetIndexFormat() const noexcept { return indexFormat; }
+		UINT GetVertexCapacity() const noexcept { return vertexCapacity; }
+		UINT GetIndexCapacity() const noexcept { return indexCapacity; }
+		UINT GetCopyNum() const noexcept { return static_cast<UINT>(copies.size()); }
+		const Stats& GetStats() const noexcept { return stats; }
+
+	private:
+		struct Copy {
+			ID3D12Resource* buffer;
+			BYTE* data;
+		};
+
+		UINT vertexStride;
+		DXGI_FORMAT indexFormat;
+		UINT indexStride;
+		UINT vertexCapacity;
+		UINT indexCapacity;
+		UINT64 indexByteOffset; // of the indices in each copy
+
+		std::vector<BYTE> vertexShadow;
+		std::vector<BYTE> indexShadow;
+		std::vector<Copy> copies;
+		size_t current{ 0 };
+		DirtyRanges vertexRanges;
+		DirtyRanges indexRanges;
+
+		Stats stats;
+		MemoryTracker* memoryTracker;
+		std::string name;
+	};
+}
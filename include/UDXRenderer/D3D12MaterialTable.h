@@ -0,0 +1,56 @@
+#pragma once
+
+#include "MaterialTable.h"
+#include "MemoryTracker.h"
+
+#include <UDX12/UDX12.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Ubpa {
+	// [summary]
+	// MaterialTable with one StructuredBuffer per frame resource in the upload heap
+	// - bind the frame's buffer once per pass as a root SRV, draws index it with their material ID
+	// - the layout of a template comes from the reflection of the shader declaring the buffer
+	// [usage]
+	// auto layout = D3D12MaterialTable::Reflect(psByteCode, "gMaterials");
+	// D3D12MaterialTable materials(device, layout, 256, gNumFrameResources);
+	// each frame: materials.Upload(frameIndex);
+	//   cmdList->SetGraphicsRootShaderResourceView(slot, materials.GetGpuAddress(frameIndex));
+	class D3D12MaterialTable {
+	public:
+		// [summary]
+		// layout of the elements of StructuredBuffer<T> bufferName, members of T by their HLSL name
+		// throws (E_INVALIDARG) if the shader has no such buffer or T has members of other types
+		static MaterialTable::Layout Reflect(ID3DBlob* shader, std::string_view bufferName);
+
+		// memoryTracker: optional, records the buffers (Upload) under name
+		D3D12MaterialTable(ID3D12Device* device, MaterialTable::Layout layout,
+			std::uint32_t capacity, std::uint32_t frameNum,
+			MemoryTracker* memoryTracker = nullptr, std::string name = {});
+		~D3D12MaterialTable();
+
+		D3D12MaterialTable(const D3D12MaterialTable&) = delete;
+		D3D12MaterialTable& operator=(const D3D12MaterialTable&) = delete;
+
+		MaterialTable& GetTable() noexcept { return table; }
+		const MaterialTable& GetTable() const noexcept { return table; }
+
+		// the dirty materials of frame into its buffer, the GPU must be done with the frame
+		// returns the bytes copied
+		size_t Upload(std::uint32_t frame);
+		D3D12_GPU_VIRTUAL_ADDRESS GetGpuAddress(std::uint32_t frame) const noexcept;
+
+	private:
+		struct Buffer {
+			ID3D12Resource* resource;
+			void* data;
+		};
+
+		MaterialTable table;
+		std::vector<Buffer> buffers; // [frame]
+		MemoryTracker* memoryTracker;
+	};
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include "D3D12TransferEngine.h"
+#include "MemoryTracker.h"
+#include "OffsetAllocator.h"
+#include "RetireQueue.h"
+
+#include <UDX12/UDX12.h>
+
+#include <string>
+#include <vector>
+
+namespace Ubpa {
+	// [summary]
+	// one large vertex buffer and one large index buffer shared by many meshes
+	// - meshes are ranges suballocated by OffsetAllocator (in vertices and indices),
+	//   drawn with BaseVertexLocation / StartIndexLocation after a single VB/IB bind
+	// - the buffers stay in D3D12_RESOURCE_STATE_COMMON and rely on implicit promotion,
+	//   so uploads must execute in a command list before the ones drawing the mesh
+	// - a mesh may hold submeshes, draw ranges inside its own ranges sharing the same binding
+	// [usage]
+	// auto mesh = pool.Register(cmdList, retireQueue, fence, vertices, vertexNum, indices, indexNum);
+	// cmdList->IASetVertexBuffers(0, 1, &pool.VertexBufferView()); // once for every mesh of the pool
+	// cmdList->IASetIndexBuffer(&pool.IndexBufferView());
+	// cmdList->DrawIndexedInstanced(mesh.indexNum, 1, mesh.StartIndexLocation(), mesh.BaseVertexLocation(), 0);
+	// for (const auto& submesh : mesh.submeshes)
+	//     cmdList->DrawIndexedInstanced(submesh.indexNum, 1,
+	//         mesh.StartIndexLocation(submesh), mesh.BaseVertexLocation(submesh), 0);
+	class D3D12MeshPool {
+	public:
+		// draw range of a mesh, relative to the mesh's vertices and indices
+		struct Submesh {
+			UINT indexNum{ 0 };
+			UINT startIndex{ 0 };
+			UINT baseVertex{ 0 };
+		};
+
+		struct Mesh {
+			OffsetAllocator::Allocation vertices;
+			OffsetAllocator::Allocation indices;
+			UINT vertexNum{ 0 };
+			UINT indexNum{ 0 };
+			std::vector<Submesh> submeshes; // empty if the mesh is drawn as a whole
+
+			bool IsNull() const noexcept { return vertices.IsNull(); }
+			INT BaseVertexLocation() const noexcept { return static_cast<INT>(vertices.offset); }
+			UINT StartIndexLocation() const noexcept { return indices.offset; }
+			INT BaseVertexLocation(const Submesh& submesh) const noexcept {
+				return static_cast<INT>(vertices.offset + submesh.baseVertex);
+			}
+			UINT StartIndexLocation(const Submesh& submesh) const noexcept { return indices.offset + submesh.startIndex; }
+		};
+
+		struct Stats {
+			OffsetAllocator::Stats vertices;
+			OffsetAllocator::Stats indices;
+			UINT meshNum{ 0 };
+		};
+
+		// [arguments]
+		// - indexFormat: DXGI_FORMAT_R16_UINT or DXGI_FORMAT_R32_UINT
+		// - memoryTracker: optional, records the buffers (Mesh) and the staging buffers (Upload) under name
+		// throws (E_INVALIDARG) if a buffer would exceed 4 GB, the views size them in UINT
+		D3D12MeshPool(ID3D12Device* device,
+			UINT vertexStride, UINT vertexCapacity,
+			DXGI_FORMAT indexFormat, UINT indexCapacity,
+			MemoryTracker* memoryTracker = nullptr, std::string name = {});
+		~D3D12MeshPool();
+
+		D3D12MeshPool(const D3D12MeshPool&) = delete;
+		D3D12MeshPool& operator=(const D3D12MeshPool&) = delete;
+
+		// [summary]
+		// suballocate a mesh and record the copy of its data into cmdList
+		// the staging buffer is retired with fence (the value signaled after cmdList executes)
+		// returns a null mesh if the pool is full
+		// submeshes: optional, copied into the mesh, each must lie in [0, indexNum) and [0, vertexNum)
+		Mesh Register(ID3D12GraphicsCommandList* cmdList, RetireQueue& retireQueue, UINT64 fence,
+			const void* vertices, UINT vertexNum, const void* indices, UINT indexNum,
+			const Submesh* submeshes = nullptr, UINT submeshNum = 0);
+		// [summary]
+		// the copy goes through the copy queue of transfer, with its staging ring
+		// ticket: complete it before the mesh is drawn
+		Mesh Register(D3D12TransferEngine& transfer,
+			const void* vertices, UINT vertexNum, const void* indices, UINT indexNum,
+			D3D12TransferEngine::Ticket& ticket,
+			const Submesh* submeshes = nullptr, UINT submeshNum = 0);
+		// the ranges are reused at once, retire the call if frames in flight still draw the mesh
+		void Unregister(const Mesh& mesh);
+
+		D3D12_VERTEX_BUFFER_VIEW VertexBufferView() const noexcept;
+		D3D12_INDEX_BUFFER_VIEW IndexBufferView() const noexcept;
+
+		UINT GetVertexStride() const noexcept { return vertexStride; }
+		DXGI_FORMAT GetIndexFormat() const noexcept { return indexFormat; }
+		Stats GetStats() const;
+
+	private:
+		// null if the pool is full
+		Mesh Allocate(UINT vertexNum, UINT indexNum, const Submesh* submeshes, UINT submeshNum);
+
+		ID3D12Device* device;
+		UINT vertexStride;
+		DXGI_FORMAT indexFormat;
+		UINT indexStride;
+
+		ID3D12Resource* vertexBuffer{ nullptr };
+		ID3D12Resource* indexBuffer{ nullptr };
+		UINT vertexCapacity;
+		UINT indexCapacity;
+
+		OffsetAllocator vertexAllocator;
+		OffsetAllocator indexAllocator;
+		UINT meshNum{ 0 };
+
+		MemoryTracker* memoryTracker;
+		std::string name;
+	};
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <UDX12/UDX12.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <unordered_map>
+#include <vector>
+
+namespace Ubpa {
+	// [summary]
+	// root signatures deduplicated by their serialized blob
+	// - descs are serialized (versioned ones up to the highest version the device supports),
+	//   blobs are keyed by a 64-bit FNV-1a hash and compared byte by byte,
+	//   an identical blob returns the root signature created for the first one
+	// - the blobs can be saved to a file, loading it creates their root signatures up front;
+	//   only the blobs requested since construction / Clear() are saved, loaded ones nobody asked for
+	//   (e.g. of a shader that changed since) drop out of the file
+	// - holds one reference of each root signature until Clear() / destruction
+	// [usage]
+	// D3D12RootSignatureCache cache(device);
+	// cache.Load(path); // optional, warms the cache
+	// ID3D12RootSignature* rootSig = cache.Create(desc); // a new reference, Release() it
+	// cache.Save(path);
+	class D3D12RootSignatureCache {
+	public:
+		struct Stats {
+			size_t requestNum{ 0 };
+			size_t hitNum{ 0 };           // requests that returned an existing root signature
+			size_t rootSignatureNum{ 0 }; // distinct blobs
+			size_t loadedNum{ 0 };        // created by Load()
+			size_t usedNum{ 0 };          // distinct blobs requested, what Save() writes
+		};
+
+		static std::uint64_t Hash(const void* data, size_t size) noexcept;
+
+		explicit D3D12RootSignatureCache(ID3D12Device* device);
+		~D3D12RootSignatureCache();
+
+		D3D12RootSignatureCache(const D3D12RootSignatureCache&) = delete;
+		D3D12RootSignatureCache& operator=(const D3D12RootSignatureCache&) = delete;
+
+		// 1.1 if the device supports it, else 1.0 (1.1 descs are converted)
+		D3D_ROOT_SIGNATURE_VERSION GetHighestVersion() const noexcept { return highestVersion; }
+
+		// [summary]
+		// returns a new reference of the root signature of the desc / blob
+		// throws if the desc can't be serialized (the error is sent to OutputDebugString) or created
+		ID3D12RootSignature* Create(const D3D12_VERSIONED_ROOT_SIGNATURE_DESC& desc);
+		ID3D12RootSignature* Create(const D3D12_ROOT_SIGNATURE_DESC& desc);
+		ID3D12RootSignature* Create(const void* blob, size_t size);
+
+		// [summary]
+		// file: magic, format version, blob number, then each blob's size and bytes
+		// Save writes the blobs of this session: requested through Create(), loaded or not
+		// Load skips the blobs the device rejects (e.g. another root signature version),
+		// returns false if the file can't be read or isn't a cache file of this format
+		bool Save(const std::filesystem::path& path) const;
+		bool Load(const std::filesystem::path& path);
+
+		// releases the cache's references, root signatures referenced elsewhere live on
+		void Clear();
+
+		const Stats& GetStats() const noexcept { return stats; }
+
+	private:
+		struct Entry {
+			std::vector<std::uint8_t> blob;
+			ID3D12RootSignature* rootSignature;
+			bool used; // requested through Create()
+		};
+
+		// the entry of the blob, nullptr (and hr) if the device rejects it
+		// valid until the next entry is created
+		Entry* FindOrCreate(const void* blob, size_t size, bool& hit, HRESULT& hr);
+
+		ID3D12Device* device;
+		D3D_ROOT_SIGNATURE_VERSION highestVersion;
+		std::vector<Entry> entries; // in creation order
+		std::unordered_multimap<std::uint64_t, size_t> entryMap; // Hash(blob) -> entry
+		Stats stats;
+	};
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "ShaderBindingLayout.h"
+
+#include <UDX12/UDX12.h>
+
+#include <vector>
+
+namespace Ubpa {
+	// [summary]
+	// D3D12 side of ShaderBindingLayout
+	// - Reflect: the resource bindings of compiled shader bytecode (D3DReflect)
+	// - the root signature desc (1.1) of a layout, kept alive by the object
+	//   unbounded tables have volatile descriptors, everything else uses the 1.1 defaults
+	// [usage]
+	// std::vector<ShaderBindingLayout::Binding> stages[] = {
+	//   D3D12ShaderBindingLayout::Reflect(vs), D3D12ShaderBindingLayout::Reflect(ps) };
+	// ShaderBindingLayout layout;
+	// layout.Build(stages, 2);
+	// D3D12ShaderBindingLayout desc(layout, staticSamplers, flags);
+	// D3D12RootSignatureCache::Create(desc.GetDesc())
+	class D3D12ShaderBindingLayout {
+	public:
+		// [summary]
+		// bindings the shader uses, visible to its stage (All for compute shaders)
+		// throws if the bytecode can't be reflected
+		static std::vector<ShaderBindingLayout::Binding> Reflect(ID3DBlob* shader);
+
+		// staticSamplers[i]: the desc of static sampler s<i>, at least layout.GetStaticSamplers() registers
+		D3D12ShaderBindingLayout(const ShaderBindingLayout& layout,
+			const D3D12_STATIC_SAMPLER_DESC* staticSamplers, D3D12_ROOT_SIGNATURE_FLAGS flags);
+
+		// points into this object
+		D3D12ShaderBindingLayout(const D3D12ShaderBindingLayout&) = delete;
+		D3D12ShaderBindingLayout& operator=(const D3D12ShaderBindingLayout&) = delete;
+
+		const D3D12_VERSIONED_ROOT_SIGNATURE_DESC& GetDesc() const noexcept { return desc; }
+
+	private:
+		std::vector<std::vector<CD3DX12_DESCRIPTOR_RANGE1>> ranges; // [param]
+		std::vector<CD3DX12_ROOT_PARAMETER1> params;
+		std::vector<D3D12_STATIC_SAMPLER_DESC> staticSamplers;
+		CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC desc;
+	};
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "FileWatcher.h"
+#include "ShaderDependencyGraph.h"
+
+#include <UDX12/UDX12.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace Ubpa {
+	// [summary]
+	// recompiles shaders whose source files change, on a background thread
+	// - the thread polls the files of a ShaderDependencyGraph (FileWatcher) every pollInterval,
+	//   a change recompiles only the shaders whose file or includes changed,
+	//   files no shader includes any more are no longer polled
+	// - a failed compile keeps the old bytecode, the errors are sent to OutputDebugString
+	// - the new bytecode waits in a queue until TakeResults(), the caller swaps it in at a frame boundary
+	// - thread-safe
+	// [usage]
+	// hotReload.AddShader("deferLightingPS", { L"deferLighting.hlsl", {}, "PS", "ps_5_0" });
+	// each frame: for (auto& [name, shader] : hotReload.TakeResults()) replace name's bytecode with shader
+	class D3D12ShaderHotReload {
+	public:
+		struct Source {
+			std::wstring filename;
+			std::vector<std::pair<std::string, std::string>> defines; // name, definition
+			std::string entrypoint;
+			std::string target;
+		};
+
+		struct Result {
+			std::string name;
+			ID3DBlob* shader; // the caller owns the reference
+		};
+
+		struct Stats {
+			size_t changeNum{ 0 };  // file changes seen
+			size_t compileNum{ 0 };
+			size_t failNum{ 0 };    // compiles that failed
+			size_t fileNum{ 0 };    // watched
+		};
+
+		// compile flags of UDX12::Util::CompileShader (debug info without optimization in debug builds)
+		static ID3DBlob* Compile(const Source& source, HRESULT& hr);
+
+		explicit D3D12ShaderHotReload(std::chrono::milliseconds pollInterval = std::chrono::milliseconds{ 250 });
+		// stops the thread, releases the results not taken
+		~D3D12ShaderHotReload();
+
+		D3D12ShaderHotReload(const D3D12ShaderHotReload&) = delete;
+		D3D12ShaderHotReload& operator=(const D3D12ShaderHotReload&) = delete;
+
+		// the source was just compiled, its file and includes are watched from now on
+		void AddShader(std::string name, Source source);
+		void RemoveShader(const std::string& name);
+
+		// recompiled since the last call, the latest bytecode of each shader
+		std::vector<Result> TakeResults();
+
+		Stats GetStats() const;
+
+	private:
+		void Run();
+		// watches the graph's new files, unwatches the ones it dropped since before
+		void UpdateWatches(const std::vector<std::filesystem::path>& before);
+
+		std::chrono::milliseconds pollInterval;
+
+		mutable std::mutex mutex;
+		std::condition_variable stopCV;
+		bool stop{ false };
+		ShaderDependencyGraph graph;
+		FileWatcher watcher;
+		std::unordered_map<std::string, Source> sources;
+		std::vector<Result> results;
+		Stats stats;
+
+		std::thread worker; // last, started once the members above exist
+	};
+}
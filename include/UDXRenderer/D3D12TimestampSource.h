@@ -0,0 +1,36 @@
+#pragma once
+
+#include "GpuProfiler.h"
+
+#include <UDX12/UDX12.h>
+
+namespace Ubpa {
+	// [summary]
+	// GpuProfiler::QuerySource on a D3D12 timestamp query heap
+	// one query heap and one readback buffer, both split into slotNum slots (frame resources)
+	// timestamps and resolves are recorded into the command list set by SetCommandList()
+	class D3D12TimestampSource final : public GpuProfiler::QuerySource {
+	public:
+		// queue: the queue the profiled command lists execute on (direct or compute)
+		D3D12TimestampSource(ID3D12Device* device, ID3D12CommandQueue* queue,
+			size_t slotNum, size_t queriesPerSlot = 64);
+		~D3D12TimestampSource();
+
+		// the command list recording the current frame, set before GpuProfiler::BeginFrame()
+		void SetCommandList(ID3D12GraphicsCommandList* cmdList) noexcept { this->cmdList = cmdList; }
+
+		virtual size_t GetQueryCapacity() const override { return queriesPerSlot; }
+		virtual std::uint64_t GetFrequency() const override { return frequency; }
+		virtual void WriteTimestamp(size_t slot, size_t query) override;
+		virtual void Resolve(size_t slot, size_t queryNum) override;
+		virtual void ReadBack(size_t slot, size_t queryNum, std::uint64_t* ticks) override;
+
+	private:
+		ID3D12QueryHeap* queryHeap{ nullptr };
+		ID3D12Resource* readback{ nullptr };
+		ID3D12GraphicsCommandList* cmdList{ nullptr };
+		size_t slotNum;
+		size_t queriesPerSlot;
+		std::uint64_t frequency{ 1 };
+	};
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "FrameLinearAllocator.h"
+#include "MemoryTracker.h"
+
+#include <UDX12/UDX12.h>
+
+#include <deque>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace Ubpa {
+	// [summary]
+	// uploads on a dedicated copy queue, the direct queue is never flushed for them
+	// - the data is copied at once into a persistent, mapped staging ring (FrameLinearAllocator in bytes),
+	//   a request larger than the ring gets its own staging buffer
+	// - requests are recorded into one copy command list and executed together by Submit(),
+	//   the ring ranges of a submission are reused once its fence completes
+	// - every request returns a ticket, the copy fence value of the submission carrying it;
+	//   poll it (IsComplete) or make another queue wait for it on the GPU (QueueWait)
+	// - destinations are used in the COMMON state: buffers and textures created in COMMON
+	//   (or COPY_DEST) are promoted on the copy queue and decay back to COMMON once the copy is done,
+	//   then the direct queue promotes them to their read state, no barriers are needed
+	// - when the ring is full, the oldest submissions are waited for on the CPU (counted in Stats)
+	// - thread-safe
+	// [usage]
+	// auto ticket = transfer.UploadBuffer(buffer, offset, data, size);
+	// transfer.Submit(); // once per frame, after the frame's requests
+	// if (transfer.IsComplete(ticket)) ... or transfer.QueueWait(directQueue, ticket);
+	class D3D12TransferEngine {
+	public:
+		using Ticket = UINT64;
+
+		struct Stats {
+			size_t submitNum{ 0 };
+			size_t requestNum{ 0 };
+			UINT64 uploadedBytes{ 0 };
+			size_t stallNum{ 0 };     // CPU waits for ring space
+			size_t dedicatedNum{ 0 }; // requests larger than the ring
+			UINT64 ringCapacity{ 0 };
+			UINT64 ringUsedBytes{ 0 };
+			UINT64 ringPeakBytes{ 0 };
+		};
+
+		// [arguments]
+		// - stagingSize: bytes of the staging ring
+		// - memoryTracker: optional, records the staging buffers (Upload)
+		D3D12TransferEngine(ID3D12Device* device, UINT64 stagingSize = 64ull << 20,
+			MemoryTracker* memoryTracker = nullptr);
+		// waits for the submitted copies
+		~D3D12TransferEngine();
+
+		D3D12TransferEngine(const D3D12TransferEngine&) = delete;
+		D3D12TransferEngine& operator=(const D3D12TransferEngine&) = delete;
+
+		// the data is copied before the call returns
+		Ticket UploadBuffer(ID3D12Resource* dst, UINT64 dstOffset, const void* data, UINT64 size);
+		// subresources [firstSubresource, firstSubresource + num) of dst,
+		// e.g. the subresources of DirectX::LoadDDSTextureFromMemory
+		Ticket UploadTexture(ID3D12Resource* dst, UINT firstSubresource,
+			const D3D12_SUBRESOURCE_DATA* subresources, UINT num);
+
+		// executes the requests recorded so far in one command list,
+		// returns the ticket of the submission (the last one if there was nothing to submit)
+		Ticket Submit();
+		// the ticket of the requests recorded so far,
+		// the last submission's if nothing is recording
+		Ticket GetRecordingTicket() const;
+
+		bool IsComplete(Ticket ticket) const;
+		Ticket GetCompletedTicket() const;
+		// GPU-side wait of waitingQueue, submits first if the ticket is still recording
+		void QueueWait(ID3D12CommandQueue* waitingQueue, Ticket ticket);
+		// CPU-side wait, submits first if the ticket is still recording
+		void Wait(Ticket ticket);
+		void WaitIdle();
+
+		ID3D12CommandQueue* GetQueue() const noexcept { return queue; }
+		ID3D12Fence* GetFence() const noexcept { return fence; }
+		Stats GetStats() const;
+
+	private:
+		struct Staging {
+			ID3D12Resource* buffer;
+			UINT64 offset;
+			BYTE* data; // mapped address of offset
+		};
+
+		struct InFlight {
+			Ticket ticket;
+			ID3D12CommandAllocator* allocator;
+		};
+
+		// space for size bytes, recording started
+		Staging Stage(UINT64 size, UINT64 alignment);
+		void BeginRecording();
+		Ticket SubmitLocked();
+		void Reclaim();
+		void WaitLocked(Ticket ticket);
+
+		ID3D12Device* device;
+		MemoryTracker* memoryTracker;
+
+		ID3D12CommandQueue* queue{ nullptr };
+		ID3D12Fence* fence{ nullptr };
+		ID3D12GraphicsCommandList* cmdList{ nullptr };
+		std::vector<ID3D12CommandAllocator*> freeAllocators;
+		std::deque<InFlight> inFlights;
+		ID3D12CommandAllocator* allocator{ nullptr }; // recording with it if not null
+		Ticket submittedTicket{ 0 };
+
+		ID3D12Resource* ring{ nullptr };
+		BYTE* ringData{ nullptr };
+		FrameLinearAllocator ringAllocator;
+		// dedicated staging buffers, released with their ticket
+		std::deque<std::pair<Ticket, ID3D12Resource*>> dedicated;
+
+		mutable std::mutex m;
+		Stats stats;
+	};
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "FrameLinearAllocator.h"
+#include "MemoryTracker.h"
+
+#include <UDX12/UDX12.h>
+
+namespace Ubpa {
+	// [summary]
+	// per-frame descriptors carved out of UDX12::DescriptorHeapMngr, retired by fence
+	// - CBV_SRV_UAV: a range of the shader-visible CSU heap, tables can be bound directly
+	// - RTV: a range of the RTV heap (CPU only)
+	// - transient tables never touch the persistent allocators, so per-frame churn does not fragment them
+	// [usage]
+	// heap.Reclaim(fence->GetCompletedValue()); // frame begin
+	// auto table = heap.Stage(srcs, 3);          // or Allocate(3) + Create*View(table.GetCpuHandle(i))
+	// cmdList->SetGraphicsRootDescriptorTable(0, table.GetGpuHandle());
+	// heap.EndFrame(fenceValue);                 // after queue->Signal(fence, fenceValue)
+	class D3D12TransientDescriptorHeap {
+	public:
+		struct Table {
+			D3D12_CPU_DESCRIPTOR_HANDLE cpuHandle{ 0 };
+			D3D12_GPU_DESCRIPTOR_HANDLE gpuHandle{ 0 };
+			UINT num{ 0 };
+			UINT descriptorSize{ 0 };
+
+			D3D12_CPU_DESCRIPTOR_HANDLE GetCpuHandle(UINT index = 0) const noexcept {
+				return { cpuHandle.ptr + static_cast<SIZE_T>(index) * descriptorSize };
+			}
+			// only for CBV_SRV_UAV
+			D3D12_GPU_DESCRIPTOR_HANDLE GetGpuHandle(UINT index = 0) const noexcept {
+				return { gpuHandle.ptr + static_cast<UINT64>(index) * descriptorSize };
+			}
+		};
+
+		// [arguments]
+		// - type: D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV or D3D12_DESCRIPTOR_HEAP_TYPE_RTV
+		// - memoryTracker: optional, records the range (DescriptorHeap) under name
+		D3D12TransientDescriptorHeap(ID3D12Device* device, D3D12_DESCRIPTOR_HEAP_TYPE type, UINT capacity,
+			MemoryTracker* memoryTracker = nullptr, std::string name = {});
+		~D3D12TransientDescriptorHeap();
+
+		D3D12TransientDescriptorHeap(const D3D12TransientDescriptorHeap&) = delete;
+		D3D12TransientDescriptorHeap& operator=(const D3D12TransientDescriptorHeap&) = delete;
+
+		// num contiguous descriptors, valid until the fence of this frame completes
+		// throws (E_OUTOFMEMORY) if the frames in flight use the whole capacity
+		Table Allocate(UINT num);
+
+		// [summary]
+		// copy descriptors from CPU-only heaps into one contiguous table with a single CopyDescriptors
+		// [arguments]
+		// - srcs: num descriptors, one each
+		Table Stage(const D3D12_CPU_DESCRIPTOR_HANDLE* srcs, UINT num);
+		// - srcRangeStarts, srcRangeSizes: rangeNum ranges, concatenated in the table
+		Table Stage(const D3D12_CPU_DESCRIPTOR_HANDLE* srcRangeStarts, const UINT* srcRangeSizes, UINT rangeNum);
+
+		void EndFrame(UINT64 fence) { ring.EndFrame(fence); }
+		void Reclaim(UINT64 completedFence) { ring.Reclaim(completedFence); }
+
+		UINT GetCapacity() const noexcept { return static_cast<UINT>(ring.GetCapacity()); }
+		UINT GetUsedNum() const noexcept { return static_cast<UINT>(ring.GetUsedNum()); }
+		UINT GetPeakUsedNum() const noexcept { return static_cast<UINT>(ring.GetPeakUsedNum()); }
+
+	private:
+		ID3D12Device* device;
+		D3D12_DESCRIPTOR_HEAP_TYPE type;
+		UINT descriptorSize;
+		UDX12::DescriptorHeapAllocation allocation;
+		FrameLinearAllocator ring;
+		MemoryTracker* memoryTracker;
+	};
+}
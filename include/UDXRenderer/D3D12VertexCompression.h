@@ -0,0 +1,35 @@
+#pragma once
+
+#include "VertexCompression.h"
+
+#include <UDX12/UDX12.h>
+
+#include <cassert>
+
+namespace Ubpa::VertexCompression {
+	inline DXGI_FORMAT ToDXGIFormat(ElementFormat format) noexcept {
+		switch (format) {
+		case ElementFormat::Float2: return DXGI_FORMAT_R32G32_FLOAT;
+		case ElementFormat::Float3: return DXGI_FORMAT_R32G32B32_FLOAT;
+		case ElementFormat::Unorm16x4: return DXGI_FORMAT_R16G16B16A16_UNORM;
+		case ElementFormat::Snorm8x2: return DXGI_FORMAT_R8G8_SNORM;
+		case ElementFormat::Snorm8x4: return DXGI_FORMAT_R8G8B8A8_SNORM;
+		case ElementFormat::Snorm16x2: return DXGI_FORMAT_R16G16_SNORM;
+		case ElementFormat::Snorm16x4: return DXGI_FORMAT_R16G16B16A16_SNORM;
+		case ElementFormat::Half2: return DXGI_FORMAT_R16G16_FLOAT;
+		default: assert(false); return DXGI_FORMAT_UNKNOWN;
+		}
+	}
+
+	// slot 0, per-vertex data
+	// the semantic names point to string literals, the result may outlive the layout
+	inline std::vector<D3D12_INPUT_ELEMENT_DESC> ToD3D12InputLayout(const Layout& layout) {
+		std::vector<D3D12_INPUT_ELEMENT_DESC> rst;
+		rst.reserve(layout.elements.size());
+		for (const auto& e : layout.elements) {
+			rst.push_back({ e.semantic, 0, ToDXGIFormat(e.format), 0, e.offset,
+				D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 });
+		}
+		return rst;
+	}
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Ubpa {
+	// [summary]
+	// thread-safe, growable allocator of contiguous descriptor ranges
+	// - works on indices only, the owner maps (page, offset) to heaps,
+	//   so it can be used (and tested) without a device
+	// - the space is split into pages of pageSize descriptors, new pages are added on demand
+	//   through the onNewPage callback (e.g. create a CPU-only heap, reserve shader-visible space)
+	// - every page has its own lock and free list; threads start searching at different pages,
+	//   so concurrent allocations rarely contend
+	// - a range never crosses pages, so num <= pageSize
+	// - pages are kept until destruction; growth stops at maxPageNum, or earlier when onNewPage
+	//   refuses (e.g. the fixed shader-visible heap behind the pages is full)
+	class DescriptorAllocator {
+	public:
+		struct Allocation {
+			std::uint32_t page{ static_cast<std::uint32_t>(-1) };
+			std::uint32_t offset{ 0 };
+			std::uint32_t num{ 0 };
+
+			bool IsNull() const noexcept { return num == 0; }
+		};
+
+		struct Stats {
+			std::uint32_t pageNum{ 0 };
+			std::uint64_t capacity{ 0 };     // pageNum * pageSize
+			std::uint64_t liveNum{ 0 };      // allocated descriptors
+			std::uint64_t freeNum{ 0 };      // capacity - liveNum
+			std::uint64_t allocationNum{ 0 };
+			std::uint32_t freeRangeNum{ 0 };
+			std::uint32_t largestFreeRange{ 0 };
+			// 1 - (sum of the largest free range of every page) / freeNum
+			// 0 when the free space of every page is one range
+			double fragmentation{ 0. };
+		};
+
+		// onNewPage(page) is called before page is used, return false to refuse growth
+		// it runs under the growth lock, never concurrently with itself
+		DescriptorAllocator(std::uint32_t pageSize, std::uint32_t maxPageNum,
+			std::function<bool(std::uint32_t page)> onNewPage = {});
+		~DescriptorAllocator();
+
+		DescriptorAllocator(const DescriptorAllocator&) = delete;
+		DescriptorAllocator& operator=(const DescriptorAllocator&) = delete;
+
+		// thread-safe, returns a null allocation if num > pageSize or no page can be added
+		Allocation Allocate(std::uint32_t num);
+		// thread-safe
+		void Free(const Allocation& allocation);
+
+		std::uint32_t GetPageSize() const noexcept { return pageSize; }
+		std::uint32_t GetPageNum() const noexcept { return pageNum.load(std::memory_order_acquire); }
+		std::uint32_t GetMaxPageNum() const noexcept { return maxPageNum; }
+
+		// thread-safe, locks every page in turn
+		Stats GetStats() const;
+
+	private:
+		struct Page;
+
+		bool TryAllocate(std::uint32_t page, std::uint32_t num, Allocation& rst, bool wait);
+
+		std::uint32_t pageSize;
+		std::uint32_t maxPageNum;
+		std::function<bool(std::uint32_t)> onNewPage;
+
+		std::unique_ptr<std::unique_ptr<Page>[]> pages; // maxPageNum slots, never reallocated
+		std::atomic<std::uint32_t> pageNum{ 0 };
+		std::mutex growMutex;
+	};
+}
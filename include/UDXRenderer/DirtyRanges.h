@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Ubpa {
+	// [summary]
+	// dirty ranges of an array kept in copyNum copies, each copy written only when it is used
+	// - Add() marks the elements the CPU changed in this frame
+	// - Commit(copy) returns what copy is missing: this frame's ranges plus the ones earlier commits
+	//   forwarded to it, then forwards this frame's ranges to every other copy
+	// - ranges are sorted and merged (overlapping and adjacent ones), nothing is listed twice
+	// pure std, the owner copies the elements (see D3D12DynamicMesh)
+	// [usage]
+	// ranges.Add(first, num); write the shadow
+	// for (auto range : ranges.Commit(frameIndex % copyNum)) copy [range.first, range.first + range.num)
+	class DirtyRanges {
+	public:
+		struct Range {
+			std::uint32_t first;
+			std::uint32_t num;
+		};
+
+		explicit DirtyRanges(size_t copyNum);
+
+		// num == 0 is ignored
+		void Add(std::uint32_t first, std::uint32_t num);
+		// elements added since the last Commit(), counted once
+		std::uint64_t GetDirtyNum();
+
+		// valid until the next Commit()
+		const std::vector<Range>& Commit(size_t copy);
+
+		// forwarded to copy by other commits, not written yet
+		const std::vector<Range>& GetPending(size_t copy) const { return pendings[copy]; }
+		size_t GetCopyNum() const noexcept { return pendings.size(); }
+
+		// sorts by first, merges overlapping and adjacent ranges
+		static void Coalesce(std::vector<Range>& ranges);
+
+	private:
+		std::vector<Range> dirty; // of this frame
+		std::vector<std::vector<Range>> pendings;
+		std::vector<Range> committed;
+	};
+}
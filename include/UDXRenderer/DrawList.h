@@ -0,0 +1,128 @@
+#pragma once
+
+#include "LodSelector.h"
+#include "MeshSimplifier.h"
+#include "Meshlets.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Ubpa {
+	// [summary]
+	// receives the draws of DrawList::Record
+	// - D3D12: an adapter over the command list (see DeferApp), without a GPU: StubDrawDevice
+	class DrawDevice {
+	public:
+		virtual ~DrawDevice() = default;
+
+		// bind the vertex / index buffers of item, called when they differ from those of the previous item
+		virtual void SetBuffers(size_t item) = 0;
+		// per-item state (object constants), before the draws of item
+		virtual void SetItem(size_t item) = 0;
+		virtual void DrawIndexed(std::uint32_t indexNum, std::uint32_t startIndex, std::int32_t baseVertex) = 0;
+	};
+
+	// [summary]
+	// a device that only counts the calls, so the CPU stages of a frame run without a GPU
+	// (headless CPU benchmark, CI on Linux)
+	class StubDrawDevice final : public DrawDevice {
+	public:
+		struct Stats {
+			size_t bufferBindNum{ 0 };
+			size_t itemNum{ 0 };
+			size_t drawNum{ 0 };
+			size_t indexNum{ 0 };
+		};
+
+		void SetBuffers(size_t) override { stats.bufferBindNum++; }
+		void SetItem(size_t) override { stats.itemNum++; }
+		void DrawIndexed(std::uint32_t indexNum, std::uint32_t, std::int32_t) override {
+			stats.drawNum++;
+			stats.indexNum += indexNum;
+		}
+
+		const Stats& GetStats() const noexcept { return stats; }
+		void Reset() noexcept { stats = {}; }
+
+	private:
+		Stats stats;
+	};
+
+	// [summary]
+	// CPU stages of the opaque draws of a frame, shared by DeferApp and the headless CPU benchmark
+	// - Cull: one pass over the items, LOD selection and meshlet frustum / backface culling
+	// - Sort: items sharing buffers stay together, each run front to back
+	// - Record: the draws into a DrawDevice, buffers are bound once per run and
+	//   consecutive visible meshlets are drawn as one index range
+	// pure std, matrices are row-major for row vectors (p * m, DirectXMath)
+	// [usage]
+	// auto id = list.Add(item); // ids are dense, in the order of Add
+	// list.Cull(view, proj, eye, viewportHeight); // every frame
+	// list.Sort(view);
+	// list.Record(device);
+	class DrawList {
+	public:
+		struct Item {
+			const void* buffers{ nullptr }; // identity of the vertex / index buffers (e.g. the mesh pool)
+			float world[16]{ 1.f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 0.f, 1.f };
+			// bounding sphere in object space
+			float center[3]{ 0.f, 0.f, 0.f };
+			float radius{ 0.f };
+			// LOD 0: [startIndex, startIndex + indexNum)
+			std::uint32_t indexNum{ 0 };
+			std::uint32_t startIndex{ 0 };
+			std::int32_t baseVertex{ 0 };
+			// (optional) LOD i > 0: [startIndex + lods[i].indexOffset, + lods[i].indexNum)
+			const MeshSimplifier::Lod* lods{ nullptr };
+			size_t lodNum{ 0 };
+			const LodSelector* lodSelector{ nullptr }; // nullptr: always LOD 0
+			// (optional) the indices of LOD 0 are in meshlet order, LOD 0 is culled per meshlet
+			const Meshlets::MeshletMesh* meshlets{ nullptr };
+		};
+
+		struct CullStats {
+			size_t drawNum{ 0 };
+			size_t indexNum{ 0 };
+			Meshlets::CullStats meshlets; // summed over the items drawn at LOD 0
+		};
+
+		// returns the id of the item
+		size_t Add(const Item& item);
+		size_t GetItemNum() const noexcept { return items.size(); }
+		// changes (e.g. world) take effect at the next Cull
+		Item& GetItem(size_t id) { return items[id]; }
+		const Item& GetItem(size_t id) const { return items[id]; }
+		// the LOD picked by the last Cull
+		std::uint32_t GetLod(size_t id) const { return states[id].lod; }
+
+		// [arguments]
+		// - view, proj: of the camera
+		// - eye: camera position in world space
+		// - viewportHeight: pixels
+		CullStats Cull(const float view[16], const float proj[16], const float eye[3], float viewportHeight);
+		// the view-space depth of the item origins orders each run
+		void Sort(const float view[16]);
+		// the draws of the last Cull in the order of the last Sort (of Add before the first Sort)
+		void Record(DrawDevice& device) const;
+
+	private:
+		struct Draw {
+			std::uint32_t indexNum;
+			std::uint32_t startIndex;
+		};
+
+		struct State {
+			std::uint32_t lod{ 0 };
+			float viewDepth{ 0.f };
+			size_t drawOffset{ 0 }; // into draws
+			size_t drawNum{ 0 };
+		};
+
+		std::vector<Item> items;
+		std::vector<State> states; // indexed by id
+		std::vector<size_t> order; // ids
+		std::vector<Draw> draws;
+		std::vector<std::uint32_t> visibleMeshlets; // scratch of Cull
+	};
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <vector>
+
+namespace Ubpa {
+	// [summary]
+	// detects changes of a set of files by polling their last write times, no OS notifications
+	// - a file changes when its write time differs from the one seen by the last Poll (or Watch),
+	//   a missing file counts as changed once it appears or disappears
+	// - not thread-safe
+	// [usage]
+	// watcher.Watch(path);
+	// periodically: for (const auto& file : watcher.Poll()) reload file
+	class FileWatcher {
+	public:
+		// the current write time is the baseline
+		void Watch(const std::filesystem::path& path);
+		void Unwatch(const std::filesystem::path& path);
+		bool IsWatched(const std::filesystem::path& path) const;
+		size_t GetFileNum() const noexcept { return files.size(); }
+
+		// files changed since the last Poll, in path order
+		std::vector<std::filesystem::path> Poll();
+
+	private:
+		// empty if the file is missing
+		static std::optional<std::filesystem::file_time_type> WriteTime(const std::filesystem::path& path);
+
+		std::map<std::filesystem::path, std::optional<std::filesystem::file_time_type>> files;
+	};
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+
+namespace Ubpa {
+	// [summary]
+	// fence-retired ring of contiguous ranges, allocation is a pointer bump
+	// - works on offsets only, the owner maps them to descriptors (or bytes)
+	// - ranges of a frame stay in use until the GPU passes the fence given to EndFrame()
+	// - a range never wraps, the tail of the ring is skipped instead
+	// - not thread-safe, use it on the recording thread
+	// [usage]
+	// ring.Reclaim(fence->GetCompletedValue());
+	// auto offset = ring.Allocate(num); ...
+	// queue->Signal(fence, ++fenceValue);
+	// ring.EndFrame(fenceValue);
+	class FrameLinearAllocator {
+	public:
+		static constexpr std::uint64_t InvalidOffset = static_cast<std::uint64_t>(-1);
+
+		explicit FrameLinearAllocator(std::uint64_t capacity);
+
+		// returns InvalidOffset if the ring has no contiguous space for num
+		// alignment must be a power of two
+		std::uint64_t Allocate(std::uint64_t num, std::uint64_t alignment = 1);
+
+		// ranges allocated since the last EndFrame() are retired by fence
+		void EndFrame(std::uint64_t fence);
+		// release the frames whose fence <= completedFence
+		void Reclaim(std::uint64_t completedFence);
+
+		std::uint64_t GetCapacity() const noexcept { return capacity; }
+		// in use by pending frames and the current frame, including skipped tails and padding
+		std::uint64_t GetUsedNum() const noexcept { return usedNum; }
+		std::uint64_t GetPeakUsedNum() const noexcept { return peakUsedNum; }
+		std::uint64_t GetPendingFrameNum() const noexcept { return frames.size(); }
+
+	private:
+		struct Frame {
+			std::uint64_t fence;
+			std::uint64_t num;
+		};
+
+		std::uint64_t capacity;
+		std::uint64_t head{ 0 }; // next free
+		std::uint64_t tail{ 0 }; // oldest in use
+		std::uint64_t usedNum{ 0 };
+		std::uint64_t curFrameNum{ 0 };
+		std::uint64_t peakUsedNum{ 0 };
+		std::deque<Frame> frames;
+	};
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "Clock.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Ubpa {
+	// [summary]
+	// paces frames to a fixed frame rate
+	// - waits for each frame's deadline by sleeping until spinThreshold before it, then spinning
+	// - deadlines advance by exactly one period, so short oversleeps do not accumulate drift;
+	//   if a frame misses its deadline by more than a period, the schedule restarts from now
+	// - the delta time handed to Update is the mean of the last smoothingWindow raw deltas
+	// - records the pacing error (wake-up time minus deadline) of every frame
+	// [usage]
+	// pacer.Reset();
+	// loop: double dt = pacer.Wait(); Update(dt); Draw();
+	class FramePacer {
+	public:
+		struct Desc {
+			double targetFps{ 60. };
+			// switch from sleeping to spinning this long before the deadline
+			std::int64_t spinThresholdNs{ 2'000'000 };
+			size_t smoothingWindow{ 8 };
+		};
+
+		struct ErrorStats {
+			size_t frameNum{ 0 };
+			double lastMs{ 0. };
+			double meanAbsMs{ 0. };
+			double maxAbsMs{ 0. };
+			size_t missedNum{ 0 }; // frames that woke up more than a period late
+		};
+
+		FramePacer(Clock& clock, const Desc& desc);
+		explicit FramePacer(Clock& clock) : FramePacer(clock, Desc{}) {}
+
+		void SetTargetFps(double fps);
+		double GetTargetFps() const noexcept { return desc.targetFps; }
+
+		// restart the schedule, the next deadline is one period from now
+		void Reset();
+
+		// wait for the next frame's deadline, returns the smoothed delta time in seconds
+		double Wait();
+
+		double GetRawDelta() const noexcept { return rawDelta; }
+		double GetSmoothedDelta() const noexcept { return smoothedDelta; }
+		const ErrorStats& GetErrorStats() const noexcept { return errorStats; }
+
+	private:
+		Clock& clock;
+		Desc desc;
+		std::int64_t periodNs;
+
+		std::int64_t deadline{ 0 };
+		std::int64_t lastWake{ 0 };
+
+		std::vector<double> deltas; // ring of raw deltas
+		size_t deltaHead{ 0 };
+		double rawDelta{ 0. };
+		double smoothedDelta{ 0. };
+
+		double absErrorSumMs{ 0. };
+		ErrorStats errorStats;
+	};
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include "Clock.h"
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Ubpa {
+	// [summary]
+	// frame-time statistics
+	// - per-frame samples live in a fixed lock-free ring (single producer, any number of readers)
+	// - per-stage breakdown through scoped markers, exclusive: a stage opened inside another one
+	//   on the same thread is not counted in the outer one
+	// - p50/p95/p99/max, 1% low, stutter and hitch detection, histograms
+	// - CSV and JSON export
+	// pure std, no window or device needed, so it also runs in headless builds
+	// times are read from a Clock, a ManualClock gives known frame times in tests
+	// [usage]
+	// auto update = stats.RegisterStage("update");
+	// stats.BeginFrame();
+	// { FrameStats::ScopedStage s(stats, update); ... }
+	// stats.EndFrame();
+	class FrameStats {
+	public:
+		static constexpr size_t MaxStages = 16;
+		static constexpr size_t InvalidStage = static_cast<size_t>(-1);
+
+		struct Sample {
+			size_t frameIndex{ 0 };
+			double frameMs{ 0. };
+			std::array<double, MaxStages> stageMs{}; // indexed by stage id
+		};
+
+		struct Percentiles {
+			double mean{ 0. };
+			double p50{ 0. };
+			double p95{ 0. };
+			double p99{ 0. };
+			double max{ 0. };
+		};
+
+		struct SummaryConfig {
+			// a frame is a stutter if it takes stutterRatio times the median of the previous stutterWindow frames
+			double stutterRatio{ 2. };
+			size_t stutterWindow{ 30 };
+			// a frame is a hitch if it takes longer than hitchMs, independent of its neighbours
+			double hitchMs{ 100. };
+		};
+
+		struct Summary {
+			size_t frameNum{ 0 };
+			Percentiles frame;
+			std::vector<Percentiles> stages; // indexed by stage id
+			double avgFps{ 0. };
+			double low1PercentFps{ 0. }; // average fps of the slowest 1% frames
+			std::vector<size_t> stutters; // frame indices
+			std::vector<size_t> hitches;  // frame indices
+		};
+
+		struct Histogram {
+			double binMs{ 1. };
+			std::vector<size_t> bins; // bins[i] counts frames in [i * binMs, (i + 1) * binMs)
+			size_t overflow{ 0 };     // frames beyond the last bin
+		};
+
+		// capacity: number of most recent frames kept in the ring
+		explicit FrameStats(size_t capacity = 4096, const Clock& clock = SteadyClock::Instance());
+		~FrameStats();
+
+		// stage ids are stable, registering an existing name returns its id
+		// not thread-safe, register stages before frames start
+		size_t RegisterStage(std::string name);
+		// InvalidStage if name isn't registered
+		size_t FindStage(std::string_view name) const;
+		size_t GetStageNum() const noexcept { return stageNames.size(); }
+		const std::string& GetStageName(size_t stage) const { return stageNames[stage]; }
+
+		// producer thread
+		void BeginFrame();
+		void EndFrame();
+
+		// any thread, accumulates: a stage may be entered several times per frame
+		void AddStageTime(size_t stage, double ms);
+
+		// drop all samples (producer thread, outside of a frame)
+		void Clear();
+		// reallocate the ring for capacity frames and drop all samples
+		// not thread-safe, like RegisterStage: call it before frames start or readers exist
+		void SetCapacity(size_t capacity);
+		size_t GetCapacity() const noexcept { return capacity; }
+
+		// any thread, lock-free
+		// returns the frames still in the ring, oldest first
+		std::vector<Sample> Snapshot() const;
+		size_t GetFrameNum() const noexcept;
+
+		Summary Summarize() const { return Summarize(SummaryConfig{}); }
+		Summary Summarize(const SummaryConfig& config) const;
+		Histogram ComputeHistogram(double binMs = 1., size_t binNum = 64) const;
+
+		// one row per frame: frame,frame_ms,<stage>_ms...
+		void WriteCSV(std::ostream& os) const;
+		// { "stages": [...], "summary": {...}, "histogram": {...}, "frames": [ {...} ] }
+		void WriteJSON(std::ostream& os) const { WriteJSON(os, SummaryConfig{}); }
+		void WriteJSON(std::ostream& os, const SummaryConfig& config) const;
+
+		// write by extension: ".json" -> JSON, otherwise CSV
+		bool WriteFile(const std::string& path) const;
+
+		// scopes of a thread close in reverse order of opening
+		class ScopedStage {
+		public:
+			ScopedStage(FrameStats& stats, size_t stage);
+			~ScopedStage();
+			ScopedStage(const ScopedStage&) = delete;
+			ScopedStage& operator=(const ScopedStage&) = delete;
+		private:
+			FrameStats& stats;
+			size_t stage;
+			std::int64_t begin; // ns
+			double nestedMs{ 0. }; // of the stages opened inside this one
+			ScopedStage* outer;
+
+			static thread_local ScopedStage* innermost;
+		};
+
+	private:
+		struct Slot;
+
+		const Clock& clock;
+		std::vector<std::string> stageNames;
+
+		std::unique_ptr<Slot[]> ring;
+		size_t capacity;
+		std::atomic<size_t> head{ 0 }; // number of frames ever written
+
+		std::array<std::atomic<double>, MaxStages> currentStageMs;
+		std::int64_t frameBegin{ 0 }; // ns
+		bool inFrame{ false };
+	};
+}
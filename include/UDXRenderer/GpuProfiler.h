@@ -0,0 +1,110 @@
+#pragma once
+
+#include "FrameStats.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Ubpa {
+	// [summary]
+	// per-pass GPU timing with timestamp queries
+	// - every frame slot (frame resource) owns queryCapacity timestamps, two per pass
+	// - results of a slot are read back when the slot comes around again,
+	//   i.e. with a latency of frameLatency frames (gNumFrameResources),
+	//   so BeginFrame() must be called after the frame resource's fence wait
+	// - queries come from a QuerySource, D3D12TimestampSource on the device,
+	//   any fake source for CPU-only tests
+	// [usage]
+	// GpuProfiler::RegisterStage(frameStats, "GBuffer Pass"); // with the other stages, at setup
+	// each frame:
+	// profiler.BeginFrame();
+	// { GpuProfiler::ScopedPass pass(profiler, "GBuffer Pass"); ... record ... }
+	// profiler.EndFrame(); // before closing the command list
+	// profiler.Publish(frameStats);
+	class GpuProfiler {
+	public:
+		class QuerySource {
+		public:
+			virtual ~QuerySource() = default;
+
+			// timestamps available per frame slot
+			virtual size_t GetQueryCapacity() const = 0;
+			// timestamp ticks per second
+			virtual std::uint64_t GetFrequency() const = 0;
+
+			// record a timestamp into query [slot, query]
+			virtual void WriteTimestamp(size_t slot, size_t query) = 0;
+			// record the copy of queries [slot, 0 .. queryNum) to CPU-readable memory
+			virtual void Resolve(size_t slot, size_t queryNum) = 0;
+			// read resolved queries of a slot whose frame has completed on the GPU
+			virtual void ReadBack(size_t slot, size_t queryNum, std::uint64_t* ticks) = 0;
+		};
+
+		struct PassTiming {
+			std::string name;
+			double ms{ 0. };
+		};
+
+		GpuProfiler(QuerySource& source, size_t frameLatency);
+
+		void BeginFrame();
+		void EndFrame();
+
+		// returns a pass id for EndPass(), static_cast<size_t>(-1) if the slot is out of queries
+		size_t BeginPass(std::string name);
+		void EndPass(size_t pass);
+
+		// timings of the most recent frame whose results arrived, in pass begin order
+		const std::vector<PassTiming>& GetLatestTimings() const noexcept { return latestTimings; }
+		// index of that frame, static_cast<size_t>(-1) before the first results arrive
+		size_t GetLatestFrameIndex() const noexcept { return latestFrameIndex; }
+		// passes dropped because a slot ran out of queries
+		size_t GetDroppedPassNum() const noexcept { return droppedPassNum; }
+
+		// registers the stage "gpu <pass>" that Publish() adds the pass's timing to
+		// like FrameStats::RegisterStage, call it before frames start
+		static size_t RegisterStage(FrameStats& stats, std::string_view pass);
+
+		// add the latest pass timings to the current frame of stats, as stages "gpu <pass>"
+		// passes without a registered stage are skipped
+		void Publish(FrameStats& stats) const;
+
+		class ScopedPass {
+		public:
+			ScopedPass(GpuProfiler& profiler, std::string name)
+				: profiler{ profiler }, pass{ profiler.BeginPass(std::move(name)) } {}
+			~ScopedPass() { profiler.EndPass(pass); }
+			ScopedPass(const ScopedPass&) = delete;
+			ScopedPass& operator=(const ScopedPass&) = delete;
+		private:
+			GpuProfiler& profiler;
+			size_t pass;
+		};
+
+	private:
+		struct PassRecord {
+			std::string name;
+			size_t beginQuery;
+			size_t endQuery;
+		};
+
+		struct Slot {
+			size_t frameIndex{ static_cast<size_t>(-1) };
+			size_t queryNum{ 0 };
+			std::vector<PassRecord> passes;
+		};
+
+		QuerySource& source;
+		std::vector<Slot> slots;
+		size_t frameIndex{ 0 };
+		bool inFrame{ false };
+
+		std::vector<std::uint64_t> ticks;
+		std::vector<PassTiming> latestTimings;
+		mutable std::string stageName; // scratch of Publish()
+		size_t latestFrameIndex{ static_cast<size_t>(-1) };
+		size_t droppedPassNum{ 0 };
+	};
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+
+namespace Ubpa::LZCodec {
+	// [summary]
+	// byte-oriented LZ77 block codec, LZ4 block format
+	// - greedy matching through a hash table of 4-byte sequences, 64 KB window
+	// - a block is self-contained, so archives split entries into blocks for random access
+	// - the decoder checks every length and offset against its buffers, corrupt input fails instead of overrunning
+	// [usage]
+	// std::vector<std::uint8_t> packed(LZCodec::CompressBound(size));
+	// packed.resize(LZCodec::Compress(data, size, packed.data(), packed.size()));
+	// LZCodec::Decompress(packed.data(), packed.size(), dst, size) == size
+
+	size_t CompressBound(size_t srcSize) noexcept;
+
+	// returns the compressed size, 0 if it doesn't fit into dstCapacity
+	size_t Compress(const void* src, size_t srcSize, void* dst, size_t dstCapacity) noexcept;
+
+	// returns the decompressed size, or static_cast<size_t>(-1) if src is corrupt or dst is too small
+	size_t Decompress(const void* src, size_t srcSize, void* dst, size_t dstCapacity) noexcept;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "MeshSimplifier.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Ubpa {
+	// [summary]
+	// picks the LOD of a mesh from its projected size, with hysteresis against popping back and forth
+	// - screen size: projected bounding sphere radius in pixels
+	// - LOD i is used up to thresholds[i] (non-increasing, thresholds[0] is +inf)
+	// - one selector per mesh, the current LOD is the state of each item
+	// [usage]
+	// auto selector = LodSelector::FromErrors(chain.lods.data(), chain.lods.size(), radius);
+	// item.lod = selector.Select(item.lod, LodSelector::ScreenSize(radius, distance, proj._22, height));
+	class LodSelector {
+	public:
+		explicit LodSelector(std::vector<float> thresholds, float hysteresis = 0.1f);
+
+		// [arguments]
+		// - lods: a chain with accumulated errors (MeshSimplifier::GenerateLods)
+		// - radius: of the bounding sphere of the mesh (mesh units)
+		// - maxPixelError: LOD i is used while its error projects to at most this many pixels
+		static LodSelector FromErrors(const MeshSimplifier::Lod* lods, size_t lodNum, float radius,
+			float maxPixelError = 1.f, float hysteresis = 0.1f);
+
+		// [arguments]
+		// - projScaleY: proj._22 of the projection matrix (1 / tan(fovY / 2))
+		// - viewportHeight: pixels
+		// +inf if the camera is inside the sphere
+		static float ScreenSize(float radius, float distance, float projScaleY, float viewportHeight) noexcept;
+
+		// current: the LOD selected last time (0 for a new item), returns the LOD to draw
+		std::uint32_t Select(std::uint32_t current, float screenSize) const noexcept;
+
+		size_t GetLodNum() const noexcept { return thresholds.size(); }
+		const std::vector<float>& GetThresholds() const noexcept { return thresholds; }
+
+	private:
+		std::vector<float> thresholds;
+		float hysteresis;
+	};
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+namespace Ubpa {
+	// [summary]
+	// read-only memory mapping of a whole file
+	// - pages are faulted in on first access, nothing is read up front
+	// - move-only, unmapped on destruction
+	// [usage]
+	// MappedFile file;
+	// if (file.Open(path)) Use(file.GetData(), file.GetSize());
+	class MappedFile {
+	public:
+		MappedFile() noexcept = default;
+		~MappedFile();
+
+		MappedFile(MappedFile&& other) noexcept;
+		MappedFile& operator=(MappedFile&& other) noexcept;
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		// closes the current mapping first
+		// returns false if the file can't be opened or is empty
+		bool Open(const std::filesystem::path& path);
+		void Close() noexcept;
+
+		bool IsOpen() const noexcept { return data != nullptr; }
+		const std::uint8_t* GetData() const noexcept { return data; }
+		size_t GetSize() const noexcept { return size; }
+
+	private:
+		const std::uint8_t* data{ nullptr };
+		size_t size{ 0 };
+#ifdef _WIN32
+		void* mapping{ nullptr }; // HANDLE of the file mapping object
+#endif
+	};
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace Ubpa {
+	// [summary]
+	// parameters of the materials of one template (layout), no GPU code
+	// - the parameters of all materials live in one dense array, material i at i * stride,
+	//   laid out as the elements of an HLSL StructuredBuffer (the layout comes from reflection)
+	// - every change marks the material dirty in a bitset per frame resource,
+	//   Upload(frame) copies the dirty span of that frame into its buffer with a single memcpy
+	// - shaders index the buffer with the MaterialID (e.g. from the per-draw constants)
+	// [usage]
+	// MaterialTable table(layout, 256, gNumFrameResources);
+	// auto id = table.Create("iron");
+	// table.Set(id, table.FindParam("Roughness"), 0.2f);
+	// each frame: table.Upload(frameIndex, mappedBufferOfTheFrame);
+	class MaterialTable {
+	public:
+		using MaterialID = std::uint32_t;
+		using ParamID = std::uint32_t;
+		static constexpr MaterialID InvalidID = static_cast<MaterialID>(-1);
+		static constexpr ParamID InvalidParam = static_cast<ParamID>(-1);
+
+		enum class ParamType {
+			Float, Float2, Float3, Float4,
+			Uint, Uint2, Uint3, Uint4,
+			Int, Int2, Int3, Int4,
+			Float4x4
+		};
+		static std::uint32_t SizeOf(ParamType type) noexcept;
+
+		struct Param {
+			std::string name;
+			ParamType type;
+			std::uint32_t offset; // bytes from the start of the material
+		};
+
+		struct Layout {
+			std::vector<Param> params;
+			std::uint32_t stride{ 0 };
+
+			// after the last parameter, 4-byte aligned, the stride grows to fit
+			Layout& Add(std::string name, ParamType type);
+			// e.g. from reflection, the stride grows to fit
+			Layout& Add(std::string name, ParamType type, std::uint32_t offset);
+			ParamID Find(std::string_view name) const noexcept;
+		};
+
+		struct Stats {
+			size_t materialNum{ 0 };
+			size_t uploadNum{ 0 };     // non-empty uploads
+			size_t uploadedBytes{ 0 };
+		};
+
+		// [arguments]
+		// - capacity: materials, the size of each frame's buffer is capacity * layout.stride
+		// - frameNum: frame resources, each has its own buffer and dirty bitset
+		MaterialTable(Layout layout, std::uint32_t capacity, std::uint32_t frameNum);
+
+		// the parameters start as the defaults (zero unless SetDefault was called)
+		// returns InvalidID if the table is full
+		MaterialID Create(std::string name);
+		// the ID is reused by a later Create
+		void Destroy(MaterialID id);
+		MaterialID Find(std::string_view name) const;
+		bool IsAlive(MaterialID id) const noexcept { return id < names.size() && !names[id].empty(); }
+		const std::string& GetName(MaterialID id) const noexcept { return names[id]; }
+		// alive IDs are < GetIDBound()
+		MaterialID GetIDBound() const noexcept { return static_cast<MaterialID>(names.size()); }
+
+		ParamID FindParam(std::string_view name) const noexcept { return layout.Find(name); }
+		const Layout& GetLayout() const noexcept { return layout; }
+
+		// size must be SizeOf the parameter's type
+		void Set(MaterialID id, ParamID param, const void* value, size_t size);
+		template<typename T>
+		void Set(MaterialID id, ParamID param, const T& value) {
+			static_assert(std::is_trivially_copyable_v<T>);
+			Set(id, param, &value, sizeof(T));
+		}
+		const void* Get(MaterialID id, ParamID param) const noexcept;
+		// the parameters of materials created later
+		void SetDefault(ParamID param, const void* value, size_t size);
+		template<typename T>
+		void SetDefault(ParamID param, const T& value) {
+			static_assert(std::is_trivially_copyable_v<T>);
+			SetDefault(param, &value, sizeof(T));
+		}
+
+		// [summary]
+		// copies the span from the first to the last material dirty in frame, clean ones included
+		// (they already hold the same data), and clears the frame's bits
+		// dst: the frame's buffer (capacity * stride bytes), returns the bytes copied
+		size_t Upload(std::uint32_t frame, void* dst);
+		bool IsDirty(std::uint32_t frame, MaterialID id) const noexcept;
+		// all frames
+		void MarkDirty(MaterialID id);
+
+		const void* GetData() const noexcept { return data.data(); }
+		std::uint32_t GetCapacity() const noexcept { return capacity; }
+		std::uint32_t GetFrameNum() const noexcept { return static_cast<std::uint32_t>(dirty.size()); }
+		Stats GetStats() const noexcept;
+
+	private:
+		Layout layout;
+		std::uint32_t capacity;
+		std::vector<std::uint8_t> data; // capacity * stride
+		std::vector<std::uint8_t> defaults;
+		std::vector<std::string> names; // empty if free
+		std::map<std::string, MaterialID, std::less<>> nameMap;
+		std::vector<MaterialID> freeIDs;
+		std::vector<std::vector<std::uint64_t>> dirty; // [frame], bit i: material i
+		size_t uploadNum{ 0 };
+		size_t uploadedBytes{ 0 };
+	};
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace Ubpa {
+	// [summary]
+	// accounting of GPU memory by category and by name
+	// - every allocation is recorded under a key (e.g. its ID3D12Resource*) with its size and alignment
+	// - live, peak and budget per category and in total, a callback fires when a budget is crossed
+	//   (both ways)
+	// - Dump lists the totals and every live allocation, what is left after shutdown leaked
+	// - thread-safe, the callback runs on the recording thread after the lock is released
+	// pure std, the caller measures the sizes (ID3D12Device::GetResourceAllocationInfo)
+	// [usage]
+	// tracker.SetBudget(MemoryTracker::Category::Texture, 512ull << 20);
+	// tracker.SetBudgetCallback([](const MemoryTracker::BudgetEvent& e) { ... });
+	// tracker.Track(resource, MemoryTracker::Category::Texture, "iron", info.SizeInBytes, info.Alignment);
+	// tracker.Untrack(resource);
+	class MemoryTracker {
+	public:
+		enum class Category : std::uint32_t {
+			Texture,
+			RenderTarget,
+			Mesh,
+			Upload,
+			DescriptorHeap,
+			Other,
+			Num
+		};
+		static constexpr size_t CategoryNum = static_cast<size_t>(Category::Num);
+
+		static std::string_view ToString(Category category) noexcept;
+
+		struct Allocation {
+			Category category;
+			std::string name;
+			std::uint64_t size;
+			std::uint64_t alignment;
+		};
+
+		struct Usage {
+			std::uint64_t liveBytes{ 0 };
+			std::uint64_t peakBytes{ 0 };
+			std::uint64_t budget{ 0 }; // 0: none
+			size_t liveNum{ 0 };
+			size_t trackNum{ 0 };      // allocations recorded so far
+		};
+
+		struct Stats {
+			std::array<Usage, CategoryNum> categories;
+			Usage total;
+		};
+
+		struct NameUsage {
+			std::string name;
+			Category category;
+			std::uint64_t liveBytes;
+			size_t liveNum;
+		};
+
+		struct BudgetEvent {
+			Category category; // Category::Num: the total budget
+			std::uint64_t liveBytes;
+			std::uint64_t budget;
+			bool exceeded;     // false: back under the budget
+		};
+		using BudgetCallback = std::function<void(const BudgetEvent&)>;
+
+		// a key that is already tracked is updated (e.g. a resized allocation)
+		void Track(const void* key, Category category, std::string name,
+			std::uint64_t size, std::uint64_t alignment = 0);
+		// does nothing if the key isn't tracked
+		void Untrack(const void* key);
+		bool IsTracked(const void* key) const;
+		// the object moved, e.g. into a retired copy, does nothing if the key isn't tracked
+		void Rekey(const void* key, const void* newKey);
+
+		// 0: no budget
+		void SetBudget(Category category, std::uint64_t budget);
+		void SetTotalBudget(std::uint64_t budget);
+		void SetBudgetCallback(BudgetCallback callback);
+
+		Stats GetStats() const;
+		// live allocations summed by (category, name), largest first
+		std::vector<NameUsage> GetNameUsages() const;
+		// totals per category, then every live allocation by category and size
+		void Dump(std::ostream& os) const;
+
+	private:
+		// the events of crossed budgets, fired after the lock is released
+		using Events = std::vector<BudgetEvent>;
+
+		void Add(Category category, std::uint64_t size);
+		void Remove(Category category, std::uint64_t size);
+		// the budgets crossed since before
+		void Check(const Stats& before, Events& events) const;
+		void Fire(const Events& events) const;
+
+		mutable std::mutex m;
+		std::unordered_map<const void*, Allocation> allocations;
+		Stats stats;
+		BudgetCallback callback;
+	};
+}
@@ -0,0 +1,182 @@
+#pragma once
+
+#include "Meshlets.h"
+#include "MeshSimplifier.h"
+#include "VertexCompression.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Ubpa {
+	class MappedFile;
+}
+
+namespace Ubpa::MeshAsset {
+	// [summary]
+	// versioned binary container of static meshes in GPU-ready layout
+	// - one vertex stream (encoded vertices, VertexCompression) and one index buffer shared by all submeshes,
+	//   plus the submesh table, bounds, LOD ranges and meshlets
+	// - every section starts at a multiple of SectionAlignment, so a mapped file is used in place:
+	//   View points into the bytes, vertices and indices go to the GPU without parsing or conversion
+	// - little-endian, the structs below are the file layout
+	// [usage]
+	// cook:  MeshAsset::Save(path, MeshAsset::Serialize(submeshes, { stride, desc, key }));
+	// load:  MappedFile file; MeshAsset::View asset;
+	//        if (MeshAsset::Load(path, file, asset) == MeshAsset::Error::None) ...
+	//        upload asset.GetVertices(submesh) / asset.GetIndices(submesh) directly
+
+	inline constexpr std::uint32_t Magic = 0x48534D55; // "UMSH"
+	inline constexpr std::uint32_t Version = 2;
+	inline constexpr std::uint32_t SectionAlignment = 256;
+
+	enum class Section : std::uint32_t {
+		Vertices,          // vertexStride bytes per vertex
+		Indices,           // indexSize bytes per index, relative to the submesh's baseVertex
+		Submeshes,         // Submesh
+		Lods,              // MeshSimplifier::Lod
+		Meshlets,          // Meshlets::Meshlet
+		MeshletBounds,     // Meshlets::Bounds, one per meshlet
+		MeshletVertices,   // std::uint32_t, submesh vertex
+		MeshletPrimitives, // std::uint32_t, Meshlets::PackTriangle
+		Names,             // UTF-8, not null-terminated
+		Num
+	};
+
+	struct SectionRange {
+		std::uint64_t offset; // bytes from the start of the file
+		std::uint64_t size;   // bytes
+	};
+
+	struct Header {
+		std::uint32_t magic;
+		std::uint32_t version;
+		std::uint64_t fileSize;
+		// set by the cook, e.g. a hash of the source meshes and settings, to detect stale files
+		std::uint64_t contentKey;
+		std::uint32_t vertexStride;
+		std::uint32_t indexSize; // 2 or 4
+		// VertexCompression::Desc of the vertices
+		std::uint8_t positionFormat;
+		std::uint8_t normalFormat;
+		std::uint8_t tangentFormat;
+		std::uint8_t uvFormat;
+		std::uint32_t submeshNum;
+		SectionRange sections[static_cast<size_t>(Section::Num)];
+	};
+
+	// offsets and numbers are in elements of the sections
+	struct Submesh {
+		std::uint32_t nameOffset;
+		std::uint32_t nameLength;
+		std::uint32_t baseVertex;
+		std::uint32_t vertexNum;
+		std::uint32_t indexOffset;
+		std::uint32_t indexNum; // every LOD
+		// Lod::indexOffset is relative to indexOffset, LOD 0 is the full mesh
+		std::uint32_t lodOffset;
+		std::uint32_t lodNum;
+		// Meshlet::vertexOffset / primitiveOffset are relative to meshletVertexOffset / meshletPrimitiveOffset
+		std::uint32_t meshletOffset;
+		std::uint32_t meshletNum;
+		std::uint32_t meshletVertexOffset;
+		std::uint32_t meshletVertexNum;
+		std::uint32_t meshletPrimitiveOffset;
+		std::uint32_t meshletPrimitiveNum;
+		float quantMin[3];    // VertexCompression::QuantizationInfo
+		float quantExtent[3];
+		float center[3];      // bounding sphere in mesh space
+		float radius;
+		float uvDensity;      // uv units per mesh unit, TextureStreamer::ComputeUVDensity
+	};
+
+	// [summary]
+	// input of the cook, the pointers are only read during Serialize
+	struct SubmeshSource {
+		std::string name;
+		const void* vertices{ nullptr }; // encoded, Config::vertexStride bytes per vertex
+		size_t vertexNum{ 0 };
+		const std::uint32_t* indices{ nullptr }; // every LOD, relative to the submesh
+		size_t indexNum{ 0 };
+		// null: a single LOD of all indices
+		const MeshSimplifier::Lod* lods{ nullptr };
+		size_t lodNum{ 0 };
+		// optional, its primitives index the first GetTriangleNum() * 3 indices in meshlet order
+		const Meshlets::MeshletMesh* meshlets{ nullptr };
+		VertexCompression::QuantizationInfo quantization;
+		float center[3]{ 0.f, 0.f, 0.f };
+		float radius{ 0.f };
+		float uvDensity{ 0.f };
+	};
+
+	struct Config {
+		std::uint32_t vertexStride{ 0 };
+		VertexCompression::Desc vertexDesc;
+		std::uint64_t contentKey{ 0 };
+	};
+
+	// [summary]
+	// 64-bit FNV-1a, to derive Config::contentKey from the source meshes and the settings of the cook
+	// [usage]
+	// std::uint64_t key = MeshAsset::HashContent(vertices.data(), vertices.size() * sizeof(Vertex));
+	// key = MeshAsset::HashContent(&lodConfig, sizeof(lodConfig), key);
+	std::uint64_t HashContent(const void* data, size_t size,
+		std::uint64_t seed = 14695981039346656037ull) noexcept;
+
+	// 16-bit indices if every submesh has at most 65536 vertices
+	std::vector<std::uint8_t> Serialize(const std::vector<SubmeshSource>& submeshes, const Config& config);
+	// writes the bytes of Serialize, returns false if the file can't be written
+	bool Save(const std::filesystem::path& path, const std::vector<std::uint8_t>& file);
+
+	enum class Error {
+		None,
+		CannotOpen,
+		Misaligned,   // the data isn't aligned to 8 bytes
+		TooSmall,
+		BadMagic,
+		BadVersion,   // written by another version, cook it again
+		BadSection,   // a section is out of the file or has a partial element
+		BadSubmesh    // a range of a submesh, LOD or meshlet is out of its section
+	};
+
+	const char* ToString(Error error) noexcept;
+
+	// [summary]
+	// non-owning view of an asset in memory, the bytes must outlive it
+	// - Init checks the header, the sections and the ranges of the submeshes, LODs and meshlets,
+	//   the vertices and indices themselves are not touched
+	class View {
+	public:
+		Error Init(const void* data, size_t size);
+
+		bool IsValid() const noexcept { return header != nullptr; }
+		const Header& GetHeader() const noexcept { return *header; }
+		VertexCompression::Desc GetVertexDesc() const noexcept;
+
+		size_t GetSubmeshNum() const noexcept { return header->submeshNum; }
+		const Submesh& GetSubmesh(size_t i) const noexcept { return submeshes[i]; }
+		// returns GetSubmeshNum() if there is no such submesh
+		size_t FindSubmesh(std::string_view name) const noexcept;
+
+		std::string_view GetName(const Submesh& submesh) const noexcept;
+		const void* GetVertices(const Submesh& submesh) const noexcept; // vertexNum * vertexStride bytes
+		const void* GetIndices(const Submesh& submesh) const noexcept;  // indexNum * indexSize bytes
+		const MeshSimplifier::Lod* GetLods(const Submesh& submesh) const noexcept;
+		VertexCompression::QuantizationInfo GetQuantization(const Submesh& submesh) const noexcept;
+		// copies the meshlets of the submesh (small next to the vertices and indices)
+		Meshlets::MeshletMesh GetMeshlets(const Submesh& submesh) const;
+
+	private:
+		const std::uint8_t* Get(Section section) const noexcept;
+
+		const std::uint8_t* data{ nullptr };
+		const Header* header{ nullptr };
+		const Submesh* submeshes{ nullptr };
+	};
+
+	// maps the file and initializes the view over it, the view is valid while file stays open
+	Error Load(const std::filesystem::path& path, MappedFile& file, View& view);
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Ubpa::MeshOptimizer {
+	// [summary]
+	// load-time / offline optimization of indexed triangle lists, CPU only
+	// 1. OptimizeVertexCache: Forsyth's linear-speed vertex cache reordering
+	// 2. OptimizeOverdraw: split the reordered list into clusters at cache-cold points,
+	//    sort clusters front-to-back from the outside (outward-facing first)
+	// 3. OptimizeVertexFetch: renumber vertices in first-use order for fetch locality
+	// [usage]
+	// auto report = MeshOptimizer::Optimize(indices, vertices.data(), vertices.size(), sizeof(Vertex), 0);
+	// report.cacheBefore.acmr -> report.cacheAfter.acmr
+
+	struct VertexCacheStats {
+		std::uint32_t transformNum{ 0 }; // cache misses
+		float acmr{ 0.f };               // transformNum / triangle number, [0.5, 3]
+		float atvr{ 0.f };               // transformNum / referenced vertex number, >= 1
+	};
+
+	struct VertexFetchStats {
+		std::uint64_t bytesFetched{ 0 };
+		float overfetch{ 0.f };          // bytesFetched / (referenced vertex number * stride), >= ~1
+	};
+
+	// FIFO post-transform cache of cacheSize vertices
+	VertexCacheStats AnalyzeVertexCache(const std::uint32_t* indices, size_t indexNum, size_t vertexNum,
+		std::uint32_t cacheSize = 16);
+	// fully associative LRU cache of 64-byte lines (4 KB)
+	VertexFetchStats AnalyzeVertexFetch(const std::uint32_t* indices, size_t indexNum, size_t vertexNum,
+		size_t vertexStride);
+
+	// dst may alias indices
+	void OptimizeVertexCache(std::uint32_t* dst, const std::uint32_t* indices, size_t indexNum, size_t vertexNum);
+
+	// [arguments]
+	// - indices: output of OptimizeVertexCache (clusters are found from its cache behaviour)
+	// - positions: float3 at positions + i * positionStride (bytes)
+	// - threshold: allowed ACMR growth for finer clusters, 1.05 is a good trade-off
+	// dst may alias indices
+	void OptimizeOverdraw(std::uint32_t* dst, const std::uint32_t* indices, size_t indexNum,
+		const void* positions, size_t vertexNum, size_t positionStride, float threshold = 1.05f);
+
+	// [summary]
+	// remap[old vertex] = new vertex in first-use order, unreferenced vertices get static_cast<std::uint32_t>(-1)
+	// returns the number of referenced vertices
+	size_t OptimizeVertexFetchRemap(std::uint32_t* remap, const std::uint32_t* indices, size_t indexNum, size_t vertexNum);
+	// dst may alias indices
+	void RemapIndexBuffer(std::uint32_t* dst, const std::uint32_t* indices, size_t indexNum, const std::uint32_t* remap);
+	// dst must not alias vertices
+	void RemapVertexBuffer(void* dst, const void* vertices, size_t vertexNum, size_t vertexStride, const std::uint32_t* remap);
+
+	struct Config {
+		std::uint32_t cacheSize = 16;    // for the reports
+		float overdrawThreshold = 1.05f; // <= 0 skips the overdraw pass
+	};
+
+	struct Report {
+		VertexCacheStats cacheBefore;
+		VertexCacheStats cacheAfter;
+		VertexFetchStats fetchBefore;
+		VertexFetchStats fetchAfter;
+		size_t vertexNumBefore{ 0 };
+		size_t vertexNumAfter{ 0 };      // unreferenced vertices are dropped
+	};
+
+	// [summary]
+	// run the three passes in place on an interleaved vertex buffer with a float3 position at positionOffset
+	// vertices are reordered in place (and compacted), returns the new vertex number in the report
+	Report Optimize(std::vector<std::uint32_t>& indices, void* vertices, size_t vertexNum,
+		size_t vertexStride, size_t positionOffset, const Config& config = {});
+}
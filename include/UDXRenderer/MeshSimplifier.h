@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Ubpa::MeshSimplifier {
+	// [summary]
+	// quadric error metric simplification of indexed triangle lists, CPU only
+	// - edge collapses move a vertex onto a neighbour, so the vertex buffer is kept as is
+	//   and every LOD is just another index list over it
+	// - vertices sharing a position with other vertices (uv / normal seams)
+	//   and vertices on open borders are locked
+	// [usage]
+	// auto chain = MeshSimplifier::GenerateLods(indices.data(), indices.size(), positions, vertexNum, sizeof(Vertex));
+	// upload chain.indices, draw chain.lods[i] as [indexOffset, indexOffset + indexNum)
+
+	// [arguments]
+	// - positions: float3 at positions + i * positionStride (bytes)
+	// - targetIndexNum: stop once the result has at most this many indices
+	// - targetError: stop before a collapse would move the surface farther than this (mesh units)
+	// - resultError: (optional) the largest error of the collapses done
+	// returns the number of indices written to dst (<= indexNum), dst may alias indices
+	size_t Simplify(std::uint32_t* dst, const std::uint32_t* indices, size_t indexNum,
+		const void* positions, size_t vertexNum, size_t positionStride,
+		size_t targetIndexNum, float targetError, float* resultError = nullptr);
+
+	struct Lod {
+		std::uint32_t indexOffset; // into LodChain::indices
+		std::uint32_t indexNum;
+		float error;               // mesh units, accumulated over the chain
+	};
+
+	struct LodConfig {
+		std::uint32_t maxLodNum = 5;  // including LOD 0
+		float ratio = 0.35f;          // target index number of a LOD over the previous one
+		float maxError = 0.05f;       // relative to the bounding box diagonal
+		float minReduction = 0.85f;   // stop if a LOD keeps more than this fraction of the previous one
+	};
+
+	struct LodChain {
+		std::vector<std::uint32_t> indices; // LOD 0 (the input) first, then each coarser LOD
+		std::vector<Lod> lods;
+	};
+
+	// each LOD is simplified from the previous one
+	LodChain GenerateLods(const std::uint32_t* indices, size_t indexNum,
+		const void* positions, size_t vertexNum, size_t positionStride, const LodConfig& config = {});
+}
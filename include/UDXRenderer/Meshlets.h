@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Ubpa::Meshlets {
+	// [summary]
+	// split indexed triangle lists into meshlets (small clusters) for cluster-level culling
+	// - a meshlet has at most Config::maxVertices vertices and Config::maxTriangles triangles,
+	//   grown greedily from a seed triangle over its neighbours (fewest new vertices first)
+	// - the triangle list is cut into fixed chunks built in parallel,
+	//   so the result does not depend on the thread number
+	// - bounds: sphere + normal cone, for frustum and backface culling on the CPU now and in mesh shaders later
+	// [usage]
+	// auto mesh = Meshlets::Build(indices.data(), indices.size(), positions, vertexNum, sizeof(Vertex));
+	// Meshlets::UnpackIndices(mesh, drawIndices.data()); // index buffer in meshlet order
+	// Meshlets::ExtractFrustumPlanes(worldViewProj, planes);
+	// Meshlets::Cull(mesh, planes, eyeL, visible); // draw the index ranges of the visible meshlets
+
+	// same layout as the meshlets of the D3D12 mesh shader samples
+	struct Meshlet {
+		std::uint32_t vertexNum;
+		std::uint32_t vertexOffset;    // into MeshletMesh::vertices
+		std::uint32_t primitiveNum;
+		std::uint32_t primitiveOffset; // into MeshletMesh::primitives
+	};
+
+	// backface cone: every triangle of the meshlet faces away from eye if
+	// dot(center - eye, coneAxis) >= coneCutoff * length(center - eye) + radius
+	struct Bounds {
+		float center[3]{ 0.f, 0.f, 0.f };
+		float radius{ 0.f };
+		float coneAxis[3]{ 0.f, 0.f, 0.f };
+		float coneCutoff{ 1.f }; // sin of the cone half angle, 1: never culled
+	};
+
+	struct MeshletMesh {
+		std::vector<Meshlet> meshlets;
+		std::vector<Bounds> bounds;         // one per meshlet
+		std::vector<std::uint32_t> vertices;   // meshlet-local vertex -> mesh vertex
+		std::vector<std::uint32_t> primitives; // packed triangles of meshlet-local vertices
+
+		size_t GetTriangleNum() const noexcept { return primitives.size(); }
+	};
+
+	// three 10-bit meshlet-local indices
+	inline std::uint32_t PackTriangle(std::uint32_t i0, std::uint32_t i1, std::uint32_t i2) noexcept {
+		return (i0 & 0x3ff) | ((i1 & 0x3ff) << 10) | ((i2 & 0x3ff) << 20);
+	}
+	inline void UnpackTriangle(std::uint32_t packed, std::uint32_t& i0, std::uint32_t& i1, std::uint32_t& i2) noexcept {
+		i0 = packed & 0x3ff;
+		i1 = (packed >> 10) & 0x3ff;
+		i2 = (packed >> 20) & 0x3ff;
+	}
+
+	struct Config {
+		std::uint32_t maxVertices = 64;   // <= 1024
+		std::uint32_t maxTriangles = 124;
+		// triangles per parallel chunk, meshlets do not cross chunks
+		std::uint32_t chunkTriangleNum = 16 * 1024;
+		// 0: std::thread::hardware_concurrency()
+		std::uint32_t threadNum = 0;
+	};
+
+	// [arguments]
+	// - positions: float3 at positions + i * positionStride (bytes)
+	// front faces: normal cross(p1 - p0, p2 - p0) (clockwise in D3D's left-handed space)
+	MeshletMesh Build(const std::uint32_t* indices, size_t indexNum,
+		const void* positions, size_t vertexNum, size_t positionStride, const Config& config = {});
+
+	// writes GetTriangleNum() * 3 mesh indices in meshlet order,
+	// meshlet i is [primitiveOffset * 3, (primitiveOffset + primitiveNum) * 3)
+	void UnpackIndices(const MeshletMesh& mesh, std::uint32_t* dst);
+
+	// [summary]
+	// normalized planes (a, b, c, d), inside: a * x + b * y + c * z + d >= 0
+	// order: left, right, bottom, top, near, far
+	// - m: row-major matrix for row vectors (p * m, DirectXMath), D3D clip space (0 <= z <= w)
+	//   pass world * view * proj for planes in object space
+	void ExtractFrustumPlanes(const float m[16], float planes[6][4]);
+
+	struct CullStats {
+		size_t meshletNum{ 0 };
+		size_t frustumCulledNum{ 0 };
+		size_t backfaceCulledNum{ 0 };
+		size_t visibleTriangleNum{ 0 };
+	};
+
+	// [arguments]
+	// - planes, eye: in the space of the mesh
+	// - visible: cleared, then filled with the indices of the visible meshlets in ascending order
+	CullStats Cull(const MeshletMesh& mesh, const float planes[6][4], const float eye[3],
+		std::vector<std::uint32_t>& visible);
+}
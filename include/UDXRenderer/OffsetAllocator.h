@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace Ubpa {
+	// [summary]
+	// TLSF-style (two-level segregated fit) allocator of ranges in [0, size)
+	// - works on offsets only (elements, bytes, ...), the owner maps them to memory
+	// - O(1) allocate and free: free ranges are binned by a 3-bit-mantissa float of their size,
+	//   two bitmap levels find the first bin that surely fits,
+	//   freed ranges merge with free neighbours at once
+	// - not thread-safe
+	class OffsetAllocator {
+	public:
+		static constexpr std::uint32_t InvalidOffset = static_cast<std::uint32_t>(-1);
+
+		struct Allocation {
+			std::uint32_t offset{ InvalidOffset };
+			std::uint32_t node{ InvalidOffset }; // for Free()
+
+			bool IsNull() const noexcept { return offset == InvalidOffset; }
+		};
+
+		struct Stats {
+			std::uint32_t size{ 0 };
+			std::uint32_t freeNum{ 0 };
+			std::uint32_t largestFreeRange{ 0 };
+			std::uint32_t freeRangeNum{ 0 };
+			std::uint32_t allocationNum{ 0 };
+		};
+
+		explicit OffsetAllocator(std::uint32_t size);
+
+		// returns a null allocation if no free range can hold num
+		Allocation Allocate(std::uint32_t num);
+		void Free(const Allocation& allocation);
+
+		std::uint32_t GetSize(const Allocation& allocation) const;
+		Stats GetStats() const;
+
+		// bin of the range sizes, exposed for tests
+		static std::uint32_t SizeToBinRoundDown(std::uint32_t size) noexcept;
+		static std::uint32_t SizeToBinRoundUp(std::uint32_t size) noexcept;
+		static std::uint32_t BinToSize(std::uint32_t bin) noexcept;
+
+	private:
+		static constexpr std::uint32_t SLBits = 3;
+		static constexpr std::uint32_t SLNum = 1 << SLBits;
+		static constexpr std::uint32_t FLNum = 32;
+		static constexpr std::uint32_t BinNum = FLNum * SLNum;
+		static constexpr std::uint32_t Null = static_cast<std::uint32_t>(-1);
+
+		struct Node {
+			std::uint32_t offset{ 0 };
+			std::uint32_t size{ 0 };
+			bool used{ false };
+			// address-ordered neighbours
+			std::uint32_t prev{ Null };
+			std::uint32_t next{ Null };
+			// free list of the bin
+			std::uint32_t binPrev{ Null };
+			std::uint32_t binNext{ Null };
+		};
+
+		std::uint32_t NewNode();
+		void LinkFree(std::uint32_t node);
+		void UnlinkFree(std::uint32_t node);
+		std::uint32_t FindBin(std::uint32_t minBin) const noexcept;
+
+		std::uint32_t size;
+		std::uint32_t freeNum;
+		std::uint32_t allocationNum{ 0 };
+
+		std::uint32_t flBitmap{ 0 };
+		std::uint8_t slBitmaps[FLNum]{};
+		std::uint32_t binHeads[BinNum];
+
+		std::vector<Node> nodes;
+		std::vector<std::uint32_t> freeNodes; // unused node slots
+	};
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Ubpa {
+	// [summary]
+	// packed asset archive: many files in one, found through a hashed table of contents
+	// - layout: header, entry data, then the TOC (entries sorted by path hash, block table, names),
+	//   the reader loads the whole TOC with one read on Open
+	// - paths are normalized (lower case, '/', no "." or ".." segments) and hashed with 64-bit FNV-1a
+	// - entries are stored raw or split into fixed-size blocks compressed with LZCodec
+	//   (a block that doesn't shrink is stored raw), so ranges of an entry are read and decoded alone
+	// - little-endian, the structs below are the file layout
+	// [usage]
+	// PackWriter writer; writer.Open(path); writer.Add("textures/a.dds", data, size); writer.Finish();
+	// PackArchive archive; archive.Open(path);
+	// auto e = archive.Find("textures/a.dds"); archive.Read(e, buffer);
+	// archive.ReadBatch(requests, num); // few large sequential reads for many entries
+	class PackArchive {
+	public:
+		static constexpr std::uint32_t Magic = 0x4B415055; // "UPAK"
+		static constexpr std::uint32_t Version = 1;
+		static constexpr std::uint32_t InvalidEntry = static_cast<std::uint32_t>(-1);
+
+		enum class Codec : std::uint32_t { None, LZ };
+
+		struct Header {
+			std::uint32_t magic;
+			std::uint32_t version;
+			std::uint32_t entryNum;
+			std::uint32_t blockSize; // uncompressed bytes per block, the last block of an entry may be shorter
+			std::uint64_t tocOffset; // Entry[entryNum], Block[blockNum], names
+			std::uint64_t tocSize;
+			std::uint32_t blockNum;
+			std::uint32_t nameSize;
+		};
+
+		struct Entry {
+			std::uint64_t hash;       // HashPath of the name, entries are sorted by (hash, name)
+			std::uint64_t dataOffset; // bytes from the start of the file
+			std::uint64_t size;       // uncompressed
+			std::uint64_t storedSize; // in the file
+			std::uint32_t blockOffset; // Codec::LZ: into the block table
+			std::uint32_t blockNum;
+			std::uint32_t nameOffset;
+			std::uint32_t nameLength;
+			Codec codec;
+			std::uint32_t padding;
+		};
+
+		// a block is stored raw if storedSize equals its uncompressed size
+		struct Block {
+			std::uint32_t storedOffset; // from the entry's dataOffset
+			std::uint32_t storedSize;
+		};
+
+		struct Config {
+			// reads of neighbouring entries are merged if the gap between them is at most maxGap bytes
+			std::uint64_t maxGap{ 64 * 1024 };
+			// size of the pooled staging buffers, a larger entry gets a buffer of its own size
+			size_t stagingSize{ 4 * 1024 * 1024 };
+		};
+
+		struct ReadRequest {
+			std::uint32_t entry{ InvalidEntry };
+			void* dst{ nullptr }; // GetSize(entry) bytes
+			bool succeeded{ false };
+		};
+
+		struct Stats {
+			size_t readNum{ 0 };        // reads of the file
+			std::uint64_t readBytes{ 0 };
+			std::uint64_t decodedBytes{ 0 };
+		};
+
+		static std::string NormalizePath(std::string_view path);
+		// of the normalized path
+		static std::uint64_t HashPath(std::string_view normalizedPath) noexcept;
+
+		PackArchive();
+		explicit PackArchive(Config config);
+		~PackArchive();
+
+		// returns false if the file can't be read or isn't a valid archive
+		bool Open(const std::filesystem::path& path);
+		void Close();
+		bool IsOpen() const noexcept { return file.is_open(); }
+
+		size_t GetEntryNum() const noexcept { return entries.size(); }
+		const Entry& GetEntry(std::uint32_t entry) const noexcept { return entries[entry]; }
+		std::string_view GetName(std::uint32_t entry) const noexcept;
+		std::uint64_t GetSize(std::uint32_t entry) const noexcept { return entries[entry].size; }
+
+		// returns InvalidEntry if there is no such entry, the path is normalized first
+		std::uint32_t Find(std::string_view path) const;
+
+		// thread-safe, the file reads are serialized, decoding isn't
+		// return false on read errors and corrupt data
+		bool Read(std::uint32_t entry, void* dst) const;
+		bool Read(std::uint32_t entry, std::vector<std::uint8_t>& dst) const;
+		// [offset, offset + size) of the uncompressed entry, reads and decodes just the blocks covering it
+		bool ReadRange(std::uint32_t entry, std::uint64_t offset, size_t size, void* dst) const;
+		// sorts the requests by file offset and merges neighbours into large reads through pooled buffers
+		// returns true if every request succeeded
+		bool ReadBatch(ReadRequest* requests, size_t num) const;
+
+		Stats GetStats() const;
+
+	private:
+		class BufferPool;
+
+		bool ReadFile(std::uint64_t offset, void* dst, size_t size) const;
+		// stored: the bytes of blocks [firstBlock, ...) of the entry, starting at the first one
+		bool Decode(const Entry& entry, const std::uint8_t* stored, std::uint32_t firstBlock,
+			std::uint32_t lastBlock, std::uint8_t* dst) const;
+		size_t BlockRawSize(const Entry& entry, std::uint32_t block) const noexcept;
+
+		Config config;
+		Header header{};
+		std::vector<Entry> entries;
+		std::vector<Block> blocks;
+		std::string names;
+
+		mutable std::ifstream file;
+		mutable std::mutex fileMutex;
+		// counters of Stats, bumped by readers without taking fileMutex
+		mutable std::atomic<size_t> readNum{ 0 };
+		mutable std::atomic<std::uint64_t> readBytes{ 0 };
+		mutable std::atomic<std::uint64_t> decodedBytes{ 0 };
+		std::unique_ptr<BufferPool> bufferPool;
+	};
+
+	// [summary]
+	// writes a PackArchive, the entry data is streamed to the file as it is added
+	class PackWriter {
+	public:
+		~PackWriter();
+
+		// blockSize: uncompressed bytes per block of Codec::LZ entries
+		bool Open(const std::filesystem::path& path, std::uint32_t blockSize = 64 * 1024);
+		// returns false on write errors and if an entry has the same (normalized) path
+		bool Add(std::string_view path, const void* data, size_t size,
+			PackArchive::Codec codec = PackArchive::Codec::LZ);
+		// writes the TOC and closes the file
+		bool Finish();
+
+	private:
+		std::ofstream file;
+		std::uint32_t blockSize{ 0 };
+		std::uint64_t offset{ 0 };
+		std::vector<PackArchive::Entry> entries;
+		std::vector<std::vector<PackArchive::Block>> entryBlocks;
+		std::vector<std::string> entryNames;
+		std::vector<std::uint8_t> scratch;
+	};
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// [summary]
+// hierarchical CPU profiler
+// - zones are scoped, nest, and carry string-literal names (the pointer is stored, not the string)
+// - every thread appends to its own lock-free ring of EventCapacity events, allocated on its first zone;
+//   long sessions keep the most recent events and the most recent FrameCapacity frame marks
+// - frames are exported to Chrome trace_event JSON (chrome://tracing, Perfetto)
+// zones compile out in release builds, define UDXR_PROFILER_ENABLED to 0/1 to override
+// [usage]
+// void Foo() {
+//     UDXR_PROFILE_FUNCTION();
+//     { UDXR_PROFILE_ZONE("Foo::Inner"); ... }
+// }
+// UDXR_PROFILE_FRAME(); // once per frame on the main thread
+
+#ifndef UDXR_PROFILER_ENABLED
+#  ifdef NDEBUG
+#    define UDXR_PROFILER_ENABLED 0
+#  else
+#    define UDXR_PROFILER_ENABLED 1
+#  endif
+#endif
+
+#define UDXR_PROFILER_CONCAT_IMPL(a, b) a##b
+#define UDXR_PROFILER_CONCAT(a, b) UDXR_PROFILER_CONCAT_IMPL(a, b)
+
+#if UDXR_PROFILER_ENABLED
+#  define UDXR_PROFILE_ZONE(name) ::Ubpa::Profiler::Zone UDXR_PROFILER_CONCAT(udxr_profile_zone_, __LINE__){ name }
+#  define UDXR_PROFILE_FUNCTION() UDXR_PROFILE_ZONE(__func__)
+#  define UDXR_PROFILE_FRAME() ::Ubpa::Profiler::Instance().MarkFrame()
+#else
+#  define UDXR_PROFILE_ZONE(name) ((void)0)
+#  define UDXR_PROFILE_FUNCTION() ((void)0)
+#  define UDXR_PROFILE_FRAME() ((void)0)
+#endif
+
+namespace Ubpa {
+	class Profiler {
+	public:
+		static Profiler& Instance() noexcept {
+			static Profiler instance;
+			return instance;
+		}
+
+		// name must outlive the profiler, e.g. a string literal or __func__
+		void BeginZone(const char* name) noexcept;
+		void EndZone() noexcept;
+
+		// main thread, at the start of every frame
+		void MarkFrame() noexcept;
+		size_t GetFrameNum() const noexcept;
+
+		// [summary]
+		// export events in frames [firstFrame, firstFrame + count) to Chrome trace_event JSON
+		// frame 0 is everything before the first MarkFrame(), frames whose mark left the ring start
+		// with the oldest events still kept
+		// safe while other threads keep profiling, in-flight and overwritten events are simply left out
+		void WriteChromeTrace(std::ostream& os,
+			size_t firstFrame = 0, size_t count = static_cast<size_t>(-1)) const;
+		bool WriteChromeTraceFile(const std::string& path,
+			size_t firstFrame = 0, size_t count = static_cast<size_t>(-1)) const;
+
+		// drop all events and frames
+		// not thread-safe, no other thread may be inside a zone
+		void Clear();
+
+		class Zone {
+		public:
+			explicit Zone(const char* name) noexcept { Instance().BeginZone(name); }
+			~Zone() { Instance().EndZone(); }
+			Zone(const Zone&) = delete;
+			Zone& operator=(const Zone&) = delete;
+		};
+
+		static constexpr size_t EventCapacity = 64 * 1024; // per thread
+		static constexpr size_t FrameCapacity = 4096;
+
+	private:
+		// fields are relaxed atomics, the exporter may read a slot while its thread overwrites it
+		struct Event {
+			std::atomic<const char*> name; // nullptr for an end event
+			std::atomic<std::int64_t> ns;
+		};
+
+		// written by its owning thread only, read by the exporter
+		struct ThreadBuffer {
+			std::uint32_t tid;
+			std::unique_ptr<Event[]> events; // ring of EventCapacity
+			std::atomic<size_t> num{ 0 };    // events ever written
+		};
+
+		// nullptr if the buffer couldn't be allocated, the thread's zones are dropped then
+		ThreadBuffer* GetThreadBuffer() noexcept;
+		static void Push(ThreadBuffer* buffer, const char* name) noexcept;
+		static std::int64_t Now() noexcept;
+
+		mutable std::mutex threadsMutex; // guards registration only
+		std::vector<std::unique_ptr<ThreadBuffer>> threads;
+		std::atomic<std::uint64_t> epoch{ 0 }; // bumped by Clear() to drop stale thread_local caches
+
+		mutable std::mutex framesMutex;
+		std::unique_ptr<std::int64_t[]> frameBegins; // ring of FrameCapacity, frame k starts at mark k - 1
+		size_t markNum{ 0 };
+		std::atomic<size_t> frameNum{ 0 };
+
+		Profiler();
+		~Profiler();
+	};
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+namespace Ubpa {
+	// [summary]
+	// deferred destruction, a release runs once the GPU has passed the fence it was retired with
+	// - fence values are plain counters, so it can be driven by a simulated fence in tests
+	// - releases are expected in non-decreasing fence order,
+	//   an out-of-order one waits for the ones retired before it (later, never earlier)
+	// - thread-safe, releases run on the thread calling Collect() / Flush(), outside the lock
+	// [usage]
+	// queue.Retire(fenceValueOfLastUse, [rsrc]() { rsrc->Release(); });
+	// queue.Collect(fence->GetCompletedValue()); // once per frame
+	class RetireQueue {
+	public:
+		RetireQueue() = default;
+		// pending releases must be flushed (after the GPU is idle) before destruction
+		~RetireQueue();
+
+		RetireQueue(const RetireQueue&) = delete;
+		RetireQueue& operator=(const RetireQueue&) = delete;
+
+		void Retire(std::uint64_t fence, std::function<void()> release);
+
+		// run the releases with fence <= completedFence, returns their number
+		size_t Collect(std::uint64_t completedFence);
+		// run every pending release, only when the GPU is idle
+		size_t Flush();
+
+		size_t GetPendingNum() const;
+		std::uint64_t GetReleasedNum() const;
+
+	private:
+		struct Entry {
+			std::uint64_t fence;
+			std::function<void()> release;
+		};
+
+		mutable std::mutex m;
+		std::deque<Entry> entries;
+		std::uint64_t releasedNum{ 0 }; // released so far
+	};
+}
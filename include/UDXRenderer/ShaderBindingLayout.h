@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Ubpa {
+	// [summary]
+	// root signature layout generated from the resource bindings of shaders, no GPU code
+	// - the bindings of the stages of a pipeline (e.g. from D3D12ShaderBindingLayout::Reflect) are merged,
+	//   a register bound by several stages is visible to all of them
+	// - a single constant buffer, structured / raw buffer SRV or UAV becomes a root descriptor,
+	//   other CBVs / SRVs / UAVs go to one descriptor table per visibility and samplers to one
+	//   sampler table per visibility, an unbounded array gets a table of its own
+	// - samplers s0 .. s<staticSamplerNum - 1> in space 0 are static samplers of the root signature
+	// - root descriptors come first, then the tables; if the layout exceeds 64 DWORDs, the last
+	//   root descriptors are moved into the tables
+	// - the root parameter of a binding is looked up by its HLSL name (GetSlot),
+	//   the name in the first stage binding the register
+	// [usage]
+	// ShaderBindingLayout layout;
+	// std::vector<ShaderBindingLayout::Binding> stages[] = { Reflect(vs), Reflect(ps) };
+	// if (layout.Build(stages, 2) != ShaderBindingLayout::BuildResult::Success) ...
+	// cmdList->SetGraphicsRootConstantBufferView(layout.GetSlot("cbPerObject").rootIndex, address);
+	class ShaderBindingLayout {
+	public:
+		static constexpr std::uint32_t UnboundedCount = static_cast<std::uint32_t>(-1);
+		static constexpr std::uint32_t InvalidIndex = static_cast<std::uint32_t>(-1);
+
+		enum class ResourceType {
+			CBV,
+			SRV,       // textures, typed buffers, tbuffers: tables only
+			BufferSRV, // structured and raw buffers
+			UAV,       // textures, typed buffers and buffers with a counter: tables only
+			BufferUAV, // structured and raw buffers
+			Sampler
+		};
+
+		// the values of D3D12_SHADER_VISIBILITY
+		enum class Visibility {
+			All,
+			Vertex,
+			Hull,
+			Domain,
+			Geometry,
+			Pixel
+		};
+
+		struct Binding {
+			std::string name;
+			ResourceType type;
+			std::uint32_t reg;
+			std::uint32_t space;
+			std::uint32_t count; // array size, UnboundedCount for T name[]
+			Visibility visibility;
+		};
+
+		enum class ParamType { CBV, SRV, UAV, Table, SamplerTable };
+
+		struct Range {
+			ResourceType type;
+			std::uint32_t reg;
+			std::uint32_t space;
+			std::uint32_t count;
+			std::uint32_t offset; // descriptors from the start of the table
+		};
+
+		struct Param {
+			ParamType type;
+			Visibility visibility;
+			std::uint32_t reg;   // root descriptors
+			std::uint32_t space; // root descriptors
+			std::vector<Range> ranges; // tables
+		};
+
+		// root parameter of a binding, InvalidIndex for static samplers and unknown names
+		struct Slot {
+			std::uint32_t rootIndex{ InvalidIndex };
+			std::uint32_t tableOffset{ 0 };
+		};
+
+		struct Config {
+			std::uint32_t staticSamplerNum{ 6 }; // DXRenderer::GetStaticSamplers()
+			bool useRootDescriptors{ true };
+		};
+
+		enum class BuildResult {
+			Success,
+			Conflict, // stages bind overlapping registers with different types or array sizes
+			TooLarge  // more than 64 DWORDs even without root descriptors
+		};
+
+		// [summary]
+		// merges the bindings of stageNum stages and generates the root parameters
+		// the layout is left empty unless Success
+		BuildResult Build(const std::vector<Binding>* stages, size_t stageNum);
+		BuildResult Build(const std::vector<Binding>* stages, size_t stageNum, const Config& config);
+
+		// merged, one per register range
+		const std::vector<Binding>& GetBindings() const noexcept { return bindings; }
+		const std::vector<Param>& GetParams() const noexcept { return params; }
+		// registers of the used static samplers (space 0)
+		const std::vector<std::uint32_t>& GetStaticSamplers() const noexcept { return staticSamplers; }
+		// DWORDs of the root signature, root descriptor 2, table 1
+		std::uint32_t GetSize() const noexcept;
+
+		Slot GetSlot(std::string_view name) const noexcept;
+
+	private:
+		std::vector<Binding> bindings;
+		std::vector<Slot> slots; // [binding]
+		std::vector<Param> params;
+		std::vector<std::uint32_t> staticSamplers;
+	};
+}
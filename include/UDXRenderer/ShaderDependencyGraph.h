@@ -0,0 +1,51 @@
+#pragma once
+
+#include <filesystem>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Ubpa {
+	// [summary]
+	// include dependencies of shaders compiled from files, no GPU code
+	// - a shader is an entry point compiled from a source file, several shaders may share a file
+	// - #include "..." and <...> are resolved relative to the including file,
+	//   includes that don't exist are kept (the compiler reports them, and they may appear later)
+	// - paths are absolute and lexically normal
+	// - a file no shader reaches any more (removed shader, include dropped by Rescan) is forgotten
+	// [usage]
+	// graph.AddShader("deferLightingPS", L"shaders/deferLighting.hlsl");
+	// on changes: for (auto& file : changed) graph.Rescan(file);
+	//             recompile graph.GetAffectedShaders(changed)
+	class ShaderDependencyGraph {
+	public:
+		// names of the #include directives of an HLSL source, comments are skipped
+		static std::vector<std::string> ScanIncludes(std::string_view source);
+		static std::filesystem::path Normalize(const std::filesystem::path& path);
+
+		// scans the file and, recursively, the files it includes
+		void AddShader(std::string name, const std::filesystem::path& file);
+		void RemoveShader(const std::string& name);
+		bool HasShader(const std::string& name) const { return shaders.find(name) != shaders.end(); }
+
+		// reads the file's include list again (and of new includes), after it changed
+		void Rescan(const std::filesystem::path& file);
+
+		// shaders whose file or (transitive) includes are in files, in name order
+		std::vector<std::string> GetAffectedShaders(const std::vector<std::filesystem::path>& files) const;
+		// every file a shader reaches, the ones to watch, in path order
+		std::vector<std::filesystem::path> GetFiles() const;
+		// direct includes of a scanned file
+		const std::vector<std::filesystem::path>& GetIncludes(const std::filesystem::path& file) const;
+
+	private:
+		// file is normalized, scans it and its includes not scanned yet
+		void Scan(const std::filesystem::path& file);
+		// forgets the scanned files no shader reaches
+		void Prune();
+
+		std::map<std::string, std::filesystem::path> shaders;
+		std::map<std::filesystem::path, std::vector<std::filesystem::path>> includes; // scanned files
+	};
+}
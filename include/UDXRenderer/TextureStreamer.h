@@ -0,0 +1,141 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Ubpa {
+	// [summary]
+	// mip residency of streamed textures under a memory budget, no GPU code
+	// - a texture of mipNum mips is resident from some mip r on (mips [r, mipNum) are in memory),
+	//   it registers with its minResidentMips smallest mips, which are never evicted
+	// - every frame the renderer requests the finest mip each texture is sampled at (EstimateMip),
+	//   Update() turns the requests into stream-in and evict operations
+	// - stream-ins are queued by the number of missing mips, the largest gap first;
+	//   evictions only drop mips finer than wanted, least recently requested textures first,
+	//   and only when a stream-in (or a lowered budget) needs the memory
+	// - a stream-in reserves its whole new mip chain until OnStreamedIn (the old one is released then),
+	//   an evict is done at once, CancelEvict rolls it back if the smaller chain can't be created
+	// [usage]
+	// auto id = streamer.Register({ residentBytes, minResidentMips });
+	// each frame:
+	//   streamer.Request(id, TextureStreamer::EstimateMip(size, uvDensity, distance, proj._22, height));
+	//   for (const auto& op : streamer.Update()) load or shrink op.texture to mips [op.mip, mipNum)
+	//   streamer.OnStreamedIn(id); // once the mips of a stream-in are in memory
+	class TextureStreamer {
+	public:
+		using TextureID = std::uint32_t;
+
+		struct Desc {
+			// [m]: bytes of the texture with mips [m, mipNum) resident, non-increasing, mipNum = size()
+			std::vector<std::uint64_t> residentBytes;
+			std::uint32_t minResidentMips{ 1 };
+		};
+
+		struct Config {
+			std::uint64_t budget{ 256ull << 20 };
+			// stream-ins started by one Update, the first one is always started
+			std::uint64_t maxStreamInBytesPerUpdate{ 32ull << 20 };
+			std::uint32_t maxPendingNum{ 8 };
+			// updates a request is kept for without new ones, then the texture is wanted at its smallest mips
+			std::uint32_t requestLifetime{ 30 };
+		};
+
+		enum class OpType { StreamIn, Evict };
+
+		struct Op {
+			OpType type;
+			TextureID texture;
+			std::uint32_t mip;         // the texture becomes resident from this mip on
+			std::uint32_t previousMip; // the resident mip before the op
+		};
+
+		struct TextureState {
+			std::uint32_t mipNum;
+			std::uint32_t minResidentMip; // mipNum - minResidentMips, the coarsest residentMip
+			std::uint32_t residentMip;
+			std::uint32_t pendingMip;     // of a stream-in in flight, residentMip if there is none
+			std::uint32_t wantedMip;
+			std::uint64_t lastRequest;    // update index
+		};
+
+		struct Stats {
+			std::uint64_t budget{ 0 };
+			std::uint64_t residentBytes{ 0 };
+			std::uint64_t pendingBytes{ 0 };
+			std::uint64_t wantedBytes{ 0 }; // if every texture were resident from its wanted mip on
+			size_t textureNum{ 0 };
+			size_t pendingNum{ 0 };
+			size_t streamInNum{ 0 };        // started so far
+			size_t evictNum{ 0 };           // done so far, cancelled ones aren't counted
+		};
+
+		// [summary]
+		// the mip a texture is sampled at: log2 of the texels per pixel of mip 0, at least 0
+		// [arguments]
+		// - textureSize: max(width, height) of mip 0
+		// - uvDensity: uv units per world unit of the surface (ComputeUVDensity divided by the world scale)
+		// - distance: from the camera to the nearest point of the surface
+		// - projScaleY: proj._22 of the projection matrix (1 / tan(fovY / 2))
+		// - viewportHeight: pixels
+		static float EstimateMip(std::uint32_t textureSize, float uvDensity, float distance,
+			float projScaleY, float viewportHeight) noexcept;
+
+		// sqrt(uv area / surface area) of the triangles, 0 for a degenerate mesh
+		// positions: float3, uvs: float2, strides in bytes
+		static float ComputeUVDensity(const std::uint32_t* indices, size_t indexNum,
+			const void* positions, size_t positionStride,
+			const void* uvs, size_t uvStride) noexcept;
+
+		TextureStreamer();
+		explicit TextureStreamer(Config config);
+
+		// resident from minResidentMip on
+		TextureID Register(const Desc& desc);
+		// the caller frees the texture's memory, a stream-in in flight is dropped
+		void Unregister(TextureID id);
+
+		// mip: from EstimateMip, the finest request of an update is kept
+		void Request(TextureID id, float mip) noexcept;
+
+		// the operations of this update in the order they should run, valid until the next call
+		const std::vector<Op>& Update();
+
+		// completes the stream-in of the texture
+		void OnStreamedIn(TextureID id);
+		// e.g. the load failed, the texture stays at its resident mip
+		void CancelStreamIn(TextureID id);
+		// the evict couldn't be done, the texture is resident from mip (Op::previousMip) on again
+		// call it before the next Update, which evicts elsewhere if the budget is exceeded
+		void CancelEvict(TextureID id, std::uint32_t mip);
+
+		const TextureState& GetState(TextureID id) const noexcept { return textures[id].state; }
+		std::uint64_t GetResidentBytes(TextureID id, std::uint32_t mip) const noexcept {
+			return textures[id].residentBytes[mip];
+		}
+
+		void SetBudget(std::uint64_t budget) noexcept { config.budget = budget; }
+		const Config& GetConfig() const noexcept { return config; }
+		Stats GetStats() const noexcept;
+
+	private:
+		struct Texture {
+			std::vector<std::uint64_t> residentBytes; // empty if unregistered
+			TextureState state;
+			float request;
+		};
+
+		std::uint64_t UsedBytes() const noexcept { return residentBytes + pendingBytes; }
+
+		Config config;
+		std::vector<Texture> textures;
+		std::vector<TextureID> freeIDs;
+		std::vector<Op> ops;
+		std::uint64_t updateIndex{ 0 };
+		std::uint64_t residentBytes{ 0 };
+		std::uint64_t pendingBytes{ 0 }; // whole new mip chains of the stream-ins in flight
+		size_t pendingNum{ 0 };
+		size_t streamInNum{ 0 };
+		size_t evictNum{ 0 };
+	};
+}
@@ -1,11 +1,31 @@
 #pragma once
 
+#include "DescriptorAllocator.h"
+#include "D3D12DynamicMesh.h"
+#include "D3D12MeshPool.h"
+#include "D3D12RootSignatureCache.h"
+#include "D3D12ShaderHotReload.h"
+#include "D3D12TransferEngine.h"
+#include "MemoryTracker.h"
+#include "Meshlets.h"
+#include "MeshSimplifier.h"
+#include "RetireQueue.h"
+#include "ShaderBindingLayout.h"
+#include "TextureStreamer.h"
+
 #include <UDX12/UDX12.h>
 
 #include <array>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
 #include <string>
+#include <string_view>
+#include <vector>
 
 namespace Ubpa {
+	class PackArchive;
+
 	class DXRenderer {
 	public:
 		static DXRenderer& Instance() noexcept {
@@ -15,7 +35,14 @@ namespace Ubpa {
 
 		DirectX::ResourceUploadBatch& GetUpload() const;
 
-		DXRenderer& Init(ID3D12Device* device);
+		// [arguments]
+		// - srvPageSize, maxSrvPageNum: texture SRVs live in pages of srvPageSize descriptors,
+		//   each page is a CPU-only heap plus the same amount of space in the shader-visible
+		//   CSU heap of UDX12::DescriptorHeapMngr, added on demand up to maxSrvPageNum pages
+		//   and kept until Release()
+		// the CSU heap can't grow, size it with GetSrvCapacity() in mind: pages stop being added
+		// once it is full (reported through OutputDebugString), below maxSrvPageNum
+		DXRenderer& Init(ID3D12Device* device, UINT srvPageSize = 128, UINT maxSrvPageNum = 64);
 		void Release();
 
 		// support tex2d and tex cube
@@ -23,6 +50,15 @@ namespace Ubpa {
 			std::string name, std::wstring_view filename);
 		DXRenderer& RegisterDDSTextureArrayFromFile(DirectX::ResourceUploadBatch& upload,
 			std::string name, const std::wstring_view* filenameArr, UINT num);
+		// the data is copied to the upload batch, free it after the call
+		DXRenderer& RegisterDDSTextureFromMemory(DirectX::ResourceUploadBatch& upload,
+			std::string name, const void* data, size_t size);
+		// all the files are read with one batched read of the archive
+		// throws if a path isn't in the archive or can't be read
+		DXRenderer& RegisterDDSTextureFromArchive(DirectX::ResourceUploadBatch& upload,
+			std::string name, const PackArchive& archive, std::string_view path);
+		DXRenderer& RegisterDDSTextureArrayFromArchive(DirectX::ResourceUploadBatch& upload,
+			std::string name, const PackArchive& archive, const std::string_view* pathArr, UINT num);
 
 		UDX12::MeshGeometry& RegisterStaticMeshGeometry(
 			DirectX::ResourceUploadBatch& upload, std::string name,
@@ -34,6 +70,72 @@ namespace Ubpa {
 			const void* vb_data, UINT vb_count, UINT vb_stride,
 			const void* ib_data, UINT ib_count, DXGI_FORMAT ib_format);
 
+		// [summary]
+		// mesh rewritten every frame (cloth, particles, procedural geometry), see D3D12DynamicMesh
+		// - one copy per frame in flight, partial updates through MapVertices / MapIndices
+		// - copyNum: frames in flight, BeginFrame(frameIndex) / Commit() it every frame it changes or is drawn
+		D3D12DynamicMesh& RegisterDynamicMesh(std::string name,
+			UINT vertexStride, UINT vertexCapacity,
+			DXGI_FORMAT indexFormat, UINT indexCapacity,
+			UINT copyNum);
+		D3D12DynamicMesh& GetDynamicMesh(const std::string& name) const;
+
+		// [summary]
+		// pooled static meshes, every mesh of a pool shares one VB/IB binding
+		// - register one pool per (vertex stride, index format)
+		// - a pooled mesh is a pair of ranges, draw it with its BaseVertexLocation / StartIndexLocation
+		// - submeshes (optional) are draw ranges of the mesh, see D3D12MeshPool::Submesh
+		DXRenderer& RegisterMeshPool(std::string name,
+			UINT vertexStride, UINT vertexCapacity,
+			DXGI_FORMAT indexFormat, UINT indexCapacity);
+		D3D12MeshPool& GetMeshPool(const std::string& name) const;
+		// [arguments]
+		// - cmdList: records the copy, must execute before the command lists drawing the mesh
+		// - fence: the value signaled after cmdList executes, retires the staging buffer
+		// throws (E_OUTOFMEMORY) if the pool is full
+		const D3D12MeshPool::Mesh& RegisterPooledMeshGeometry(
+			ID3D12GraphicsCommandList* cmdList, UINT64 fence,
+			const std::string& poolName, std::string name,
+			const void* vb_data, UINT vb_count,
+			const void* ib_data, UINT ib_count,
+			const D3D12MeshPool::Submesh* submeshes = nullptr, UINT submeshNum = 0);
+		// [summary]
+		// copies through the transfer engine instead, the direct queue doesn't wait for it on the CPU
+		// returns the ticket to complete before the mesh is drawn (IsComplete, or QueueWait on the direct queue)
+		// throws (E_OUTOFMEMORY) if the pool is full
+		D3D12TransferEngine::Ticket UploadPooledMeshGeometry(
+			const std::string& poolName, std::string name,
+			const void* vb_data, UINT vb_count,
+			const void* ib_data, UINT ib_count,
+			const D3D12MeshPool::Submesh* submeshes = nullptr, UINT submeshNum = 0);
+		const D3D12MeshPool::Mesh& GetPooledMeshGeometry(const std::string& name) const;
+		D3D12MeshPool& GetPooledMeshGeometryPool(const std::string& name) const;
+		// ranges are reused after fence completes
+		DXRenderer& UnregisterPooledMeshGeometry(const std::string& name, UINT64 fence);
+
+		// [summary]
+		// meshlets of a (pooled) mesh geometry, built from its CPU-side indices and positions
+		// - stored under the mesh name, removed with the mesh
+		// - vertices of the meshlets index the mesh's vertices (add BaseVertexLocation for pooled meshes)
+		// [arguments]
+		// - positions: float3 at positions + i * positionStride (bytes)
+		const Meshlets::MeshletMesh& RegisterMeshlets(const std::string& meshName,
+			const std::uint32_t* indices, size_t indexNum,
+			const void* positions, size_t vertexNum, size_t positionStride,
+			const Meshlets::Config& config = {});
+		// prebuilt, e.g. when the index buffer was uploaded in meshlet order (Meshlets::UnpackIndices)
+		const Meshlets::MeshletMesh& RegisterMeshlets(const std::string& meshName, Meshlets::MeshletMesh meshlets);
+		const Meshlets::MeshletMesh& GetMeshlets(const std::string& meshName) const;
+		bool HasMeshlets(const std::string& meshName) const;
+
+		// [summary]
+		// LOD chain of a (pooled) mesh geometry, stored under the mesh name and removed with the mesh
+		// - the LODs are index ranges relative to the mesh's first index, LOD 0 is the full mesh
+		// - upload MeshSimplifier::LodChain::indices as the mesh's indices
+		DXRenderer& RegisterMeshLods(const std::string& meshName, std::vector<MeshSimplifier::Lod> lods);
+		const std::vector<MeshSimplifier::Lod>& GetMeshLods(const std::string& meshName) const;
+		bool HasMeshLods(const std::string& meshName) const;
+
 		// [summary]
 		// compile shader file to bytecode
 		// [arguments]
@@ -48,11 +150,38 @@ namespace Ubpa {
 			const D3D_SHADER_MACRO* defines,
 			const std::string& entrypoint,
 			const std::string& target);
+		// source in a PackArchive, #include "..." is looked up in the archive relative to the including file
+		ID3DBlob* RegisterShaderByteCode(
+			std::string name,
+			const PackArchive& archive,
+			std::string_view path,
+			const D3D_SHADER_MACRO* defines,
+			const std::string& entrypoint,
+			const std::string& target);
 
+		// [summary]
+		// root signatures go through a D3D12RootSignatureCache, names whose serialized blobs are
+		// identical share one ID3D12RootSignature (compare GetRootSignature pointers to skip rebinds)
+		// throws if the desc can't be serialized or created
 		DXRenderer& RegisterRootSignature(
 			std::string name,
 			const D3D12_ROOT_SIGNATURE_DESC* descs);
+		// 1.1 descs (e.g. with DATA_STATIC ranges) are converted to 1.0 if the device doesn't support them
+		DXRenderer& RegisterRootSignature(
+			std::string name,
+			const D3D12_VERSIONED_ROOT_SIGNATURE_DESC* desc);
+		// [summary]
+		// root signature (1.1) generated from the bindings of registered shaders (e.g. the VS and PS of a pass),
+		// see ShaderBindingLayout, the static samplers are GetStaticSamplers()
+		// - bind with the root index of GetRootSignatureLayout(name).GetSlot(HLSL name)
+		// throws (E_INVALIDARG) if the shaders bind a register differently or the layout doesn't fit
+		DXRenderer& RegisterRootSignature(
+			std::string name,
+			const std::string* shaderNameArr, UINT num,
+			D3D12_ROOT_SIGNATURE_FLAGS flags = D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
 
+		// with shader hot reload, the desc is kept to rebuild the PSO (stream output isn't supported),
+		// its root signature must stay registered
 		DXRenderer& RegisterPSO(
 			std::string name,
 			const D3D12_GRAPHICS_PIPELINE_STATE_DESC* desc);
@@ -60,9 +189,127 @@ namespace Ubpa {
 		DXRenderer& RegisterRenderTexture2D(std::string name, UINT width, UINT height, DXGI_FORMAT format);
 		DXRenderer& RegisterRenderTextureCube(std::string name, UINT size, DXGI_FORMAT format);
 
+		// [summary]
+		// deferred destruction of objects that frames in flight may still use
+		// - the name is removed at once (and can be registered again),
+		//   resources and descriptors are released by CollectRetired() after fence completes
+		// - fence: the value signaled after the last command list using the object
+		DXRenderer& UnregisterTexture(const std::string& name, UINT64 fence);
+		DXRenderer& UnregisterMeshGeometry(const std::string& name, UINT64 fence);
+		DXRenderer& UnregisterDynamicMesh(const std::string& name, UINT64 fence);
+		DXRenderer& UnregisterRootSignature(const std::string& name, UINT64 fence);
+		DXRenderer& UnregisterPSO(const std::string& name, UINT64 fence);
+
+		// call once per frame, returns the number of released objects
+		size_t CollectRetired(UINT64 completedFence);
+		// also takes the app's own objects, flushed by Release()
+		RetireQueue& GetRetireQueue() const;
+
+		// [summary]
+		// GPU memory of the resources created through DXRenderer, by category and name
+		// - textures, render textures, mesh geometries, mesh pools and their staging buffers,
+		//   dynamic meshes, SRV pages
+		// - uploads inside DirectX::ResourceUploadBatch aren't visible and aren't recorded,
+		//   the staging buffers of the transfer engine are (Upload)
+		// - also takes the app's own resources (e.g. the frame-graph render targets),
+		//   it outlives Release(), what is left once the app has untracked its own leaked
+		MemoryTracker& GetMemoryTracker() const;
+
+		// CPU-only copy of the SRV, use it as the source of CopyDescriptors
 		D3D12_CPU_DESCRIPTOR_HANDLE GetTextureSrvCpuHandle(const std::string& name, UINT index = 0) const;
 		D3D12_GPU_DESCRIPTOR_HANDLE GetTextureSrvGpuHandle(const std::string& name, UINT index = 0) const;
 
+		// live/free/fragmentation of the texture SRV pages
+		DescriptorAllocator::Stats GetSrvAllocatorStats() const;
+		// shader-visible descriptors the SRV pages take at most, srvPageSize * maxSrvPageNum
+		UINT GetSrvCapacity() const;
+
+		// [summary]
+		// bindless mode, every texture SRV also gets a stable index into one shader-visible table
+		// - call after UDX12::DescriptorHeapMngr::Init and before registering textures from other threads,
+		//   textures registered before are added too
+		// - capacity descriptors are reserved from the CSU heap of UDX12::DescriptorHeapMngr,
+		//   recorded in the memory tracker (DescriptorHeap) as "bindless table"
+		// [usage]
+		// root signature: table of GetBindlessRange(), bound once to GetBindlessTable()
+		// HLSL: Texture2D gTextures[] : register(t0, space1); gTextures[index from material constants]
+		DXRenderer& EnableBindless(UINT capacity = 4096);
+		bool IsBindlessEnabled() const;
+		D3D12_GPU_DESCRIPTOR_HANDLE GetBindlessTable() const;
+		// index of the index-th SRV of the texture, elements of a texture array are consecutive
+		UINT GetTextureBindlessIndex(const std::string& name, UINT index = 0) const;
+		DescriptorAllocator::Stats GetBindlessStats() const;
+		// unbounded SRV range [t<baseRegister>, ...) in register space
+		CD3DX12_DESCRIPTOR_RANGE GetBindlessRange(UINT baseRegister = 0, UINT space = 1) const;
+
+		// [summary]
+		// runtime uploads on a dedicated copy queue, see D3D12TransferEngine
+		// - used by texture streaming and UploadPooledMeshGeometry,
+		//   GetUpload() still takes the uploads of the other Register* functions
+		// - call GetTransferEngine().Submit() once per frame, after the frame's uploads
+		DXRenderer& EnableTransferEngine(UINT64 stagingSize = 64ull << 20);
+		bool IsTransferEngineEnabled() const;
+		D3D12TransferEngine& GetTransferEngine() const;
+
+		// [summary]
+		// development mode, shaders registered from files are recompiled on a background thread
+		// when their file or one of its includes changes, see D3D12ShaderHotReload
+		// - call before registering the shaders and PSOs, shaders from a PackArchive aren't reloaded
+		// - UpdateShaderHotReload swaps in the new bytecode and rebuilds the PSOs made from it,
+		//   GetPSO / GetShaderByteCode return the new ones from then on
+		// - the root signatures aren't regenerated, a PSO whose new shaders don't fit its root signature
+		//   fails to build, then none of the update's new shaders and PSOs are swapped in
+		// [usage]
+		// EnableShaderHotReload(); register shaders and PSOs
+		// each frame, before recording: UpdateShaderHotReload(fence)
+		DXRenderer& EnableShaderHotReload(std::chrono::milliseconds pollInterval = std::chrono::milliseconds{ 250 });
+		bool IsShaderHotReloadEnabled() const;
+		// [summary]
+		// call at a frame boundary
+		// - fence: the value signaled after the last command list using the current PSOs, retires them
+		// returns the number of rebuilt PSOs
+		size_t UpdateShaderHotReload(UINT64 fence);
+		D3D12ShaderHotReload::Stats GetShaderHotReloadStats() const;
+
+		// [summary]
+		// streamed DDS textures (tex2d and tex cube), see TextureStreamer
+		// - registered with their minResidentMips smallest mips, the files are kept on the CPU
+		//   and the larger mips are loaded from them on demand
+		// - a residency change recreates the texture with the new mip chain and new SRVs, which
+		//   replace the old ones once the upload completes, so re-query GetTextureBindlessIndex
+		//   (and the SRV handles) every frame
+		// - the elements of a texture array share the residency, mip m of the largest element
+		//   goes with the mips of the same size of the others
+		// - every upload goes through the transfer engine (EnableTransferEngine first),
+		//   the smallest mips of a new texture must be waited for before it is sampled
+		//   (GetTransferEngine().QueueWait on the direct queue)
+		// [usage]
+		// EnableTextureStreaming(config); RegisterStreamedDDSTextureArrayFromMemory(name, files);
+		// each frame: RequestTextureMip(name, mip) for every use, UpdateTextureStreaming(fence),
+		//   GetTransferEngine().Submit()
+		DXRenderer& EnableTextureStreaming(const TextureStreamer::Config& config);
+		bool IsTextureStreamingEnabled() const;
+		DXRenderer& RegisterStreamedDDSTextureArrayFromMemory(
+			std::string name, std::vector<std::vector<std::uint8_t>> files, UINT minResidentMips = 6);
+		// all the files are read with one batched read of the archive
+		DXRenderer& RegisterStreamedDDSTextureArrayFromArchive(
+			std::string name, const PackArchive& archive, const std::string_view* pathArr, UINT num,
+			UINT minResidentMips = 6);
+		bool IsStreamedTexture(const std::string& name) const;
+		// max(width, height) of mip 0 of the largest element, the textureSize of TextureStreamer::EstimateMip
+		UINT GetStreamedTextureSize(const std::string& name) const;
+		// mip: the finest mip the texture is sampled at this frame, the finest request of a frame is kept
+		DXRenderer& RequestTextureMip(const std::string& name, float mip);
+		// [summary]
+		// call once per frame: commits the textures whose uploads completed,
+		// then records the residency changes TextureStreamer::Update asks for to the transfer engine
+		// [arguments]
+		// - fence: the value signaled after the last command list of this frame, retires replaced textures
+		// returns the number of textures whose SRVs changed
+		size_t UpdateTextureStreaming(UINT64 fence);
+		const TextureStreamer& GetTextureStreamer() const;
+		TextureStreamer& GetTextureStreamer();
+
 		UDX12::DescriptorHeapAllocation& GetTextureRtvs(const std::string& name) const;
 
 		UDX12::MeshGeometry& GetMeshGeometry(const std::string& name) const;
@@ -70,6 +317,16 @@ namespace Ubpa {
 		ID3DBlob* GetShaderByteCode(const std::string& name) const;
 
 		ID3D12RootSignature* GetRootSignature(const std::string& name) const;
+		// only for root signatures generated from shaders
+		const ShaderBindingLayout& GetRootSignatureLayout(const std::string& name) const;
+
+		// [summary]
+		// the serialized blobs of the root signature cache on disk, load it before registering
+		// root signatures to create them up front, save it once they are registered
+		// Load returns false if the file is missing or stale (another format)
+		bool LoadRootSignatureCache(const std::filesystem::path& path);
+		bool SaveRootSignatureCache(const std::filesystem::path& path) const;
+		const D3D12RootSignatureCache::Stats& GetRootSignatureCacheStats() const;
 
 		ID3D12PipelineState* GetPSO(const std::string& name) const;
 
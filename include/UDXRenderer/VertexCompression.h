@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Ubpa::VertexCompression {
+	// [summary]
+	// quantized vertex formats, CPU encoder / decoder, input layout and HLSL decode generation
+	// - positions: 16-bit unorm against the mesh bounds (dequantize with QuantizationInfo)
+	// - normals, tangents: octahedral, 2x8 or 2x16-bit snorm
+	//   (with equal formats, normal and tangent share one 4-component element)
+	// - uvs: half floats
+	// - elements are 4-byte aligned, e.g. 16 bytes for Unorm16 / Oct8 + Oct8 / Half2
+	// [usage]
+	// auto mesh = VertexCompression::Encode(source, desc);
+	// mesh.error.maxPositionError, mesh.layout.stride, mesh.vertices
+	// VertexCompression::GenerateHLSL(mesh.layout) -> VertexIn + DecodeVertex()
+	// D3D12: ToD3D12InputLayout(mesh.layout) (D3D12VertexCompression.h)
+
+	enum class PositionFormat { Float3, Unorm16 };
+	enum class DirectionFormat { None, Float3, Oct8, Oct16 };
+	enum class UVFormat { None, Float2, Half2 };
+
+	struct Desc {
+		PositionFormat position = PositionFormat::Unorm16;
+		DirectionFormat normal = DirectionFormat::Oct16;
+		DirectionFormat tangent = DirectionFormat::None;
+		UVFormat uv = UVFormat::Half2;
+	};
+
+	// formats of the vertex elements, map 1:1 to DXGI formats
+	enum class ElementFormat {
+		Float2,    // R32G32_FLOAT
+		Float3,    // R32G32B32_FLOAT
+		Unorm16x4, // R16G16B16A16_UNORM
+		Snorm8x2,  // R8G8_SNORM
+		Snorm8x4,  // R8G8B8A8_SNORM
+		Snorm16x2, // R16G16_SNORM
+		Snorm16x4, // R16G16B16A16_SNORM
+		Half2      // R16G16_FLOAT
+	};
+
+	struct Element {
+		const char* semantic;   // POSITION, NORMAL, TANGENT, TEXCOORD
+		ElementFormat format;
+		std::uint32_t offset;
+	};
+
+	struct Layout {
+		Desc desc;
+		std::vector<Element> elements;
+		std::uint32_t stride{ 0 };
+		// normal and tangent share the NORMAL element (xy: normal, zw: tangent)
+		bool packedNormalTangent{ false };
+	};
+
+	Layout MakeLayout(const Desc& desc);
+
+	// pos = min + q * extent, q in [0, 1]^3
+	struct QuantizationInfo {
+		float min[3]{ 0.f, 0.f, 0.f };
+		float extent[3]{ 1.f, 1.f, 1.f };
+	};
+
+	struct ErrorMetrics {
+		float maxPositionError{ 0.f };  // mesh units
+		float rmsPositionError{ 0.f };
+		float maxNormalErrorDeg{ 0.f };
+		float maxTangentErrorDeg{ 0.f };
+		float maxUVError{ 0.f };
+	};
+
+	// attribute streams with a byte stride, null data for absent attributes
+	struct Stream {
+		const void* data{ nullptr };
+		size_t stride{ 0 };
+	};
+
+	struct SourceMesh {
+		size_t vertexNum{ 0 };
+		Stream positions; // float3
+		Stream normals;   // float3, unit length
+		Stream tangents;  // float3, unit length
+		Stream uvs;       // float2
+	};
+
+	struct EncodedMesh {
+		Layout layout;
+		QuantizationInfo quantization;
+		ErrorMetrics error;
+		size_t vertexNum{ 0 };
+		std::vector<std::uint8_t> vertices; // vertexNum * layout.stride
+	};
+
+	// error metrics are measured by decoding the result
+	EncodedMesh Encode(const SourceMesh& mesh, const Desc& desc);
+
+	struct DecodedVertex {
+		float position[3]{ 0.f, 0.f, 0.f };
+		float normal[3]{ 0.f, 0.f, 0.f };
+		float tangent[3]{ 0.f, 0.f, 0.f };
+		float uv[2]{ 0.f, 0.f };
+	};
+
+	DecodedVertex Decode(const EncodedMesh& mesh, size_t vertex);
+
+	// [summary]
+	// HLSL matching the layout:
+	// - struct VertexIn (input of the vertex shader)
+	// - struct DecodedVertex { float3 PosL; float3 NormalL; float3 TangentL; float2 TexC; }
+	// - DecodedVertex DecodeVertex(VertexIn vin, float3 quantMin, float3 quantExtent)
+	std::string GenerateHLSL(const Layout& layout);
+
+	// building blocks, exposed for tests
+	void OctEncode(const float n[3], float e[2]) noexcept;
+	void OctDecode(const float e[2], float n[3]) noexcept;
+	std::uint16_t FloatToHalf(float f) noexcept;
+	float HalfToFloat(std::uint16_t h) noexcept;
+}
@@ -0,0 +1,115 @@
+#include <UDXRenderer/D3D12DynamicMesh.h>
+
+#include <cassert>
+#include <cstring>
+
+using namespace Ubpa;
+using namespace std;
+
+namespace {
+    // returns the bytes copied
+    UINT64 CopyRanges(BYTE* dst, const BYTE* src, UINT stride, const vector<D3D12DynamicMesh::Range>& ranges) {
+        UINT64 bytes = 0;
+        for (const auto& range : ranges) {
+            size_t offset = size_t{ range.first } * stride;
+            size_t size = size_t{ range.num } * stride;
+            memcpy(dst + offset, src + offset, size);
+            bytes += size;
+        }
+        return bytes;
+    }
+}
+
+D3D12DynamicMesh::D3D12DynamicMesh(ID3D12Device* device,
+    UINT vertexStride, UINT vertexCapacity,
+    DXGI_FORMAT indexFormat, UINT indexCapacity,
+    UINT copyNum,
+    MemoryTracker* memoryTracker, string name)
+    : vertexStride{ vertexStride },
+    indexFormat{ indexFormat },
+    indexStride{ indexFormat == DXGI_FORMAT_R16_UINT ? 2u : 4u },
+    vertexCapacity{ vertexCapacity },
+    indexCapacity{ indexCapacity },
+    vertexShadow(size_t{ vertexCapacity } * vertexStride),
+    indexShadow(size_t{ indexCapacity } * (indexFormat == DXGI_FORMAT_R16_UINT ? 2u : 4u)),
+    vertexRanges{ copyNum },
+    indexRanges{ copyNum },
+    memoryTracker{ memoryTracker },
+    name{ move(name) }
+{
+    assert(indexFormat == DXGI_FORMAT_R16_UINT || indexFormat == DXGI_FORMAT_R32_UINT);
+    assert(copyNum > 0);
+
+    // indices start 256-byte aligned
+    indexByteOffset = (UINT64{ vertexCapacity } * vertexStride + 255) & ~UINT64(255);
+    UINT64 size = indexByteOffset + UINT64{ indexCapacity } * indexStride;
+
+    CD3DX12_HEAP_PROPERTIES heapProps(D3D12_HEAP_TYPE_UPLOAD);
+    auto desc = CD3DX12_RESOURCE_DESC::Buffer(size);
+    auto info = device->GetResourceAllocationInfo(0, 1, &desc);
+    copies.resize(copyNum);
+    for (UINT i = 0; i < copyNum; i++) {
+        auto& copy = copies[i];
+        ThrowIfFailed(device->CreateCommittedResource(
+            &heapProps, D3D12_HEAP_FLAG_NONE, &desc,
+            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&copy.buffer)));
+        ThrowIfFailed(copy.buffer->Map(0, nullptr, reinterpret_cast<void**>(&copy.data))); // stays mapped
+        // every copy starts as the (zeroed) shadow
+        memset(copy.data, 0, static_cast<size_t>(size));
+        if (memoryTracker)
+            memoryTracker->Track(copy.buffer, MemoryTracker::Category::Mesh,
+                this->name + " copy " + to_string(i), info.SizeInBytes, info.Alignment);
+    }
+}
+
+D3D12DynamicMesh::~D3D12DynamicMesh() {
+    for (auto& copy : copies) {
+        if (memoryTracker)
+            memoryTracker->Untrack(copy.buffer);
+        copy.buffer->Unmap(0, nullptr);
+        copy.buffer->Release();
+    }
+}
+
+void D3D12DynamicMesh::BeginFrame(UINT64 frameIndex) {
+    current = static_cast<size_t>(frameIndex % copies.size());
+}
+
+void* D3D12DynamicMesh::MapVertices(UINT first, UINT num) {
+    assert(UINT64{ first } + num <= vertexCapacity);
+    vertexRanges.Add(first, num);
+    return vertexShadow.data() + size_t{ first } * vertexStride;
+}
+
+void* D3D12DynamicMesh::MapIndices(UINT first, UINT num) {
+    assert(UINT64{ first } + num <= indexCapacity);
+    indexRanges.Add(first, num);
+    return indexShadow.data() + size_t{ first } * indexStride;
+}
+
+void D3D12DynamicMesh::Commit() {
+    stats.dirtyBytes += vertexRanges.GetDirtyNum() * vertexStride;
+    stats.dirtyBytes += indexRanges.GetDirtyNum() * indexStride;
+
+    // the ranges other frames dirtied, together with this frame's
+    auto& copy = copies[current];
+    stats.copiedBytes += CopyRanges(copy.data, vertexShadow.data(), vertexStride, vertexRanges.Commit(current));
+    stats.copiedBytes += CopyRanges(copy.data + indexByteOffset, indexShadow.data(), indexStride, indexRanges.Commit(current));
+    stats.commitNum++;
+}
+
+D3D12_VERTEX_BUFFER_VIEW D3D12DynamicMesh::VertexBufferView() const noexcept {
+    D3D12_VERTEX_BUFFER_VIEW view;
+    view.BufferLocation = copies[current].buffer->GetGPUVirtualAddress();
+    view.StrideInBytes = vertexStride;
+    view.SizeInBytes = vertexCapacity * vertexStride;
+    return view;
+}
+
+D3D12_INDEX_BUFFER_VIEW D3D12DynamicMesh::IndexBufferView() const noexcept {
+    D3D12_INDEX_BUFFER_VIEW view;
+    view.BufferLocation = copies[current].buffer->GetGPUVirtualAddress() + indexByteOffset;
+    view.Format = indexFormat;
+    view.SizeInBytes = indexCapacity * indexStride;
+    return view;
+}
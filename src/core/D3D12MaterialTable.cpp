@@ -0,0 +1,109 @@
+#include <UDXRenderer/D3D12MaterialTable.h>
+
+#include <d3d12shader.h>
+#include <d3dcompiler.h>
+
+using namespace Ubpa;
+using namespace std;
+
+namespace {
+    bool ToParamType(const D3D12_SHADER_TYPE_DESC& desc, MaterialTable::ParamType& type) {
+        using ParamType = MaterialTable::ParamType;
+        if (desc.Elements != 0)
+            return false; // arrays aren't supported
+
+        if (desc.Class == D3D_SVC_MATRIX_ROWS || desc.Class == D3D_SVC_MATRIX_COLUMNS) {
+            if (desc.Type != D3D_SVT_FLOAT || desc.Rows != 4 || desc.Columns != 4)
+                return false;
+            type = ParamType::Float4x4;
+            return true;
+        }
+        if ((desc.Class != D3D_SVC_SCALAR && desc.Class != D3D_SVC_VECTOR) || desc.Columns < 1 || desc.Columns > 4)
+            return false;
+
+        ParamType base;
+        switch (desc.Type)
+        {
+        case D3D_SVT_FLOAT: base = ParamType::Float; break;
+        case D3D_SVT_UINT: base = ParamType::Uint; break;
+        case D3D_SVT_INT: base = ParamType::Int; break;
+        default: return false;
+        }
+        type = static_cast<ParamType>(static_cast<int>(base) + desc.Columns - 1);
+        return true;
+    }
+}
+
+MaterialTable::Layout D3D12MaterialTable::Reflect(ID3DBlob* shader, string_view bufferName) {
+    ID3D12ShaderReflection* reflection;
+    ThrowIfFailed(D3DReflect(shader->GetBufferPointer(), shader->GetBufferSize(), IID_PPV_ARGS(&reflection)));
+
+    // the buffer of a StructuredBuffer has a single variable, its element
+    string name(bufferName);
+    auto buffer = reflection->GetConstantBufferByName(name.c_str());
+    D3D12_SHADER_BUFFER_DESC bufferDesc;
+    D3D12_SHADER_VARIABLE_DESC elementDesc;
+    D3D12_SHADER_TYPE_DESC typeDesc;
+    ID3D12ShaderReflectionType* type = nullptr;
+    bool found = SUCCEEDED(buffer->GetDesc(&bufferDesc))
+        && bufferDesc.Type == D3D_CT_RESOURCE_BIND_INFO && bufferDesc.Variables == 1
+        && SUCCEEDED(buffer->GetVariableByIndex(0)->GetDesc(&elementDesc));
+    if (found) {
+        type = buffer->GetVariableByIndex(0)->GetType();
+        found = SUCCEEDED(type->GetDesc(&typeDesc)) && typeDesc.Class == D3D_SVC_STRUCT;
+    }
+
+    MaterialTable::Layout layout;
+    for (UINT i = 0; found && i < typeDesc.Members; i++) {
+        D3D12_SHADER_TYPE_DESC memberDesc;
+        MaterialTable::ParamType paramType;
+        found = SUCCEEDED(type->GetMemberTypeByIndex(i)->GetDesc(&memberDesc))
+            && ToParamType(memberDesc, paramType);
+        if (found)
+            layout.Add(type->GetMemberTypeName(i), paramType, memberDesc.Offset);
+    }
+    reflection->Release();
+
+    if (!found || layout.params.empty())
+        ThrowIfFailed(E_INVALIDARG);
+    layout.stride = elementDesc.Size;
+    return layout;
+}
+
+D3D12MaterialTable::D3D12MaterialTable(ID3D12Device* device, MaterialTable::Layout layout,
+    uint32_t capacity, uint32_t frameNum, MemoryTracker* memoryTracker, string name)
+    : table{ move(layout), capacity, frameNum }, memoryTracker{ memoryTracker }
+{
+    UINT64 size = UINT64{ capacity } * table.GetLayout().stride;
+    CD3DX12_HEAP_PROPERTIES heapProps(D3D12_HEAP_TYPE_UPLOAD);
+    auto desc = CD3DX12_RESOURCE_DESC::Buffer(size);
+    auto info = device->GetResourceAllocationInfo(0, 1, &desc);
+    buffers.resize(frameNum);
+    for (uint32_t i = 0; i < frameNum; i++) {
+        auto& buffer = buffers[i];
+        ThrowIfFailed(device->CreateCommittedResource(
+            &heapProps, D3D12_HEAP_FLAG_NONE, &desc,
+            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&buffer.resource)));
+        ThrowIfFailed(buffer.resource->Map(0, nullptr, &buffer.data)); // stays mapped
+        if (memoryTracker)
+            memoryTracker->Track(buffer.resource, MemoryTracker::Category::Upload,
+                name + " frame " + to_string(i), info.SizeInBytes, info.Alignment);
+    }
+}
+
+D3D12MaterialTable::~D3D12MaterialTable() {
+    for (auto& buffer : buffers) {
+        if (memoryTracker)
+            memoryTracker->Untrack(buffer.resource);
+        buffer.resource->Unmap(0, nullptr);
+        buffer.resource->Release();
+    }
+}
+
+size_t D3D12MaterialTable::Upload(uint32_t frame) {
+    return table.Upload(frame, buffers[frame].data);
+}
+
+D3D12_GPU_VIRTUAL_ADDRESS D3D12MaterialTable::GetGpuAddress(uint32_t frame) const noexcept {
+    return buffers[frame].resource->GetGPUVirtualAddress();
+}
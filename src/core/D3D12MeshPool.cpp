@@ -0,0 +1,177 @@
+#include <UDXRenderer/D3D12MeshPool.h>
+
+#include <cassert>
+#include <climits>
+#include <cstring>
+
+using namespace Ubpa;
+using namespace std;
+
+namespace {
+    ID3D12Resource* CreateBuffer(ID3D12Device* device, UINT64 size, D3D12_HEAP_TYPE heapType, D3D12_RESOURCE_STATES state) {
+        CD3DX12_HEAP_PROPERTIES heapProps(heapType);
+        auto desc = CD3DX12_RESOURCE_DESC::Buffer(size);
+        ID3D12Resource* buffer;
+        ThrowIfFailed(device->CreateCommittedResource(
+            &heapProps, D3D12_HEAP_FLAG_NONE, &desc,
+            state, nullptr, IID_PPV_ARGS(&buffer)));
+        return buffer;
+    }
+
+    void Track(MemoryTracker* memoryTracker, ID3D12Device* device, ID3D12Resource* buffer,
+        MemoryTracker::Category category, string name)
+    {
+        if (!memoryTracker)
+            return;
+        auto desc = buffer->GetDesc();
+        auto info = device->GetResourceAllocationInfo(0, 1, &desc);
+        memoryTracker->Track(buffer, category, move(name), info.SizeInBytes, info.Alignment);
+    }
+}
+
+D3D12MeshPool::D3D12MeshPool(ID3D12Device* device,
+    UINT vertexStride, UINT vertexCapacity,
+    DXGI_FORMAT indexFormat, UINT indexCapacity,
+    MemoryTracker* memoryTracker, string name)
+    : device{ device },
+    vertexStride{ vertexStride },
+    indexFormat{ indexFormat },
+    indexStride{ indexFormat == DXGI_FORMAT_R16_UINT ? 2u : 4u },
+    vertexCapacity{ vertexCapacity },
+    indexCapacity{ indexCapacity },
+    vertexAllocator{ vertexCapacity },
+    indexAllocator{ indexCapacity },
+    memoryTracker{ memoryTracker },
+    name{ move(name) }
+{
+    assert(indexFormat == DXGI_FORMAT_R16_UINT || indexFormat == DXGI_FORMAT_R32_UINT);
+    // D3D12_VERTEX_BUFFER_VIEW / D3D12_INDEX_BUFFER_VIEW::SizeInBytes are UINT
+    if (static_cast<UINT64>(vertexCapacity) * vertexStride > UINT_MAX
+        || static_cast<UINT64>(indexCapacity) * indexStride > UINT_MAX)
+        ThrowIfFailed(E_INVALIDARG);
+
+    vertexBuffer = CreateBuffer(device, static_cast<UINT64>(vertexCapacity) * vertexStride,
+        D3D12_HEAP_TYPE_DEFAULT, D3D12_RESOURCE_STATE_COMMON);
+    indexBuffer = CreateBuffer(device, static_cast<UINT64>(indexCapacity) * indexStride,
+        D3D12_HEAP_TYPE_DEFAULT, D3D12_RESOURCE_STATE_COMMON);
+    Track(memoryTracker, device, vertexBuffer, MemoryTracker::Category::Mesh, this->name + " vertices");
+    Track(memoryTracker, device, indexBuffer, MemoryTracker::Category::Mesh, this->name + " indices");
+}
+
+D3D12MeshPool::~D3D12MeshPool() {
+    if (memoryTracker) {
+        memoryTracker->Untrack(vertexBuffer);
+        memoryTracker->Untrack(indexBuffer);
+    }
+    vertexBuffer->Release();
+    indexBuffer->Release();
+}
+
+D3D12MeshPool::Mesh D3D12MeshPool::Register(ID3D12GraphicsCommandList* cmdList, RetireQueue& retireQueue, UINT64 fence,
+    const void* vertices, UINT vertexNum, const void* indices, UINT indexNum,
+    const Submesh* submeshes, UINT submeshNum)
+{
+    Mesh mesh = Allocate(vertexNum, indexNum, submeshes, submeshNum);
+    if (mesh.IsNull())
+        return {};
+
+    // one staging buffer for both, indices start 4-byte aligned
+    UINT64 vbByteSize = static_cast<UINT64>(vertexNum) * vertexStride;
+    UINT64 ibByteOffset = (vbByteSize + 3) & ~UINT64(3);
+    UINT64 ibByteSize = static_cast<UINT64>(indexNum) * indexStride;
+
+    ID3D12Resource* staging = CreateBuffer(device, ibByteOffset + ibByteSize,
+        D3D12_HEAP_TYPE_UPLOAD, D3D12_RESOURCE_STATE_GENERIC_READ);
+    BYTE* mapped;
+    ThrowIfFailed(staging->Map(0, nullptr, reinterpret_cast<void**>(&mapped)));
+    memcpy(mapped, vertices, static_cast<size_t>(vbByteSize));
+    memcpy(mapped + ibByteOffset, indices, static_cast<size_t>(ibByteSize));
+    staging->Unmap(0, nullptr);
+
+    cmdList->CopyBufferRegion(vertexBuffer, static_cast<UINT64>(mesh.vertices.offset) * vertexStride,
+        staging, 0, vbByteSize);
+    cmdList->CopyBufferRegion(indexBuffer, static_cast<UINT64>(mesh.indices.offset) * indexStride,
+        staging, ibByteOffset, ibByteSize);
+
+    Track(memoryTracker, device, staging, MemoryTracker::Category::Upload, name + " staging");
+    retireQueue.Retire(fence, [staging, memoryTracker = memoryTracker]() {
+        if (memoryTracker)
+            memoryTracker->Untrack(staging);
+        staging->Release();
+    });
+
+    return mesh;
+}
+
+D3D12MeshPool::Mesh D3D12MeshPool::Register(D3D12TransferEngine& transfer,
+    const void* vertices, UINT vertexNum, const void* indices, UINT indexNum,
+    D3D12TransferEngine::Ticket& ticket,
+    const Submesh* submeshes, UINT submeshNum)
+{
+    Mesh mesh = Allocate(vertexNum, indexNum, submeshes, submeshNum);
+    if (mesh.IsNull())
+        return {};
+
+    transfer.UploadBuffer(vertexBuffer, static_cast<UINT64>(mesh.vertices.offset) * vertexStride,
+        vertices, static_cast<UINT64>(vertexNum) * vertexStride);
+    ticket = transfer.UploadBuffer(indexBuffer, static_cast<UINT64>(mesh.indices.offset) * indexStride,
+        indices, static_cast<UINT64>(indexNum) * indexStride);
+    return mesh;
+}
+
+void D3D12MeshPool::Unregister(const Mesh& mesh) {
+    if (mesh.IsNull())
+        return;
+    vertexAllocator.Free(mesh.vertices);
+    indexAllocator.Free(mesh.indices);
+    meshNum--;
+}
+
+D3D12_VERTEX_BUFFER_VIEW D3D12MeshPool::VertexBufferView() const noexcept {
+    D3D12_VERTEX_BUFFER_VIEW view;
+    view.BufferLocation = vertexBuffer->GetGPUVirtualAddress();
+    view.StrideInBytes = vertexStride;
+    view.SizeInBytes = vertexCapacity * vertexStride;
+    return view;
+}
+
+D3D12_INDEX_BUFFER_VIEW D3D12MeshPool::IndexBufferView() const noexcept {
+    D3D12_INDEX_BUFFER_VIEW view;
+    view.BufferLocation = indexBuffer->GetGPUVirtualAddress();
+    view.Format = indexFormat;
+    view.SizeInBytes = indexCapacity * indexStride;
+    return view;
+}
+
+D3D12MeshPool::Mesh D3D12MeshPool::Allocate(UINT vertexNum, UINT indexNum,
+    const Submesh* submeshes, UINT submeshNum)
+{
+    Mesh mesh;
+    mesh.vertices = vertexAllocator.Allocate(vertexNum);
+    if (mesh.vertices.IsNull())
+        return {};
+    mesh.indices = indexAllocator.Allocate(indexNum);
+    if (mesh.indices.IsNull()) {
+        vertexAllocator.Free(mesh.vertices);
+        return {};
+    }
+    mesh.vertexNum = vertexNum;
+    mesh.indexNum = indexNum;
+    if (submeshes) {
+        mesh.submeshes.assign(submeshes, submeshes + submeshNum);
+        for (const auto& submesh : mesh.submeshes) {
+            assert(static_cast<UINT64>(submesh.startIndex) + submesh.indexNum <= indexNum);
+            assert(submesh.baseVertex < vertexNum);
+        }
+    }
+    meshNum++;
+    return mesh;
+}
+
+D3D12MeshPool::Stats D3D12MeshPool::GetStats() const {
+    Stats stats;
+    stats.vertices = vertexAllocator.GetStats();
+    stats.indices = indexAllocator.GetStats();
+    stats.meshNum = meshNum;
+    return stats;
+}
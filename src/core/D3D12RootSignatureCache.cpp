@@ -0,0 +1,171 @@
+#include <UDXRenderer/D3D12RootSignatureCache.h>
+
+#include <cstring>
+#include <fstream>
+
+using namespace Ubpa;
+using namespace std;
+
+namespace {
+    constexpr uint32_t Magic = 0x43535255; // "URSC"
+    constexpr uint32_t FormatVersion = 1;
+    constexpr uint32_t MaxBlobSize = 1 << 20; // rejects corrupt files before allocating
+
+    // the error blob goes to the debugger
+    ID3DBlob* Serialize(const D3D12_VERSIONED_ROOT_SIGNATURE_DESC& desc, D3D_ROOT_SIGNATURE_VERSION maxVersion) {
+        ID3DBlob* serializedRootSig = nullptr;
+        ID3DBlob* errorBlob = nullptr;
+        HRESULT hr = D3DX12SerializeVersionedRootSignature(&desc, maxVersion, &serializedRootSig, &errorBlob);
+        if (errorBlob != nullptr) {
+            ::OutputDebugStringA((char*)errorBlob->GetBufferPointer());
+            errorBlob->Release();
+        }
+        ThrowIfFailed(hr);
+        return serializedRootSig;
+    }
+}
+
+uint64_t D3D12RootSignatureCache::Hash(const void* data, size_t size) noexcept {
+    // 64-bit FNV-1a, as PackArchive::HashPath
+    uint64_t hash = 14695981039346656037ull;
+    auto bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+D3D12RootSignatureCache::D3D12RootSignatureCache(ID3D12Device* device)
+    : device{ device }, highestVersion{ D3D_ROOT_SIGNATURE_VERSION_1_1 }
+{
+    D3D12_FEATURE_DATA_ROOT_SIGNATURE feature{ D3D_ROOT_SIGNATURE_VERSION_1_1 };
+    if (FAILED(device->CheckFeatureSupport(D3D12_FEATURE_ROOT_SIGNATURE, &feature, sizeof(feature))))
+        highestVersion = D3D_ROOT_SIGNATURE_VERSION_1_0;
+}
+
+D3D12RootSignatureCache::~D3D12RootSignatureCache() {
+    Clear();
+}
+
+ID3D12RootSignature* D3D12RootSignatureCache::Create(const D3D12_VERSIONED_ROOT_SIGNATURE_DESC& desc) {
+    ID3DBlob* blob = Serialize(desc, highestVersion);
+    ID3D12RootSignature* rootSig;
+    try {
+        rootSig = Create(blob->GetBufferPointer(), blob->GetBufferSize());
+    }
+    catch (...) {
+        blob->Release();
+        throw;
+    }
+    blob->Release();
+    return rootSig;
+}
+
+ID3D12RootSignature* D3D12RootSignatureCache::Create(const D3D12_ROOT_SIGNATURE_DESC& desc) {
+    D3D12_VERSIONED_ROOT_SIGNATURE_DESC versionedDesc;
+    versionedDesc.Version = D3D_ROOT_SIGNATURE_VERSION_1_0;
+    versionedDesc.Desc_1_0 = desc;
+    return Create(versionedDesc);
+}
+
+ID3D12RootSignature* D3D12RootSignatureCache::Create(const void* blob, size_t size) {
+    bool hit;
+    HRESULT hr;
+    Entry* entry = FindOrCreate(blob, size, hit, hr);
+    ThrowIfFailed(hr);
+    if (!entry->used) {
+        entry->used = true;
+        stats.usedNum++;
+    }
+    ID3D12RootSignature* rootSig = entry->rootSignature;
+    stats.requestNum++;
+    if (hit)
+        stats.hitNum++;
+    rootSig->AddRef();
+    return rootSig;
+}
+
+D3D12RootSignatureCache::Entry* D3D12RootSignatureCache::FindOrCreate(const void* blob, size_t size, bool& hit, HRESULT& hr) {
+    hr = S_OK;
+    uint64_t hash = Hash(blob, size);
+    auto [begin, end] = entryMap.equal_range(hash);
+    for (auto target = begin; target != end; ++target) {
+        auto& entry = entries[target->second];
+        if (entry.blob.size() == size && memcmp(entry.blob.data(), blob, size) == 0) {
+            hit = true;
+            return &entry;
+        }
+    }
+
+    hit = false;
+    ID3D12RootSignature* rootSig;
+    hr = device->CreateRootSignature(0, blob, size, IID_PPV_ARGS(&rootSig));
+    if (FAILED(hr))
+        return nullptr;
+
+    auto bytes = static_cast<const uint8_t*>(blob);
+    entryMap.emplace(hash, entries.size());
+    entries.push_back({ vector<uint8_t>(bytes, bytes + size), rootSig, false });
+    stats.rootSignatureNum++;
+    return &entries.back();
+}
+
+bool D3D12RootSignatureCache::Save(const filesystem::path& path) const {
+    ofstream out(path, ios::binary | ios::trunc);
+    if (!out)
+        return false;
+
+    auto write = [&out](uint32_t value) {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    };
+    write(Magic);
+    write(FormatVersion);
+    // loaded blobs no one asked for are stale
+    write(static_cast<uint32_t>(stats.usedNum));
+    for (const auto& entry : entries) {
+        if (!entry.used)
+            continue;
+        write(static_cast<uint32_t>(entry.blob.size()));
+        out.write(reinterpret_cast<const char*>(entry.blob.data()), static_cast<streamsize>(entry.blob.size()));
+    }
+    return static_cast<bool>(out);
+}
+
+bool D3D12RootSignatureCache::Load(const filesystem::path& path) {
+    ifstream in(path, ios::binary);
+    if (!in)
+        return false;
+
+    auto read = [&in](uint32_t& value) {
+        return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(value)));
+    };
+    uint32_t magic, version, num;
+    if (!read(magic) || !read(version) || !read(num) || magic != Magic || version != FormatVersion)
+        return false;
+
+    vector<uint8_t> blob;
+    for (uint32_t i = 0; i < num; i++) {
+        uint32_t size;
+        if (!read(size) || size > MaxBlobSize)
+            return false;
+        blob.resize(size);
+        if (!in.read(reinterpret_cast<char*>(blob.data()), size))
+            return false;
+
+        bool hit;
+        HRESULT hr;
+        if (FindOrCreate(blob.data(), blob.size(), hit, hr) && !hit)
+            stats.loadedNum++;
+    }
+    return true;
+}
+
+void D3D12RootSignatureCache::Clear() {
+    for (auto& entry : entries)
+        entry.rootSignature->Release();
+    entries.clear();
+    entryMap.clear();
+    stats.rootSignatureNum = 0;
+    stats.usedNum = 0;
+}
@@ -0,0 +1,134 @@
+#include <UDXRenderer/D3D12ShaderBindingLayout.h>
+
+#include <d3d12shader.h>
+#include <d3dcompiler.h>
+
+using namespace Ubpa;
+using namespace std;
+
+namespace {
+    using ResourceType = ShaderBindingLayout::ResourceType;
+    using Visibility = ShaderBindingLayout::Visibility;
+
+    Visibility VisibilityOf(UINT version) noexcept {
+        switch (D3D12_SHVER_GET_TYPE(version))
+        {
+        case D3D12_SHVER_VERTEX_SHADER: return Visibility::Vertex;
+        case D3D12_SHVER_HULL_SHADER: return Visibility::Hull;
+        case D3D12_SHVER_DOMAIN_SHADER: return Visibility::Domain;
+        case D3D12_SHVER_GEOMETRY_SHADER: return Visibility::Geometry;
+        case D3D12_SHVER_PIXEL_SHADER: return Visibility::Pixel;
+        default: return Visibility::All;
+        }
+    }
+
+    ResourceType ResourceTypeOf(D3D_SHADER_INPUT_TYPE type) noexcept {
+        switch (type)
+        {
+        case D3D_SIT_CBUFFER:
+            return ResourceType::CBV;
+        case D3D_SIT_STRUCTURED:
+        case D3D_SIT_BYTEADDRESS:
+            return ResourceType::BufferSRV;
+        case D3D_SIT_UAV_RWSTRUCTURED:
+        case D3D_SIT_UAV_RWBYTEADDRESS:
+            return ResourceType::BufferUAV;
+        case D3D_SIT_UAV_RWTYPED:
+        case D3D_SIT_UAV_APPEND_STRUCTURED:
+        case D3D_SIT_UAV_CONSUME_STRUCTURED:
+        case D3D_SIT_UAV_RWSTRUCTURED_WITH_COUNTER:
+            return ResourceType::UAV; // root UAVs have no counter
+        case D3D_SIT_SAMPLER:
+            return ResourceType::Sampler;
+        default:
+            return ResourceType::SRV; // textures, typed buffers, tbuffers
+        }
+    }
+
+    D3D12_DESCRIPTOR_RANGE_TYPE RangeTypeOf(ResourceType type) noexcept {
+        switch (type)
+        {
+        case ResourceType::CBV: return D3D12_DESCRIPTOR_RANGE_TYPE_CBV;
+        case ResourceType::SRV:
+        case ResourceType::BufferSRV: return D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+        case ResourceType::UAV:
+        case ResourceType::BufferUAV: return D3D12_DESCRIPTOR_RANGE_TYPE_UAV;
+        default: return D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER;
+        }
+    }
+}
+
+vector<ShaderBindingLayout::Binding> D3D12ShaderBindingLayout::Reflect(ID3DBlob* shader) {
+    ID3D12ShaderReflection* reflection;
+    ThrowIfFailed(D3DReflect(shader->GetBufferPointer(), shader->GetBufferSize(), IID_PPV_ARGS(&reflection)));
+
+    D3D12_SHADER_DESC shaderDesc;
+    HRESULT hr = reflection->GetDesc(&shaderDesc);
+    vector<ShaderBindingLayout::Binding> bindings;
+    for (UINT i = 0; SUCCEEDED(hr) && i < shaderDesc.BoundResources; i++) {
+        D3D12_SHADER_INPUT_BIND_DESC bindDesc;
+        hr = reflection->GetResourceBindingDesc(i, &bindDesc);
+        if (FAILED(hr))
+            break;
+
+        ShaderBindingLayout::Binding binding;
+        binding.name = bindDesc.Name;
+        binding.type = ResourceTypeOf(bindDesc.Type);
+        binding.reg = bindDesc.BindPoint;
+        binding.space = bindDesc.Space;
+        // fxc reports unbounded arrays with 0, dxc with UINT_MAX
+        binding.count = bindDesc.BindCount == 0 ? ShaderBindingLayout::UnboundedCount : bindDesc.BindCount;
+        binding.visibility = VisibilityOf(shaderDesc.Version);
+        bindings.push_back(move(binding));
+    }
+    reflection->Release();
+    ThrowIfFailed(hr);
+
+    return bindings;
+}
+
+D3D12ShaderBindingLayout::D3D12ShaderBindingLayout(const ShaderBindingLayout& layout,
+    const D3D12_STATIC_SAMPLER_DESC* staticSamplers, D3D12_ROOT_SIGNATURE_FLAGS flags)
+{
+    const auto& layoutParams = layout.GetParams();
+    ranges.resize(layoutParams.size());
+    params.resize(layoutParams.size());
+    for (size_t i = 0; i < layoutParams.size(); i++) {
+        const auto& param = layoutParams[i];
+        auto visibility = static_cast<D3D12_SHADER_VISIBILITY>(param.visibility);
+        // 1.1 defaults: the data of CBVs and SRVs is static while set at execute,
+        // descriptors are static once the table is set
+        switch (param.type)
+        {
+        case ShaderBindingLayout::ParamType::CBV:
+            params[i].InitAsConstantBufferView(param.reg, param.space, D3D12_ROOT_DESCRIPTOR_FLAG_NONE, visibility);
+            break;
+        case ShaderBindingLayout::ParamType::SRV:
+            params[i].InitAsShaderResourceView(param.reg, param.space, D3D12_ROOT_DESCRIPTOR_FLAG_NONE, visibility);
+            break;
+        case ShaderBindingLayout::ParamType::UAV:
+            params[i].InitAsUnorderedAccessView(param.reg, param.space, D3D12_ROOT_DESCRIPTOR_FLAG_NONE, visibility);
+            break;
+        default:
+            for (const auto& range : param.ranges) {
+                // an unbounded (bindless) table gets new descriptors while frames using it are in flight
+                auto flags = range.count == ShaderBindingLayout::UnboundedCount ?
+                    D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE : D3D12_DESCRIPTOR_RANGE_FLAG_NONE;
+                ranges[i].emplace_back();
+                // UnboundedCount is UINT_MAX, the unbounded NumDescriptors of D3D12
+                ranges[i].back().Init(RangeTypeOf(range.type), range.count, range.reg, range.space, flags, range.offset);
+            }
+            params[i].InitAsDescriptorTable(static_cast<UINT>(ranges[i].size()), ranges[i].data(), visibility);
+            break;
+        }
+    }
+
+    for (auto reg : layout.GetStaticSamplers()) {
+        this->staticSamplers.push_back(staticSamplers[reg]);
+        this->staticSamplers.back().ShaderRegister = reg;
+        this->staticSamplers.back().RegisterSpace = 0;
+    }
+
+    desc.Init_1_1(static_cast<UINT>(params.size()), params.data(),
+        static_cast<UINT>(this->staticSamplers.size()), this->staticSamplers.data(), flags);
+}
@@ -0,0 +1,132 @@
+#include <UDXRenderer/D3D12ShaderHotReload.h>
+
+#include <d3dcompiler.h>
+
+#include <algorithm>
+
+using namespace Ubpa;
+using namespace std;
+
+ID3DBlob* D3D12ShaderHotReload::Compile(const Source& source, HRESULT& hr) {
+    UINT compileFlags = 0;
+#if defined(DEBUG) || defined(_DEBUG)
+    compileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+#endif
+
+    vector<D3D_SHADER_MACRO> macros;
+    for (const auto& [name, definition] : source.defines)
+        macros.push_back({ name.c_str(), definition.c_str() });
+    macros.push_back({ nullptr, nullptr });
+
+    ID3DBlob* shader = nullptr;
+    ID3DBlob* errors = nullptr;
+    hr = D3DCompileFromFile(source.filename.c_str(), macros.data(), D3D_COMPILE_STANDARD_FILE_INCLUDE,
+        source.entrypoint.c_str(), source.target.c_str(), compileFlags, 0, &shader, &errors);
+    if (errors) {
+        OutputDebugStringA(static_cast<const char*>(errors->GetBufferPointer()));
+        errors->Release();
+    }
+    return SUCCEEDED(hr) ? shader : nullptr;
+}
+
+D3D12ShaderHotReload::D3D12ShaderHotReload(chrono::milliseconds pollInterval)
+    : pollInterval{ pollInterval }, worker{ [this]() { Run(); } } {}
+
+D3D12ShaderHotReload::~D3D12ShaderHotReload() {
+    {
+        lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    stopCV.notify_one();
+    worker.join();
+
+    for (auto& result : results)
+        result.shader->Release();
+}
+
+void D3D12ShaderHotReload::AddShader(string name, Source source) {
+    lock_guard<std::mutex> lock(mutex);
+    auto before = graph.GetFiles();
+    graph.AddShader(name, source.filename);
+    UpdateWatches(before);
+    sources[move(name)] = move(source);
+}
+
+void D3D12ShaderHotReload::RemoveShader(const string& name) {
+    lock_guard<std::mutex> lock(mutex);
+    auto before = graph.GetFiles();
+    graph.RemoveShader(name);
+    UpdateWatches(before);
+    sources.erase(name);
+}
+
+vector<D3D12ShaderHotReload::Result> D3D12ShaderHotReload::TakeResults() {
+    lock_guard<std::mutex> lock(mutex);
+    return move(results);
+}
+
+D3D12ShaderHotReload::Stats D3D12ShaderHotReload::GetStats() const {
+    lock_guard<std::mutex> lock(mutex);
+    Stats result = stats;
+    result.fileNum = watcher.GetFileNum();
+    return result;
+}
+
+void D3D12ShaderHotReload::Run() {
+    unique_lock<std::mutex> lock(mutex);
+    while (!stopCV.wait_for(lock, pollInterval, [this]() { return stop; })) {
+        auto changed = watcher.Poll();
+        if (changed.empty())
+            continue;
+        stats.changeNum += changed.size();
+
+        // the include lists of the changed files may have changed too
+        auto before = graph.GetFiles();
+        for (const auto& file : changed)
+            graph.Rescan(file);
+        UpdateWatches(before);
+
+        vector<pair<string, Source>> affected;
+        for (auto& name : graph.GetAffectedShaders(changed))
+            affected.emplace_back(name, sources.at(name));
+
+        // compile without the lock, AddShader / TakeResults don't wait for the compiler
+        lock.unlock();
+        vector<Result> compiled;
+        size_t failNum = 0;
+        for (const auto& [name, source] : affected) {
+            HRESULT hr;
+            if (auto shader = Compile(source, hr))
+                compiled.push_back({ name, shader });
+            else
+                failNum++;
+        }
+        lock.lock();
+
+        stats.compileNum += affected.size();
+        stats.failNum += failNum;
+        for (auto& result : compiled) {
+            // a newer compile replaces the one not taken yet
+            auto target = find_if(results.begin(), results.end(),
+                [&](const Result& r) { return r.name == result.name; });
+            if (target != results.end()) {
+                target->shader->Release();
+                target->shader = result.shader;
+            }
+            else
+                results.push_back(move(result));
+        }
+    }
+}
+
+void D3D12ShaderHotReload::UpdateWatches(const vector<filesystem::path>& before) {
+    auto files = graph.GetFiles(); // in path order
+    for (const auto& file : files) {
+        if (!watcher.IsWatched(file))
+            watcher.Watch(file);
+    }
+    for (const auto& file : before) {
+        if (!binary_search(files.begin(), files.end(), file))
+            watcher.Unwatch(file);
+    }
+}
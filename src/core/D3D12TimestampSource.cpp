@@ -0,0 +1,58 @@
+#include <UDXRenderer/D3D12TimestampSource.h>
+
+using namespace Ubpa;
+using namespace std;
+
+D3D12TimestampSource::D3D12TimestampSource(ID3D12Device* device, ID3D12CommandQueue* queue,
+    size_t slotNum, size_t queriesPerSlot)
+    : slotNum{ slotNum }, queriesPerSlot{ queriesPerSlot }
+{
+    ThrowIfFailed(queue->GetTimestampFrequency(&frequency));
+
+    D3D12_QUERY_HEAP_DESC heapDesc = {};
+    heapDesc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+    heapDesc.Count = static_cast<UINT>(slotNum * queriesPerSlot);
+    heapDesc.NodeMask = 0;
+    ThrowIfFailed(device->CreateQueryHeap(&heapDesc, IID_PPV_ARGS(&queryHeap)));
+
+    ThrowIfFailed(device->CreateCommittedResource(
+        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_READBACK),
+        D3D12_HEAP_FLAG_NONE,
+        &CD3DX12_RESOURCE_DESC::Buffer(slotNum * queriesPerSlot * sizeof(uint64_t)),
+        D3D12_RESOURCE_STATE_COPY_DEST,
+        nullptr,
+        IID_PPV_ARGS(&readback)));
+}
+
+D3D12TimestampSource::~D3D12TimestampSource() {
+    if (readback)
+        readback->Release();
+    if (queryHeap)
+        queryHeap->Release();
+}
+
+void D3D12TimestampSource::WriteTimestamp(size_t slot, size_t query) {
+    assert(cmdList && slot < slotNum && query < queriesPerSlot);
+    cmdList->EndQuery(queryHeap, D3D12_QUERY_TYPE_TIMESTAMP,
+        static_cast<UINT>(slot * queriesPerSlot + query));
+}
+
+void D3D12TimestampSource::Resolve(size_t slot, size_t queryNum) {
+    assert(cmdList && slot < slotNum && queryNum <= queriesPerSlot);
+    cmdList->ResolveQueryData(queryHeap, D3D12_QUERY_TYPE_TIMESTAMP,
+        static_cast<UINT>(slot * queriesPerSlot), static_cast<UINT>(queryNum),
+        readback, slot * queriesPerSlot * sizeof(uint64_t));
+}
+
+void D3D12TimestampSource::ReadBack(size_t slot, size_t queryNum, uint64_t* ticks) {
+    assert(slot < slotNum && queryNum <= queriesPerSlot);
+
+    size_t begin = slot * queriesPerSlot * sizeof(uint64_t);
+    D3D12_RANGE readRange{ begin, begin + queryNum * sizeof(uint64_t) };
+    D3D12_RANGE writtenRange{ 0, 0 };
+
+    void* data;
+    ThrowIfFailed(readback->Map(0, &readRange, &data));
+    memcpy(ticks, static_cast<const uint8_t*>(data) + begin, queryNum * sizeof(uint64_t));
+    readback->Unmap(0, &writtenRange);
+}
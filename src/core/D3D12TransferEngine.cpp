@@ -0,0 +1,238 @@
+#include <UDXRenderer/D3D12TransferEngine.h>
+
+#include <cassert>
+#include <cstring>
+
+using namespace Ubpa;
+using namespace std;
+
+namespace {
+    constexpr UINT64 BufferAlignment = 16;
+
+    ID3D12Resource* CreateUploadBuffer(ID3D12Device* device, UINT64 size) {
+        CD3DX12_HEAP_PROPERTIES heapProps(D3D12_HEAP_TYPE_UPLOAD);
+        auto desc = CD3DX12_RESOURCE_DESC::Buffer(size);
+        ID3D12Resource* buffer;
+        ThrowIfFailed(device->CreateCommittedResource(
+            &heapProps, D3D12_HEAP_FLAG_NONE, &desc,
+            D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&buffer)));
+        return buffer;
+    }
+}
+
+D3D12TransferEngine::D3D12TransferEngine(ID3D12Device* device, UINT64 stagingSize, MemoryTracker* memoryTracker)
+    : device{ device }, memoryTracker{ memoryTracker }, ringAllocator{ stagingSize }
+{
+    D3D12_COMMAND_QUEUE_DESC queueDesc = {};
+    queueDesc.Type = D3D12_COMMAND_LIST_TYPE_COPY;
+    queueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+    ThrowIfFailed(device->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&queue)));
+    ThrowIfFailed(device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&fence)));
+
+    ID3D12CommandAllocator* first;
+    ThrowIfFailed(device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY, IID_PPV_ARGS(&first)));
+    ThrowIfFailed(device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_COPY, first, nullptr, IID_PPV_ARGS(&cmdList)));
+    ThrowIfFailed(cmdList->Close());
+    freeAllocators.push_back(first);
+
+    ring = CreateUploadBuffer(device, stagingSize);
+    ThrowIfFailed(ring->Map(0, nullptr, reinterpret_cast<void**>(&ringData))); // stays mapped
+    if (memoryTracker)
+        memoryTracker->Track(ring, MemoryTracker::Category::Upload, "transfer staging ring", stagingSize);
+    stats.ringCapacity = stagingSize;
+}
+
+D3D12TransferEngine::~D3D12TransferEngine() {
+    WaitIdle();
+    assert(!allocator && dedicated.empty() && inFlights.empty());
+
+    for (auto a : freeAllocators)
+        a->Release();
+
+    if (memoryTracker)
+        memoryTracker->Untrack(ring);
+    ring->Unmap(0, nullptr);
+    ring->Release();
+    cmdList->Release();
+    fence->Release();
+    queue->Release();
+}
+
+D3D12TransferEngine::Ticket D3D12TransferEngine::UploadBuffer(
+    ID3D12Resource* dst, UINT64 dstOffset, const void* data, UINT64 size)
+{
+    lock_guard<mutex> lock(m);
+    if (size == 0)
+        return submittedTicket;
+    Staging staging = Stage(size, BufferAlignment);
+    memcpy(staging.data, data, static_cast<size_t>(size));
+    cmdList->CopyBufferRegion(dst, dstOffset, staging.buffer, staging.offset, size);
+
+    stats.requestNum++;
+    stats.uploadedBytes += size;
+    return submittedTicket + 1;
+}
+
+D3D12TransferEngine::Ticket D3D12TransferEngine::UploadTexture(ID3D12Resource* dst, UINT firstSubresource,
+    const D3D12_SUBRESOURCE_DATA* subresources, UINT num)
+{
+    vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> layouts(num);
+    vector<UINT> rowNums(num);
+    vector<UINT64> rowSizes(num);
+    UINT64 size;
+    auto desc = dst->GetDesc();
+    device->GetCopyableFootprints(&desc, firstSubresource, num, 0,
+        layouts.data(), rowNums.data(), rowSizes.data(), &size);
+
+    lock_guard<mutex> lock(m);
+    Staging staging = Stage(size, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+    for (UINT i = 0; i < num; i++) {
+        auto& layout = layouts[i];
+        D3D12_MEMCPY_DEST dstData;
+        dstData.pData = staging.data + layout.Offset;
+        dstData.RowPitch = layout.Footprint.RowPitch;
+        dstData.SlicePitch = SIZE_T{ layout.Footprint.RowPitch } * rowNums[i];
+        MemcpySubresource(&dstData, &subresources[i], static_cast<SIZE_T>(rowSizes[i]),
+            rowNums[i], layout.Footprint.Depth);
+
+        layout.Offset += staging.offset;
+        CD3DX12_TEXTURE_COPY_LOCATION dstLocation(dst, firstSubresource + i);
+        CD3DX12_TEXTURE_COPY_LOCATION srcLocation(staging.buffer, layout);
+        cmdList->CopyTextureRegion(&dstLocation, 0, 0, 0, &srcLocation, nullptr);
+    }
+
+    stats.requestNum++;
+    stats.uploadedBytes += size;
+    return submittedTicket + 1;
+}
+
+D3D12TransferEngine::Ticket D3D12TransferEngine::Submit() {
+    lock_guard<mutex> lock(m);
+    return SubmitLocked();
+}
+
+D3D12TransferEngine::Ticket D3D12TransferEngine::GetRecordingTicket() const {
+    lock_guard<mutex> lock(m);
+    // nothing recorded, a ticket of the next submission would never complete without one
+    if (!allocator)
+        return submittedTicket;
+    return submittedTicket + 1;
+}
+
+bool D3D12TransferEngine::IsComplete(Ticket ticket) const {
+    return fence->GetCompletedValue() >= ticket;
+}
+
+D3D12TransferEngine::Ticket D3D12TransferEngine::GetCompletedTicket() const {
+    return fence->GetCompletedValue();
+}
+
+void D3D12TransferEngine::QueueWait(ID3D12CommandQueue* waitingQueue, Ticket ticket) {
+    {
+        lock_guard<mutex> lock(m);
+        if (ticket > submittedTicket)
+            SubmitLocked();
+    }
+    ThrowIfFailed(waitingQueue->Wait(fence, ticket));
+}
+
+void D3D12TransferEngine::Wait(Ticket ticket) {
+    lock_guard<mutex> lock(m);
+    WaitLocked(ticket);
+}
+
+void D3D12TransferEngine::WaitIdle() {
+    lock_guard<mutex> lock(m);
+    SubmitLocked();
+    WaitLocked(submittedTicket);
+}
+
+D3D12TransferEngine::Stats D3D12TransferEngine::GetStats() const {
+    lock_guard<mutex> lock(m);
+    Stats result = stats;
+    result.ringUsedBytes = ringAllocator.GetUsedNum();
+    result.ringPeakBytes = ringAllocator.GetPeakUsedNum();
+    return result;
+}
+
+D3D12TransferEngine::Staging D3D12TransferEngine::Stage(UINT64 size, UINT64 alignment) {
+    Reclaim();
+
+    UINT64 offset = ringAllocator.Allocate(size, alignment);
+    while (offset == FrameLinearAllocator::InvalidOffset && size <= ringAllocator.GetCapacity()) {
+        // the ring is full: submit what is recorded, then wait for the oldest submission
+        SubmitLocked();
+        if (inFlights.empty())
+            break;
+        stats.stallNum++;
+        WaitLocked(inFlights.front().ticket);
+        offset = ringAllocator.Allocate(size, alignment);
+    }
+
+    BeginRecording();
+    if (offset != FrameLinearAllocator::InvalidOffset)
+        return { ring, offset, ringData + offset };
+
+    ID3D12Resource* buffer = CreateUploadBuffer(device, size);
+    BYTE* data;
+    ThrowIfFailed(buffer->Map(0, nullptr, reinterpret_cast<void**>(&data)));
+    if (memoryTracker)
+        memoryTracker->Track(buffer, MemoryTracker::Category::Upload, "transfer staging", size);
+    dedicated.emplace_back(submittedTicket + 1, buffer);
+    stats.dedicatedNum++;
+    return { buffer, 0, data };
+}
+
+void D3D12TransferEngine::BeginRecording() {
+    if (allocator)
+        return;
+
+    if (freeAllocators.empty()) {
+        ThrowIfFailed(device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY, IID_PPV_ARGS(&allocator)));
+    }
+    else {
+        allocator = freeAllocators.back();
+        freeAllocators.pop_back();
+        ThrowIfFailed(allocator->Reset());
+    }
+    ThrowIfFailed(cmdList->Reset(allocator, nullptr));
+}
+
+D3D12TransferEngine::Ticket D3D12TransferEngine::SubmitLocked() {
+    if (!allocator)
+        return submittedTicket;
+
+    ThrowIfFailed(cmdList->Close());
+    ID3D12CommandList* cmdLists[] = { cmdList };
+    queue->ExecuteCommandLists(1, cmdLists);
+    ThrowIfFailed(queue->Signal(fence, ++submittedTicket));
+
+    ringAllocator.EndFrame(submittedTicket);
+    inFlights.push_back({ submittedTicket, allocator });
+    allocator = nullptr;
+    stats.submitNum++;
+    return submittedTicket;
+}
+
+void D3D12TransferEngine::Reclaim() {
+    Ticket completed = fence->GetCompletedValue();
+    ringAllocator.Reclaim(completed);
+    while (!inFlights.empty() && inFlights.front().ticket <= completed) {
+        freeAllocators.push_back(inFlights.front().allocator);
+        inFlights.pop_front();
+    }
+    while (!dedicated.empty() && dedicated.front().first <= completed) {
+        if (memoryTracker)
+            memoryTracker->Untrack(dedicated.front().second);
+        dedicated.front().second->Release();
+        dedicated.pop_front();
+    }
+}
+
+void D3D12TransferEngine::WaitLocked(Ticket ticket) {
+    if (ticket > submittedTicket)
+        SubmitLocked();
+    if (fence->GetCompletedValue() < ticket)
+        ThrowIfFailed(fence->SetEventOnCompletion(ticket, nullptr)); // null event: blocks until completion
+    Reclaim();
+}
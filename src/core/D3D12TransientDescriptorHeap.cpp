@@ -0,0 +1,73 @@
+#include <UDXRenderer/D3D12TransientDescriptorHeap.h>
+
+#include <cassert>
+#include <vector>
+
+using namespace Ubpa;
+using namespace std;
+
+D3D12TransientDescriptorHeap::D3D12TransientDescriptorHeap(
+    ID3D12Device* device, D3D12_DESCRIPTOR_HEAP_TYPE type, UINT capacity,
+    MemoryTracker* memoryTracker, string name)
+    : device{ device }, type{ type },
+    descriptorSize{ device->GetDescriptorHandleIncrementSize(type) },
+    ring{ capacity },
+    memoryTracker{ memoryTracker }
+{
+    assert(type == D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV || type == D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
+
+    if (type == D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV)
+        allocation = UDX12::DescriptorHeapMngr::Instance().GetCSUGpuDH()->Allocate(capacity);
+    else
+        allocation = UDX12::DescriptorHeapMngr::Instance().GetRTVCpuDH()->Allocate(capacity);
+
+    if (memoryTracker) {
+        memoryTracker->Track(this, MemoryTracker::Category::DescriptorHeap, move(name),
+            uint64_t{ capacity } * descriptorSize, descriptorSize);
+    }
+}
+
+D3D12TransientDescriptorHeap::~D3D12TransientDescriptorHeap() {
+    if (memoryTracker)
+        memoryTracker->Untrack(this);
+    if (type == D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV)
+        UDX12::DescriptorHeapMngr::Instance().GetCSUGpuDH()->Free(move(allocation));
+    else
+        UDX12::DescriptorHeapMngr::Instance().GetRTVCpuDH()->Free(move(allocation));
+}
+
+D3D12TransientDescriptorHeap::Table D3D12TransientDescriptorHeap::Allocate(UINT num) {
+    UINT64 offset = ring.Allocate(num);
+    if (offset == FrameLinearAllocator::InvalidOffset)
+        ThrowIfFailed(E_OUTOFMEMORY); // capacity is too small for the frames in flight
+
+    Table table;
+    table.cpuHandle = allocation.GetCpuHandle(static_cast<UINT>(offset));
+    if (type == D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV)
+        table.gpuHandle = allocation.GetGpuHandle(static_cast<UINT>(offset));
+    table.num = num;
+    table.descriptorSize = descriptorSize;
+    return table;
+}
+
+D3D12TransientDescriptorHeap::Table D3D12TransientDescriptorHeap::Stage(
+    const D3D12_CPU_DESCRIPTOR_HANDLE* srcs, UINT num)
+{
+    vector<UINT> sizes(num, 1);
+    return Stage(srcs, sizes.data(), num);
+}
+
+D3D12TransientDescriptorHeap::Table D3D12TransientDescriptorHeap::Stage(
+    const D3D12_CPU_DESCRIPTOR_HANDLE* srcRangeStarts, const UINT* srcRangeSizes, UINT rangeNum)
+{
+    UINT num = 0;
+    for (UINT i = 0; i < rangeNum; i++)
+        num += srcRangeSizes[i];
+
+    Table table = Allocate(num);
+    device->CopyDescriptors(
+        1, &table.cpuHandle, &num,
+        rangeNum, srcRangeStarts, srcRangeSizes,
+        type);
+    return table;
+}
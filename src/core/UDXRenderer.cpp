@@ -1,29 +1,178 @@
 #include <UDXRenderer/UDXRenderer.h>
 
+#include <UDXRenderer/D3D12ShaderBindingLayout.h>
+#include <UDXRenderer/PackArchive.h>
+#include <UDXRenderer/Profiler.h>
+
+#include <d3dcompiler.h>
+
+#include <algorithm>
+#include <cstring>
 #include <unordered_map>
 #include <iostream>
+#include <memory>
+#include <mutex>
 
 using namespace Ubpa;
 using namespace std;
 
+namespace {
+    // resolves #include "..." in a PackArchive, relative to the including file
+    class ArchiveInclude final : public ID3DInclude {
+    public:
+        ArchiveInclude(const PackArchive& archive, string_view rootPath)
+            : archive{ archive }, rootPath{ PackArchive::NormalizePath(rootPath) } {}
+
+        HRESULT __stdcall Open(D3D_INCLUDE_TYPE, LPCSTR fileName, LPCVOID parentData,
+            LPCVOID* data, UINT* bytes) override
+        {
+            auto parent = paths.find(parentData);
+            const string& parentPath = parent != paths.end() ? parent->second : rootPath;
+            string path = PackArchive::NormalizePath(
+                parentPath.substr(0, parentPath.find_last_of('/') + 1) + fileName);
+
+            auto entry = archive.Find(path);
+            auto buffer = make_unique<vector<uint8_t>>();
+            if (entry == PackArchive::InvalidEntry || !archive.Read(entry, *buffer))
+                return E_FAIL;
+
+            *data = buffer->data();
+            *bytes = static_cast<UINT>(buffer->size());
+            paths.emplace(buffer->data(), move(path));
+            buffers.emplace(buffer->data(), move(buffer));
+            return S_OK;
+        }
+
+        HRESULT __stdcall Close(LPCVOID data) override {
+            paths.erase(data);
+            buffers.erase(data);
+            return S_OK;
+        }
+
+    private:
+        const PackArchive& archive;
+        string rootPath;
+        unordered_map<const void*, string> paths; // of the opened files, by their data
+        unordered_map<const void*, unique_ptr<vector<uint8_t>>> buffers;
+    };
+
+    struct DDSInfo {
+        UINT width;
+        UINT height;
+        UINT mipNum;
+    };
+
+    // the size fields of the DDS header
+    bool ReadDDSInfo(const vector<uint8_t>& file, DDSInfo& info) {
+        constexpr uint32_t magic = 0x20534444; // "DDS "
+        constexpr uint32_t mipMapCountFlag = 0x20000;
+        constexpr size_t headerEnd = 4 + 124;
+        if (file.size() < headerEnd)
+            return false;
+
+        uint32_t fields[8];
+        memcpy(fields, file.data(), sizeof(fields));
+        // magic, size, flags, height, width, pitch, depth, mip map count
+        if (fields[0] != magic || fields[1] != 124 || fields[3] == 0 || fields[4] == 0)
+            return false;
+        info.height = fields[3];
+        info.width = fields[4];
+        info.mipNum = (fields[2] & mipMapCountFlag) && fields[7] != 0 ? fields[7] : 1;
+        return true;
+    }
+
+    // the mips DirectX::CreateDDSTextureFromMemory skips for maxsize
+    UINT SkippedMips(const DDSInfo& info, UINT maxsize) {
+        UINT skipped = 0;
+        while (skipped + 1 < info.mipNum && max(info.width >> skipped, info.height >> skipped) > maxsize)
+            skipped++;
+        return skipped;
+    }
+}
+
 struct DXRenderer::Impl {
     struct Texture {
         vector<ID3D12Resource*> resources;
-        UDX12::DescriptorHeapAllocation allocationSRV;
+        DescriptorAllocator::Allocation allocationSRV;
+        DescriptorAllocator::Allocation allocationBindless;
         UDX12::DescriptorHeapAllocation allocationRTV;
     };
 
+    // SRVs are written to the CPU-only heap, then copied to the shader-visible mirror
+    struct SrvPage {
+        ID3D12DescriptorHeap* cpuHeap{ nullptr };
+        UDX12::DescriptorHeapAllocation gpuAllocation;
+    };
+
     bool isInit{ false };
     ID3D12Device* device{ nullptr };
     DirectX::ResourceUploadBatch* upload{ nullptr };
 
+    UINT csuDescriptorSize{ 0 };
+    vector<SrvPage> srvPages; // maxSrvPageNum slots, filled on demand
+    unique_ptr<DescriptorAllocator> srvAllocator;
+    bool srvPagesCapped{ false }; // the CSU heap refused a page
+
+    // bindless table, a single page so that indices are offsets into bindlessTable
+    UDX12::DescriptorHeapAllocation bindlessTable;
+    unique_ptr<DescriptorAllocator> bindlessAllocator;
+
+    mutable mutex textureMapMutex;
     unordered_map<string, Texture> textureMap;
 
     unordered_map<string, UDX12::MeshGeometry> meshGeoMap;
+
+    struct PooledMesh {
+        D3D12MeshPool* pool;
+        D3D12MeshPool::Mesh mesh;
+    };
+    unordered_map<string, unique_ptr<D3D12MeshPool>> meshPoolMap;
+    unordered_map<string, PooledMesh> pooledMeshMap;
+    unordered_map<string, unique_ptr<D3D12DynamicMesh>> dynamicMeshMap;
+    unordered_map<string, Meshlets::MeshletMesh> meshletMap; // by mesh name
+    unordered_map<string, vector<MeshSimplifier::Lod>> meshLodMap; // by mesh name
     unordered_map<string, ID3DBlob*> shaderByteCodeMap;
-    unordered_map<string, ID3D12RootSignature*> rootSignatureMap;
+    unique_ptr<D3D12RootSignatureCache> rootSignatureCache;
+    unordered_map<string, ID3D12RootSignature*> rootSignatureMap; // a reference per name
+    unordered_map<string, ShaderBindingLayout> rootSignatureLayoutMap; // generated from shaders
     unordered_map<string, ID3D12PipelineState*> PSOMap;
 
+    // shader hot reload, the descs of the PSOs to rebuild them
+    struct PSORecord {
+        D3D12_GRAPHICS_PIPELINE_STATE_DESC desc;
+        vector<D3D12_INPUT_ELEMENT_DESC> inputElements;
+        vector<string> semanticNames; // [input element]
+        // VS, PS, DS, HS, GS: the registered shader the stage was made from, empty if none
+        array<string, 5> shaderNames;
+    };
+    unique_ptr<D3D12ShaderHotReload> shaderHotReload;
+    unordered_map<string, PSORecord> PSORecordMap;
+
+    RetireQueue retireQueue;
+    mutable MemoryTracker memoryTracker;
+
+    struct StreamedTexture {
+        string name; // empty if unregistered
+        vector<vector<uint8_t>> files;
+        vector<bool> isCubeMaps;
+        UINT size; // max(width, height) of mip 0 of the largest element
+    };
+    // a new mip chain of a streamed texture, replaces the texture once uploaded
+    struct StreamedMips {
+        TextureStreamer::OpType type;
+        TextureStreamer::TextureID id;
+        string name;
+        Texture tex;
+        bool failed;
+        bool dropped; // the texture was unregistered
+        D3D12TransferEngine::Ticket ticket;
+    };
+    unique_ptr<D3D12TransferEngine> transfer;
+    unique_ptr<TextureStreamer> textureStreamer;
+    vector<StreamedTexture> streamedTextures; // by TextureStreamer::TextureID
+    unordered_map<string, TextureStreamer::TextureID> streamedTextureMap;
+    vector<StreamedMips> streamedMips; // in submission order
+
     const CD3DX12_STATIC_SAMPLER_DESC pointWrap{
         0,                               // shaderRegister
         D3D12_FILTER_MIN_MAG_MIP_POINT,  // filter
@@ -75,6 +224,193 @@ struct DXRenderer::Impl {
         0.0f,                             // mipLODBias
         8                                 // maxAnisotropy
     };
+
+    bool AddSrvPage(UINT page) {
+        auto gpuAllocation = UDX12::DescriptorHeapMngr::Instance().GetCSUGpuDH()->Allocate(srvAllocator->GetPageSize());
+        if (gpuAllocation.IsNull()) {
+            if (!srvPagesCapped) {
+                srvPagesCapped = true;
+                OutputDebugStringA(("DXRenderer: the shader-visible CSU heap is full, texture SRVs are capped at "
+                    + to_string(page) + " pages of " + to_string(srvAllocator->GetPageSize()) + "\n").c_str());
+            }
+            return false;
+        }
+
+        D3D12_DESCRIPTOR_HEAP_DESC desc;
+        desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+        desc.NumDescriptors = srvAllocator->GetPageSize();
+        desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+        desc.NodeMask = 0;
+        if (FAILED(device->CreateDescriptorHeap(&desc, IID_PPV_ARGS(&srvPages[page].cpuHeap)))) {
+            UDX12::DescriptorHeapMngr::Instance().GetCSUGpuDH()->Free(move(gpuAllocation));
+            return false;
+        }
+
+        srvPages[page].gpuAllocation = move(gpuAllocation);
+        memoryTracker.Track(srvPages[page].cpuHeap, MemoryTracker::Category::DescriptorHeap,
+            "srv page " + to_string(page), uint64_t{ desc.NumDescriptors } * csuDescriptorSize, csuDescriptorSize);
+        return true;
+    }
+
+    void TrackResource(ID3D12Resource* resource, MemoryTracker::Category category, string name) const {
+        auto desc = resource->GetDesc();
+        auto info = device->GetResourceAllocationInfo(0, 1, &desc);
+        memoryTracker.Track(resource, category, move(name), info.SizeInBytes, info.Alignment);
+    }
+
+    // key: the address of the geometry, its buffers are committed resources
+    void TrackMeshGeometry(const UDX12::MeshGeometry* meshGeo, const string& name,
+        UINT vb_count, UINT vb_stride, UINT ib_count, DXGI_FORMAT ib_format) const
+    {
+        UINT64 ibStride = ib_format == DXGI_FORMAT_R16_UINT ? 2 : 4;
+        D3D12_RESOURCE_DESC descs[2] = {
+            CD3DX12_RESOURCE_DESC::Buffer(UINT64{ vb_count } * vb_stride),
+            CD3DX12_RESOURCE_DESC::Buffer(UINT64{ ib_count } * ibStride)
+        };
+        uint64_t size = 0;
+        uint64_t alignment = 0;
+        for (const auto& desc : descs) {
+            auto info = device->GetResourceAllocationInfo(0, 1, &desc);
+            size += info.SizeInBytes;
+            alignment = max(alignment, info.Alignment);
+        }
+        memoryTracker.Track(meshGeo, MemoryTracker::Category::Mesh, name, size, alignment);
+    }
+
+    // load: void(UINT i, ID3D12Resource** resource, bool* isCubeMap)
+    template<typename Load>
+    void RegisterDDSTextures(string name, UINT num, Load&& load) {
+        Texture tex;
+        tex.resources.resize(num);
+
+        tex.allocationSRV = AllocateSrv(num);
+
+        for (UINT i = 0; i < num; i++) {
+            bool isCubeMap;
+            load(i, &tex.resources[i], &isCubeMap);
+
+            D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc =
+                isCubeMap ?
+                UDX12::Desc::SRV::TexCube(tex.resources[i]->GetDesc().Format)
+                : UDX12::Desc::SRV::Tex2D(tex.resources[i]->GetDesc().Format);
+
+            device->CreateShaderResourceView(tex.resources[i], &srvDesc, SrvCpuHandle(tex.allocationSRV, i));
+            TrackResource(tex.resources[i], MemoryTracker::Category::Texture, name);
+        }
+        CommitSrv(tex);
+
+        lock_guard<mutex> lock(textureMapMutex);
+        textureMap.emplace(move(name), move(tex));
+    }
+
+    DescriptorAllocator::Allocation AllocateSrv(UINT num) {
+        auto allocation = srvAllocator->Allocate(num);
+        if (allocation.IsNull())
+            ThrowIfFailed(E_OUTOFMEMORY); // more SRVs than maxSrvPageNum pages (or the shader-visible heap) hold
+        return allocation;
+    }
+
+    D3D12_CPU_DESCRIPTOR_HANDLE SrvCpuHandle(const DescriptorAllocator::Allocation& allocation, UINT index = 0) const {
+        return CD3DX12_CPU_DESCRIPTOR_HANDLE(
+            srvPages[allocation.page].cpuHeap->GetCPUDescriptorHandleForHeapStart(),
+            allocation.offset + index, csuDescriptorSize);
+    }
+
+    D3D12_GPU_DESCRIPTOR_HANDLE SrvGpuHandle(const DescriptorAllocator::Allocation& allocation, UINT index = 0) const {
+        return srvPages[allocation.page].gpuAllocation.GetGpuHandle(allocation.offset + index);
+    }
+
+    // publish the CPU-only descriptors to the shader-visible heap (and the bindless table)
+    void CommitSrv(Texture& tex) const {
+        const auto& allocation = tex.allocationSRV;
+        device->CopyDescriptorsSimple(allocation.num,
+            srvPages[allocation.page].gpuAllocation.GetCpuHandle(allocation.offset),
+            SrvCpuHandle(allocation),
+            D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+        if (bindlessAllocator)
+            AddToBindless(tex);
+    }
+
+    void ReleaseTexture(Texture& tex) {
+        srvAllocator->Free(tex.allocationSRV);
+        if (bindlessAllocator)
+            bindlessAllocator->Free(tex.allocationBindless);
+        if (!tex.allocationRTV.IsNull())
+            UDX12::DescriptorHeapMngr::Instance().GetRTVCpuDH()->Free(move(tex.allocationRTV));
+        for (auto rsrc : tex.resources) {
+            memoryTracker.Untrack(rsrc);
+            rsrc->Release();
+        }
+    }
+
+    // creates the texture with its mips up to maxsize and records their upload to the transfer engine
+    HRESULT UploadDDSTexture(const vector<uint8_t>& file, UINT maxsize, ID3D12Resource** resource, bool* isCubeMap) {
+        vector<D3D12_SUBRESOURCE_DATA> subresources;
+        HRESULT hr = DirectX::LoadDDSTextureFromMemory(
+            device,
+            file.data(),
+            file.size(),
+            resource,
+            subresources,
+            maxsize,
+            nullptr,
+            isCubeMap);
+        if (FAILED(hr))
+            return hr;
+        transfer->UploadTexture(*resource, 0, subresources.data(), static_cast<UINT>(subresources.size()));
+        return S_OK;
+    }
+
+    // mips [mip, ...) of every element of the streamed texture, recorded to the transfer engine
+    // returns false if a file can't be loaded, the resources created so far are still in tex
+    bool LoadStreamedMips(const StreamedTexture& streamed, uint32_t mip, Texture& tex) {
+        const UINT maxsize = max(streamed.size >> mip, 1u);
+        const UINT num = static_cast<UINT>(streamed.files.size());
+        for (UINT i = 0; i < num; i++) {
+            ID3D12Resource* resource = nullptr;
+            bool isCubeMap;
+            if (FAILED(UploadDDSTexture(streamed.files[i], maxsize, &resource, &isCubeMap)))
+                return false;
+            tex.resources.push_back(resource);
+            TrackResource(resource, MemoryTracker::Category::Texture, streamed.name);
+        }
+
+        tex.allocationSRV = AllocateSrv(num);
+        for (UINT i = 0; i < num; i++) {
+            D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc =
+                streamed.isCubeMaps[i] ?
+                UDX12::Desc::SRV::TexCube(tex.resources[i]->GetDesc().Format)
+                : UDX12::Desc::SRV::Tex2D(tex.resources[i]->GetDesc().Format);
+            device->CreateShaderResourceView(tex.resources[i], &srvDesc, SrvCpuHandle(tex.allocationSRV, i));
+        }
+        CommitSrv(tex);
+        return true;
+    }
+
+    // the old texture is released after fence completes
+    void ReplaceTexture(const string& name, Texture tex, UINT64 fence) {
+        shared_ptr<Texture> old;
+        {
+            lock_guard<mutex> lock(textureMapMutex);
+            auto target = textureMap.find(name);
+            old = make_shared<Texture>(move(target->second));
+            textureMap.erase(target);
+            textureMap.emplace(name, move(tex));
+        }
+        retireQueue.Retire(fence, [this, old]() { ReleaseTexture(*old); });
+    }
+
+    void AddToBindless(Texture& tex) const {
+        const auto& allocation = tex.allocationSRV;
+        tex.allocationBindless = bindlessAllocator->Allocate(allocation.num);
+        if (tex.allocationBindless.IsNull())
+            ThrowIfFailed(E_OUTOFMEMORY); // bindless table is full
+        device->CopyDescriptorsSimple(allocation.num,
+            bindlessTable.GetCpuHandle(tex.allocationBindless.offset),
+            SrvCpuHandle(allocation),
+            D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    }
 };
 
 DXRenderer::DXRenderer()
@@ -87,11 +423,17 @@ DXRenderer::~DXRenderer() {
     delete(pImpl);
 }
 
-DXRenderer& DXRenderer::Init(ID3D12Device* device) {
+DXRenderer& DXRenderer::Init(ID3D12Device* device, UINT srvPageSize, UINT maxSrvPageNum) {
     assert(!pImpl->isInit);
 
     pImpl->device = device;
     pImpl->upload = new DirectX::ResourceUploadBatch{ device };
+
+    pImpl->csuDescriptorSize = device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    pImpl->srvPages.resize(maxSrvPageNum);
+    pImpl->srvAllocator = make_unique<DescriptorAllocator>(srvPageSize, maxSrvPageNum,
+        [impl = pImpl](uint32_t page) { return impl->AddSrvPage(page); });
+    pImpl->rootSignatureCache = make_unique<D3D12RootSignatureCache>(device);
     
     pImpl->isInit = true;
     return *this;
@@ -100,12 +442,38 @@ DXRenderer& DXRenderer::Init(ID3D12Device* device) {
 void DXRenderer::Release() {
     assert(pImpl->isInit);
 
-    for (auto& [name, tex] : pImpl->textureMap) {
-        UDX12::DescriptorHeapMngr::Instance().GetCSUGpuDH()->Free(move(tex.allocationSRV));
-        if(!tex.allocationRTV.IsNull())
-            UDX12::DescriptorHeapMngr::Instance().GetRTVCpuDH()->Free(move(tex.allocationRTV));
-        for (auto rsrc : tex.resources)
-            rsrc->Release();
+    // the GPU is idle at shutdown, but the copy queue may still be running
+    if (pImpl->transfer)
+        pImpl->transfer->WaitIdle();
+    for (auto& mips : pImpl->streamedMips)
+        pImpl->ReleaseTexture(mips.tex);
+    pImpl->streamedMips.clear();
+    pImpl->streamedTextures.clear();
+    pImpl->streamedTextureMap.clear();
+    pImpl->textureStreamer.reset();
+    pImpl->transfer.reset();
+    pImpl->shaderHotReload.reset(); // joins the compile thread
+    pImpl->PSORecordMap.clear();
+
+    pImpl->retireQueue.Flush();
+
+    for (auto& [name, tex] : pImpl->textureMap)
+        pImpl->ReleaseTexture(tex);
+
+    for (UINT i = 0; i < pImpl->srvAllocator->GetPageNum(); i++) {
+        auto& page = pImpl->srvPages[i];
+        UDX12::DescriptorHeapMngr::Instance().GetCSUGpuDH()->Free(move(page.gpuAllocation));
+        pImpl->memoryTracker.Untrack(page.cpuHeap);
+        page.cpuHeap->Release();
+    }
+    pImpl->srvPages.clear();
+    pImpl->srvAllocator.reset();
+    pImpl->srvPagesCapped = false;
+
+    if (pImpl->bindlessAllocator) {
+        pImpl->memoryTracker.Untrack(&pImpl->bindlessTable);
+        UDX12::DescriptorHeapMngr::Instance().GetCSUGpuDH()->Free(move(pImpl->bindlessTable));
+        pImpl->bindlessAllocator.reset();
     }
 
     for (auto& [name, rootSig] : pImpl->rootSignatureMap)
@@ -118,8 +486,17 @@ void DXRenderer::Release() {
     delete pImpl->upload;
 
     pImpl->textureMap.clear();
+    for (const auto& [name, meshGeo] : pImpl->meshGeoMap)
+        pImpl->memoryTracker.Untrack(&meshGeo);
     pImpl->meshGeoMap.clear();
+    pImpl->pooledMeshMap.clear();
+    pImpl->dynamicMeshMap.clear();
+    pImpl->meshletMap.clear();
+    pImpl->meshLodMap.clear();
+    pImpl->meshPoolMap.clear();
     pImpl->rootSignatureMap.clear();
+    pImpl->rootSignatureLayoutMap.clear();
+    pImpl->rootSignatureCache.reset();
     pImpl->PSOMap.clear();
 
     pImpl->isInit = false;
@@ -134,50 +511,402 @@ DXRenderer& DXRenderer::RegisterDDSTextureFromFile(
     string name,
     wstring_view filename)
 {
+    UDXR_PROFILE_ZONE("DXRenderer::RegisterDDSTextureFromFile");
     return RegisterDDSTextureArrayFromFile(upload, move(name), &filename, 1);
 }
 
 DXRenderer& DXRenderer::RegisterDDSTextureArrayFromFile(DirectX::ResourceUploadBatch& upload,
     string name, const wstring_view* filenameArr, UINT num)
 {
-    Impl::Texture tex;
-    tex.resources.resize(num);
-
-    tex.allocationSRV = UDX12::DescriptorHeapMngr::Instance().GetCSUGpuDH()->Allocate(num);
-
-    for (UINT i = 0; i < num; i++) {
-        bool isCubeMap;
+    UDXR_PROFILE_ZONE("DXRenderer::RegisterDDSTextureArrayFromFile");
+    pImpl->RegisterDDSTextures(move(name), num, [&](UINT i, ID3D12Resource** resource, bool* isCubeMap) {
         DirectX::CreateDDSTextureFromFile(
             pImpl->device,
             upload,
             filenameArr[i].data(),
-            &tex.resources[i],
+            resource,
+            false,
+            0,
+            nullptr,
+            isCubeMap);
+    });
+    return *this;
+}
+
+DXRenderer& DXRenderer::RegisterDDSTextureFromMemory(DirectX::ResourceUploadBatch& upload,
+    string name, const void* data, size_t size)
+{
+    UDXR_PROFILE_ZONE("DXRenderer::RegisterDDSTextureFromMemory");
+    pImpl->RegisterDDSTextures(move(name), 1, [&](UINT, ID3D12Resource** resource, bool* isCubeMap) {
+        ThrowIfFailed(DirectX::CreateDDSTextureFromMemory(
+            pImpl->device,
+            upload,
+            static_cast<const uint8_t*>(data),
+            size,
+            resource,
             false,
             0,
             nullptr,
-            &isCubeMap);
+            isCubeMap));
+    });
+    return *this;
+}
 
-        D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc =
-            isCubeMap ?
-            UDX12::Desc::SRV::TexCube(tex.resources[i]->GetDesc().Format)
-            : UDX12::Desc::SRV::Tex2D(tex.resources[i]->GetDesc().Format);
+DXRenderer& DXRenderer::RegisterDDSTextureFromArchive(DirectX::ResourceUploadBatch& upload,
+    string name, const PackArchive& archive, string_view path)
+{
+    return RegisterDDSTextureArrayFromArchive(upload, move(name), archive, &path, 1);
+}
 
-        pImpl->device->CreateShaderResourceView(tex.resources[i], &srvDesc, tex.allocationSRV.GetCpuHandle(i));
+DXRenderer& DXRenderer::RegisterDDSTextureArrayFromArchive(DirectX::ResourceUploadBatch& upload,
+    string name, const PackArchive& archive, const string_view* pathArr, UINT num)
+{
+    UDXR_PROFILE_ZONE("DXRenderer::RegisterDDSTextureArrayFromArchive");
+    vector<vector<uint8_t>> files(num);
+    vector<PackArchive::ReadRequest> requests(num);
+    for (UINT i = 0; i < num; i++) {
+        auto entry = archive.Find(pathArr[i]);
+        if (entry == PackArchive::InvalidEntry)
+            ThrowIfFailed(HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND));
+        files[i].resize(static_cast<size_t>(archive.GetSize(entry)));
+        requests[i] = { entry, files[i].data() };
     }
+    if (!archive.ReadBatch(requests.data(), num))
+        ThrowIfFailed(HRESULT_FROM_WIN32(ERROR_READ_FAULT));
 
-    pImpl->textureMap.emplace(move(name), move(tex));
-
+    pImpl->RegisterDDSTextures(move(name), num, [&](UINT i, ID3D12Resource** resource, bool* isCubeMap) {
+        ThrowIfFailed(DirectX::CreateDDSTextureFromMemory(
+            pImpl->device,
+            upload,
+            files[i].data(),
+            files[i].size(),
+            resource,
+            false,
+            0,
+            nullptr,
+            isCubeMap));
+    });
     return *this;
 }
 
 D3D12_CPU_DESCRIPTOR_HANDLE DXRenderer::GetTextureSrvCpuHandle(const string& name, UINT index) const {
-    return pImpl->textureMap.find(name)->second.allocationSRV.GetCpuHandle(index);
+    lock_guard<mutex> lock(pImpl->textureMapMutex);
+    return pImpl->SrvCpuHandle(pImpl->textureMap.find(name)->second.allocationSRV, index);
 }
 D3D12_GPU_DESCRIPTOR_HANDLE DXRenderer::GetTextureSrvGpuHandle(const string& name, UINT index) const {
-    return pImpl->textureMap.find(name)->second.allocationSRV.GetGpuHandle(index);
+    lock_guard<mutex> lock(pImpl->textureMapMutex);
+    return pImpl->SrvGpuHandle(pImpl->textureMap.find(name)->second.allocationSRV, index);
+}
+
+DescriptorAllocator::Stats DXRenderer::GetSrvAllocatorStats() const {
+    return pImpl->srvAllocator->GetStats();
+}
+
+UINT DXRenderer::GetSrvCapacity() const {
+    return pImpl->srvAllocator->GetPageSize() * pImpl->srvAllocator->GetMaxPageNum();
+}
+
+DXRenderer& DXRenderer::EnableBindless(UINT capacity) {
+    assert(pImpl->isInit && !pImpl->bindlessAllocator);
+
+    pImpl->bindlessTable = UDX12::DescriptorHeapMngr::Instance().GetCSUGpuDH()->Allocate(capacity);
+    pImpl->bindlessAllocator = make_unique<DescriptorAllocator>(capacity, 1);
+    pImpl->memoryTracker.Track(&pImpl->bindlessTable, MemoryTracker::Category::DescriptorHeap,
+        "bindless table", uint64_t{ capacity } * pImpl->csuDescriptorSize, pImpl->csuDescriptorSize);
+
+    // add the textures registered so far
+    lock_guard<mutex> lock(pImpl->textureMapMutex);
+    for (auto& [name, tex] : pImpl->textureMap)
+        pImpl->AddToBindless(tex);
+
+    return *this;
+}
+
+bool DXRenderer::IsBindlessEnabled() const {
+    return pImpl->bindlessAllocator != nullptr;
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE DXRenderer::GetBindlessTable() const {
+    assert(IsBindlessEnabled());
+    return pImpl->bindlessTable.GetGpuHandle();
+}
+
+UINT DXRenderer::GetTextureBindlessIndex(const string& name, UINT index) const {
+    assert(IsBindlessEnabled());
+    lock_guard<mutex> lock(pImpl->textureMapMutex);
+    const auto& allocation = pImpl->textureMap.find(name)->second.allocationBindless;
+    assert(index < allocation.num);
+    return allocation.offset + index;
+}
+
+DescriptorAllocator::Stats DXRenderer::GetBindlessStats() const {
+    assert(IsBindlessEnabled());
+    return pImpl->bindlessAllocator->GetStats();
+}
+
+CD3DX12_DESCRIPTOR_RANGE DXRenderer::GetBindlessRange(UINT baseRegister, UINT space) const {
+    CD3DX12_DESCRIPTOR_RANGE range;
+    range.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, UINT_MAX, baseRegister, space); // UINT_MAX: unbounded
+    return range;
+}
+
+DXRenderer& DXRenderer::EnableTransferEngine(UINT64 stagingSize) {
+    assert(pImpl->isInit && !pImpl->transfer);
+
+    pImpl->transfer = make_unique<D3D12TransferEngine>(pImpl->device, stagingSize, &pImpl->memoryTracker);
+    return *this;
+}
+
+bool DXRenderer::IsTransferEngineEnabled() const {
+    return pImpl->transfer != nullptr;
+}
+
+D3D12TransferEngine& DXRenderer::GetTransferEngine() const {
+    return *pImpl->transfer;
+}
+
+DXRenderer& DXRenderer::EnableShaderHotReload(chrono::milliseconds pollInterval) {
+    assert(pImpl->isInit && !pImpl->shaderHotReload);
+
+    pImpl->shaderHotReload = make_unique<D3D12ShaderHotReload>(pollInterval);
+    return *this;
+}
+
+bool DXRenderer::IsShaderHotReloadEnabled() const {
+    return pImpl->shaderHotReload != nullptr;
+}
+
+size_t DXRenderer::UpdateShaderHotReload(UINT64 fence) {
+    if (!pImpl->shaderHotReload)
+        return 0;
+    UDXR_PROFILE_ZONE("DXRenderer::UpdateShaderHotReload");
+
+    // the new bytecode by shader name, the last result of a shader wins
+    unordered_map<string, ID3DBlob*> changed;
+    for (auto& [name, shader] : pImpl->shaderHotReload->TakeResults()) {
+        if (pImpl->shaderByteCodeMap.find(name) == pImpl->shaderByteCodeMap.end()) {
+            shader->Release();
+            continue;
+        }
+        auto [target, isNew] = changed.emplace(name, shader);
+        if (!isNew) {
+            target->second->Release();
+            target->second = shader;
+        }
+    }
+    if (changed.empty())
+        return 0;
+
+    // all affected PSOs are built before anything is swapped in,
+    // so a failure keeps the old shaders and PSOs together
+    vector<pair<ID3D12PipelineState**, ID3D12PipelineState*>> rebuilt;
+    for (auto& [name, record] : pImpl->PSORecordMap) {
+        bool isAffected = false;
+        for (const auto& shaderName : record.shaderNames)
+            isAffected = isAffected || changed.find(shaderName) != changed.end();
+        if (!isAffected)
+            continue;
+
+        auto desc = record.desc;
+        D3D12_SHADER_BYTECODE* stages[] = { &desc.VS, &desc.PS, &desc.DS, &desc.HS, &desc.GS };
+        for (size_t i = 0; i < record.shaderNames.size(); i++) {
+            if (record.shaderNames[i].empty())
+                continue;
+            auto target = changed.find(record.shaderNames[i]);
+            auto shader = target != changed.end() ? target->second : pImpl->shaderByteCodeMap.at(record.shaderNames[i]);
+            *stages[i] = { shader->GetBufferPointer(), shader->GetBufferSize() };
+        }
+        for (size_t i = 0; i < record.inputElements.size(); i++)
+            record.inputElements[i].SemanticName = record.semanticNames[i].c_str();
+        desc.InputLayout = { record.inputElements.data(), static_cast<UINT>(record.inputElements.size()) };
+
+        ID3D12PipelineState* pso;
+        if (FAILED(pImpl->device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&pso)))) {
+            OutputDebugStringA(("shader hot reload: PSO " + name
+                + " doesn't build from the new shaders, the old shaders and PSOs are kept\n").c_str());
+            for (auto& [slot, built] : rebuilt)
+                built->Release();
+            for (auto& [shaderName, shader] : changed)
+                shader->Release();
+            return 0;
+        }
+        rebuilt.emplace_back(&pImpl->PSOMap.at(name), pso);
+    }
+
+    // the app may still hold the old bytecode and PSOs for this frame
+    for (auto& [name, shader] : changed) {
+        auto& current = pImpl->shaderByteCodeMap.at(name);
+        pImpl->retireQueue.Retire(fence, [old = current]() { old->Release(); });
+        current = shader;
+    }
+    for (auto& [slot, built] : rebuilt) {
+        pImpl->retireQueue.Retire(fence, [old = *slot]() { old->Release(); });
+        *slot = built;
+    }
+    return rebuilt.size();
+}
+
+D3D12ShaderHotReload::Stats DXRenderer::GetShaderHotReloadStats() const {
+    return pImpl->shaderHotReload->GetStats();
+}
+
+DXRenderer& DXRenderer::EnableTextureStreaming(const TextureStreamer::Config& config) {
+    assert(pImpl->isInit && !pImpl->textureStreamer && IsTransferEngineEnabled());
+
+    pImpl->textureStreamer = make_unique<TextureStreamer>(config);
+    return *this;
+}
+
+bool DXRenderer::IsTextureStreamingEnabled() const {
+    return pImpl->textureStreamer != nullptr;
+}
+
+DXRenderer& DXRenderer::RegisterStreamedDDSTextureArrayFromMemory(
+    string name, vector<vector<uint8_t>> files, UINT minResidentMips)
+{
+    UDXR_PROFILE_ZONE("DXRenderer::RegisterStreamedDDSTextureArrayFromMemory");
+    assert(IsTextureStreamingEnabled());
+
+    const UINT num = static_cast<UINT>(files.size());
+    vector<DDSInfo> infos(num);
+    Impl::StreamedTexture streamed;
+    streamed.name = name;
+    streamed.isCubeMaps.resize(num);
+    streamed.size = 0;
+    UINT mipNum = 0;
+    for (UINT i = 0; i < num; i++) {
+        if (!ReadDDSInfo(files[i], infos[i]))
+            ThrowIfFailed(E_INVALIDARG);
+        UINT size = max(infos[i].width, infos[i].height);
+        if (size > streamed.size) {
+            streamed.size = size;
+            mipNum = infos[i].mipNum;
+        }
+    }
+    const UINT minResidentMip = mipNum - clamp(minResidentMips, 1u, mipNum);
+    const UINT residentSize = max(streamed.size >> minResidentMip, 1u);
+
+    vector<D3D12_RESOURCE_DESC> descs(num);
+    pImpl->RegisterDDSTextures(name, num, [&](UINT i, ID3D12Resource** resource, bool* isCubeMap) {
+        ThrowIfFailed(pImpl->UploadDDSTexture(files[i], residentSize, resource, isCubeMap));
+        streamed.isCubeMaps[i] = *isCubeMap;
+        descs[i] = (*resource)->GetDesc();
+    });
+
+    // the memory of each mip chain the texture can be recreated with
+    TextureStreamer::Desc desc;
+    desc.residentBytes.resize(mipNum);
+    desc.minResidentMips = mipNum - minResidentMip;
+    for (UINT mip = 0; mip < mipNum; mip++) {
+        const UINT maxsize = max(streamed.size >> mip, 1u);
+        for (UINT i = 0; i < num; i++) {
+            UINT skipped = SkippedMips(infos[i], maxsize);
+            D3D12_RESOURCE_DESC mipsDesc = descs[i];
+            mipsDesc.Width = max(infos[i].width >> skipped, 1u);
+            mipsDesc.Height = max(infos[i].height >> skipped, 1u);
+            mipsDesc.MipLevels = static_cast<UINT16>(infos[i].mipNum - skipped);
+            desc.residentBytes[mip] += pImpl->device->GetResourceAllocationInfo(0, 1, &mipsDesc).SizeInBytes;
+        }
+    }
+
+    auto id = pImpl->textureStreamer->Register(desc);
+    if (id >= pImpl->streamedTextures.size())
+        pImpl->streamedTextures.resize(id + 1);
+    streamed.files = move(files);
+    pImpl->streamedTextures[id] = move(streamed);
+    pImpl->streamedTextureMap.emplace(move(name), id);
+    return *this;
+}
+
+DXRenderer& DXRenderer::RegisterStreamedDDSTextureArrayFromArchive(
+    string name, const PackArchive& archive, const string_view* pathArr, UINT num, UINT minResidentMips)
+{
+    UDXR_PROFILE_ZONE("DXRenderer::RegisterStreamedDDSTextureArrayFromArchive");
+    vector<vector<uint8_t>> files(num);
+    vector<PackArchive::ReadRequest> requests(num);
+    for (UINT i = 0; i < num; i++) {
+        auto entry = archive.Find(pathArr[i]);
+        if (entry == PackArchive::InvalidEntry)
+            ThrowIfFailed(HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND));
+        files[i].resize(static_cast<size_t>(archive.GetSize(entry)));
+        requests[i] = { entry, files[i].data() };
+    }
+    if (!archive.ReadBatch(requests.data(), num))
+        ThrowIfFailed(HRESULT_FROM_WIN32(ERROR_READ_FAULT));
+
+    return RegisterStreamedDDSTextureArrayFromMemory(move(name), move(files), minResidentMips);
+}
+
+bool DXRenderer::IsStreamedTexture(const string& name) const {
+    return pImpl->streamedTextureMap.find(name) != pImpl->streamedTextureMap.end();
+}
+
+UINT DXRenderer::GetStreamedTextureSize(const string& name) const {
+    return pImpl->streamedTextures[pImpl->streamedTextureMap.find(name)->second].size;
+}
+
+DXRenderer& DXRenderer::RequestTextureMip(const string& name, float mip) {
+    pImpl->textureStreamer->Request(pImpl->streamedTextureMap.find(name)->second, mip);
+    return *this;
+}
+
+size_t DXRenderer::UpdateTextureStreaming(UINT64 fence) {
+    UDXR_PROFILE_ZONE("DXRenderer::UpdateTextureStreaming");
+    auto& impl = *pImpl;
+
+    // the uploads complete in submission order
+    size_t committed = 0;
+    size_t doneNum = 0;
+    for (; doneNum < impl.streamedMips.size(); doneNum++) {
+        auto& mips = impl.streamedMips[doneNum];
+        if (!impl.transfer->IsComplete(mips.ticket))
+            break;
+
+        bool isStreamIn = mips.type == TextureStreamer::OpType::StreamIn;
+        if (mips.failed || mips.dropped) {
+            if (isStreamIn && !mips.dropped)
+                impl.textureStreamer->CancelStreamIn(mips.id);
+            // the GPU is done with it, only the upload used it
+            impl.ReleaseTexture(mips.tex);
+            continue;
+        }
+
+        impl.ReplaceTexture(mips.name, move(mips.tex), fence);
+        if (isStreamIn)
+            impl.textureStreamer->OnStreamedIn(mips.id);
+        committed++;
+    }
+    impl.streamedMips.erase(impl.streamedMips.begin(), impl.streamedMips.begin() + doneNum);
+
+    for (const auto& op : impl.textureStreamer->Update()) {
+        const auto& streamed = impl.streamedTextures[op.texture];
+        Impl::StreamedMips mips;
+        mips.type = op.type;
+        mips.id = op.texture;
+        mips.name = streamed.name;
+        mips.failed = !impl.LoadStreamedMips(streamed, op.mip, mips.tex);
+        mips.dropped = false;
+        // the streamer has already released the evicted mips, but the old texture stays
+        if (mips.failed && op.type == TextureStreamer::OpType::Evict)
+            impl.textureStreamer->CancelEvict(op.texture, op.previousMip);
+        // covers every upload recorded so far (also those of a failed load)
+        mips.ticket = impl.transfer->GetRecordingTicket();
+        impl.streamedMips.push_back(move(mips));
+    }
+
+    return committed;
+}
+
+const TextureStreamer& DXRenderer::GetTextureStreamer() const {
+    return *pImpl->textureStreamer;
+}
+
+TextureStreamer& DXRenderer::GetTextureStreamer() {
+    return *pImpl->textureStreamer;
 }
 
 UDX12::DescriptorHeapAllocation& DXRenderer::GetTextureRtvs(const string& name) const {
+    lock_guard<mutex> lock(pImpl->textureMapMutex);
     return pImpl->textureMap.find(name)->second.allocationRTV;
 }
 
@@ -186,12 +915,14 @@ UDX12::MeshGeometry& DXRenderer::RegisterStaticMeshGeometry(
     const void* vb_data, UINT vb_count, UINT vb_stride,
     const void* ib_data, UINT ib_count, DXGI_FORMAT ib_format)
 {
+    UDXR_PROFILE_ZONE("DXRenderer::RegisterStaticMeshGeometry");
     auto& meshGeo = pImpl->meshGeoMap[name];
     meshGeo.Name = move(name);
     meshGeo.InitBuffer(pImpl->device, upload,
         vb_data, vb_count, vb_stride,
         ib_data, ib_count, ib_format
     );
+    pImpl->TrackMeshGeometry(&meshGeo, meshGeo.Name, vb_count, vb_stride, ib_count, ib_format);
     return meshGeo;
 }
 
@@ -200,18 +931,145 @@ UDX12::MeshGeometry& DXRenderer::RegisterDynamicMeshGeometry(
     const void* vb_data, UINT vb_count, UINT vb_stride,
     const void* ib_data, UINT ib_count, DXGI_FORMAT ib_format)
 {
+    UDXR_PROFILE_ZONE("DXRenderer::RegisterDynamicMeshGeometry");
     auto& meshGeo = pImpl->meshGeoMap[name];
     meshGeo.Name = move(name);
     meshGeo.InitBuffer(pImpl->device,
         vb_data, vb_count, vb_stride,
         ib_data, ib_count, ib_format);
+    pImpl->TrackMeshGeometry(&meshGeo, meshGeo.Name, vb_count, vb_stride, ib_count, ib_format);
     return meshGeo;
 }
 
+D3D12DynamicMesh& DXRenderer::RegisterDynamicMesh(string name,
+    UINT vertexStride, UINT vertexCapacity,
+    DXGI_FORMAT indexFormat, UINT indexCapacity,
+    UINT copyNum)
+{
+    UDXR_PROFILE_ZONE("DXRenderer::RegisterDynamicMesh");
+    auto mesh = make_unique<D3D12DynamicMesh>(pImpl->device,
+        vertexStride, vertexCapacity, indexFormat, indexCapacity, copyNum, &pImpl->memoryTracker, name);
+    return *pImpl->dynamicMeshMap.emplace(move(name), move(mesh)).first->second;
+}
+
+D3D12DynamicMesh& DXRenderer::GetDynamicMesh(const string& name) const {
+    return *pImpl->dynamicMeshMap.find(name)->second;
+}
+
 UDX12::MeshGeometry& DXRenderer::GetMeshGeometry(const string& name) const {
     return pImpl->meshGeoMap.find(name)->second;
 }
 
+DXRenderer& DXRenderer::RegisterMeshPool(string name,
+    UINT vertexStride, UINT vertexCapacity,
+    DXGI_FORMAT indexFormat, UINT indexCapacity)
+{
+    UDXR_PROFILE_ZONE("DXRenderer::RegisterMeshPool");
+    auto pool = make_unique<D3D12MeshPool>(pImpl->device,
+        vertexStride, vertexCapacity, indexFormat, indexCapacity, &pImpl->memoryTracker, name);
+    pImpl->meshPoolMap.emplace(move(name), move(pool));
+    return *this;
+}
+
+D3D12MeshPool& DXRenderer::GetMeshPool(const string& name) const {
+    return *pImpl->meshPoolMap.find(name)->second;
+}
+
+const D3D12MeshPool::Mesh& DXRenderer::RegisterPooledMeshGeometry(
+    ID3D12GraphicsCommandList* cmdList, UINT64 fence,
+    const string& poolName, string name,
+    const void* vb_data, UINT vb_count,
+    const void* ib_data, UINT ib_count,
+    const D3D12MeshPool::Submesh* submeshes, UINT submeshNum)
+{
+    UDXR_PROFILE_ZONE("DXRenderer::RegisterPooledMeshGeometry");
+    auto& pool = GetMeshPool(poolName);
+    auto mesh = pool.Register(cmdList, pImpl->retireQueue, fence, vb_data, vb_count, ib_data, ib_count,
+        submeshes, submeshNum);
+    if (mesh.IsNull())
+        ThrowIfFailed(E_OUTOFMEMORY); // the pool is full (or too fragmented)
+    return pImpl->pooledMeshMap.emplace(move(name), Impl::PooledMesh{ &pool, move(mesh) }).first->second.mesh;
+}
+
+D3D12TransferEngine::Ticket DXRenderer::UploadPooledMeshGeometry(
+    const string& poolName, string name,
+    const void* vb_data, UINT vb_count,
+    const void* ib_data, UINT ib_count,
+    const D3D12MeshPool::Submesh* submeshes, UINT submeshNum)
+{
+    UDXR_PROFILE_ZONE("DXRenderer::UploadPooledMeshGeometry");
+    auto& pool = GetMeshPool(poolName);
+    D3D12TransferEngine::Ticket ticket;
+    auto mesh = pool.Register(*pImpl->transfer, vb_data, vb_count, ib_data, ib_count, ticket,
+        submeshes, submeshNum);
+    if (mesh.IsNull())
+        ThrowIfFailed(E_OUTOFMEMORY); // the pool is full (or too fragmented)
+    pImpl->pooledMeshMap.emplace(move(name), Impl::PooledMesh{ &pool, move(mesh) });
+    return ticket;
+}
+
+const D3D12MeshPool::Mesh& DXRenderer::GetPooledMeshGeometry(const string& name) const {
+    return pImpl->pooledMeshMap.find(name)->second.mesh;
+}
+
+D3D12MeshPool& DXRenderer::GetPooledMeshGeometryPool(const string& name) const {
+    return *pImpl->pooledMeshMap.find(name)->second.pool;
+}
+
+DXRenderer& DXRenderer::UnregisterPooledMeshGeometry(const string& name, UINT64 fence) {
+    auto target = pImpl->pooledMeshMap.find(name);
+    assert(target != pImpl->pooledMeshMap.end());
+    pImpl->retireQueue.Retire(fence, [pooledMesh = target->second]() {
+        pooledMesh.pool->Unregister(pooledMesh.mesh);
+    });
+    pImpl->pooledMeshMap.erase(target);
+    pImpl->meshletMap.erase(name);
+    pImpl->meshLodMap.erase(name);
+    return *this;
+}
+
+const Meshlets::MeshletMesh& DXRenderer::RegisterMeshlets(const string& meshName,
+    const uint32_t* indices, size_t indexNum,
+    const void* positions, size_t vertexNum, size_t positionStride,
+    const Meshlets::Config& config)
+{
+    UDXR_PROFILE_ZONE("DXRenderer::RegisterMeshlets");
+    return RegisterMeshlets(meshName,
+        Meshlets::Build(indices, indexNum, positions, vertexNum, positionStride, config));
+}
+
+const Meshlets::MeshletMesh& DXRenderer::RegisterMeshlets(const string& meshName, Meshlets::MeshletMesh meshlets) {
+    assert(pImpl->meshGeoMap.find(meshName) != pImpl->meshGeoMap.end()
+        || pImpl->pooledMeshMap.find(meshName) != pImpl->pooledMeshMap.end());
+    auto& target = pImpl->meshletMap[meshName];
+    target = move(meshlets);
+    return target;
+}
+
+const Meshlets::MeshletMesh& DXRenderer::GetMeshlets(const string& meshName) const {
+    return pImpl->meshletMap.find(meshName)->second;
+}
+
+bool DXRenderer::HasMeshlets(const string& meshName) const {
+    return pImpl->meshletMap.find(meshName) != pImpl->meshletMap.end();
+}
+
+DXRenderer& DXRenderer::RegisterMeshLods(const string& meshName, vector<MeshSimplifier::Lod> lods) {
+    assert(pImpl->meshGeoMap.find(meshName) != pImpl->meshGeoMap.end()
+        || pImpl->pooledMeshMap.find(meshName) != pImpl->pooledMeshMap.end());
+    assert(!lods.empty());
+    pImpl->meshLodMap[meshName] = move(lods);
+    return *this;
+}
+
+const vector<MeshSimplifier::Lod>& DXRenderer::GetMeshLods(const string& meshName) const {
+    return pImpl->meshLodMap.find(meshName)->second;
+}
+
+bool DXRenderer::HasMeshLods(const string& meshName) const {
+    return pImpl->meshLodMap.find(meshName) != pImpl->meshLodMap.end();
+}
+
 ID3DBlob* DXRenderer::RegisterShaderByteCode(
     string name,
     const wstring& filename,
@@ -219,7 +1077,51 @@ ID3DBlob* DXRenderer::RegisterShaderByteCode(
     const string& entrypoint,
     const string& target)
 {
+    UDXR_PROFILE_ZONE("DXRenderer::RegisterShaderByteCode");
     auto shader = UDX12::Util::CompileShader(filename, defines, entrypoint, target);
+    if (pImpl->shaderHotReload) {
+        D3D12ShaderHotReload::Source source{ filename, {}, entrypoint, target };
+        for (auto define = defines; define && define->Name; ++define)
+            source.defines.emplace_back(define->Name, define->Definition ? define->Definition : "");
+        pImpl->shaderHotReload->AddShader(name, move(source));
+    }
+    pImpl->shaderByteCodeMap.emplace(move(name), shader);
+    return shader;
+}
+
+ID3DBlob* DXRenderer::RegisterShaderByteCode(
+    string name,
+    const PackArchive& archive,
+    string_view path,
+    const D3D_SHADER_MACRO* defines,
+    const string& entrypoint,
+    const string& target)
+{
+    UDXR_PROFILE_ZONE("DXRenderer::RegisterShaderByteCode");
+    auto entry = archive.Find(path);
+    vector<uint8_t> source;
+    if (entry == PackArchive::InvalidEntry)
+        ThrowIfFailed(HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND));
+    if (!archive.Read(entry, source))
+        ThrowIfFailed(HRESULT_FROM_WIN32(ERROR_READ_FAULT));
+
+    UINT compileFlags = 0;
+#if defined(DEBUG) || defined(_DEBUG)
+    compileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+#endif
+
+    ArchiveInclude include(archive, path);
+    string sourceName(archive.GetName(entry)); // for the error messages
+    ID3DBlob* shader = nullptr;
+    ID3DBlob* errors = nullptr;
+    HRESULT hr = D3DCompile(source.data(), source.size(), sourceName.c_str(), defines, &include,
+        entrypoint.c_str(), target.c_str(), compileFlags, 0, &shader, &errors);
+    if (errors) {
+        OutputDebugStringA(static_cast<const char*>(errors->GetBufferPointer()));
+        errors->Release();
+    }
+    ThrowIfFailed(hr);
+
     pImpl->shaderByteCodeMap.emplace(move(name), shader);
     return shader;
 }
@@ -229,10 +1131,11 @@ ID3DBlob* DXRenderer::GetShaderByteCode(const string& name) const {
 }
 
 DXRenderer& DXRenderer::RegisterRenderTexture2D(string name, UINT width, UINT height, DXGI_FORMAT format) {
+    UDXR_PROFILE_ZONE("DXRenderer::RegisterRenderTexture2D");
     Impl::Texture tex;
     tex.resources.resize(1);
 
-    tex.allocationSRV = UDX12::DescriptorHeapMngr::Instance().GetCSUGpuDH()->Allocate(1);
+    tex.allocationSRV = pImpl->AllocateSrv(1);
     tex.allocationRTV = UDX12::DescriptorHeapMngr::Instance().GetRTVCpuDH()->Allocate(1);
 
     // create resource
@@ -253,12 +1156,14 @@ DXRenderer& DXRenderer::RegisterRenderTexture2D(string name, UINT width, UINT he
         D3D12_RESOURCE_STATE_GENERIC_READ,
         nullptr,
         IID_PPV_ARGS(&tex.resources[0])));
+    pImpl->TrackResource(tex.resources[0], MemoryTracker::Category::RenderTarget, name);
 
     // create SRV
     pImpl->device->CreateShaderResourceView(
         tex.resources[0],
         &UDX12::Desc::SRV::Tex2D(format),
-        tex.allocationSRV.GetCpuHandle());
+        pImpl->SrvCpuHandle(tex.allocationSRV));
+    pImpl->CommitSrv(tex);
 
     // create RTVs
     D3D12_RENDER_TARGET_VIEW_DESC rtvDesc;
@@ -269,16 +1174,18 @@ DXRenderer& DXRenderer::RegisterRenderTexture2D(string name, UINT width, UINT he
     rtvDesc.Texture2D.PlaneSlice = 0; // ?
     pImpl->device->CreateRenderTargetView(tex.resources[0], &rtvDesc, tex.allocationRTV.GetCpuHandle());
 
+    lock_guard<mutex> lock(pImpl->textureMapMutex);
     pImpl->textureMap.emplace(move(name), move(tex));
 
     return *this;
 }
 
 DXRenderer& DXRenderer::RegisterRenderTextureCube(string name, UINT size, DXGI_FORMAT format) {
+    UDXR_PROFILE_ZONE("DXRenderer::RegisterRenderTextureCube");
     Impl::Texture tex;
     tex.resources.resize(1);
 
-    tex.allocationSRV = UDX12::DescriptorHeapMngr::Instance().GetCSUGpuDH()->Allocate(1);
+    tex.allocationSRV = pImpl->AllocateSrv(1);
     tex.allocationRTV = UDX12::DescriptorHeapMngr::Instance().GetRTVCpuDH()->Allocate(6);
 
     // create resource
@@ -301,12 +1208,14 @@ DXRenderer& DXRenderer::RegisterRenderTextureCube(string name, UINT size, DXGI_F
         D3D12_RESOURCE_STATE_GENERIC_READ,
         nullptr,
         IID_PPV_ARGS(&tex.resources[0])));
+    pImpl->TrackResource(tex.resources[0], MemoryTracker::Category::RenderTarget, name);
 
     // create SRV
     pImpl->device->CreateShaderResourceView(
         tex.resources[0],
         &UDX12::Desc::SRV::TexCube(format),
-        tex.allocationSRV.GetCpuHandle());
+        pImpl->SrvCpuHandle(tex.allocationSRV));
+    pImpl->CommitSrv(tex);
 
     // create RTVs
     for (UINT i = 0; i < 6; i++)
@@ -322,41 +1231,129 @@ DXRenderer& DXRenderer::RegisterRenderTextureCube(string name, UINT size, DXGI_F
         pImpl->device->CreateRenderTargetView(tex.resources[0], &rtvDesc, tex.allocationRTV.GetCpuHandle(i));
     }
 
+    lock_guard<mutex> lock(pImpl->textureMapMutex);
     pImpl->textureMap.emplace(move(name), move(tex));
 
     return *this;
 }
 
+DXRenderer& DXRenderer::UnregisterTexture(const string& name, UINT64 fence) {
+    shared_ptr<Impl::Texture> tex;
+    {
+        lock_guard<mutex> lock(pImpl->textureMapMutex);
+        auto target = pImpl->textureMap.find(name);
+        assert(target != pImpl->textureMap.end());
+        tex = make_shared<Impl::Texture>(move(target->second));
+        pImpl->textureMap.erase(target);
+    }
+    auto streamed = pImpl->streamedTextureMap.find(name);
+    if (streamed != pImpl->streamedTextureMap.end()) {
+        // mips still uploading are released when their upload completes
+        for (auto& mips : pImpl->streamedMips) {
+            if (mips.id == streamed->second)
+                mips.dropped = true;
+        }
+        pImpl->textureStreamer->Unregister(streamed->second);
+        pImpl->streamedTextures[streamed->second] = {};
+        pImpl->streamedTextureMap.erase(streamed);
+    }
+    pImpl->retireQueue.Retire(fence, [impl = pImpl, tex]() { impl->ReleaseTexture(*tex); });
+    return *this;
+}
+
+DXRenderer& DXRenderer::UnregisterMeshGeometry(const string& name, UINT64 fence) {
+    auto target = pImpl->meshGeoMap.find(name);
+    assert(target != pImpl->meshGeoMap.end());
+    // the buffers go with the last reference
+    auto meshGeo = make_shared<UDX12::MeshGeometry>(move(target->second));
+    pImpl->memoryTracker.Rekey(&target->second, meshGeo.get());
+    pImpl->meshGeoMap.erase(target);
+    pImpl->meshletMap.erase(name);
+    pImpl->meshLodMap.erase(name);
+    pImpl->retireQueue.Retire(fence, [impl = pImpl, meshGeo]() mutable {
+        impl->memoryTracker.Untrack(meshGeo.get());
+        meshGeo.reset();
+    });
+    return *this;
+}
+
+DXRenderer& DXRenderer::UnregisterDynamicMesh(const string& name, UINT64 fence) {
+    auto target = pImpl->dynamicMeshMap.find(name);
+    assert(target != pImpl->dynamicMeshMap.end());
+    shared_ptr<D3D12DynamicMesh> mesh = move(target->second);
+    pImpl->dynamicMeshMap.erase(target);
+    pImpl->retireQueue.Retire(fence, [mesh]() mutable { mesh.reset(); });
+    return *this;
+}
+
+DXRenderer& DXRenderer::UnregisterRootSignature(const string& name, UINT64 fence) {
+    auto target = pImpl->rootSignatureMap.find(name);
+    assert(target != pImpl->rootSignatureMap.end());
+    pImpl->retireQueue.Retire(fence, [rootSig = target->second]() { rootSig->Release(); });
+    pImpl->rootSignatureMap.erase(target);
+    pImpl->rootSignatureLayoutMap.erase(name);
+    return *this;
+}
+
+DXRenderer& DXRenderer::UnregisterPSO(const string& name, UINT64 fence) {
+    auto target = pImpl->PSOMap.find(name);
+    assert(target != pImpl->PSOMap.end());
+    pImpl->retireQueue.Retire(fence, [PSO = target->second]() { PSO->Release(); });
+    pImpl->PSOMap.erase(target);
+    pImpl->PSORecordMap.erase(name);
+    return *this;
+}
+
+MemoryTracker& DXRenderer::GetMemoryTracker() const {
+    return pImpl->memoryTracker;
+}
+
+size_t DXRenderer::CollectRetired(UINT64 completedFence) {
+    return pImpl->retireQueue.Collect(completedFence);
+}
+
+RetireQueue& DXRenderer::GetRetireQueue() const {
+    return pImpl->retireQueue;
+}
+
 DXRenderer& DXRenderer::RegisterRootSignature(
     string name,
     const D3D12_ROOT_SIGNATURE_DESC* desc
 )
 {
-    // create a root signature with a single slot which points to a descriptor range consisting of a single constant buffer
-    ID3DBlob* serializedRootSig = nullptr;
-    ID3DBlob* errorBlob = nullptr;
-
-    HRESULT hr = D3D12SerializeRootSignature(desc, D3D_ROOT_SIGNATURE_VERSION_1,
-        &serializedRootSig, &errorBlob);
-
-    if (errorBlob != nullptr)
-    {
-        ::OutputDebugStringA((char*)errorBlob->GetBufferPointer());
-        errorBlob->Release();
-    }
-    ThrowIfFailed(hr);
+    UDXR_PROFILE_ZONE("DXRenderer::RegisterRootSignature");
+    auto rootSig = pImpl->rootSignatureCache->Create(*desc);
+    pImpl->rootSignatureMap.emplace(move(name), rootSig);
+    return *this;
+}
 
-    ID3D12RootSignature* rootSig;
+DXRenderer& DXRenderer::RegisterRootSignature(
+    string name,
+    const D3D12_VERSIONED_ROOT_SIGNATURE_DESC* desc)
+{
+    UDXR_PROFILE_ZONE("DXRenderer::RegisterRootSignature");
+    auto rootSig = pImpl->rootSignatureCache->Create(*desc);
+    pImpl->rootSignatureMap.emplace(move(name), rootSig);
+    return *this;
+}
 
-    ThrowIfFailed(pImpl->device->CreateRootSignature(
-        0,
-        serializedRootSig->GetBufferPointer(),
-        serializedRootSig->GetBufferSize(),
-        IID_PPV_ARGS(&rootSig)));
+DXRenderer& DXRenderer::RegisterRootSignature(
+    string name,
+    const string* shaderNameArr, UINT num,
+    D3D12_ROOT_SIGNATURE_FLAGS flags)
+{
+    vector<vector<ShaderBindingLayout::Binding>> stages;
+    for (UINT i = 0; i < num; i++)
+        stages.push_back(D3D12ShaderBindingLayout::Reflect(GetShaderByteCode(shaderNameArr[i])));
 
-    pImpl->rootSignatureMap.emplace(move(name), rootSig);
+    ShaderBindingLayout layout;
+    if (layout.Build(stages.data(), stages.size()) != ShaderBindingLayout::BuildResult::Success)
+        ThrowIfFailed(E_INVALIDARG);
 
-    serializedRootSig->Release();
+    auto staticSamplers = GetStaticSamplers();
+    D3D12ShaderBindingLayout desc(layout, staticSamplers.data(), flags);
+    RegisterRootSignature(name, &desc.GetDesc());
+    pImpl->rootSignatureLayoutMap.emplace(move(name), move(layout));
 
     return *this;
 }
@@ -365,12 +1362,56 @@ ID3D12RootSignature* DXRenderer::GetRootSignature(const string& name) const {
     return pImpl->rootSignatureMap.find(name)->second;
 }
 
+const ShaderBindingLayout& DXRenderer::GetRootSignatureLayout(const string& name) const {
+    auto target = pImpl->rootSignatureLayoutMap.find(name);
+    assert(target != pImpl->rootSignatureLayoutMap.end());
+    return target->second;
+}
+
+bool DXRenderer::LoadRootSignatureCache(const filesystem::path& path) {
+    return pImpl->rootSignatureCache->Load(path);
+}
+
+bool DXRenderer::SaveRootSignatureCache(const filesystem::path& path) const {
+    return pImpl->rootSignatureCache->Save(path);
+}
+
+const D3D12RootSignatureCache::Stats& DXRenderer::GetRootSignatureCacheStats() const {
+    return pImpl->rootSignatureCache->GetStats();
+}
+
 DXRenderer& DXRenderer::RegisterPSO(
     string name,
     const D3D12_GRAPHICS_PIPELINE_STATE_DESC* desc)
 {
+    UDXR_PROFILE_ZONE("DXRenderer::RegisterPSO");
     ID3D12PipelineState* pso;
     pImpl->device->CreateGraphicsPipelineState(desc, IID_PPV_ARGS(&pso));
+
+    if (pImpl->shaderHotReload) {
+        assert(desc->StreamOutput.NumEntries == 0);
+        Impl::PSORecord record;
+        record.desc = *desc;
+        record.desc.CachedPSO = {};
+        record.inputElements.assign(desc->InputLayout.pInputElementDescs,
+            desc->InputLayout.pInputElementDescs + desc->InputLayout.NumElements);
+        for (const auto& element : record.inputElements)
+            record.semanticNames.emplace_back(element.SemanticName);
+
+        const D3D12_SHADER_BYTECODE* stages[] = { &desc->VS, &desc->PS, &desc->DS, &desc->HS, &desc->GS };
+        for (size_t i = 0; i < record.shaderNames.size(); i++) {
+            if (!stages[i]->pShaderBytecode)
+                continue;
+            for (const auto& [shaderName, shader] : pImpl->shaderByteCodeMap) {
+                if (shader->GetBufferPointer() == stages[i]->pShaderBytecode) {
+                    record.shaderNames[i] = shaderName;
+                    break;
+                }
+            }
+        }
+        pImpl->PSORecordMap.emplace(name, move(record));
+    }
+
     pImpl->PSOMap.emplace(move(name), pso);
     return *this;
 }
@@ -0,0 +1,21 @@
+#include <UDXRenderer/Clock.h>
+
+#include <chrono>
+#include <thread>
+
+using namespace Ubpa;
+using namespace std;
+
+int64_t SteadyClock::Now() const noexcept {
+    return chrono::duration_cast<chrono::nanoseconds>(
+        chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void SteadyClock::SleepFor(int64_t ns) {
+    if (ns > 0)
+        this_thread::sleep_for(chrono::nanoseconds(ns));
+}
+
+void SteadyClock::Spin() noexcept {
+    this_thread::yield();
+}
@@ -0,0 +1,166 @@
+#include <UDXRenderer/DescriptorAllocator.h>
+
+#include <algorithm>
+#include <cassert>
+#include <thread>
+
+using namespace Ubpa;
+using namespace std;
+
+struct DescriptorAllocator::Page {
+    struct Range {
+        uint32_t offset;
+        uint32_t num;
+    };
+
+    mutable mutex m;
+    vector<Range> freeRanges; // sorted by offset, never adjacent
+    uint32_t liveNum{ 0 };
+    uint32_t allocationNum{ 0 };
+
+    explicit Page(uint32_t size) : freeRanges{ { 0, size } } {}
+
+    bool Allocate(uint32_t num, uint32_t& offset) {
+        // first fit keeps low offsets busy and the tail of the page free for large ranges
+        for (auto iter = freeRanges.begin(); iter != freeRanges.end(); ++iter) {
+            if (iter->num < num)
+                continue;
+            offset = iter->offset;
+            iter->offset += num;
+            iter->num -= num;
+            if (iter->num == 0)
+                freeRanges.erase(iter);
+            liveNum += num;
+            allocationNum++;
+            return true;
+        }
+        return false;
+    }
+
+    void Free(uint32_t offset, uint32_t num) {
+        auto next = lower_bound(freeRanges.begin(), freeRanges.end(), offset,
+            [](const Range& r, uint32_t o) { return r.offset < o; });
+
+        assert(next == freeRanges.end() || offset + num <= next->offset);
+        assert(next == freeRanges.begin() || prev(next)->offset + prev(next)->num <= offset);
+
+        bool mergePrev = next != freeRanges.begin() && prev(next)->offset + prev(next)->num == offset;
+        bool mergeNext = next != freeRanges.end() && offset + num == next->offset;
+
+        if (mergePrev && mergeNext) {
+            prev(next)->num += num + next->num;
+            freeRanges.erase(next);
+        }
+        else if (mergePrev)
+            prev(next)->num += num;
+        else if (mergeNext) {
+            next->offset = offset;
+            next->num += num;
+        }
+        else
+            freeRanges.insert(next, { offset, num });
+
+        liveNum -= num;
+        allocationNum--;
+    }
+};
+
+DescriptorAllocator::DescriptorAllocator(uint32_t pageSize, uint32_t maxPageNum,
+    function<bool(uint32_t)> onNewPage)
+    : pageSize{ pageSize }, maxPageNum{ maxPageNum }, onNewPage{ move(onNewPage) },
+    pages{ new unique_ptr<Page>[maxPageNum] }
+{
+    assert(pageSize > 0 && maxPageNum > 0);
+}
+
+DescriptorAllocator::~DescriptorAllocator() = default;
+
+bool DescriptorAllocator::TryAllocate(uint32_t page, uint32_t num, Allocation& rst, bool wait) {
+    Page& p = *pages[page];
+    unique_lock<mutex> lock(p.m, defer_lock);
+    if (wait)
+        lock.lock();
+    else if (!lock.try_lock())
+        return false;
+
+    uint32_t offset;
+    if (!p.Allocate(num, offset))
+        return false;
+
+    rst = { page, offset, num };
+    return true;
+}
+
+DescriptorAllocator::Allocation DescriptorAllocator::Allocate(uint32_t num) {
+    Allocation rst;
+    if (num == 0 || num > pageSize)
+        return rst;
+
+    // shard by thread so that concurrent callers start on different pages
+    uint32_t start = static_cast<uint32_t>(hash<thread::id>{}(this_thread::get_id()));
+
+    for (bool wait : { false, true }) {
+        uint32_t curPageNum = pageNum.load(memory_order_acquire);
+        for (uint32_t i = 0; i < curPageNum; i++) {
+            if (TryAllocate((start + i) % curPageNum, num, rst, wait))
+                return rst;
+        }
+    }
+
+    // every page is full (or fragmented), add one
+    lock_guard<mutex> growLock(growMutex);
+
+    // another thread may have grown while we waited
+    uint32_t curPageNum = pageNum.load(memory_order_acquire);
+    if (curPageNum > 0 && TryAllocate(curPageNum - 1, num, rst, true))
+        return rst;
+
+    if (curPageNum == maxPageNum)
+        return rst;
+    if (onNewPage && !onNewPage(curPageNum))
+        return rst;
+
+    pages[curPageNum] = make_unique<Page>(pageSize);
+    TryAllocate(curPageNum, num, rst, true);
+    pageNum.store(curPageNum + 1, memory_order_release);
+
+    return rst;
+}
+
+void DescriptorAllocator::Free(const Allocation& allocation) {
+    if (allocation.IsNull())
+        return;
+
+    assert(allocation.page < pageNum.load(memory_order_acquire));
+    assert(allocation.offset + allocation.num <= pageSize);
+
+    Page& p = *pages[allocation.page];
+    lock_guard<mutex> lock(p.m);
+    p.Free(allocation.offset, allocation.num);
+}
+
+DescriptorAllocator::Stats DescriptorAllocator::GetStats() const {
+    Stats stats;
+    stats.pageNum = pageNum.load(memory_order_acquire);
+    stats.capacity = static_cast<uint64_t>(stats.pageNum) * pageSize;
+
+    uint64_t largestSum = 0;
+    for (uint32_t i = 0; i < stats.pageNum; i++) {
+        const Page& p = *pages[i];
+        lock_guard<mutex> lock(p.m);
+        stats.liveNum += p.liveNum;
+        stats.allocationNum += p.allocationNum;
+        stats.freeRangeNum += static_cast<uint32_t>(p.freeRanges.size());
+        uint32_t largest = 0;
+        for (const auto& r : p.freeRanges)
+            largest = max(largest, r.num);
+        largestSum += largest;
+        stats.largestFreeRange = max(stats.largestFreeRange, largest);
+    }
+
+    stats.freeNum = stats.capacity - stats.liveNum;
+    if (stats.freeNum > 0)
+        stats.fragmentation = 1. - static_cast<double>(largestSum) / stats.freeNum;
+
+    return stats;
+}
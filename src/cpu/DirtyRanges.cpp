@@ -0,0 +1,70 @@
+#include <UDXRenderer/DirtyRanges.h>
+
+#include <algorithm>
+#include <cassert>
+
+using namespace Ubpa;
+using namespace std;
+
+namespace {
+    void Append(vector<DirtyRanges::Range>& dst, const vector<DirtyRanges::Range>& src) {
+        if (src.empty())
+            return;
+        dst.insert(dst.end(), src.begin(), src.end());
+        DirtyRanges::Coalesce(dst);
+    }
+}
+
+DirtyRanges::DirtyRanges(size_t copyNum)
+    : pendings(copyNum)
+{
+    assert(copyNum > 0);
+}
+
+void DirtyRanges::Add(uint32_t first, uint32_t num) {
+    if (num != 0)
+        dirty.push_back({ first, num });
+}
+
+uint64_t DirtyRanges::GetDirtyNum() {
+    Coalesce(dirty);
+    uint64_t num = 0;
+    for (const auto& range : dirty)
+        num += range.num;
+    return num;
+}
+
+const vector<DirtyRanges::Range>& DirtyRanges::Commit(size_t copy) {
+    assert(copy < pendings.size());
+    Coalesce(dirty);
+
+    // the ranges other frames dirtied, together with this frame's
+    committed.swap(pendings[copy]);
+    pendings[copy].clear();
+    Append(committed, dirty);
+
+    for (size_t i = 0; i < pendings.size(); i++) {
+        if (i != copy)
+            Append(pendings[i], dirty);
+    }
+    dirty.clear();
+    return committed;
+}
+
+void DirtyRanges::Coalesce(vector<Range>& ranges) {
+    if (ranges.size() < 2)
+        return;
+    sort(ranges.begin(), ranges.end(), [](const Range& lhs, const Range& rhs) {
+        return lhs.first < rhs.first;
+    });
+    size_t last = 0;
+    for (size_t i = 1; i < ranges.size(); i++) {
+        auto& merged = ranges[last];
+        uint32_t mergedEnd = merged.first + merged.num;
+        if (ranges[i].first <= mergedEnd)
+            merged.num = max(mergedEnd, ranges[i].first + ranges[i].num) - merged.first;
+        else
+            ranges[++last] = ranges[i];
+    }
+    ranges.resize(last + 1);
+}
@@ -0,0 +1,166 @@
+#include <UDXRenderer/DrawList.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <functional>
+
+using namespace Ubpa;
+using namespace std;
+
+namespace {
+    // row vectors: r = a * b
+    void Multiply(const float a[16], const float b[16], float r[16]) noexcept {
+        for (size_t i = 0; i < 4; i++) {
+            for (size_t j = 0; j < 4; j++) {
+                float sum = 0.f;
+                for (size_t k = 0; k < 4; k++)
+                    sum += a[i * 4 + k] * b[k * 4 + j];
+                r[i * 4 + j] = sum;
+            }
+        }
+    }
+
+    // p * m for the point p (w = 1), m affine
+    void TransformPoint(const float p[3], const float m[16], float r[3]) noexcept {
+        for (size_t j = 0; j < 3; j++)
+            r[j] = p[0] * m[j] + p[1] * m[4 + j] + p[2] * m[8 + j] + m[12 + j];
+    }
+
+    // p * inverse(m) for the point p, m affine and invertible
+    void InverseTransformPoint(const float p[3], const float m[16], float r[3]) noexcept {
+        // rows of the linear part
+        const float* x = m;
+        const float* y = m + 4;
+        const float* z = m + 8;
+        float d[3] = { p[0] - m[12], p[1] - m[13], p[2] - m[14] };
+        // d = r * [x; y; z], solved with Cramer's rule
+        float det = x[0] * (y[1] * z[2] - y[2] * z[1])
+            - x[1] * (y[0] * z[2] - y[2] * z[0])
+            + x[2] * (y[0] * z[1] - y[1] * z[0]);
+        assert(det != 0.f);
+        float inv = 1.f / det;
+        r[0] = (d[0] * (y[1] * z[2] - y[2] * z[1]) - d[1] * (y[0] * z[2] - y[2] * z[0]) + d[2] * (y[0] * z[1] - y[1] * z[0])) * inv;
+        r[1] = (x[0] * (d[1] * z[2] - d[2] * z[1]) - x[1] * (d[0] * z[2] - d[2] * z[0]) + x[2] * (d[0] * z[1] - d[1] * z[0])) * inv;
+        r[2] = (x[0] * (y[1] * d[2] - y[2] * d[1]) - x[1] * (y[0] * d[2] - y[2] * d[0]) + x[2] * (y[0] * d[1] - y[1] * d[0])) * inv;
+    }
+
+    // largest scale of the linear part
+    float MaxScale(const float m[16]) noexcept {
+        float s = 0.f;
+        for (size_t i = 0; i < 3; i++)
+            s = max(s, sqrtf(m[i * 4] * m[i * 4] + m[i * 4 + 1] * m[i * 4 + 1] + m[i * 4 + 2] * m[i * 4 + 2]));
+        return s;
+    }
+}
+
+size_t DrawList::Add(const Item& item) {
+    assert(item.lodNum == 0 || item.lods);
+    assert(!item.lodSelector || item.lodSelector->GetLodNum() <= max<size_t>(item.lodNum, 1));
+    size_t id = items.size();
+    items.push_back(item);
+    states.emplace_back();
+    order.push_back(id);
+    return id;
+}
+
+DrawList::CullStats DrawList::Cull(const float view[16], const float proj[16], const float eye[3], float viewportHeight) {
+    CullStats stats;
+    draws.clear();
+
+    float viewProj[16];
+    Multiply(view, proj, viewProj);
+
+    for (size_t id = 0; id < items.size(); id++) {
+        const auto& item = items[id];
+        auto& state = states[id];
+        state.drawOffset = draws.size();
+
+        if (item.lodSelector) {
+            float centerW[3];
+            TransformPoint(item.center, item.world, centerW);
+            float radius = MaxScale(item.world) * item.radius;
+            float d[3] = { centerW[0] - eye[0], centerW[1] - eye[1], centerW[2] - eye[2] };
+            float distance = sqrtf(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+            float screenSize = LodSelector::ScreenSize(radius, distance, proj[5], viewportHeight);
+            state.lod = item.lodSelector->Select(state.lod, screenSize);
+        }
+        else
+            state.lod = 0;
+
+        if (state.lod > 0) {
+            const auto& lod = item.lods[state.lod];
+            draws.push_back({ lod.indexNum, item.startIndex + lod.indexOffset });
+        }
+        else if (!item.meshlets)
+            draws.push_back({ item.indexNum, item.startIndex });
+        else {
+            // cull in object space, then draw runs of consecutive visible meshlets
+            float worldViewProj[16];
+            Multiply(item.world, viewProj, worldViewProj);
+            float planes[6][4];
+            Meshlets::ExtractFrustumPlanes(worldViewProj, planes);
+            float eyeL[3];
+            InverseTransformPoint(eye, item.world, eyeL);
+            auto meshletStats = Meshlets::Cull(*item.meshlets, planes, eyeL, visibleMeshlets);
+            stats.meshlets.meshletNum += meshletStats.meshletNum;
+            stats.meshlets.frustumCulledNum += meshletStats.frustumCulledNum;
+            stats.meshlets.backfaceCulledNum += meshletStats.backfaceCulledNum;
+            stats.meshlets.visibleTriangleNum += meshletStats.visibleTriangleNum;
+
+            const auto& meshlets = item.meshlets->meshlets;
+            for (size_t i = 0; i < visibleMeshlets.size();) {
+                uint32_t first = meshlets[visibleMeshlets[i]].primitiveOffset;
+                uint32_t triangleNum = 0;
+                for (uint32_t next = visibleMeshlets[i]; i < visibleMeshlets.size() && visibleMeshlets[i] == next; i++, next++)
+                    triangleNum += meshlets[next].primitiveNum;
+                draws.push_back({ 3 * triangleNum, item.startIndex + 3 * first });
+            }
+        }
+
+        state.drawNum = draws.size() - state.drawOffset;
+        for (size_t i = state.drawOffset; i < draws.size(); i++)
+            stats.indexNum += draws[i].indexNum;
+    }
+
+    stats.drawNum = draws.size();
+    return stats;
+}
+
+void DrawList::Sort(const float view[16]) {
+    for (size_t id = 0; id < items.size(); id++) {
+        const float* world = items[id].world;
+        states[id].viewDepth = world[12] * view[2] + world[13] * view[6] + world[14] * view[10] + view[14];
+    }
+
+    // ids break ties, so the order doesn't depend on the previous frame
+    sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        const void* aBuffers = items[a].buffers;
+        const void* bBuffers = items[b].buffers;
+        if (aBuffers != bBuffers)
+            return less<const void*>{}(aBuffers, bBuffers);
+        if (states[a].viewDepth != states[b].viewDepth)
+            return states[a].viewDepth < states[b].viewDepth;
+        return a < b;
+    });
+}
+
+void DrawList::Record(DrawDevice& device) const {
+    bool bound = false;
+    const void* boundBuffers = nullptr;
+    for (size_t id : order) {
+        const auto& item = items[id];
+        const auto& state = states[id];
+        if (state.drawNum == 0)
+            continue;
+
+        if (!bound || item.buffers != boundBuffers) {
+            device.SetBuffers(id);
+            bound = true;
+            boundBuffers = item.buffers;
+        }
+        device.SetItem(id);
+        for (size_t i = state.drawOffset; i < state.drawOffset + state.drawNum; i++)
+            device.DrawIndexed(draws[i].indexNum, draws[i].startIndex, item.baseVertex);
+    }
+}
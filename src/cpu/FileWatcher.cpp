@@ -0,0 +1,36 @@
+#include <UDXRenderer/FileWatcher.h>
+
+using namespace Ubpa;
+using namespace std;
+
+optional<filesystem::file_time_type> FileWatcher::WriteTime(const filesystem::path& path) {
+    error_code ec;
+    auto time = filesystem::last_write_time(path, ec);
+    if (ec)
+        return nullopt;
+    return time;
+}
+
+void FileWatcher::Watch(const filesystem::path& path) {
+    files[path] = WriteTime(path);
+}
+
+void FileWatcher::Unwatch(const filesystem::path& path) {
+    files.erase(path);
+}
+
+bool FileWatcher::IsWatched(const filesystem::path& path) const {
+    return files.find(path) != files.end();
+}
+
+vector<filesystem::path> FileWatcher::Poll() {
+    vector<filesystem::path> changed;
+    for (auto& [path, time] : files) {
+        auto current = WriteTime(path);
+        if (current == time)
+            continue;
+        time = current;
+        changed.push_back(path);
+    }
+    return changed;
+}
@@ -0,0 +1,69 @@
+#include <UDXRenderer/FrameLinearAllocator.h>
+
+#include <algorithm>
+#include <cassert>
+
+using namespace Ubpa;
+using namespace std;
+
+FrameLinearAllocator::FrameLinearAllocator(uint64_t capacity)
+    : capacity{ capacity }
+{
+    assert(capacity > 0);
+}
+
+uint64_t FrameLinearAllocator::Allocate(uint64_t num, uint64_t alignment) {
+    assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+    if (num == 0 || num > capacity)
+        return InvalidOffset;
+
+    if (usedNum == 0)
+        head = tail = 0;
+
+    uint64_t offset = (head + alignment - 1) & ~(alignment - 1);
+    uint64_t padding;
+    if (head >= tail && usedNum < capacity) {
+        // free: [head, capacity) and [0, tail)
+        if (offset + num <= capacity)
+            padding = offset - head;
+        else if (num <= tail) {
+            // skip the tail of the ring, it is retired with this frame
+            padding = capacity - head;
+            offset = 0;
+        }
+        else
+            return InvalidOffset;
+    }
+    else {
+        // free: [head, tail)
+        if (offset + num <= tail)
+            padding = offset - head;
+        else
+            return InvalidOffset;
+    }
+
+    head = offset + num;
+    if (head == capacity)
+        head = 0;
+
+    usedNum += padding + num;
+    curFrameNum += padding + num;
+    peakUsedNum = max(peakUsedNum, usedNum);
+    return offset;
+}
+
+void FrameLinearAllocator::EndFrame(uint64_t fence) {
+    assert(frames.empty() || frames.back().fence <= fence);
+    if (curFrameNum == 0)
+        return;
+    frames.push_back({ fence, curFrameNum });
+    curFrameNum = 0;
+}
+
+void FrameLinearAllocator::Reclaim(uint64_t completedFence) {
+    while (!frames.empty() && frames.front().fence <= completedFence) {
+        tail = (tail + frames.front().num) % capacity;
+        usedNum -= frames.front().num;
+        frames.pop_front();
+    }
+}
@@ -0,0 +1,73 @@
+#include <UDXRenderer/FramePacer.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <numeric>
+
+using namespace Ubpa;
+using namespace std;
+
+FramePacer::FramePacer(Clock& clock, const Desc& desc)
+    : clock{ clock }, desc{ desc }
+{
+    assert(desc.smoothingWindow > 0);
+    SetTargetFps(desc.targetFps);
+    Reset();
+}
+
+void FramePacer::SetTargetFps(double fps) {
+    assert(fps > 0.);
+    desc.targetFps = fps;
+    periodNs = Clock::FromSeconds(1. / fps);
+}
+
+void FramePacer::Reset() {
+    lastWake = clock.Now();
+    deadline = lastWake + periodNs;
+
+    deltas.assign(desc.smoothingWindow, Clock::ToSeconds(periodNs));
+    deltaHead = 0;
+    rawDelta = smoothedDelta = Clock::ToSeconds(periodNs);
+
+    absErrorSumMs = 0.;
+    errorStats = {};
+}
+
+double FramePacer::Wait() {
+    // coarse: sleep until shortly before the deadline
+    int64_t remaining = deadline - clock.Now();
+    if (remaining > desc.spinThresholdNs)
+        clock.SleepFor(remaining - desc.spinThresholdNs);
+
+    // fine: spin the rest
+    while (clock.Now() < deadline)
+        clock.Spin();
+
+    int64_t wake = clock.Now();
+    int64_t error = wake - deadline;
+
+    double errorMs = Clock::ToMilliseconds(error);
+    errorStats.frameNum++;
+    errorStats.lastMs = errorMs;
+    absErrorSumMs += abs(errorMs);
+    errorStats.meanAbsMs = absErrorSumMs / errorStats.frameNum;
+    errorStats.maxAbsMs = max(errorStats.maxAbsMs, abs(errorMs));
+
+    if (error > periodNs) {
+        // hopelessly late (e.g. a hitch), restart the schedule instead of bursting to catch up
+        errorStats.missedNum++;
+        deadline = wake + periodNs;
+    }
+    else
+        deadline += periodNs;
+
+    rawDelta = Clock::ToSeconds(wake - lastWake);
+    lastWake = wake;
+
+    deltas[deltaHead] = rawDelta;
+    deltaHead = (deltaHead + 1) % deltas.size();
+    smoothedDelta = accumulate(deltas.begin(), deltas.end(), 0.) / deltas.size();
+
+    return smoothedDelta;
+}
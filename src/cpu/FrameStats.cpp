@@ -0,0 +1,319 @@
+#include <UDXRenderer/FrameStats.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <fstream>
+#include <numeric>
+#include <string_view>
+
+using namespace Ubpa;
+using namespace std;
+
+// seqlock slot: seq is odd while the producer writes the sample
+struct FrameStats::Slot {
+    atomic<size_t> seq{ 0 };
+    Sample sample;
+};
+
+namespace {
+    // nearest-rank percentile over sorted data
+    double Percentile(const vector<double>& sorted, double p) {
+        if (sorted.empty())
+            return 0.;
+        size_t rank = static_cast<size_t>(ceil(p * sorted.size()));
+        return sorted[min(max<size_t>(rank, 1), sorted.size()) - 1];
+    }
+
+    FrameStats::Percentiles ComputePercentiles(vector<double> values) {
+        FrameStats::Percentiles rst;
+        if (values.empty())
+            return rst;
+
+        sort(values.begin(), values.end());
+        rst.mean = accumulate(values.begin(), values.end(), 0.) / values.size();
+        rst.p50 = Percentile(values, 0.50);
+        rst.p95 = Percentile(values, 0.95);
+        rst.p99 = Percentile(values, 0.99);
+        rst.max = values.back();
+        return rst;
+    }
+
+    void WritePercentiles(ostream& os, const FrameStats::Percentiles& p) {
+        os << "{ \"mean\": " << p.mean
+            << ", \"p50\": " << p.p50
+            << ", \"p95\": " << p.p95
+            << ", \"p99\": " << p.p99
+            << ", \"max\": " << p.max << " }";
+    }
+
+    void WriteIndices(ostream& os, const vector<size_t>& indices) {
+        os << '[';
+        for (size_t i = 0; i < indices.size(); i++)
+            os << (i == 0 ? "" : ", ") << indices[i];
+        os << ']';
+    }
+}
+
+FrameStats::FrameStats(size_t capacity, const Clock& clock)
+    : clock{ clock }, ring{ new Slot[max<size_t>(capacity, 1)] }, capacity{ max<size_t>(capacity, 1) }
+{
+    for (auto& ms : currentStageMs)
+        ms.store(0., memory_order_relaxed);
+}
+
+FrameStats::~FrameStats() = default;
+
+size_t FrameStats::RegisterStage(string name) {
+    auto target = find(stageNames.begin(), stageNames.end(), name);
+    if (target != stageNames.end())
+        return static_cast<size_t>(target - stageNames.begin());
+
+    assert(stageNames.size() < MaxStages);
+    stageNames.push_back(move(name));
+    return stageNames.size() - 1;
+}
+
+size_t FrameStats::FindStage(string_view name) const {
+    auto target = find(stageNames.begin(), stageNames.end(), name);
+    return target != stageNames.end() ? static_cast<size_t>(target - stageNames.begin()) : InvalidStage;
+}
+
+void FrameStats::BeginFrame() {
+    assert(!inFrame);
+
+    for (auto& ms : currentStageMs)
+        ms.store(0., memory_order_relaxed);
+    frameBegin = clock.Now();
+    inFrame = true;
+}
+
+void FrameStats::EndFrame() {
+    assert(inFrame);
+
+    double frameMs = Clock::ToMilliseconds(clock.Now() - frameBegin);
+
+    size_t index = head.load(memory_order_relaxed);
+    Slot& slot = ring[index % capacity];
+
+    slot.seq.store(2 * index + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    slot.sample.frameIndex = index;
+    slot.sample.frameMs = frameMs;
+    for (size_t i = 0; i < MaxStages; i++)
+        slot.sample.stageMs[i] = currentStageMs[i].load(memory_order_relaxed);
+
+    slot.seq.store(2 * index + 2, memory_order_release);
+    head.store(index + 1, memory_order_release);
+
+    inFrame = false;
+}
+
+void FrameStats::AddStageTime(size_t stage, double ms) {
+    assert(stage < stageNames.size());
+
+    auto& target = currentStageMs[stage];
+    double old = target.load(memory_order_relaxed);
+    while (!target.compare_exchange_weak(old, old + ms, memory_order_relaxed))
+        ;
+}
+
+thread_local FrameStats::ScopedStage* FrameStats::ScopedStage::innermost = nullptr;
+
+FrameStats::ScopedStage::ScopedStage(FrameStats& stats, size_t stage)
+    : stats{ stats }, stage{ stage }, begin{ stats.clock.Now() }, outer{ innermost }
+{
+    innermost = this;
+}
+
+FrameStats::ScopedStage::~ScopedStage() {
+    assert(innermost == this);
+    innermost = outer;
+    double ms = Clock::ToMilliseconds(stats.clock.Now() - begin);
+    stats.AddStageTime(stage, ms - nestedMs);
+    if (outer && &outer->stats == &stats)
+        outer->nestedMs += ms;
+}
+
+void FrameStats::Clear() {
+    assert(!inFrame);
+
+    for (size_t i = 0; i < capacity; i++)
+        ring[i].seq.store(0, memory_order_relaxed);
+    head.store(0, memory_order_release);
+}
+
+void FrameStats::SetCapacity(size_t newCapacity) {
+    assert(!inFrame);
+
+    capacity = max<size_t>(newCapacity, 1);
+    ring.reset(new Slot[capacity]);
+    head.store(0, memory_order_release);
+}
+
+size_t FrameStats::GetFrameNum() const noexcept {
+    return min(head.load(memory_order_acquire), capacity);
+}
+
+vector<FrameStats::Sample> FrameStats::Snapshot() const {
+    size_t end = head.load(memory_order_acquire);
+    size_t begin = end > capacity ? end - capacity : 0;
+
+    vector<Sample> samples;
+    samples.reserve(end - begin);
+    for (size_t index = begin; index < end; index++) {
+        const Slot& slot = ring[index % capacity];
+
+        size_t seq0 = slot.seq.load(memory_order_acquire);
+        if (seq0 != 2 * index + 2)
+            continue; // overwritten by a newer frame
+        Sample sample = slot.sample;
+        atomic_thread_fence(memory_order_acquire);
+        if (slot.seq.load(memory_order_relaxed) != seq0)
+            continue;
+
+        samples.push_back(sample);
+    }
+    return samples;
+}
+
+FrameStats::Summary FrameStats::Summarize(const SummaryConfig& config) const {
+    auto samples = Snapshot();
+
+    Summary summary;
+    summary.frameNum = samples.size();
+    if (samples.empty())
+        return summary;
+
+    vector<double> frameMs(samples.size());
+    for (size_t i = 0; i < samples.size(); i++)
+        frameMs[i] = samples[i].frameMs;
+
+    summary.frame = ComputePercentiles(frameMs);
+    for (size_t s = 0; s < stageNames.size(); s++) {
+        vector<double> stageMs(samples.size());
+        for (size_t i = 0; i < samples.size(); i++)
+            stageMs[i] = samples[i].stageMs[s];
+        summary.stages.push_back(ComputePercentiles(move(stageMs)));
+    }
+
+    if (summary.frame.mean > 0.)
+        summary.avgFps = 1000. / summary.frame.mean;
+
+    {
+        vector<double> sorted = frameMs;
+        sort(sorted.begin(), sorted.end(), greater<double>());
+        size_t num = max<size_t>(sorted.size() / 100, 1);
+        double slowMs = accumulate(sorted.begin(), sorted.begin() + num, 0.) / num;
+        if (slowMs > 0.)
+            summary.low1PercentFps = 1000. / slowMs;
+    }
+
+    vector<double> window;
+    for (size_t i = 0; i < samples.size(); i++) {
+        if (frameMs[i] > config.hitchMs)
+            summary.hitches.push_back(samples[i].frameIndex);
+
+        if (config.stutterWindow > 0 && i >= config.stutterWindow) {
+            window.assign(frameMs.begin() + (i - config.stutterWindow), frameMs.begin() + i);
+            auto mid = window.begin() + window.size() / 2;
+            nth_element(window.begin(), mid, window.end());
+            if (frameMs[i] > config.stutterRatio * (*mid))
+                summary.stutters.push_back(samples[i].frameIndex);
+        }
+    }
+
+    return summary;
+}
+
+FrameStats::Histogram FrameStats::ComputeHistogram(double binMs, size_t binNum) const {
+    assert(binMs > 0.);
+
+    Histogram histogram;
+    histogram.binMs = binMs;
+    histogram.bins.assign(binNum, 0);
+
+    for (const auto& sample : Snapshot()) {
+        size_t bin = static_cast<size_t>(sample.frameMs / binMs);
+        if (bin < binNum)
+            histogram.bins[bin]++;
+        else
+            histogram.overflow++;
+    }
+
+    return histogram;
+}
+
+void FrameStats::WriteCSV(ostream& os) const {
+    os << "frame,frame_ms";
+    for (const auto& name : stageNames)
+        os << ',' << name << "_ms";
+    os << '\n';
+
+    for (const auto& sample : Snapshot()) {
+        os << sample.frameIndex << ',' << sample.frameMs;
+        for (size_t i = 0; i < stageNames.size(); i++)
+            os << ',' << sample.stageMs[i];
+        os << '\n';
+    }
+}
+
+void FrameStats::WriteJSON(ostream& os, const SummaryConfig& config) const {
+    auto summary = Summarize(config);
+    auto histogram = ComputeHistogram();
+
+    os << "{\n  \"stages\": [";
+    for (size_t i = 0; i < stageNames.size(); i++)
+        os << (i == 0 ? "" : ", ") << '"' << stageNames[i] << '"';
+    os << "],\n";
+
+    os << "  \"summary\": {\n"
+        << "    \"frames\": " << summary.frameNum << ",\n"
+        << "    \"avg_fps\": " << summary.avgFps << ",\n"
+        << "    \"low_1_percent_fps\": " << summary.low1PercentFps << ",\n"
+        << "    \"frame_ms\": ";
+    WritePercentiles(os, summary.frame);
+    os << ",\n    \"stage_ms\": {";
+    for (size_t i = 0; i < summary.stages.size(); i++) {
+        os << (i == 0 ? "\n" : ",\n") << "      \"" << stageNames[i] << "\": ";
+        WritePercentiles(os, summary.stages[i]);
+    }
+    os << "\n    },\n    \"stutters\": ";
+    WriteIndices(os, summary.stutters);
+    os << ",\n    \"hitches\": ";
+    WriteIndices(os, summary.hitches);
+    os << "\n  },\n";
+
+    os << "  \"histogram\": { \"bin_ms\": " << histogram.binMs << ", \"bins\": [";
+    for (size_t i = 0; i < histogram.bins.size(); i++)
+        os << (i == 0 ? "" : ", ") << histogram.bins[i];
+    os << "], \"overflow\": " << histogram.overflow << " },\n";
+
+    os << "  \"frames\": [";
+    auto samples = Snapshot();
+    for (size_t f = 0; f < samples.size(); f++) {
+        const auto& sample = samples[f];
+        os << (f == 0 ? "\n" : ",\n")
+            << "    { \"frame\": " << sample.frameIndex
+            << ", \"frame_ms\": " << sample.frameMs;
+        for (size_t i = 0; i < stageNames.size(); i++)
+            os << ", \"" << stageNames[i] << "\": " << sample.stageMs[i];
+        os << " }";
+    }
+    os << "\n  ]\n}\n";
+}
+
+bool FrameStats::WriteFile(const string& path) const {
+    ofstream ofs(path);
+    if (!ofs.is_open())
+        return false;
+
+    constexpr string_view ext = ".json";
+    if (path.size() >= ext.size() && path.compare(path.size() - ext.size(), ext.size(), ext) == 0)
+        WriteJSON(ofs);
+    else
+        WriteCSV(ofs);
+
+    return true;
+}
@@ -0,0 +1,96 @@
+#include <UDXRenderer/GpuProfiler.h>
+
+#include <cassert>
+
+using namespace Ubpa;
+using namespace std;
+
+GpuProfiler::GpuProfiler(QuerySource& source, size_t frameLatency)
+    : source{ source }, slots(frameLatency)
+{
+    assert(frameLatency > 0);
+}
+
+void GpuProfiler::BeginFrame() {
+    assert(!inFrame);
+
+    Slot& slot = slots[frameIndex % slots.size()];
+
+    // the slot's previous frame has completed, the caller waited on its fence
+    if (slot.frameIndex != static_cast<size_t>(-1) && slot.queryNum > 0) {
+        ticks.resize(slot.queryNum);
+        source.ReadBack(frameIndex % slots.size(), slot.queryNum, ticks.data());
+
+        double msPerTick = 1000. / static_cast<double>(source.GetFrequency());
+        latestTimings.clear();
+        for (const auto& pass : slot.passes) {
+            if (pass.endQuery == static_cast<size_t>(-1))
+                continue; // never ended
+            uint64_t begin = ticks[pass.beginQuery];
+            uint64_t end = ticks[pass.endQuery];
+            latestTimings.push_back({ pass.name, end > begin ? (end - begin) * msPerTick : 0. });
+        }
+        latestFrameIndex = slot.frameIndex;
+    }
+
+    slot.frameIndex = frameIndex;
+    slot.queryNum = 0;
+    slot.passes.clear();
+    inFrame = true;
+}
+
+void GpuProfiler::EndFrame() {
+    assert(inFrame);
+
+    size_t slotIndex = frameIndex % slots.size();
+    Slot& slot = slots[slotIndex];
+    if (slot.queryNum > 0)
+        source.Resolve(slotIndex, slot.queryNum);
+
+    frameIndex++;
+    inFrame = false;
+}
+
+size_t GpuProfiler::BeginPass(string name) {
+    assert(inFrame);
+
+    size_t slotIndex = frameIndex % slots.size();
+    Slot& slot = slots[slotIndex];
+    if (slot.queryNum + 2 > source.GetQueryCapacity()) {
+        droppedPassNum++;
+        return static_cast<size_t>(-1);
+    }
+
+    size_t query = slot.queryNum++;
+    source.WriteTimestamp(slotIndex, query);
+    slot.passes.push_back({ move(name), query, static_cast<size_t>(-1) });
+    // reserve the end query so nested passes cannot starve it
+    slot.queryNum++;
+
+    return slot.passes.size() - 1;
+}
+
+void GpuProfiler::EndPass(size_t pass) {
+    assert(inFrame);
+    if (pass == static_cast<size_t>(-1))
+        return;
+
+    size_t slotIndex = frameIndex % slots.size();
+    auto& record = slots[slotIndex].passes[pass];
+    record.endQuery = record.beginQuery + 1;
+    source.WriteTimestamp(slotIndex, record.endQuery);
+}
+
+size_t GpuProfiler::RegisterStage(FrameStats& stats, string_view pass) {
+    return stats.RegisterStage("gpu " + string(pass));
+}
+
+void GpuProfiler::Publish(FrameStats& stats) const {
+    for (const auto& timing : latestTimings) {
+        stageName.assign("gpu ");
+        stageName += timing.name;
+        size_t stage = stats.FindStage(stageName);
+        if (stage != FrameStats::InvalidStage)
+            stats.AddStageTime(stage, timing.ms);
+    }
+}
@@ -0,0 +1,201 @@
+#include <UDXRenderer/LZCodec.h>
+
+#include <cstdint>
+#include <cstring>
+
+using namespace Ubpa;
+using namespace std;
+
+namespace {
+    constexpr size_t MinMatch = 4;
+    constexpr size_t LastLiterals = 5; // the last bytes of a block are always literals
+    constexpr size_t MFLimit = 12;     // a match starts at least this many bytes before the end
+    constexpr size_t MaxOffset = 65535;
+    constexpr uint32_t HashLog = 12;
+    constexpr size_t Failed = static_cast<size_t>(-1);
+
+    uint32_t Read32(const uint8_t* p) noexcept {
+        uint32_t v;
+        memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    uint32_t Hash(uint32_t sequence) noexcept {
+        return (sequence * 2654435761u) >> (32 - HashLog);
+    }
+
+    class Output {
+    public:
+        Output(uint8_t* dst, size_t capacity) noexcept : begin{ dst }, cur{ dst }, end{ dst + capacity } {}
+
+        bool Byte(uint8_t b) noexcept {
+            if (cur == end)
+                return false;
+            *cur++ = b;
+            return true;
+        }
+
+        bool Bytes(const uint8_t* src, size_t num) noexcept {
+            if (num == 0)
+                return true;
+            if (static_cast<size_t>(end - cur) < num)
+                return false;
+            memcpy(cur, src, num);
+            cur += num;
+            return true;
+        }
+
+        // the part of a length that doesn't fit into its 4 bits of the token
+        bool ExtraLength(size_t len) noexcept {
+            for (; len >= 255; len -= 255) {
+                if (!Byte(255))
+                    return false;
+            }
+            return Byte(static_cast<uint8_t>(len));
+        }
+
+        size_t Size() const noexcept { return static_cast<size_t>(cur - begin); }
+
+    private:
+        uint8_t* begin;
+        uint8_t* cur;
+        uint8_t* end;
+    };
+
+    bool EmitSequence(Output& out, const uint8_t* literals, size_t literalNum, size_t offset, size_t matchLen) noexcept {
+        size_t matchCode = matchLen - MinMatch;
+        uint8_t token = static_cast<uint8_t>((literalNum < 15 ? literalNum : 15) << 4)
+            | static_cast<uint8_t>(matchCode < 15 ? matchCode : 15);
+        return out.Byte(token)
+            && (literalNum < 15 || out.ExtraLength(literalNum - 15))
+            && out.Bytes(literals, literalNum)
+            && out.Byte(static_cast<uint8_t>(offset & 0xff))
+            && out.Byte(static_cast<uint8_t>(offset >> 8))
+            && (matchCode < 15 || out.ExtraLength(matchCode - 15));
+    }
+
+    bool EmitLastLiterals(Output& out, const uint8_t* literals, size_t literalNum) noexcept {
+        uint8_t token = static_cast<uint8_t>((literalNum < 15 ? literalNum : 15) << 4);
+        return out.Byte(token)
+            && (literalNum < 15 || out.ExtraLength(literalNum - 15))
+            && out.Bytes(literals, literalNum);
+    }
+
+    // returns false on a truncated length
+    bool ReadExtraLength(const uint8_t*& ip, const uint8_t* end, size_t& len, size_t limit) noexcept {
+        uint8_t b;
+        do {
+            if (ip == end)
+                return false;
+            b = *ip++;
+            len += b;
+            if (len > limit)
+                return false;
+        } while (b == 255);
+        return true;
+    }
+}
+
+size_t LZCodec::CompressBound(size_t srcSize) noexcept {
+    return srcSize + srcSize / 255 + 16;
+}
+
+size_t LZCodec::Compress(const void* srcData, size_t srcSize, void* dst, size_t dstCapacity) noexcept {
+    auto src = static_cast<const uint8_t*>(srcData);
+    Output out(static_cast<uint8_t*>(dst), dstCapacity);
+
+    size_t anchor = 0;
+    if (srcSize > MFLimit) {
+        // positions + 1, 0 is empty
+        uint32_t table[size_t{ 1 } << HashLog]{};
+        const size_t matchLimit = srcSize - LastLiterals;
+        const size_t mfLimit = srcSize - MFLimit;
+
+        size_t ip = 0;
+        while (ip <= mfLimit) {
+            uint32_t sequence = Read32(src + ip);
+            uint32_t& slot = table[Hash(sequence)];
+            size_t candidate = slot;
+            slot = static_cast<uint32_t>(ip + 1);
+
+            if (candidate == 0 || ip - (candidate - 1) > MaxOffset || Read32(src + candidate - 1) != sequence) {
+                // skip faster through incompressible data
+                ip += 1 + ((ip - anchor) >> 6);
+                continue;
+            }
+            size_t match = candidate - 1;
+
+            while (ip > anchor && match > 0 && src[ip - 1] == src[match - 1]) {
+                ip--;
+                match--;
+            }
+            size_t len = MinMatch;
+            while (ip + len < matchLimit && src[ip + len] == src[match + len])
+                len++;
+
+            if (!EmitSequence(out, src + anchor, ip - anchor, ip - match, len))
+                return 0;
+            ip += len;
+            anchor = ip;
+
+            // the position inside the match helps the next search
+            if (ip - 2 <= mfLimit)
+                table[Hash(Read32(src + ip - 2))] = static_cast<uint32_t>(ip - 2 + 1);
+        }
+    }
+
+    if (!EmitLastLiterals(out, src + anchor, srcSize - anchor))
+        return 0;
+    return out.Size();
+}
+
+size_t LZCodec::Decompress(const void* srcData, size_t srcSize, void* dstData, size_t dstCapacity) noexcept {
+    auto ip = static_cast<const uint8_t*>(srcData);
+    const uint8_t* const ipEnd = ip + srcSize;
+    auto dst = static_cast<uint8_t*>(dstData);
+    size_t op = 0;
+
+    while (true) {
+        if (ip == ipEnd)
+            return Failed;
+        uint8_t token = *ip++;
+
+        size_t literalNum = token >> 4;
+        if (literalNum == 15 && !ReadExtraLength(ip, ipEnd, literalNum, dstCapacity))
+            return Failed;
+        if (static_cast<size_t>(ipEnd - ip) < literalNum || dstCapacity - op < literalNum)
+            return Failed;
+        if (literalNum != 0)
+            memcpy(dst + op, ip, literalNum);
+        ip += literalNum;
+        op += literalNum;
+
+        if (ip == ipEnd) // the last sequence has no match
+            return op;
+
+        if (ipEnd - ip < 2)
+            return Failed;
+        size_t offset = size_t{ ip[0] } | (size_t{ ip[1] } << 8);
+        ip += 2;
+        if (offset == 0 || offset > op)
+            return Failed;
+
+        size_t matchLen = token & 15;
+        if (matchLen == 15 && !ReadExtraLength(ip, ipEnd, matchLen, dstCapacity))
+            return Failed;
+        matchLen += MinMatch;
+        if (dstCapacity - op < matchLen)
+            return Failed;
+
+        uint8_t* out = dst + op;
+        const uint8_t* match = out - offset;
+        if (offset >= matchLen)
+            memcpy(out, match, matchLen);
+        else {
+            // overlapping, repeats the last offset bytes
+            for (size_t i = 0; i < matchLen; i++)
+                out[i] = match[i];
+        }
+        op += matchLen;
+    }
+}
@@ -0,0 +1,53 @@
+#include <UDXRenderer/LodSelector.h>
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+using namespace Ubpa;
+using namespace std;
+
+LodSelector::LodSelector(vector<float> thresholds, float hysteresis)
+    : thresholds{ move(thresholds) }, hysteresis{ hysteresis }
+{
+    assert(!this->thresholds.empty());
+    assert(is_sorted(this->thresholds.rbegin(), this->thresholds.rend()));
+    assert(hysteresis >= 0.f && hysteresis < 1.f);
+}
+
+LodSelector LodSelector::FromErrors(const MeshSimplifier::Lod* lods, size_t lodNum, float radius,
+    float maxPixelError, float hysteresis)
+{
+    assert(lodNum > 0);
+    // pixel error of LOD i = error_i / radius * screen size
+    vector<float> thresholds(lodNum);
+    thresholds[0] = numeric_limits<float>::infinity();
+    for (size_t i = 1; i < lodNum; i++) {
+        float t = lods[i].error > 0.f ? maxPixelError * radius / lods[i].error : numeric_limits<float>::infinity();
+        thresholds[i] = min(thresholds[i - 1], t);
+    }
+    return LodSelector{ move(thresholds), hysteresis };
+}
+
+float LodSelector::ScreenSize(float radius, float distance, float projScaleY, float viewportHeight) noexcept {
+    if (distance <= radius)
+        return numeric_limits<float>::infinity();
+    return radius * projScaleY / distance * 0.5f * viewportHeight;
+}
+
+uint32_t LodSelector::Select(uint32_t current, float screenSize) const noexcept {
+    auto lodNum = static_cast<uint32_t>(thresholds.size());
+    current = min(current, lodNum - 1);
+
+    // keep the current LOD inside a band around its range
+    bool finerFits = screenSize <= thresholds[current] * (1.f + hysteresis);
+    bool coarserFits = current + 1 < lodNum && screenSize <= thresholds[current + 1] * (1.f - hysteresis);
+    if (finerFits && !coarserFits)
+        return current;
+
+    // the coarsest LOD that fits
+    uint32_t lod = 0;
+    while (lod + 1 < lodNum && screenSize <= thresholds[lod + 1])
+        lod++;
+    return lod;
+}
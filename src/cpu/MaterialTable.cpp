@@ -0,0 +1,177 @@
+#include <UDXRenderer/MaterialTable.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+using namespace Ubpa;
+using namespace std;
+
+namespace {
+    // index of the lowest / highest set bit, word != 0
+    uint32_t LowestBit(uint64_t word) noexcept {
+        uint32_t i = 0;
+        while (!(word & 1)) {
+            word >>= 1;
+            i++;
+        }
+        return i;
+    }
+
+    uint32_t HighestBit(uint64_t word) noexcept {
+        uint32_t i = 0;
+        while (word >>= 1)
+            i++;
+        return i;
+    }
+}
+
+uint32_t MaterialTable::SizeOf(ParamType type) noexcept {
+    switch (type)
+    {
+    case ParamType::Float:
+    case ParamType::Uint:
+    case ParamType::Int:
+        return 4;
+    case ParamType::Float2:
+    case ParamType::Uint2:
+    case ParamType::Int2:
+        return 8;
+    case ParamType::Float3:
+    case ParamType::Uint3:
+    case ParamType::Int3:
+        return 12;
+    case ParamType::Float4:
+    case ParamType::Uint4:
+    case ParamType::Int4:
+        return 16;
+    case ParamType::Float4x4:
+        return 64;
+    default:
+        assert(false);
+        return 0;
+    }
+}
+
+MaterialTable::Layout& MaterialTable::Layout::Add(string name, ParamType type) {
+    return Add(move(name), type, (stride + 3) & ~3u);
+}
+
+MaterialTable::Layout& MaterialTable::Layout::Add(string name, ParamType type, uint32_t offset) {
+    assert(offset % 4 == 0);
+    stride = max(stride, offset + SizeOf(type));
+    params.push_back({ move(name), type, offset });
+    return *this;
+}
+
+MaterialTable::ParamID MaterialTable::Layout::Find(string_view name) const noexcept {
+    for (size_t i = 0; i < params.size(); i++) {
+        if (params[i].name == name)
+            return static_cast<ParamID>(i);
+    }
+    return InvalidParam;
+}
+
+MaterialTable::MaterialTable(Layout layout, uint32_t capacity, uint32_t frameNum)
+    : layout{ move(layout) }, capacity{ capacity }
+{
+    assert(this->layout.stride > 0 && frameNum > 0);
+    data.resize(size_t{ capacity } * this->layout.stride);
+    defaults.resize(this->layout.stride);
+    dirty.resize(frameNum, vector<uint64_t>((size_t{ capacity } + 63) / 64));
+}
+
+MaterialTable::MaterialID MaterialTable::Create(string name) {
+    assert(!name.empty() && nameMap.find(name) == nameMap.end());
+
+    MaterialID id;
+    if (!freeIDs.empty()) {
+        id = freeIDs.back();
+        freeIDs.pop_back();
+    }
+    else if (names.size() < capacity) {
+        id = static_cast<MaterialID>(names.size());
+        names.emplace_back();
+    }
+    else
+        return InvalidID;
+
+    memcpy(data.data() + size_t{ id } * layout.stride, defaults.data(), layout.stride);
+    nameMap.emplace(name, id);
+    names[id] = move(name);
+    MarkDirty(id);
+    return id;
+}
+
+void MaterialTable::Destroy(MaterialID id) {
+    assert(IsAlive(id));
+    nameMap.erase(names[id]);
+    names[id].clear();
+    freeIDs.push_back(id);
+}
+
+MaterialTable::MaterialID MaterialTable::Find(string_view name) const {
+    auto target = nameMap.find(name);
+    return target != nameMap.end() ? target->second : InvalidID;
+}
+
+void MaterialTable::Set(MaterialID id, ParamID param, const void* value, size_t size) {
+    assert(IsAlive(id) && param < layout.params.size());
+    const auto& p = layout.params[param];
+    assert(size == SizeOf(p.type));
+    memcpy(data.data() + size_t{ id } * layout.stride + p.offset, value, size);
+    MarkDirty(id);
+}
+
+const void* MaterialTable::Get(MaterialID id, ParamID param) const noexcept {
+    assert(IsAlive(id) && param < layout.params.size());
+    return data.data() + size_t{ id } * layout.stride + layout.params[param].offset;
+}
+
+void MaterialTable::SetDefault(ParamID param, const void* value, size_t size) {
+    assert(param < layout.params.size());
+    const auto& p = layout.params[param];
+    assert(size == SizeOf(p.type));
+    memcpy(defaults.data() + p.offset, value, size);
+}
+
+size_t MaterialTable::Upload(uint32_t frame, void* dst) {
+    constexpr size_t None = static_cast<size_t>(-1);
+    auto& words = dirty[frame];
+    size_t first = None;
+    size_t last = 0;
+    for (size_t i = 0; i < words.size(); i++) {
+        if (words[i] == 0)
+            continue;
+        if (first == None)
+            first = i * 64 + LowestBit(words[i]);
+        last = i * 64 + HighestBit(words[i]);
+        words[i] = 0;
+    }
+    if (first == None)
+        return 0;
+
+    size_t offset = first * layout.stride;
+    size_t size = (last - first + 1) * layout.stride;
+    memcpy(static_cast<uint8_t*>(dst) + offset, data.data() + offset, size);
+    uploadNum++;
+    uploadedBytes += size;
+    return size;
+}
+
+bool MaterialTable::IsDirty(uint32_t frame, MaterialID id) const noexcept {
+    return (dirty[frame][id / 64] >> (id % 64)) & 1;
+}
+
+void MaterialTable::MarkDirty(MaterialID id) {
+    for (auto& words : dirty)
+        words[id / 64] |= uint64_t{ 1 } << (id % 64);
+}
+
+MaterialTable::Stats MaterialTable::GetStats() const noexcept {
+    Stats stats;
+    stats.materialNum = names.size() - freeIDs.size();
+    stats.uploadNum = uploadNum;
+    stats.uploadedBytes = uploadedBytes;
+    return stats;
+}
@@ -0,0 +1,193 @@
+#include <UDXRenderer/MemoryTracker.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <utility>
+
+using namespace Ubpa;
+using namespace std;
+
+namespace {
+    void WriteBytes(ostream& os, uint64_t bytes) {
+        os << fixed << setprecision(2) << static_cast<double>(bytes) / (1024. * 1024.) << " MB";
+    }
+
+    void WriteUsage(ostream& os, string_view name, const MemoryTracker::Usage& usage) {
+        os << name << ": live ";
+        WriteBytes(os, usage.liveBytes);
+        os << " (" << usage.liveNum << "), peak ";
+        WriteBytes(os, usage.peakBytes);
+        if (usage.budget != 0) {
+            os << ", budget ";
+            WriteBytes(os, usage.budget);
+        }
+        os << '\n';
+    }
+}
+
+string_view MemoryTracker::ToString(Category category) noexcept {
+    switch (category)
+    {
+    case Category::Texture: return "texture";
+    case Category::RenderTarget: return "render target";
+    case Category::Mesh: return "mesh";
+    case Category::Upload: return "upload";
+    case Category::DescriptorHeap: return "descriptor heap";
+    case Category::Other: return "other";
+    default: return "total";
+    }
+}
+
+void MemoryTracker::Track(const void* key, Category category, string name, uint64_t size, uint64_t alignment) {
+    Events events;
+    {
+        lock_guard<mutex> lock(m);
+        Stats before = stats;
+        auto [target, isNew] = allocations.try_emplace(key);
+        if (!isNew)
+            Remove(target->second.category, target->second.size);
+        target->second = { category, move(name), size, alignment };
+        Add(category, size);
+        Check(before, events);
+    }
+    Fire(events);
+}
+
+void MemoryTracker::Untrack(const void* key) {
+    Events events;
+    {
+        lock_guard<mutex> lock(m);
+        auto target = allocations.find(key);
+        if (target == allocations.end())
+            return;
+        Stats before = stats;
+        Remove(target->second.category, target->second.size);
+        allocations.erase(target);
+        Check(before, events);
+    }
+    Fire(events);
+}
+
+bool MemoryTracker::IsTracked(const void* key) const {
+    lock_guard<mutex> lock(m);
+    return allocations.find(key) != allocations.end();
+}
+
+void MemoryTracker::Rekey(const void* key, const void* newKey) {
+    lock_guard<mutex> lock(m);
+    auto target = allocations.find(key);
+    if (target == allocations.end())
+        return;
+    Allocation allocation = move(target->second);
+    allocations.erase(target);
+    allocations.insert_or_assign(newKey, move(allocation));
+}
+
+void MemoryTracker::SetBudget(Category category, uint64_t budget) {
+    lock_guard<mutex> lock(m);
+    stats.categories[static_cast<size_t>(category)].budget = budget;
+}
+
+void MemoryTracker::SetTotalBudget(uint64_t budget) {
+    lock_guard<mutex> lock(m);
+    stats.total.budget = budget;
+}
+
+void MemoryTracker::SetBudgetCallback(BudgetCallback callback) {
+    lock_guard<mutex> lock(m);
+    this->callback = move(callback);
+}
+
+MemoryTracker::Stats MemoryTracker::GetStats() const {
+    lock_guard<mutex> lock(m);
+    return stats;
+}
+
+vector<MemoryTracker::NameUsage> MemoryTracker::GetNameUsages() const {
+    map<pair<Category, string_view>, NameUsage> usages;
+    lock_guard<mutex> lock(m);
+    for (const auto& [key, allocation] : allocations) {
+        auto [target, isNew] = usages.try_emplace({ allocation.category, allocation.name });
+        if (isNew)
+            target->second = { allocation.name, allocation.category, 0, 0 };
+        target->second.liveBytes += allocation.size;
+        target->second.liveNum++;
+    }
+
+    vector<NameUsage> result;
+    result.reserve(usages.size());
+    for (auto& [key, usage] : usages)
+        result.push_back(move(usage));
+    stable_sort(result.begin(), result.end(), [](const NameUsage& lhs, const NameUsage& rhs) {
+        return lhs.liveBytes > rhs.liveBytes;
+    });
+    return result;
+}
+
+void MemoryTracker::Dump(ostream& os) const {
+    lock_guard<mutex> lock(m);
+    for (size_t i = 0; i < CategoryNum; i++)
+        WriteUsage(os, ToString(static_cast<Category>(i)), stats.categories[i]);
+    WriteUsage(os, ToString(Category::Num), stats.total);
+
+    vector<const Allocation*> live;
+    live.reserve(allocations.size());
+    for (const auto& [key, allocation] : allocations)
+        live.push_back(&allocation);
+    sort(live.begin(), live.end(), [](const Allocation* lhs, const Allocation* rhs) {
+        if (lhs->category != rhs->category)
+            return lhs->category < rhs->category;
+        if (lhs->size != rhs->size)
+            return lhs->size > rhs->size;
+        return lhs->name < rhs->name;
+    });
+    for (const Allocation* allocation : live) {
+        os << "  [" << ToString(allocation->category) << "] " << allocation->name << ": "
+            << allocation->size << " bytes, alignment " << allocation->alignment << '\n';
+    }
+}
+
+void MemoryTracker::Add(Category category, uint64_t size) {
+    for (Usage* usage : { &stats.categories[static_cast<size_t>(category)], &stats.total }) {
+        usage->liveBytes += size;
+        usage->peakBytes = max(usage->peakBytes, usage->liveBytes);
+        usage->liveNum++;
+        usage->trackNum++;
+    }
+}
+
+void MemoryTracker::Remove(Category category, uint64_t size) {
+    for (Usage* usage : { &stats.categories[static_cast<size_t>(category)], &stats.total }) {
+        usage->liveBytes -= size;
+        usage->liveNum--;
+    }
+}
+
+void MemoryTracker::Check(const Stats& before, Events& events) const {
+    auto check = [&](Category category, const Usage& old, const Usage& usage) {
+        if (usage.budget == 0)
+            return;
+        bool wasOver = old.liveBytes > usage.budget;
+        bool isOver = usage.liveBytes > usage.budget;
+        if (wasOver != isOver)
+            events.push_back({ category, usage.liveBytes, usage.budget, isOver });
+    };
+    for (size_t i = 0; i < CategoryNum; i++)
+        check(static_cast<Category>(i), before.categories[i], stats.categories[i]);
+    check(Category::Num, before.total, stats.total);
+}
+
+void MemoryTracker::Fire(const Events& events) const {
+    if (events.empty())
+        return;
+    BudgetCallback f;
+    {
+        lock_guard<mutex> lock(m);
+        f = callback;
+    }
+    if (!f)
+        return;
+    for (const auto& e : events)
+        f(e);
+}
@@ -0,0 +1,346 @@
+#include <UDXRenderer/MeshAsset.h>
+
+#include <UDXRenderer/MappedFile.h>
+
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+using namespace Ubpa;
+using namespace Ubpa::MeshAsset;
+using namespace std;
+
+static_assert(sizeof(Header) == 184);
+static_assert(sizeof(Submesh) == 100);
+static_assert(sizeof(MeshSimplifier::Lod) == 12);
+static_assert(sizeof(Meshlets::Meshlet) == 16);
+static_assert(sizeof(Meshlets::Bounds) == 32);
+
+namespace {
+    constexpr size_t SectionNum = static_cast<size_t>(Section::Num);
+
+    constexpr uint64_t AlignUp(uint64_t x) noexcept {
+        return (x + SectionAlignment - 1) & ~static_cast<uint64_t>(SectionAlignment - 1);
+    }
+
+    // element size of the fixed-layout sections, 0 for the others
+    uint64_t ElementSize(Section section, const Header& header) noexcept {
+        switch (section) {
+        case Section::Vertices: return header.vertexStride;
+        case Section::Indices: return header.indexSize;
+        case Section::Submeshes: return sizeof(Submesh);
+        case Section::Lods: return sizeof(MeshSimplifier::Lod);
+        case Section::Meshlets: return sizeof(Meshlets::Meshlet);
+        case Section::MeshletBounds: return sizeof(Meshlets::Bounds);
+        case Section::MeshletVertices: return sizeof(uint32_t);
+        case Section::MeshletPrimitives: return sizeof(uint32_t);
+        case Section::Names: return 1;
+        default: return 0;
+        }
+    }
+
+    uint64_t ElementNum(const Header& header, Section section) noexcept {
+        return header.sections[static_cast<size_t>(section)].size / ElementSize(section, header);
+    }
+
+    bool InRange(uint64_t offset, uint64_t num, uint64_t total) noexcept {
+        return offset <= total && num <= total - offset;
+    }
+}
+
+uint64_t MeshAsset::HashContent(const void* data, size_t size, uint64_t seed) noexcept {
+    uint64_t hash = seed;
+    auto bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+vector<uint8_t> MeshAsset::Serialize(const vector<SubmeshSource>& sources, const Config& config) {
+    assert(config.vertexStride > 0);
+
+    Header header{};
+    header.magic = Magic;
+    header.version = Version;
+    header.contentKey = config.contentKey;
+    header.vertexStride = config.vertexStride;
+    header.positionFormat = static_cast<uint8_t>(config.vertexDesc.position);
+    header.normalFormat = static_cast<uint8_t>(config.vertexDesc.normal);
+    header.tangentFormat = static_cast<uint8_t>(config.vertexDesc.tangent);
+    header.uvFormat = static_cast<uint8_t>(config.vertexDesc.uv);
+    header.submeshNum = static_cast<uint32_t>(sources.size());
+
+    // element numbers of the sections, the submeshes are laid out one after another
+    uint64_t nums[SectionNum]{};
+    vector<Submesh> submeshes(sources.size());
+    bool fitsIn16Bits = true;
+    for (size_t i = 0; i < sources.size(); i++) {
+        const auto& src = sources[i];
+        auto& dst = submeshes[i];
+        assert(src.vertices && src.indices && src.indexNum % 3 == 0);
+
+        dst.nameOffset = static_cast<uint32_t>(nums[static_cast<size_t>(Section::Names)]);
+        dst.nameLength = static_cast<uint32_t>(src.name.size());
+        dst.baseVertex = static_cast<uint32_t>(nums[static_cast<size_t>(Section::Vertices)]);
+        dst.vertexNum = static_cast<uint32_t>(src.vertexNum);
+        dst.indexOffset = static_cast<uint32_t>(nums[static_cast<size_t>(Section::Indices)]);
+        dst.indexNum = static_cast<uint32_t>(src.indexNum);
+        dst.lodOffset = static_cast<uint32_t>(nums[static_cast<size_t>(Section::Lods)]);
+        dst.lodNum = src.lods ? static_cast<uint32_t>(src.lodNum) : 1;
+        dst.meshletOffset = static_cast<uint32_t>(nums[static_cast<size_t>(Section::Meshlets)]);
+        dst.meshletNum = src.meshlets ? static_cast<uint32_t>(src.meshlets->meshlets.size()) : 0;
+        dst.meshletVertexOffset = static_cast<uint32_t>(nums[static_cast<size_t>(Section::MeshletVertices)]);
+        dst.meshletVertexNum = src.meshlets ? static_cast<uint32_t>(src.meshlets->vertices.size()) : 0;
+        dst.meshletPrimitiveOffset = static_cast<uint32_t>(nums[static_cast<size_t>(Section::MeshletPrimitives)]);
+        dst.meshletPrimitiveNum = src.meshlets ? static_cast<uint32_t>(src.meshlets->primitives.size()) : 0;
+        for (size_t k = 0; k < 3; k++) {
+            dst.quantMin[k] = src.quantization.min[k];
+            dst.quantExtent[k] = src.quantization.extent[k];
+            dst.center[k] = src.center[k];
+        }
+        dst.radius = src.radius;
+        dst.uvDensity = src.uvDensity;
+
+        nums[static_cast<size_t>(Section::Names)] += dst.nameLength;
+        nums[static_cast<size_t>(Section::Vertices)] += dst.vertexNum;
+        nums[static_cast<size_t>(Section::Indices)] += dst.indexNum;
+        nums[static_cast<size_t>(Section::Lods)] += dst.lodNum;
+        nums[static_cast<size_t>(Section::Meshlets)] += dst.meshletNum;
+        nums[static_cast<size_t>(Section::MeshletBounds)] += dst.meshletNum;
+        nums[static_cast<size_t>(Section::MeshletVertices)] += dst.meshletVertexNum;
+        nums[static_cast<size_t>(Section::MeshletPrimitives)] += dst.meshletPrimitiveNum;
+
+        if (src.vertexNum > numeric_limits<uint16_t>::max() + size_t{ 1 })
+            fitsIn16Bits = false;
+    }
+    nums[static_cast<size_t>(Section::Submeshes)] = sources.size();
+    header.indexSize = fitsIn16Bits ? 2 : 4;
+
+    uint64_t offset = AlignUp(sizeof(Header));
+    for (size_t s = 0; s < SectionNum; s++) {
+        auto& range = header.sections[s];
+        range.offset = offset;
+        range.size = nums[s] * ElementSize(static_cast<Section>(s), header);
+        offset = AlignUp(offset + range.size);
+    }
+    const auto& last = header.sections[SectionNum - 1];
+    header.fileSize = last.offset + last.size;
+
+    vector<uint8_t> file(header.fileSize, 0);
+    memcpy(file.data(), &header, sizeof(Header));
+    auto section = [&](Section s) { return file.data() + header.sections[static_cast<size_t>(s)].offset; };
+
+    memcpy(section(Section::Submeshes), submeshes.data(), submeshes.size() * sizeof(Submesh));
+    for (size_t i = 0; i < sources.size(); i++) {
+        const auto& src = sources[i];
+        const auto& dst = submeshes[i];
+
+        memcpy(section(Section::Names) + dst.nameOffset, src.name.data(), dst.nameLength);
+        memcpy(section(Section::Vertices) + uint64_t{ dst.baseVertex } * header.vertexStride,
+            src.vertices, src.vertexNum * header.vertexStride);
+
+        uint8_t* indices = section(Section::Indices) + uint64_t{ dst.indexOffset } * header.indexSize;
+        if (header.indexSize == 2) {
+            auto indices16 = reinterpret_cast<uint16_t*>(indices);
+            for (size_t k = 0; k < src.indexNum; k++) {
+                assert(src.indices[k] < src.vertexNum);
+                indices16[k] = static_cast<uint16_t>(src.indices[k]);
+            }
+        }
+        else
+            memcpy(indices, src.indices, src.indexNum * sizeof(uint32_t));
+
+        auto lods = reinterpret_cast<MeshSimplifier::Lod*>(section(Section::Lods)) + dst.lodOffset;
+        if (src.lods) {
+            for (size_t k = 0; k < src.lodNum; k++)
+                assert(InRange(src.lods[k].indexOffset, src.lods[k].indexNum, src.indexNum));
+            memcpy(lods, src.lods, src.lodNum * sizeof(MeshSimplifier::Lod));
+        }
+        else
+            *lods = { 0, dst.indexNum, 0.f };
+
+        if (src.meshlets) {
+            const auto& meshlets = *src.meshlets;
+            assert(meshlets.GetTriangleNum() * 3 <= src.indexNum);
+            memcpy(reinterpret_cast<Meshlets::Meshlet*>(section(Section::Meshlets)) + dst.meshletOffset,
+                meshlets.meshlets.data(), meshlets.meshlets.size() * sizeof(Meshlets::Meshlet));
+            memcpy(reinterpret_cast<Meshlets::Bounds*>(section(Section::MeshletBounds)) + dst.meshletOffset,
+                meshlets.bounds.data(), meshlets.bounds.size() * sizeof(Meshlets::Bounds));
+            memcpy(reinterpret_cast<uint32_t*>(section(Section::MeshletVertices)) + dst.meshletVertexOffset,
+                meshlets.vertices.data(), meshlets.vertices.size() * sizeof(uint32_t));
+            memcpy(reinterpret_cast<uint32_t*>(section(Section::MeshletPrimitives)) + dst.meshletPrimitiveOffset,
+                meshlets.primitives.data(), meshlets.primitives.size() * sizeof(uint32_t));
+        }
+    }
+
+    return file;
+}
+
+bool MeshAsset::Save(const filesystem::path& path, const vector<uint8_t>& file) {
+    ofstream out(path, ios::binary | ios::trunc);
+    if (!out)
+        return false;
+    out.write(reinterpret_cast<const char*>(file.data()), static_cast<streamsize>(file.size()));
+    return static_cast<bool>(out);
+}
+
+const char* MeshAsset::ToString(Error error) noexcept {
+    switch (error) {
+    case Error::None: return "none";
+    case Error::CannotOpen: return "cannot open";
+    case Error::Misaligned: return "misaligned";
+    case Error::TooSmall: return "too small";
+    case Error::BadMagic: return "bad magic";
+    case Error::BadVersion: return "bad version";
+    case Error::BadSection: return "bad section";
+    case Error::BadSubmesh: return "bad submesh";
+    default: return "unknown";
+    }
+}
+
+Error View::Init(const void* bytes, size_t size) {
+    data = nullptr;
+    header = nullptr;
+    submeshes = nullptr;
+
+    auto begin = static_cast<const uint8_t*>(bytes);
+    if (reinterpret_cast<uintptr_t>(begin) % alignof(uint64_t) != 0)
+        return Error::Misaligned;
+    if (size < sizeof(Header))
+        return Error::TooSmall;
+
+    auto h = reinterpret_cast<const Header*>(begin);
+    if (h->magic != Magic)
+        return Error::BadMagic;
+    if (h->version != Version)
+        return Error::BadVersion;
+    if (h->fileSize > size)
+        return Error::TooSmall;
+    if (h->vertexStride == 0 || (h->indexSize != 2 && h->indexSize != 4))
+        return Error::BadSection;
+
+    for (size_t s = 0; s < SectionNum; s++) {
+        const auto& range = h->sections[s];
+        if (range.offset % SectionAlignment != 0
+            || range.offset < sizeof(Header)
+            || !InRange(range.offset, range.size, h->fileSize)
+            || range.size % ElementSize(static_cast<Section>(s), *h) != 0)
+        {
+            return Error::BadSection;
+        }
+    }
+    if (ElementNum(*h, Section::Submeshes) != h->submeshNum
+        || ElementNum(*h, Section::MeshletBounds) != ElementNum(*h, Section::Meshlets))
+    {
+        return Error::BadSection;
+    }
+
+    auto subs = reinterpret_cast<const Submesh*>(begin + h->sections[static_cast<size_t>(Section::Submeshes)].offset);
+    auto lods = reinterpret_cast<const MeshSimplifier::Lod*>(begin + h->sections[static_cast<size_t>(Section::Lods)].offset);
+    auto meshlets = reinterpret_cast<const Meshlets::Meshlet*>(begin + h->sections[static_cast<size_t>(Section::Meshlets)].offset);
+    for (size_t i = 0; i < h->submeshNum; i++) {
+        const auto& sub = subs[i];
+        if (!InRange(sub.nameOffset, sub.nameLength, ElementNum(*h, Section::Names))
+            || !InRange(sub.baseVertex, sub.vertexNum, ElementNum(*h, Section::Vertices))
+            || !InRange(sub.indexOffset, sub.indexNum, ElementNum(*h, Section::Indices))
+            || !InRange(sub.lodOffset, sub.lodNum, ElementNum(*h, Section::Lods))
+            || !InRange(sub.meshletOffset, sub.meshletNum, ElementNum(*h, Section::Meshlets))
+            || !InRange(sub.meshletVertexOffset, sub.meshletVertexNum, ElementNum(*h, Section::MeshletVertices))
+            || !InRange(sub.meshletPrimitiveOffset, sub.meshletPrimitiveNum, ElementNum(*h, Section::MeshletPrimitives)))
+        {
+            return Error::BadSubmesh;
+        }
+        for (size_t k = 0; k < sub.lodNum; k++) {
+            const auto& lod = lods[sub.lodOffset + k];
+            if (!InRange(lod.indexOffset, lod.indexNum, sub.indexNum))
+                return Error::BadSubmesh;
+        }
+        // meshlet primitives index the first meshletPrimitiveNum triangles
+        if (uint64_t{ sub.meshletPrimitiveNum } * 3 > sub.indexNum)
+            return Error::BadSubmesh;
+        for (size_t k = 0; k < sub.meshletNum; k++) {
+            const auto& meshlet = meshlets[sub.meshletOffset + k];
+            if (!InRange(meshlet.vertexOffset, meshlet.vertexNum, sub.meshletVertexNum)
+                || !InRange(meshlet.primitiveOffset, meshlet.primitiveNum, sub.meshletPrimitiveNum))
+            {
+                return Error::BadSubmesh;
+            }
+        }
+    }
+
+    data = begin;
+    header = h;
+    submeshes = subs;
+    return Error::None;
+}
+
+VertexCompression::Desc View::GetVertexDesc() const noexcept {
+    VertexCompression::Desc desc;
+    desc.position = static_cast<VertexCompression::PositionFormat>(header->positionFormat);
+    desc.normal = static_cast<VertexCompression::DirectionFormat>(header->normalFormat);
+    desc.tangent = static_cast<VertexCompression::DirectionFormat>(header->tangentFormat);
+    desc.uv = static_cast<VertexCompression::UVFormat>(header->uvFormat);
+    return desc;
+}
+
+size_t View::FindSubmesh(string_view name) const noexcept {
+    for (size_t i = 0; i < header->submeshNum; i++) {
+        if (GetName(submeshes[i]) == name)
+            return i;
+    }
+    return header->submeshNum;
+}
+
+const uint8_t* View::Get(Section section) const noexcept {
+    return data + header->sections[static_cast<size_t>(section)].offset;
+}
+
+string_view View::GetName(const Submesh& submesh) const noexcept {
+    return { reinterpret_cast<const char*>(Get(Section::Names)) + submesh.nameOffset, submesh.nameLength };
+}
+
+const void* View::GetVertices(const Submesh& submesh) const noexcept {
+    return Get(Section::Vertices) + uint64_t{ submesh.baseVertex } * header->vertexStride;
+}
+
+const void* View::GetIndices(const Submesh& submesh) const noexcept {
+    return Get(Section::Indices) + uint64_t{ submesh.indexOffset } * header->indexSize;
+}
+
+const MeshSimplifier::Lod* View::GetLods(const Submesh& submesh) const noexcept {
+    return reinterpret_cast<const MeshSimplifier::Lod*>(Get(Section::Lods)) + submesh.lodOffset;
+}
+
+VertexCompression::QuantizationInfo View::GetQuantization(const Submesh& submesh) const noexcept {
+    VertexCompression::QuantizationInfo info;
+    for (size_t k = 0; k < 3; k++) {
+        info.min[k] = submesh.quantMin[k];
+        info.extent[k] = submesh.quantExtent[k];
+    }
+    return info;
+}
+
+Meshlets::MeshletMesh View::GetMeshlets(const Submesh& submesh) const {
+    auto meshlets = reinterpret_cast<const Meshlets::Meshlet*>(Get(Section::Meshlets)) + submesh.meshletOffset;
+    auto bounds = reinterpret_cast<const Meshlets::Bounds*>(Get(Section::MeshletBounds)) + submesh.meshletOffset;
+    auto vertices = reinterpret_cast<const uint32_t*>(Get(Section::MeshletVertices)) + submesh.meshletVertexOffset;
+    auto primitives = reinterpret_cast<const uint32_t*>(Get(Section::MeshletPrimitives)) + submesh.meshletPrimitiveOffset;
+
+    Meshlets::MeshletMesh mesh;
+    mesh.meshlets.assign(meshlets, meshlets + submesh.meshletNum);
+    mesh.bounds.assign(bounds, bounds + submesh.meshletNum);
+    mesh.vertices.assign(vertices, vertices + submesh.meshletVertexNum);
+    mesh.primitives.assign(primitives, primitives + submesh.meshletPrimitiveNum);
+    return mesh;
+}
+
+Error MeshAsset::Load(const filesystem::path& path, MappedFile& file, View& view) {
+    if (!file.Open(path)) {
+        view.Init(nullptr, 0);
+        return Error::CannotOpen;
+    }
+    return view.Init(file.GetData(), file.GetSize());
+}
@@ -0,0 +1,420 @@
+#include <UDXRenderer/MeshOptimizer.h>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+using namespace Ubpa;
+using namespace std;
+
+namespace {
+    constexpr uint32_t Unused = static_cast<uint32_t>(-1);
+
+    // FIFO cache with timestamps: vertex v is cached iff time - stamp[v] < cacheSize
+    struct FifoCache {
+        vector<uint32_t> stamps;
+        uint32_t time;
+        uint32_t size;
+
+        FifoCache(size_t vertexNum, uint32_t size)
+            : stamps(vertexNum, 0), time{ size + 1 }, size{ size } {}
+
+        // returns true on a miss
+        bool Touch(uint32_t v) {
+            if (time - stamps[v] <= size)
+                return false;
+            stamps[v] = time++;
+            return true;
+        }
+
+        void Reset() { time += size + 1; }
+    };
+
+    array<float, 3> LoadPosition(const void* positions, size_t stride, uint32_t v) {
+        array<float, 3> p;
+        memcpy(p.data(), static_cast<const uint8_t*>(positions) + v * stride, sizeof(p));
+        return p;
+    }
+
+    // [Forsyth 2006] Linear-Speed Vertex Cache Optimisation
+    namespace Forsyth {
+        constexpr uint32_t CacheSize = 32;
+        constexpr uint32_t MaxValence = 64; // valence boost table size
+        constexpr float CacheDecayPower = 1.5f;
+        constexpr float LastTriScore = 0.75f;
+        constexpr float ValenceBoostScale = 2.0f;
+        constexpr float ValenceBoostPower = 0.5f;
+
+        struct Tables {
+            array<float, CacheSize> cache;
+            array<float, MaxValence> valence;
+
+            Tables() {
+                for (uint32_t i = 0; i < CacheSize; i++) {
+                    if (i < 3)
+                        cache[i] = LastTriScore;
+                    else {
+                        float scaler = 1.f / (CacheSize - 3);
+                        cache[i] = powf(1.f - (i - 3) * scaler, CacheDecayPower);
+                    }
+                }
+                valence[0] = 0.f;
+                for (uint32_t i = 1; i < MaxValence; i++)
+                    valence[i] = ValenceBoostScale * powf(static_cast<float>(i), -ValenceBoostPower);
+            }
+        };
+
+        const Tables& GetTables() {
+            static const Tables tables;
+            return tables;
+        }
+
+        float VertexScore(uint32_t cachePos, uint32_t remaining) {
+            if (remaining == 0)
+                return -1.f;
+            const auto& tables = GetTables();
+            float score = cachePos < CacheSize ? tables.cache[cachePos] : 0.f;
+            return score + tables.valence[min(remaining, MaxValence - 1)];
+        }
+    }
+}
+
+MeshOptimizer::VertexCacheStats MeshOptimizer::AnalyzeVertexCache(
+    const uint32_t* indices, size_t indexNum, size_t vertexNum, uint32_t cacheSize)
+{
+    assert(indexNum % 3 == 0);
+    VertexCacheStats stats;
+    if (indexNum == 0)
+        return stats;
+
+    FifoCache cache(vertexNum, cacheSize);
+    vector<bool> referenced(vertexNum, false);
+    size_t referencedNum = 0;
+    for (size_t i = 0; i < indexNum; i++) {
+        uint32_t v = indices[i];
+        assert(v < vertexNum);
+        stats.transformNum += cache.Touch(v);
+        if (!referenced[v]) {
+            referenced[v] = true;
+            referencedNum++;
+        }
+    }
+
+    stats.acmr = static_cast<float>(stats.transformNum) / (indexNum / 3);
+    stats.atvr = static_cast<float>(stats.transformNum) / referencedNum;
+    return stats;
+}
+
+MeshOptimizer::VertexFetchStats MeshOptimizer::AnalyzeVertexFetch(
+    const uint32_t* indices, size_t indexNum, size_t vertexNum, size_t vertexStride)
+{
+    constexpr size_t LineSize = 64;
+    constexpr size_t LineNum = 64;
+
+    VertexFetchStats stats;
+    if (indexNum == 0)
+        return stats;
+
+    vector<uint64_t> lines; // most recent last
+    lines.reserve(LineNum);
+    vector<bool> referenced(vertexNum, false);
+    size_t referencedNum = 0;
+
+    for (size_t i = 0; i < indexNum; i++) {
+        uint32_t v = indices[i];
+        if (!referenced[v]) {
+            referenced[v] = true;
+            referencedNum++;
+        }
+
+        uint64_t first = static_cast<uint64_t>(v) * vertexStride / LineSize;
+        uint64_t last = (static_cast<uint64_t>(v) * vertexStride + vertexStride - 1) / LineSize;
+        for (uint64_t line = first; line <= last; line++) {
+            auto target = find(lines.begin(), lines.end(), line);
+            if (target != lines.end())
+                lines.erase(target);
+            else {
+                stats.bytesFetched += LineSize;
+                if (lines.size() == LineNum)
+                    lines.erase(lines.begin());
+            }
+            lines.push_back(line);
+        }
+    }
+
+    stats.overfetch = static_cast<float>(stats.bytesFetched) / (referencedNum * vertexStride);
+    return stats;
+}
+
+void MeshOptimizer::OptimizeVertexCache(uint32_t* dst, const uint32_t* indices, size_t indexNum, size_t vertexNum) {
+    using namespace Forsyth;
+    assert(indexNum % 3 == 0);
+    size_t triNum = indexNum / 3;
+    if (triNum == 0)
+        return;
+
+    vector<uint32_t> input(indices, indices + indexNum); // dst may alias indices
+
+    // vertex -> triangles, the first remaining[v] entries are the unemitted ones
+    vector<uint32_t> remaining(vertexNum, 0);
+    for (auto v : input)
+        remaining[v]++;
+    vector<uint32_t> triOffsets(vertexNum + 1, 0);
+    for (size_t v = 0; v < vertexNum; v++)
+        triOffsets[v + 1] = triOffsets[v] + remaining[v];
+    vector<uint32_t> vertexTris(indexNum);
+    {
+        vector<uint32_t> fill(triOffsets.begin(), triOffsets.end() - 1);
+        for (size_t t = 0; t < triNum; t++) {
+            for (size_t k = 0; k < 3; k++)
+                vertexTris[fill[input[3 * t + k]]++] = static_cast<uint32_t>(t);
+        }
+    }
+
+    vector<uint32_t> cachePos(vertexNum, CacheSize);
+    vector<float> vertexScores(vertexNum);
+    for (size_t v = 0; v < vertexNum; v++)
+        vertexScores[v] = VertexScore(CacheSize, remaining[v]);
+
+    vector<float> triScores(triNum);
+    for (size_t t = 0; t < triNum; t++)
+        triScores[t] = vertexScores[input[3 * t]] + vertexScores[input[3 * t + 1]] + vertexScores[input[3 * t + 2]];
+
+    vector<bool> emitted(triNum, false);
+    array<uint32_t, CacheSize + 3> cache;
+    array<uint32_t, CacheSize + 3> newCache;
+    size_t cacheNum = 0;
+
+    size_t cursor = 0; // fallback scan for the next unemitted triangle
+    uint32_t bestTri = 0;
+    for (size_t out = 0; out < triNum; out++) {
+        if (bestTri == Unused) {
+            while (emitted[cursor])
+                cursor++;
+            bestTri = static_cast<uint32_t>(cursor);
+        }
+
+        emitted[bestTri] = true;
+        const uint32_t* tri = &input[3 * bestTri];
+        memcpy(dst + 3 * out, tri, 3 * sizeof(uint32_t));
+
+        // the triangle's vertices go to the front of the LRU cache
+        size_t newCacheNum = 0;
+        for (size_t k = 0; k < 3; k++) {
+            uint32_t v = tri[k];
+            newCache[newCacheNum++] = v;
+
+            // drop the triangle from the vertex's remaining list
+            uint32_t* tris = &vertexTris[triOffsets[v]];
+            uint32_t* last = tris + remaining[v] - 1;
+            *find(tris, last + 1, bestTri) = *last;
+            *last = bestTri;
+            remaining[v]--;
+        }
+        for (size_t i = 0; i < cacheNum; i++) {
+            uint32_t v = cache[i];
+            if (v != tri[0] && v != tri[1] && v != tri[2])
+                newCache[newCacheNum++] = v;
+        }
+
+        // rescore the cached vertices (and the evicted ones) and their triangles
+        for (size_t i = 0; i < newCacheNum; i++) {
+            uint32_t v = newCache[i];
+            cachePos[v] = i < CacheSize ? static_cast<uint32_t>(i) : CacheSize;
+            float score = VertexScore(cachePos[v], remaining[v]);
+            float delta = score - vertexScores[v];
+            vertexScores[v] = score;
+            for (uint32_t j = 0; j < remaining[v]; j++)
+                triScores[vertexTris[triOffsets[v] + j]] += delta;
+        }
+
+        cacheNum = min<size_t>(newCacheNum, CacheSize);
+        swap(cache, newCache);
+
+        // the next triangle is the best one touching the cache
+        bestTri = Unused;
+        float bestScore = -1.f;
+        for (size_t i = 0; i < cacheNum; i++) {
+            uint32_t v = cache[i];
+            for (uint32_t j = 0; j < remaining[v]; j++) {
+                uint32_t t = vertexTris[triOffsets[v] + j];
+                if (triScores[t] > bestScore) {
+                    bestScore = triScores[t];
+                    bestTri = t;
+                }
+            }
+        }
+    }
+}
+
+void MeshOptimizer::OptimizeOverdraw(uint32_t* dst, const uint32_t* indices, size_t indexNum,
+    const void* positions, size_t vertexNum, size_t positionStride, float threshold)
+{
+    constexpr uint32_t CacheSize = 16;
+    assert(indexNum % 3 == 0);
+    size_t triNum = indexNum / 3;
+    if (triNum == 0)
+        return;
+
+    vector<uint32_t> input(indices, indices + indexNum);
+
+    // hard boundaries: triangles whose three vertices all miss the cache
+    vector<size_t> hardClusters;
+    {
+        FifoCache cache(vertexNum, CacheSize);
+        for (size_t t = 0; t < triNum; t++) {
+            uint32_t misses = cache.Touch(input[3 * t]) + cache.Touch(input[3 * t + 1]) + cache.Touch(input[3 * t + 2]);
+            if (misses == 3)
+                hardClusters.push_back(t);
+        }
+        if (hardClusters.empty() || hardClusters[0] != 0)
+            hardClusters.insert(hardClusters.begin(), 0);
+    }
+
+    // soft boundaries: split a hard cluster where its running ACMR is within threshold
+    vector<size_t> clusters;
+    {
+        FifoCache cache(vertexNum, CacheSize);
+        for (size_t c = 0; c < hardClusters.size(); c++) {
+            size_t begin = hardClusters[c];
+            size_t end = c + 1 < hardClusters.size() ? hardClusters[c + 1] : triNum;
+
+            cache.Reset();
+            uint32_t clusterMisses = 0;
+            for (size_t t = begin; t < end; t++)
+                clusterMisses += cache.Touch(input[3 * t]) + cache.Touch(input[3 * t + 1]) + cache.Touch(input[3 * t + 2]);
+            float clusterACMR = static_cast<float>(clusterMisses) / (end - begin);
+
+            clusters.push_back(begin);
+            cache.Reset();
+            uint32_t misses = 0;
+            size_t start = begin;
+            for (size_t t = begin; t < end; t++) {
+                misses += cache.Touch(input[3 * t]) + cache.Touch(input[3 * t + 1]) + cache.Touch(input[3 * t + 2]);
+                if (t + 1 < end && static_cast<float>(misses) / (t + 1 - start) <= threshold * clusterACMR) {
+                    clusters.push_back(t + 1);
+                    start = t + 1;
+                    misses = 0;
+                    cache.Reset();
+                }
+            }
+        }
+    }
+
+    // area-weighted centroid and normal of every cluster and of the mesh
+    size_t clusterNum = clusters.size();
+    vector<array<float, 3>> centroids(clusterNum, { 0.f, 0.f, 0.f });
+    vector<array<float, 3>> normals(clusterNum, { 0.f, 0.f, 0.f });
+    vector<float> areas(clusterNum, 0.f);
+    array<float, 3> meshCentroid{ 0.f, 0.f, 0.f };
+    float meshArea = 0.f;
+
+    for (size_t c = 0; c < clusterNum; c++) {
+        size_t end = c + 1 < clusterNum ? clusters[c + 1] : triNum;
+        for (size_t t = clusters[c]; t < end; t++) {
+            auto p0 = LoadPosition(positions, positionStride, input[3 * t]);
+            auto p1 = LoadPosition(positions, positionStride, input[3 * t + 1]);
+            auto p2 = LoadPosition(positions, positionStride, input[3 * t + 2]);
+            array<float, 3> e1{ p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+            array<float, 3> e2{ p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+            array<float, 3> n{ e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+            float area = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            for (size_t k = 0; k < 3; k++) {
+                float center = (p0[k] + p1[k] + p2[k]) / 3.f;
+                centroids[c][k] += center * area;
+                normals[c][k] += n[k];
+                meshCentroid[k] += center * area;
+            }
+            areas[c] += area;
+            meshArea += area;
+        }
+    }
+    if (meshArea > 0.f) {
+        for (auto& x : meshCentroid)
+            x /= meshArea;
+    }
+
+    // clusters far out along their own normal occlude the rest, draw them first
+    vector<float> keys(clusterNum);
+    for (size_t c = 0; c < clusterNum; c++) {
+        float len = sqrtf(normals[c][0] * normals[c][0] + normals[c][1] * normals[c][1] + normals[c][2] * normals[c][2]);
+        float key = 0.f;
+        if (areas[c] > 0.f && len > 0.f) {
+            for (size_t k = 0; k < 3; k++)
+                key += (centroids[c][k] / areas[c] - meshCentroid[k]) * normals[c][k] / len;
+        }
+        keys[c] = key;
+    }
+
+    vector<size_t> order(clusterNum);
+    for (size_t c = 0; c < clusterNum; c++)
+        order[c] = c;
+    stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return keys[a] > keys[b]; });
+
+    size_t out = 0;
+    for (size_t c : order) {
+        size_t end = c + 1 < clusterNum ? clusters[c + 1] : triNum;
+        size_t num = 3 * (end - clusters[c]);
+        memcpy(dst + out, &input[3 * clusters[c]], num * sizeof(uint32_t));
+        out += num;
+    }
+}
+
+size_t MeshOptimizer::OptimizeVertexFetchRemap(uint32_t* remap, const uint32_t* indices, size_t indexNum, size_t vertexNum) {
+    fill(remap, remap + vertexNum, Unused);
+    uint32_t next = 0;
+    for (size_t i = 0; i < indexNum; i++) {
+        uint32_t v = indices[i];
+        assert(v < vertexNum);
+        if (remap[v] == Unused)
+            remap[v] = next++;
+    }
+    return next;
+}
+
+void MeshOptimizer::RemapIndexBuffer(uint32_t* dst, const uint32_t* indices, size_t indexNum, const uint32_t* remap) {
+    for (size_t i = 0; i < indexNum; i++) {
+        assert(remap[indices[i]] != Unused);
+        dst[i] = remap[indices[i]];
+    }
+}
+
+void MeshOptimizer::RemapVertexBuffer(void* dst, const void* vertices, size_t vertexNum, size_t vertexStride, const uint32_t* remap) {
+    assert(dst != vertices);
+    auto src = static_cast<const uint8_t*>(vertices);
+    auto out = static_cast<uint8_t*>(dst);
+    for (size_t v = 0; v < vertexNum; v++) {
+        if (remap[v] != Unused)
+            memcpy(out + remap[v] * vertexStride, src + v * vertexStride, vertexStride);
+    }
+}
+
+MeshOptimizer::Report MeshOptimizer::Optimize(vector<uint32_t>& indices, void* vertices, size_t vertexNum,
+    size_t vertexStride, size_t positionOffset, const Config& config)
+{
+    Report report;
+    report.vertexNumBefore = vertexNum;
+    report.cacheBefore = AnalyzeVertexCache(indices.data(), indices.size(), vertexNum, config.cacheSize);
+    report.fetchBefore = AnalyzeVertexFetch(indices.data(), indices.size(), vertexNum, vertexStride);
+
+    OptimizeVertexCache(indices.data(), indices.data(), indices.size(), vertexNum);
+
+    if (config.overdrawThreshold > 0.f) {
+        const void* positions = static_cast<const uint8_t*>(vertices) + positionOffset;
+        OptimizeOverdraw(indices.data(), indices.data(), indices.size(),
+            positions, vertexNum, vertexStride, config.overdrawThreshold);
+    }
+
+    vector<uint32_t> remap(vertexNum);
+    size_t newVertexNum = OptimizeVertexFetchRemap(remap.data(), indices.data(), indices.size(), vertexNum);
+    RemapIndexBuffer(indices.data(), indices.data(), indices.size(), remap.data());
+    vector<uint8_t> copy(static_cast<const uint8_t*>(vertices), static_cast<const uint8_t*>(vertices) + vertexNum * vertexStride);
+    RemapVertexBuffer(vertices, copy.data(), vertexNum, vertexStride, remap.data());
+
+    report.vertexNumAfter = newVertexNum;
+    report.cacheAfter = AnalyzeVertexCache(indices.data(), indices.size(), newVertexNum, config.cacheSize);
+    report.fetchAfter = AnalyzeVertexFetch(indices.data(), indices.size(), newVertexNum, vertexStride);
+    return report;
+}
@@ -0,0 +1,306 @@
+#include <UDXRenderer/MeshSimplifier.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <numeric>
+
+using namespace Ubpa;
+using namespace Ubpa::MeshSimplifier;
+using namespace std;
+
+namespace {
+    struct Vec3 {
+        double x, y, z;
+        Vec3 operator-(const Vec3& v) const noexcept { return { x - v.x, y - v.y, z - v.z }; }
+    };
+
+    double Dot(const Vec3& a, const Vec3& b) noexcept { return a.x * b.x + a.y * b.y + a.z * b.z; }
+    Vec3 Cross(const Vec3& a, const Vec3& b) noexcept {
+        return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+    }
+
+    // symmetric 4x4 (xx xy xz xw yy yz yw zz zw ww), weighted by triangle area
+    struct Quadric {
+        double a[10]{};
+        double weight{ 0. };
+
+        void AddPlane(const Vec3& n, double d, double w) noexcept {
+            double p[4] = { n.x, n.y, n.z, d };
+            size_t k = 0;
+            for (size_t i = 0; i < 4; i++) {
+                for (size_t j = i; j < 4; j++)
+                    a[k++] += w * p[i] * p[j];
+            }
+            weight += w;
+        }
+
+        Quadric& operator+=(const Quadric& q) noexcept {
+            for (size_t i = 0; i < 10; i++)
+                a[i] += q.a[i];
+            weight += q.weight;
+            return *this;
+        }
+
+        // weighted mean squared distance to the planes
+        double Evaluate(const Vec3& v) const noexcept {
+            double p[4] = { v.x, v.y, v.z, 1. };
+            double e = 0.;
+            size_t k = 0;
+            for (size_t i = 0; i < 4; i++) {
+                for (size_t j = i; j < 4; j++)
+                    e += (i == j ? 1. : 2.) * a[k++] * p[i] * p[j];
+            }
+            return weight > 0. ? max(e, 0.) / weight : 0.;
+        }
+    };
+
+    struct Collapse {
+        uint32_t from;      // vertex (its position class has just this vertex)
+        uint32_t to;        // vertex replacing it, keeps the attributes of this corner
+        uint32_t toClass;
+        double cost;
+    };
+
+    Vec3 LoadPosition(const uint8_t* positions, size_t stride, uint32_t i) noexcept {
+        const float* p = reinterpret_cast<const float*>(positions + i * stride);
+        return { p[0], p[1], p[2] };
+    }
+}
+
+size_t MeshSimplifier::Simplify(uint32_t* dst, const uint32_t* indices, size_t indexNum,
+    const void* positionData, size_t vertexNum, size_t positionStride,
+    size_t targetIndexNum, float targetError, float* resultError)
+{
+    assert(indexNum % 3 == 0);
+    const auto* positions = static_cast<const uint8_t*>(positionData);
+    auto position = [&](uint32_t v) { return LoadPosition(positions, positionStride, v); };
+
+    // position classes
+    vector<uint32_t> order(vertexNum);
+    iota(order.begin(), order.end(), 0u);
+    auto less = [&](uint32_t l, uint32_t r) {
+        Vec3 a = position(l), b = position(r);
+        if (a.x != b.x) return a.x < b.x;
+        if (a.y != b.y) return a.y < b.y;
+        if (a.z != b.z) return a.z < b.z;
+        return l < r;
+    };
+    sort(order.begin(), order.end(), less);
+    vector<uint32_t> weld(vertexNum);
+    vector<uint32_t> classSize;
+    for (size_t i = 0; i < vertexNum; i++) {
+        Vec3 p = position(order[i]);
+        if (i == 0 || Dot(p - position(order[i - 1]), p - position(order[i - 1])) != 0.)
+            classSize.push_back(0);
+        weld[order[i]] = static_cast<uint32_t>(classSize.size() - 1);
+        classSize.back()++;
+    }
+    size_t classNum = classSize.size();
+
+    vector<uint8_t> locked(classNum, 0);
+    for (size_t c = 0; c < classNum; c++)
+        locked[c] = classSize[c] > 1;
+
+    // working copy without degenerate triangles
+    vector<uint32_t> work;
+    work.reserve(indexNum);
+    for (size_t i = 0; i < indexNum; i += 3) {
+        uint32_t a = weld[indices[i]], b = weld[indices[i + 1]], c = weld[indices[i + 2]];
+        if (a != b && b != c && c != a)
+            work.insert(work.end(), indices + i, indices + i + 3);
+    }
+
+    // quadrics
+    vector<Quadric> quadrics(classNum);
+    for (size_t i = 0; i < work.size(); i += 3) {
+        Vec3 p0 = position(work[i]), p1 = position(work[i + 1]), p2 = position(work[i + 2]);
+        Vec3 n = Cross(p1 - p0, p2 - p0);
+        double area2 = sqrt(Dot(n, n));
+        if (area2 == 0.)
+            continue;
+        n = { n.x / area2, n.y / area2, n.z / area2 };
+        double d = -Dot(n, p0);
+        for (size_t k = 0; k < 3; k++)
+            quadrics[weld[work[i + k]]].AddPlane(n, d, area2 * 0.5);
+    }
+
+    // lock borders and non-manifold edges (not used by exactly two triangles)
+    {
+        vector<uint64_t> edges;
+        edges.reserve(work.size());
+        for (size_t i = 0; i < work.size(); i += 3) {
+            for (size_t k = 0; k < 3; k++) {
+                uint64_t a = weld[work[i + k]], b = weld[work[i + (k + 1) % 3]];
+                edges.push_back(a < b ? (a << 32 | b) : (b << 32 | a));
+            }
+        }
+        sort(edges.begin(), edges.end());
+        for (size_t i = 0; i < edges.size();) {
+            size_t j = i;
+            while (j < edges.size() && edges[j] == edges[i])
+                j++;
+            if (j - i != 2) {
+                locked[edges[i] >> 32] = 1;
+                locked[edges[i] & 0xffffffff] = 1;
+            }
+            i = j;
+        }
+    }
+
+    double maxCost = static_cast<double>(targetError) * targetError;
+    double doneCost = 0.;
+    vector<uint32_t> remap(vertexNum);
+    vector<uint8_t> touched(classNum);
+    vector<uint32_t> adjOffsets(classNum + 1);
+    vector<uint32_t> adj;
+    vector<Collapse> collapses;
+
+    while (work.size() > targetIndexNum) {
+        size_t triNum = work.size() / 3;
+
+        // class -> triangles
+        fill(adjOffsets.begin(), adjOffsets.end(), 0u);
+        for (uint32_t v : work)
+            adjOffsets[weld[v] + 1]++;
+        for (size_t i = 1; i <= classNum; i++)
+            adjOffsets[i] += adjOffsets[i - 1];
+        adj.resize(work.size());
+        {
+            vector<uint32_t> cursor(adjOffsets.begin(), adjOffsets.end() - 1);
+            for (size_t i = 0; i < work.size(); i++)
+                adj[cursor[weld[work[i]]]++] = static_cast<uint32_t>(i / 3);
+        }
+
+        // candidates, cheapest first
+        collapses.clear();
+        for (size_t i = 0; i < work.size(); i += 3) {
+            for (size_t k = 0; k < 3; k++) {
+                uint32_t va = work[i + k], vb = work[i + (k + 1) % 3];
+                uint32_t a = weld[va], b = weld[vb];
+                Quadric q = quadrics[a];
+                q += quadrics[b];
+                if (!locked[a])
+                    collapses.push_back({ va, vb, b, q.Evaluate(position(vb)) });
+                if (!locked[b])
+                    collapses.push_back({ vb, va, a, q.Evaluate(position(va)) });
+            }
+        }
+        sort(collapses.begin(), collapses.end(), [](const Collapse& l, const Collapse& r) {
+            if (l.cost != r.cost) return l.cost < r.cost;
+            if (l.from != r.from) return l.from < r.from;
+            return l.to < r.to;
+        });
+
+        iota(remap.begin(), remap.end(), 0u);
+        fill(touched.begin(), touched.end(), uint8_t{ 0 });
+        size_t neededTriNum = (work.size() - targetIndexNum + 2) / 3;
+        size_t removedTriNum = 0;
+        size_t collapseNum = 0;
+
+        for (const auto& collapse : collapses) {
+            if (collapse.cost > maxCost || removedTriNum >= neededTriNum)
+                break;
+            uint32_t from = weld[collapse.from];
+            uint32_t to = collapse.toClass;
+            if (touched[from] || touched[to])
+                continue;
+
+            // reject collapses flipping (or squashing) a remaining triangle
+            Vec3 target = position(collapse.to);
+            bool flip = false;
+            size_t removed = 0;
+            for (uint32_t i = adjOffsets[from]; i < adjOffsets[from + 1] && !flip; i++) {
+                const uint32_t* tri = work.data() + 3 * adj[i];
+                uint32_t c[3] = { weld[tri[0]], weld[tri[1]], weld[tri[2]] };
+                if (c[0] == to || c[1] == to || c[2] == to) {
+                    removed++;
+                    continue;
+                }
+                Vec3 p[3], q[3];
+                for (size_t k = 0; k < 3; k++) {
+                    p[k] = position(tri[k]);
+                    q[k] = c[k] == from ? target : p[k];
+                }
+                Vec3 n0 = Cross(p[1] - p[0], p[2] - p[0]);
+                Vec3 n1 = Cross(q[1] - q[0], q[2] - q[0]);
+                flip = Dot(n0, n1) <= 0.25 * sqrt(Dot(n0, n0) * Dot(n1, n1));
+            }
+            if (flip)
+                continue;
+
+            remap[collapse.from] = collapse.to;
+            quadrics[to] += quadrics[from];
+            // the one-ring of from changes, its vertices wait for the next pass
+            for (uint32_t i = adjOffsets[from]; i < adjOffsets[from + 1]; i++) {
+                const uint32_t* tri = work.data() + 3 * adj[i];
+                for (size_t k = 0; k < 3; k++)
+                    touched[weld[tri[k]]] = 1;
+            }
+            removedTriNum += removed;
+            collapseNum++;
+            doneCost = max(doneCost, collapse.cost);
+        }
+
+        if (collapseNum == 0)
+            break;
+
+        size_t dstNum = 0;
+        for (size_t i = 0; i < triNum; i++) {
+            uint32_t v[3] = { remap[work[3 * i]], remap[work[3 * i + 1]], remap[work[3 * i + 2]] };
+            if (weld[v[0]] == weld[v[1]] || weld[v[1]] == weld[v[2]] || weld[v[2]] == weld[v[0]])
+                continue;
+            work[dstNum++] = v[0];
+            work[dstNum++] = v[1];
+            work[dstNum++] = v[2];
+        }
+        work.resize(dstNum);
+    }
+
+    copy(work.begin(), work.end(), dst);
+    if (resultError)
+        *resultError = static_cast<float>(sqrt(doneCost));
+    return work.size();
+}
+
+LodChain MeshSimplifier::GenerateLods(const uint32_t* indices, size_t indexNum,
+    const void* positionData, size_t vertexNum, size_t positionStride, const LodConfig& config)
+{
+    LodChain chain;
+    chain.indices.assign(indices, indices + indexNum);
+    chain.lods.push_back({ 0, static_cast<uint32_t>(indexNum), 0.f });
+
+    // bounding box diagonal of the referenced vertices
+    const auto* positions = static_cast<const uint8_t*>(positionData);
+    float lo[3]{ 0.f, 0.f, 0.f }, hi[3]{ 0.f, 0.f, 0.f };
+    for (size_t i = 0; i < indexNum; i++) {
+        const float* p = reinterpret_cast<const float*>(positions + indices[i] * positionStride);
+        for (size_t k = 0; k < 3; k++) {
+            lo[k] = i == 0 ? p[k] : min(lo[k], p[k]);
+            hi[k] = i == 0 ? p[k] : max(hi[k], p[k]);
+        }
+    }
+    float diagonal = sqrtf((hi[0] - lo[0]) * (hi[0] - lo[0])
+        + (hi[1] - lo[1]) * (hi[1] - lo[1]) + (hi[2] - lo[2]) * (hi[2] - lo[2]));
+    float maxError = config.maxError * diagonal;
+
+    vector<uint32_t> lodIndices;
+    while (chain.lods.size() < config.maxLodNum) {
+        const Lod prev = chain.lods.back();
+        size_t target = static_cast<size_t>(prev.indexNum * config.ratio) / 3 * 3;
+        if (target < 3)
+            break;
+
+        lodIndices.resize(prev.indexNum);
+        float error = 0.f;
+        size_t num = Simplify(lodIndices.data(), chain.indices.data() + prev.indexOffset, prev.indexNum,
+            positionData, vertexNum, positionStride, target, maxError - prev.error, &error);
+        if (num == 0 || num > prev.indexNum * config.minReduction)
+            break;
+
+        chain.lods.push_back({ static_cast<uint32_t>(chain.indices.size()), static_cast<uint32_t>(num), prev.error + error });
+        chain.indices.insert(chain.indices.end(), lodIndices.begin(), lodIndices.begin() + num);
+    }
+
+    return chain;
+}
@@ -0,0 +1,364 @@
+#include <UDXRenderer/Meshlets.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <thread>
+
+using namespace Ubpa;
+using namespace Ubpa::Meshlets;
+using namespace std;
+
+namespace {
+    struct ChunkResult {
+        vector<Meshlet> meshlets;
+        vector<Bounds> bounds;
+        vector<uint32_t> vertices;
+        vector<uint32_t> primitives;
+    };
+
+    struct Vec3 {
+        float x, y, z;
+        Vec3 operator-(const Vec3& v) const noexcept { return { x - v.x, y - v.y, z - v.z }; }
+        Vec3 operator+(const Vec3& v) const noexcept { return { x + v.x, y + v.y, z + v.z }; }
+        Vec3 operator*(float k) const noexcept { return { x * k, y * k, z * k }; }
+    };
+
+    float Dot(const Vec3& a, const Vec3& b) noexcept { return a.x * b.x + a.y * b.y + a.z * b.z; }
+    float Length(const Vec3& v) noexcept { return sqrtf(Dot(v, v)); }
+    Vec3 Cross(const Vec3& a, const Vec3& b) noexcept {
+        return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+    }
+
+    Vec3 LoadPosition(const uint8_t* positions, size_t stride, uint32_t i) noexcept {
+        const float* p = reinterpret_cast<const float*>(positions + i * stride);
+        return { p[0], p[1], p[2] };
+    }
+
+    Bounds ComputeBounds(const Meshlet& meshlet, const ChunkResult& chunk,
+        const uint8_t* positions, size_t stride)
+    {
+        const uint32_t* vertices = chunk.vertices.data() + meshlet.vertexOffset;
+        auto position = [&](uint32_t local) { return LoadPosition(positions, stride, vertices[local]); };
+
+        // Ritter's sphere: the diameter from two far points, then grow over the rest
+        Vec3 p0 = position(0);
+        Vec3 p1 = p0;
+        for (uint32_t i = 1; i < meshlet.vertexNum; i++) {
+            Vec3 p = position(i);
+            if (Dot(p - p0, p - p0) > Dot(p1 - p0, p1 - p0))
+                p1 = p;
+        }
+        Vec3 p2 = p1;
+        for (uint32_t i = 0; i < meshlet.vertexNum; i++) {
+            Vec3 p = position(i);
+            if (Dot(p - p1, p - p1) > Dot(p2 - p1, p2 - p1))
+                p2 = p;
+        }
+        Vec3 center = (p1 + p2) * 0.5f;
+        float radius = Length(p2 - p1) * 0.5f;
+        for (uint32_t i = 0; i < meshlet.vertexNum; i++) {
+            Vec3 p = position(i);
+            float d = Length(p - center);
+            if (d > radius) {
+                float newRadius = (radius + d) * 0.5f;
+                center = center + (p - center) * ((newRadius - radius) / d);
+                radius = newRadius;
+            }
+        }
+
+        Bounds bounds;
+        bounds.center[0] = center.x;
+        bounds.center[1] = center.y;
+        bounds.center[2] = center.z;
+        bounds.radius = radius;
+
+        // normal cone
+        const uint32_t* primitives = chunk.primitives.data() + meshlet.primitiveOffset;
+        vector<Vec3> normals;
+        normals.reserve(meshlet.primitiveNum);
+        Vec3 axis{ 0.f, 0.f, 0.f };
+        for (uint32_t i = 0; i < meshlet.primitiveNum; i++) {
+            uint32_t i0, i1, i2;
+            UnpackTriangle(primitives[i], i0, i1, i2);
+            Vec3 a = position(i0);
+            Vec3 n = Cross(position(i1) - a, position(i2) - a);
+            float len = Length(n);
+            if (len == 0.f)
+                continue; // degenerate
+            normals.push_back(n * (1.f / len));
+            axis = axis + normals.back();
+        }
+
+        float axisLength = Length(axis);
+        if (normals.empty() || axisLength < 1e-6f)
+            return bounds;
+        axis = axis * (1.f / axisLength);
+
+        float minDot = 1.f;
+        for (const auto& n : normals)
+            minDot = min(minDot, Dot(n, axis));
+
+        bounds.coneAxis[0] = axis.x;
+        bounds.coneAxis[1] = axis.y;
+        bounds.coneAxis[2] = axis.z;
+        // wider than ~84 degrees: too wide to ever be culled
+        bounds.coneCutoff = minDot <= 0.1f ? 1.f : sqrtf(1.f - minDot * minDot);
+        return bounds;
+    }
+
+    void BuildChunk(const uint32_t* indices, size_t triNum,
+        const uint8_t* positions, size_t stride, const Config& config, ChunkResult& out)
+    {
+        // compact chunk vertices
+        vector<uint32_t> chunkVertices(indices, indices + triNum * 3);
+        sort(chunkVertices.begin(), chunkVertices.end());
+        chunkVertices.erase(unique(chunkVertices.begin(), chunkVertices.end()), chunkVertices.end());
+
+        vector<uint32_t> corners(triNum * 3);
+        for (size_t i = 0; i < corners.size(); i++) {
+            corners[i] = static_cast<uint32_t>(
+                lower_bound(chunkVertices.begin(), chunkVertices.end(), indices[i]) - chunkVertices.begin());
+        }
+
+        // vertex -> triangles, in ascending triangle order
+        vector<uint32_t> adjOffsets(chunkVertices.size() + 1, 0);
+        for (uint32_t v : corners)
+            adjOffsets[v + 1]++;
+        for (size_t i = 1; i < adjOffsets.size(); i++)
+            adjOffsets[i] += adjOffsets[i - 1];
+        vector<uint32_t> adj(corners.size());
+        {
+            vector<uint32_t> cursor(adjOffsets.begin(), adjOffsets.end() - 1);
+            for (size_t i = 0; i < corners.size(); i++)
+                adj[cursor[corners[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+
+        vector<int32_t> localIndex(chunkVertices.size(), -1);
+        vector<uint8_t> used(triNum, 0);
+        vector<uint32_t> currentVertices; // chunk vertex ids
+        Vec3 positionSum{ 0.f, 0.f, 0.f };  // of currentVertices
+
+        Meshlet current{};
+        auto reset = [&]() {
+            current.vertexNum = 0;
+            current.vertexOffset = static_cast<uint32_t>(out.vertices.size());
+            current.primitiveNum = 0;
+            current.primitiveOffset = static_cast<uint32_t>(out.primitives.size());
+        };
+        auto flush = [&]() {
+            if (current.primitiveNum == 0)
+                return;
+            out.bounds.push_back(ComputeBounds(current, out, positions, stride));
+            out.meshlets.push_back(current);
+            for (uint32_t v : currentVertices)
+                localIndex[v] = -1;
+            currentVertices.clear();
+            positionSum = { 0.f, 0.f, 0.f };
+            reset();
+        };
+        auto newVertexNum = [&](size_t t) {
+            uint32_t a = corners[3 * t], b = corners[3 * t + 1], c = corners[3 * t + 2];
+            uint32_t n = localIndex[a] < 0;
+            n += localIndex[b] < 0 && b != a;
+            n += localIndex[c] < 0 && c != a && c != b;
+            return n;
+        };
+        auto add = [&](size_t t) {
+            used[t] = 1;
+            uint32_t local[3];
+            for (size_t k = 0; k < 3; k++) {
+                uint32_t v = corners[3 * t + k];
+                if (localIndex[v] < 0) {
+                    localIndex[v] = static_cast<int32_t>(currentVertices.size());
+                    currentVertices.push_back(v);
+                    positionSum = positionSum + LoadPosition(positions, stride, chunkVertices[v]);
+                    out.vertices.push_back(chunkVertices[v]);
+                    current.vertexNum++;
+                }
+                local[k] = static_cast<uint32_t>(localIndex[v]);
+            }
+            out.primitives.push_back(PackTriangle(local[0], local[1], local[2]));
+            current.primitiveNum++;
+        };
+
+        reset();
+        size_t seed = 0;
+        constexpr size_t npos = static_cast<size_t>(-1);
+        while (true) {
+            // the neighbour adding the fewest vertices,
+            // ties to the one closest to the meshlet centroid (round meshlets), then the lowest triangle
+            size_t best = npos;
+            uint32_t bestNew = 4;
+            float bestDistance = 0.f;
+            if (current.primitiveNum < config.maxTriangles) {
+                Vec3 centroid = positionSum * (1.f / current.vertexNum);
+                for (uint32_t v : currentVertices) {
+                    for (uint32_t i = adjOffsets[v]; i < adjOffsets[v + 1]; i++) {
+                        uint32_t t = adj[i];
+                        if (used[t])
+                            continue;
+                        uint32_t n = newVertexNum(t);
+                        if (current.vertexNum + n > config.maxVertices)
+                            continue;
+                        if (n > bestNew)
+                            continue;
+                        Vec3 triCentroid = (LoadPosition(positions, stride, indices[3 * t])
+                            + LoadPosition(positions, stride, indices[3 * t + 1])
+                            + LoadPosition(positions, stride, indices[3 * t + 2])) * (1.f / 3.f);
+                        float distance = Dot(triCentroid - centroid, triCentroid - centroid);
+                        if (n < bestNew || distance < bestDistance || (distance == bestDistance && t < best)) {
+                            best = t;
+                            bestNew = n;
+                            bestDistance = distance;
+                        }
+                    }
+                }
+            }
+
+            if (best == npos) {
+                // full or no connected triangle fits, seed a new meshlet
+                flush();
+                while (seed < triNum && used[seed])
+                    seed++;
+                if (seed == triNum)
+                    break;
+                best = seed;
+            }
+            add(best);
+        }
+    }
+}
+
+MeshletMesh Meshlets::Build(const uint32_t* indices, size_t indexNum,
+    const void* positions, size_t vertexNum, size_t positionStride, const Config& config)
+{
+    assert(indexNum % 3 == 0);
+    assert(config.maxVertices >= 3 && config.maxVertices <= 1024);
+    assert(config.maxTriangles >= 1 && config.chunkTriangleNum >= 1);
+#ifndef NDEBUG
+    for (size_t i = 0; i < indexNum; i++)
+        assert(indices[i] < vertexNum);
+#else
+    (void)vertexNum;
+#endif
+
+    size_t triNum = indexNum / 3;
+    size_t chunkNum = (triNum + config.chunkTriangleNum - 1) / config.chunkTriangleNum;
+    vector<ChunkResult> chunks(chunkNum);
+
+    atomic<size_t> nextChunk{ 0 };
+    auto worker = [&]() {
+        for (size_t c = nextChunk++; c < chunkNum; c = nextChunk++) {
+            size_t begin = c * config.chunkTriangleNum;
+            size_t num = min<size_t>(config.chunkTriangleNum, triNum - begin);
+            BuildChunk(indices + begin * 3, num, static_cast<const uint8_t*>(positions), positionStride,
+                config, chunks[c]);
+        }
+    };
+
+    size_t threadNum = config.threadNum != 0 ? config.threadNum : max(1u, thread::hardware_concurrency());
+    threadNum = max<size_t>(1, min(threadNum, chunkNum));
+    vector<thread> threads;
+    threads.reserve(threadNum - 1);
+    for (size_t i = 1; i < threadNum; i++)
+        threads.emplace_back(worker);
+    worker();
+    for (auto& t : threads)
+        t.join();
+
+    // concatenate in chunk order
+    MeshletMesh mesh;
+    size_t meshletNum = 0, vertexTotal = 0, primitiveTotal = 0;
+    for (const auto& chunk : chunks) {
+        meshletNum += chunk.meshlets.size();
+        vertexTotal += chunk.vertices.size();
+        primitiveTotal += chunk.primitives.size();
+    }
+    mesh.meshlets.reserve(meshletNum);
+    mesh.bounds.reserve(meshletNum);
+    mesh.vertices.reserve(vertexTotal);
+    mesh.primitives.reserve(primitiveTotal);
+    for (const auto& chunk : chunks) {
+        auto vertexBase = static_cast<uint32_t>(mesh.vertices.size());
+        auto primitiveBase = static_cast<uint32_t>(mesh.primitives.size());
+        for (auto meshlet : chunk.meshlets) {
+            meshlet.vertexOffset += vertexBase;
+            meshlet.primitiveOffset += primitiveBase;
+            mesh.meshlets.push_back(meshlet);
+        }
+        mesh.bounds.insert(mesh.bounds.end(), chunk.bounds.begin(), chunk.bounds.end());
+        mesh.vertices.insert(mesh.vertices.end(), chunk.vertices.begin(), chunk.vertices.end());
+        mesh.primitives.insert(mesh.primitives.end(), chunk.primitives.begin(), chunk.primitives.end());
+    }
+
+    return mesh;
+}
+
+void Meshlets::UnpackIndices(const MeshletMesh& mesh, uint32_t* dst) {
+    for (const auto& meshlet : mesh.meshlets) {
+        const uint32_t* vertices = mesh.vertices.data() + meshlet.vertexOffset;
+        for (uint32_t i = 0; i < meshlet.primitiveNum; i++) {
+            uint32_t i0, i1, i2;
+            UnpackTriangle(mesh.primitives[meshlet.primitiveOffset + i], i0, i1, i2);
+            *dst++ = vertices[i0];
+            *dst++ = vertices[i1];
+            *dst++ = vertices[i2];
+        }
+    }
+}
+
+void Meshlets::ExtractFrustumPlanes(const float m[16], float planes[6][4]) {
+    // clip = p * m, column j of m gives clip component j
+    auto column = [&](size_t j, size_t i) { return m[i * 4 + j]; };
+    for (size_t i = 0; i < 4; i++) {
+        planes[0][i] = column(3, i) + column(0, i); // left:   x >= -w
+        planes[1][i] = column(3, i) - column(0, i); // right:  x <= w
+        planes[2][i] = column(3, i) + column(1, i); // bottom: y >= -w
+        planes[3][i] = column(3, i) - column(1, i); // top:    y <= w
+        planes[4][i] = column(2, i);                // near:   z >= 0
+        planes[5][i] = column(3, i) - column(2, i); // far:    z <= w
+    }
+    for (size_t p = 0; p < 6; p++) {
+        float len = sqrtf(planes[p][0] * planes[p][0] + planes[p][1] * planes[p][1] + planes[p][2] * planes[p][2]);
+        if (len > 0.f) {
+            for (size_t i = 0; i < 4; i++)
+                planes[p][i] /= len;
+        }
+    }
+}
+
+CullStats Meshlets::Cull(const MeshletMesh& mesh, const float planes[6][4], const float eye[3],
+    vector<uint32_t>& visible)
+{
+    visible.clear();
+    CullStats stats;
+    stats.meshletNum = mesh.meshlets.size();
+    Vec3 eyePos{ eye[0], eye[1], eye[2] };
+    for (size_t i = 0; i < mesh.meshlets.size(); i++) {
+        const Bounds& bounds = mesh.bounds[i];
+        Vec3 center{ bounds.center[0], bounds.center[1], bounds.center[2] };
+
+        bool outside = false;
+        for (size_t p = 0; p < 6 && !outside; p++) {
+            float d = planes[p][0] * center.x + planes[p][1] * center.y + planes[p][2] * center.z + planes[p][3];
+            outside = d < -bounds.radius;
+        }
+        if (outside) {
+            stats.frustumCulledNum++;
+            continue;
+        }
+
+        Vec3 view = center - eyePos;
+        Vec3 axis{ bounds.coneAxis[0], bounds.coneAxis[1], bounds.coneAxis[2] };
+        if (Dot(view, axis) >= bounds.coneCutoff * Length(view) + bounds.radius) {
+            stats.backfaceCulledNum++;
+            continue;
+        }
+
+        visible.push_back(static_cast<uint32_t>(i));
+        stats.visibleTriangleNum += mesh.meshlets[i].primitiveNum;
+    }
+    return stats;
+}
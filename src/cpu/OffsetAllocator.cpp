@@ -0,0 +1,237 @@
+#include <UDXRenderer/OffsetAllocator.h>
+
+#include <algorithm>
+#include <cassert>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+using namespace Ubpa;
+using namespace std;
+
+namespace {
+    // v != 0
+    uint32_t LowestBit(uint32_t v) noexcept {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward(&index, v);
+        return index;
+#else
+        return static_cast<uint32_t>(__builtin_ctz(v));
+#endif
+    }
+
+    // v != 0
+    uint32_t HighestBit(uint32_t v) noexcept {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanReverse(&index, v);
+        return index;
+#else
+        return 31 - static_cast<uint32_t>(__builtin_clz(v));
+#endif
+    }
+}
+
+// sizes < SLNum map to themselves, larger ones to (exponent, 3-bit mantissa)
+uint32_t OffsetAllocator::SizeToBinRoundDown(uint32_t size) noexcept {
+    if (size < SLNum)
+        return size;
+    uint32_t h = HighestBit(size);
+    uint32_t exponent = h - SLBits + 1;
+    uint32_t mantissa = (size >> (h - SLBits)) & (SLNum - 1);
+    return (exponent << SLBits) | mantissa;
+}
+
+uint32_t OffsetAllocator::SizeToBinRoundUp(uint32_t size) noexcept {
+    uint32_t bin = SizeToBinRoundDown(size);
+    if (size >= SLNum) {
+        uint32_t lowBits = size & ((1u << (HighestBit(size) - SLBits)) - 1);
+        if (lowBits != 0)
+            bin++;
+    }
+    return bin;
+}
+
+uint32_t OffsetAllocator::BinToSize(uint32_t bin) noexcept {
+    uint32_t exponent = bin >> SLBits;
+    uint32_t mantissa = bin & (SLNum - 1);
+    if (exponent == 0)
+        return mantissa;
+    return (SLNum | mantissa) << (exponent - 1);
+}
+
+OffsetAllocator::OffsetAllocator(uint32_t size)
+    : size{ size }, freeNum{ size }
+{
+    fill(begin(binHeads), end(binHeads), Null);
+    if (size == 0)
+        return;
+
+    uint32_t node = NewNode();
+    nodes[node].offset = 0;
+    nodes[node].size = size;
+    LinkFree(node);
+}
+
+uint32_t OffsetAllocator::NewNode() {
+    if (!freeNodes.empty()) {
+        uint32_t node = freeNodes.back();
+        freeNodes.pop_back();
+        nodes[node] = Node{};
+        return node;
+    }
+    nodes.emplace_back();
+    return static_cast<uint32_t>(nodes.size() - 1);
+}
+
+void OffsetAllocator::LinkFree(uint32_t node) {
+    Node& n = nodes[node];
+    uint32_t bin = SizeToBinRoundDown(n.size);
+    n.used = false;
+    n.binPrev = Null;
+    n.binNext = binHeads[bin];
+    if (n.binNext != Null)
+        nodes[n.binNext].binPrev = node;
+    binHeads[bin] = node;
+
+    flBitmap |= 1u << (bin >> SLBits);
+    slBitmaps[bin >> SLBits] |= static_cast<uint8_t>(1u << (bin & (SLNum - 1)));
+}
+
+void OffsetAllocator::UnlinkFree(uint32_t node) {
+    Node& n = nodes[node];
+    uint32_t bin = SizeToBinRoundDown(n.size);
+    if (n.binPrev != Null)
+        nodes[n.binPrev].binNext = n.binNext;
+    else
+        binHeads[bin] = n.binNext;
+    if (n.binNext != Null)
+        nodes[n.binNext].binPrev = n.binPrev;
+
+    if (binHeads[bin] == Null) {
+        slBitmaps[bin >> SLBits] &= static_cast<uint8_t>(~(1u << (bin & (SLNum - 1))));
+        if (slBitmaps[bin >> SLBits] == 0)
+            flBitmap &= ~(1u << (bin >> SLBits));
+    }
+}
+
+uint32_t OffsetAllocator::FindBin(uint32_t minBin) const noexcept {
+    uint32_t fl = minBin >> SLBits;
+    uint32_t sl = minBin & (SLNum - 1);
+
+    uint32_t slMask = slBitmaps[fl] & (~0u << sl);
+    if (slMask != 0)
+        return (fl << SLBits) | LowestBit(slMask);
+
+    uint32_t flMask = fl + 1 < FLNum ? flBitmap & (~0u << (fl + 1)) : 0;
+    if (flMask == 0)
+        return Null;
+
+    fl = LowestBit(flMask);
+    return (fl << SLBits) | LowestBit(slBitmaps[fl]);
+}
+
+OffsetAllocator::Allocation OffsetAllocator::Allocate(uint32_t num) {
+    Allocation rst;
+    if (num == 0 || num > freeNum)
+        return rst;
+
+    // every range in the rounded-up bin fits, no list search
+    uint32_t node = Null;
+    uint32_t bin = FindBin(SizeToBinRoundUp(num));
+    if (bin != Null)
+        node = binHeads[bin];
+    else {
+        // last resort, ranges of num's own bin may still fit
+        for (uint32_t n = binHeads[SizeToBinRoundDown(num)]; n != Null; n = nodes[n].binNext) {
+            if (nodes[n].size >= num) {
+                node = n;
+                break;
+            }
+        }
+        if (node == Null)
+            return rst;
+    }
+    UnlinkFree(node);
+
+    if (nodes[node].size > num) {
+        // split, the remainder stays free
+        uint32_t remainder = NewNode(); // may reallocate nodes
+        Node& n = nodes[node];
+        Node& r = nodes[remainder];
+        r.offset = n.offset + num;
+        r.size = n.size - num;
+        r.prev = node;
+        r.next = n.next;
+        if (n.next != Null)
+            nodes[n.next].prev = remainder;
+        n.next = remainder;
+        n.size = num;
+        LinkFree(remainder);
+    }
+
+    nodes[node].used = true;
+    freeNum -= num;
+    allocationNum++;
+
+    rst.offset = nodes[node].offset;
+    rst.node = node;
+    return rst;
+}
+
+void OffsetAllocator::Free(const Allocation& allocation) {
+    if (allocation.IsNull())
+        return;
+
+    uint32_t node = allocation.node;
+    assert(node < nodes.size() && nodes[node].used && nodes[node].offset == allocation.offset);
+
+    freeNum += nodes[node].size;
+    allocationNum--;
+
+    // merge with the previous free range
+    uint32_t prev = nodes[node].prev;
+    if (prev != Null && !nodes[prev].used) {
+        UnlinkFree(prev);
+        nodes[prev].size += nodes[node].size;
+        nodes[prev].next = nodes[node].next;
+        if (nodes[node].next != Null)
+            nodes[nodes[node].next].prev = prev;
+        freeNodes.push_back(node);
+        node = prev;
+    }
+
+    // merge with the next free range
+    uint32_t next = nodes[node].next;
+    if (next != Null && !nodes[next].used) {
+        UnlinkFree(next);
+        nodes[node].size += nodes[next].size;
+        nodes[node].next = nodes[next].next;
+        if (nodes[next].next != Null)
+            nodes[nodes[next].next].prev = node;
+        freeNodes.push_back(next);
+    }
+
+    LinkFree(node);
+}
+
+uint32_t OffsetAllocator::GetSize(const Allocation& allocation) const {
+    assert(!allocation.IsNull());
+    return nodes[allocation.node].size;
+}
+
+OffsetAllocator::Stats OffsetAllocator::GetStats() const {
+    Stats stats;
+    stats.size = size;
+    stats.freeNum = freeNum;
+    stats.allocationNum = allocationNum;
+    for (uint32_t bin = 0; bin < BinNum; bin++) {
+        for (uint32_t node = binHeads[bin]; node != Null; node = nodes[node].binNext) {
+            stats.freeRangeNum++;
+            stats.largestFreeRange = max(stats.largestFreeRange, nodes[node].size);
+        }
+    }
+    return stats;
+}
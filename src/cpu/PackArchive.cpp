@@ -0,0 +1,458 @@
+#include <UDXRenderer/PackArchive.h>
+
+#include <UDXRenderer/LZCodec.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <limits>
+#include <numeric>
+
+using namespace Ubpa;
+using namespace std;
+
+static_assert(sizeof(PackArchive::Header) == 40);
+static_assert(sizeof(PackArchive::Entry) == 56);
+static_assert(sizeof(PackArchive::Block) == 8);
+
+// staging buffers of Config::stagingSize bytes, larger requests get a buffer that isn't pooled
+class PackArchive::BufferPool {
+public:
+    explicit BufferPool(size_t stagingSize) : stagingSize{ stagingSize } {}
+
+    class Lease {
+    public:
+        Lease(BufferPool& pool, unique_ptr<vector<uint8_t>> buffer) : pool{ pool }, buffer{ move(buffer) } {}
+        ~Lease() { pool.Release(move(buffer)); }
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+
+        uint8_t* Data() noexcept { return buffer->data(); }
+
+    private:
+        BufferPool& pool;
+        unique_ptr<vector<uint8_t>> buffer;
+    };
+
+    Lease Acquire(size_t size) {
+        if (size > stagingSize)
+            return { *this, make_unique<vector<uint8_t>>(size) };
+
+        lock_guard<mutex> lock(poolMutex);
+        if (freeBuffers.empty())
+            return { *this, make_unique<vector<uint8_t>>(stagingSize) };
+        auto buffer = move(freeBuffers.back());
+        freeBuffers.pop_back();
+        return { *this, move(buffer) };
+    }
+
+private:
+    void Release(unique_ptr<vector<uint8_t>> buffer) {
+        if (buffer->size() != stagingSize)
+            return;
+        lock_guard<mutex> lock(poolMutex);
+        freeBuffers.push_back(move(buffer));
+    }
+
+    const size_t stagingSize;
+    mutex poolMutex;
+    vector<unique_ptr<vector<uint8_t>>> freeBuffers;
+};
+
+string PackArchive::NormalizePath(string_view path) {
+    vector<string> segments;
+    size_t begin = 0;
+    while (begin <= path.size()) {
+        size_t end = path.find_first_of("/\\", begin);
+        if (end == string_view::npos)
+            end = path.size();
+        string_view segment = path.substr(begin, end - begin);
+        if (segment == "..") {
+            if (!segments.empty())
+                segments.pop_back();
+        }
+        else if (!segment.empty() && segment != ".") {
+            string s(segment);
+            for (auto& c : s) {
+                if (c >= 'A' && c <= 'Z')
+                    c = static_cast<char>(c - 'A' + 'a');
+            }
+            segments.push_back(move(s));
+        }
+        begin = end + 1;
+    }
+
+    string rst;
+    for (const auto& segment : segments) {
+        if (!rst.empty())
+            rst += '/';
+        rst += segment;
+    }
+    return rst;
+}
+
+uint64_t PackArchive::HashPath(string_view normalizedPath) noexcept {
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : normalizedPath) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+PackArchive::PackArchive() = default;
+
+PackArchive::PackArchive(Config config) : config{ config } {}
+
+PackArchive::~PackArchive() = default;
+
+bool PackArchive::Open(const filesystem::path& path) {
+    Close();
+
+    file.open(path, ios::binary);
+    if (!file)
+        return false;
+
+    file.seekg(0, ios::end);
+    const uint64_t fileSize = static_cast<uint64_t>(file.tellg());
+    Header h;
+    if (fileSize < sizeof(Header) || !ReadFile(0, &h, sizeof(Header))
+        || h.magic != Magic || h.version != Version || h.blockSize == 0
+        || h.tocOffset < sizeof(Header) || h.tocOffset > fileSize || h.tocSize > fileSize - h.tocOffset
+        || h.tocSize != uint64_t{ h.entryNum } * sizeof(Entry) + uint64_t{ h.blockNum } * sizeof(Block) + h.nameSize)
+    {
+        Close();
+        return false;
+    }
+
+    // the whole TOC in one read
+    vector<uint8_t> toc(h.tocSize);
+    if (!ReadFile(h.tocOffset, toc.data(), toc.size())) {
+        Close();
+        return false;
+    }
+    entries.resize(h.entryNum);
+    blocks.resize(h.blockNum);
+    memcpy(entries.data(), toc.data(), entries.size() * sizeof(Entry));
+    memcpy(blocks.data(), toc.data() + entries.size() * sizeof(Entry), blocks.size() * sizeof(Block));
+    names.assign(reinterpret_cast<const char*>(toc.data()) + entries.size() * sizeof(Entry) + blocks.size() * sizeof(Block),
+        h.nameSize);
+    header = h;
+
+    // ranges, block tables and the order Find relies on
+    for (size_t i = 0; i < entries.size(); i++) {
+        const auto& e = entries[i];
+        bool valid = e.dataOffset >= sizeof(Header) && e.dataOffset <= h.tocOffset
+            && e.storedSize <= h.tocOffset - e.dataOffset
+            && e.nameOffset <= h.nameSize && e.nameLength <= h.nameSize - e.nameOffset
+            && (i == 0 || entries[i - 1].hash < e.hash
+                || (entries[i - 1].hash == e.hash && GetName(static_cast<uint32_t>(i - 1)) < GetName(static_cast<uint32_t>(i))));
+        if (e.codec == Codec::None)
+            valid = valid && e.storedSize == e.size && e.blockNum == 0;
+        else if (e.codec == Codec::LZ) {
+            valid = valid && e.blockNum == (e.size + h.blockSize - 1) / h.blockSize
+                && e.blockOffset <= h.blockNum && e.blockNum <= h.blockNum - e.blockOffset;
+            uint64_t storedEnd = 0;
+            for (uint32_t b = 0; valid && b < e.blockNum; b++) {
+                const auto& block = blocks[e.blockOffset + b];
+                valid = block.storedOffset == storedEnd && block.storedSize <= BlockRawSize(e, b);
+                storedEnd += block.storedSize;
+            }
+            valid = valid && storedEnd == e.storedSize;
+        }
+        else
+            valid = false;
+
+        if (!valid) {
+            Close();
+            return false;
+        }
+    }
+
+    bufferPool = make_unique<BufferPool>(config.stagingSize);
+    return true;
+}
+
+void PackArchive::Close() {
+    lock_guard<mutex> lock(fileMutex);
+    file.close();
+    file.clear();
+    header = {};
+    entries.clear();
+    blocks.clear();
+    names.clear();
+    readNum = 0;
+    readBytes = 0;
+    decodedBytes = 0;
+    bufferPool.reset();
+}
+
+string_view PackArchive::GetName(uint32_t entry) const noexcept {
+    return string_view(names).substr(entries[entry].nameOffset, entries[entry].nameLength);
+}
+
+uint32_t PackArchive::Find(string_view path) const {
+    string name = NormalizePath(path);
+    uint64_t hash = HashPath(name);
+    auto target = lower_bound(entries.begin(), entries.end(), hash,
+        [](const Entry& e, uint64_t hash) { return e.hash < hash; });
+    for (; target != entries.end() && target->hash == hash; ++target) {
+        uint32_t entry = static_cast<uint32_t>(target - entries.begin());
+        if (GetName(entry) == name)
+            return entry;
+    }
+    return InvalidEntry;
+}
+
+size_t PackArchive::BlockRawSize(const Entry& entry, uint32_t block) const noexcept {
+    uint64_t begin = uint64_t{ block } * header.blockSize;
+    return static_cast<size_t>(min<uint64_t>(header.blockSize, entry.size - begin));
+}
+
+bool PackArchive::ReadFile(uint64_t offset, void* dst, size_t size) const {
+    if (size == 0)
+        return true;
+    lock_guard<mutex> lock(fileMutex);
+    file.clear();
+    file.seekg(static_cast<streamoff>(offset));
+    file.read(static_cast<char*>(dst), static_cast<streamsize>(size));
+    readNum.fetch_add(1, memory_order_relaxed);
+    readBytes.fetch_add(size, memory_order_relaxed);
+    return file.gcount() == static_cast<streamsize>(size);
+}
+
+bool PackArchive::Decode(const Entry& entry, const uint8_t* stored, uint32_t firstBlock,
+    uint32_t lastBlock, uint8_t* dst) const
+{
+    const Block* entryBlocks = blocks.data() + entry.blockOffset;
+    const uint32_t base = entryBlocks[firstBlock].storedOffset;
+    size_t decoded = 0;
+    for (uint32_t b = firstBlock; b <= lastBlock; b++) {
+        const auto& block = entryBlocks[b];
+        size_t rawSize = BlockRawSize(entry, b);
+        const uint8_t* src = stored + (block.storedOffset - base);
+        if (block.storedSize == rawSize)
+            memcpy(dst, src, rawSize);
+        else if (LZCodec::Decompress(src, block.storedSize, dst, rawSize) != rawSize)
+            return false;
+        dst += rawSize;
+        decoded += rawSize;
+    }
+    decodedBytes.fetch_add(decoded, memory_order_relaxed);
+    return true;
+}
+
+bool PackArchive::Read(uint32_t entry, void* dst) const {
+    ReadRequest request{ entry, dst };
+    return ReadBatch(&request, 1);
+}
+
+bool PackArchive::Read(uint32_t entry, vector<uint8_t>& dst) const {
+    if (entry >= entries.size())
+        return false;
+    dst.resize(static_cast<size_t>(entries[entry].size));
+    return Read(entry, dst.data());
+}
+
+bool PackArchive::ReadRange(uint32_t entry, uint64_t offset, size_t size, void* dst) const {
+    if (entry >= entries.size())
+        return false;
+    const auto& e = entries[entry];
+    if (offset > e.size || size > e.size - offset)
+        return false;
+    if (size == 0)
+        return true;
+
+    if (e.codec == Codec::None)
+        return ReadFile(e.dataOffset + offset, dst, size);
+
+    auto firstBlock = static_cast<uint32_t>(offset / header.blockSize);
+    auto lastBlock = static_cast<uint32_t>((offset + size - 1) / header.blockSize);
+    const Block& first = blocks[e.blockOffset + firstBlock];
+    const Block& last = blocks[e.blockOffset + lastBlock];
+    size_t storedSize = last.storedOffset + last.storedSize - first.storedOffset;
+
+    auto stored = bufferPool->Acquire(storedSize);
+    if (!ReadFile(e.dataOffset + first.storedOffset, stored.Data(), storedSize))
+        return false;
+
+    uint64_t rawBegin = uint64_t{ firstBlock } * header.blockSize;
+    size_t rawSize = static_cast<size_t>(min<uint64_t>(uint64_t{ lastBlock + 1 } * header.blockSize, e.size) - rawBegin);
+    if (rawBegin == offset && rawSize == size)
+        return Decode(e, stored.Data(), firstBlock, lastBlock, static_cast<uint8_t*>(dst));
+
+    auto raw = bufferPool->Acquire(rawSize);
+    if (!Decode(e, stored.Data(), firstBlock, lastBlock, raw.Data()))
+        return false;
+    memcpy(dst, raw.Data() + (offset - rawBegin), size);
+    return true;
+}
+
+bool PackArchive::ReadBatch(ReadRequest* requests, size_t num) const {
+    vector<size_t> order;
+    order.reserve(num);
+    for (size_t i = 0; i < num; i++) {
+        requests[i].succeeded = false;
+        if (requests[i].entry < entries.size())
+            order.push_back(i);
+    }
+    sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return entries[requests[a].entry].dataOffset < entries[requests[b].entry].dataOffset;
+    });
+
+    for (size_t i = 0; i < order.size();) {
+        // neighbours within maxGap share one read
+        const auto& firstEntry = entries[requests[order[i]].entry];
+        const uint64_t begin = firstEntry.dataOffset;
+        uint64_t end = begin + firstEntry.storedSize;
+        size_t j = i + 1;
+        for (; j < order.size(); j++) {
+            const auto& e = entries[requests[order[j]].entry];
+            uint64_t newEnd = max(end, e.dataOffset + e.storedSize);
+            if (e.dataOffset > end + config.maxGap || newEnd - begin > config.stagingSize)
+                break;
+            end = newEnd;
+        }
+
+        auto stored = bufferPool->Acquire(static_cast<size_t>(end - begin));
+        if (ReadFile(begin, stored.Data(), static_cast<size_t>(end - begin))) {
+            for (size_t k = i; k < j; k++) {
+                auto& request = requests[order[k]];
+                const auto& e = entries[request.entry];
+                const uint8_t* src = stored.Data() + (e.dataOffset - begin);
+                if (e.codec == Codec::None) {
+                    if (e.size != 0)
+                        memcpy(request.dst, src, static_cast<size_t>(e.size));
+                    request.succeeded = true;
+                }
+                else {
+                    request.succeeded = e.blockNum == 0
+                        || Decode(e, src, 0, e.blockNum - 1, static_cast<uint8_t*>(request.dst));
+                }
+            }
+        }
+        i = j;
+    }
+
+    return all_of(requests, requests + num, [](const ReadRequest& r) { return r.succeeded; });
+}
+
+PackArchive::Stats PackArchive::GetStats() const {
+    Stats stats;
+    stats.readNum = readNum.load(memory_order_relaxed);
+    stats.readBytes = readBytes.load(memory_order_relaxed);
+    stats.decodedBytes = decodedBytes.load(memory_order_relaxed);
+    return stats;
+}
+
+PackWriter::~PackWriter() = default;
+
+bool PackWriter::Open(const filesystem::path& path, uint32_t blockSize) {
+    assert(blockSize > 0);
+    this->blockSize = blockSize;
+    entries.clear();
+    entryBlocks.clear();
+    entryNames.clear();
+
+    file.open(path, ios::binary | ios::trunc);
+    PackArchive::Header placeholder{};
+    file.write(reinterpret_cast<const char*>(&placeholder), sizeof(placeholder));
+    offset = sizeof(placeholder);
+    return static_cast<bool>(file);
+}
+
+bool PackWriter::Add(string_view path, const void* data, size_t size, PackArchive::Codec codec) {
+    string name = PackArchive::NormalizePath(path);
+    if (!file || find(entryNames.begin(), entryNames.end(), name) != entryNames.end())
+        return false;
+
+    PackArchive::Entry entry{};
+    entry.hash = PackArchive::HashPath(name);
+    entry.dataOffset = offset;
+    entry.size = size;
+    entry.codec = codec;
+
+    vector<PackArchive::Block> blocks;
+    auto bytes = static_cast<const uint8_t*>(data);
+    if (codec == PackArchive::Codec::LZ) {
+        bool compressed = false;
+        for (size_t begin = 0; begin < size; begin += blockSize) {
+            size_t rawSize = min<size_t>(blockSize, size - begin);
+            scratch.resize(LZCodec::CompressBound(rawSize));
+            size_t storedSize = LZCodec::Compress(bytes + begin, rawSize, scratch.data(), scratch.size());
+            if (storedSize == 0 || storedSize >= rawSize) {
+                storedSize = rawSize;
+                file.write(reinterpret_cast<const char*>(bytes + begin), static_cast<streamsize>(rawSize));
+            }
+            else {
+                compressed = true;
+                file.write(reinterpret_cast<const char*>(scratch.data()), static_cast<streamsize>(storedSize));
+            }
+            if (entry.storedSize > numeric_limits<uint32_t>::max())
+                return false; // block offsets are 32-bit
+            blocks.push_back({ static_cast<uint32_t>(entry.storedSize), static_cast<uint32_t>(storedSize) });
+            entry.storedSize += storedSize;
+        }
+        // nothing shrank, read it without the block table
+        if (!compressed) {
+            entry.codec = PackArchive::Codec::None;
+            blocks.clear();
+        }
+    }
+    else {
+        file.write(static_cast<const char*>(data), static_cast<streamsize>(size));
+        entry.storedSize = size;
+    }
+    entry.blockNum = static_cast<uint32_t>(blocks.size());
+    offset += entry.storedSize;
+
+    entries.push_back(entry);
+    entryBlocks.push_back(move(blocks));
+    entryNames.push_back(move(name));
+    return static_cast<bool>(file);
+}
+
+bool PackWriter::Finish() {
+    if (!file)
+        return false;
+
+    vector<size_t> order(entries.size());
+    iota(order.begin(), order.end(), size_t{ 0 });
+    sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return entries[a].hash < entries[b].hash
+            || (entries[a].hash == entries[b].hash && entryNames[a] < entryNames[b]);
+    });
+
+    vector<PackArchive::Entry> tocEntries;
+    vector<PackArchive::Block> tocBlocks;
+    string tocNames;
+    for (size_t i : order) {
+        auto entry = entries[i];
+        entry.blockOffset = static_cast<uint32_t>(tocBlocks.size());
+        entry.nameOffset = static_cast<uint32_t>(tocNames.size());
+        entry.nameLength = static_cast<uint32_t>(entryNames[i].size());
+        tocEntries.push_back(entry);
+        tocBlocks.insert(tocBlocks.end(), entryBlocks[i].begin(), entryBlocks[i].end());
+        tocNames += entryNames[i];
+    }
+
+    PackArchive::Header header{};
+    header.magic = PackArchive::Magic;
+    header.version = PackArchive::Version;
+    header.entryNum = static_cast<uint32_t>(tocEntries.size());
+    header.blockSize = blockSize;
+    header.tocOffset = offset;
+    header.blockNum = static_cast<uint32_t>(tocBlocks.size());
+    header.nameSize = static_cast<uint32_t>(tocNames.size());
+    header.tocSize = tocEntries.size() * sizeof(PackArchive::Entry)
+        + tocBlocks.size() * sizeof(PackArchive::Block) + tocNames.size();
+
+    file.write(reinterpret_cast<const char*>(tocEntries.data()), tocEntries.size() * sizeof(PackArchive::Entry));
+    file.write(reinterpret_cast<const char*>(tocBlocks.data()), tocBlocks.size() * sizeof(PackArchive::Block));
+    file.write(tocNames.data(), static_cast<streamsize>(tocNames.size()));
+    file.seekp(0);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    bool succeeded = static_cast<bool>(file);
+    file.close();
+    return succeeded;
+}
@@ -0,0 +1,203 @@
+#include <UDXRenderer/Profiler.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+
+using namespace Ubpa;
+using namespace std;
+
+namespace {
+    struct ThreadCache {
+        void* buffer{ nullptr };
+        uint64_t epoch{ 0 };
+    };
+    thread_local ThreadCache threadCache;
+
+    void WriteEscaped(ostream& os, const char* str) {
+        for (; *str; ++str) {
+            switch (*str) {
+            case '"': os << "\\\""; break;
+            case '\\': os << "\\\\"; break;
+            default: os << *str; break;
+            }
+        }
+    }
+}
+
+Profiler::Profiler() : frameBegins{ new int64_t[FrameCapacity] } {}
+
+Profiler::~Profiler() = default;
+
+int64_t Profiler::Now() noexcept {
+    return chrono::duration_cast<chrono::nanoseconds>(
+        chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+Profiler::ThreadBuffer* Profiler::GetThreadBuffer() noexcept {
+    uint64_t curEpoch = epoch.load(memory_order_acquire);
+    if (threadCache.buffer && threadCache.epoch == curEpoch)
+        return reinterpret_cast<ThreadBuffer*>(threadCache.buffer);
+
+    // the only allocation of a thread, Push never allocates
+    // on failure the zone is dropped and the next one tries again
+    try {
+        auto buffer = make_unique<ThreadBuffer>();
+        buffer->events.reset(new Event[EventCapacity]);
+
+        lock_guard<mutex> lock(threadsMutex);
+        buffer->tid = static_cast<uint32_t>(threads.size());
+        threads.push_back(move(buffer));
+        threadCache.buffer = threads.back().get();
+        threadCache.epoch = curEpoch;
+        return threads.back().get();
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
+
+void Profiler::Push(ThreadBuffer* buffer, const char* name) noexcept {
+    if (!buffer)
+        return;
+    size_t num = buffer->num.load(memory_order_relaxed);
+    // the previous num is visible before this slot changes, so a reader that sees the new
+    // contents also sees that at most slot num is being written
+    atomic_thread_fence(memory_order_release);
+    Event& e = buffer->events[num % EventCapacity];
+    e.name.store(name, memory_order_relaxed);
+    e.ns.store(Now(), memory_order_relaxed);
+    buffer->num.store(num + 1, memory_order_release);
+}
+
+void Profiler::BeginZone(const char* name) noexcept {
+    Push(GetThreadBuffer(), name);
+}
+
+void Profiler::EndZone() noexcept {
+    Push(GetThreadBuffer(), nullptr);
+}
+
+void Profiler::MarkFrame() noexcept {
+    int64_t t = Now();
+    lock_guard<mutex> lock(framesMutex);
+    frameBegins[markNum % FrameCapacity] = t;
+    markNum++;
+    frameNum.store(markNum + 1, memory_order_release);
+}
+
+size_t Profiler::GetFrameNum() const noexcept {
+    return frameNum.load(memory_order_acquire);
+}
+
+void Profiler::Clear() {
+    lock_guard<mutex> threadsLock(threadsMutex);
+    lock_guard<mutex> framesLock(framesMutex);
+
+    threads.clear();
+    markNum = 0;
+    frameNum.store(0, memory_order_release);
+    epoch.fetch_add(1, memory_order_acq_rel);
+}
+
+void Profiler::WriteChromeTrace(ostream& os, size_t firstFrame, size_t count) const {
+    int64_t begin, end;
+    vector<int64_t> marks;
+    {
+        lock_guard<mutex> lock(framesMutex);
+        size_t oldestMark = markNum > FrameCapacity ? markNum - FrameCapacity : 0;
+        // frame k starts at mark k - 1, frame 0 and frames whose mark was overwritten at the beginning of time
+        auto frameStart = [&](size_t k) {
+            if (k == 0 || k - 1 < oldestMark)
+                return numeric_limits<int64_t>::min();
+            if (k - 1 < markNum)
+                return frameBegins[(k - 1) % FrameCapacity];
+            return numeric_limits<int64_t>::max();
+        };
+        begin = frameStart(firstFrame);
+        end = count > markNum + 1 ? numeric_limits<int64_t>::max() : frameStart(firstFrame + count);
+        for (size_t i = oldestMark; i < markNum; i++) {
+            int64_t t = frameBegins[i % FrameCapacity];
+            if (t >= begin && t < end)
+                marks.push_back(t);
+        }
+    }
+
+    // timestamps are in microseconds, keep nanosecond resolution
+    auto flags = os.flags();
+    auto precision = os.precision();
+    os << fixed << setprecision(3);
+
+    os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    auto sep = [&]() -> ostream& {
+        os << (first ? "\n" : ",\n");
+        first = false;
+        return os;
+    };
+
+    for (size_t i = 0; i < marks.size(); i++) {
+        sep() << "{\"name\":\"Frame\",\"ph\":\"i\",\"s\":\"g\",\"pid\":0,\"tid\":0,\"ts\":"
+            << marks[i] / 1000. << '}';
+    }
+
+    lock_guard<mutex> lock(threadsMutex);
+    for (const auto& buffer : threads) {
+        sep() << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << buffer->tid
+            << ",\"args\":{\"name\":\"Thread " << buffer->tid << "\"}}";
+
+        // copy the ring, then drop the slots the thread may have overwritten meanwhile
+        size_t num = buffer->num.load(memory_order_acquire);
+        size_t oldest = num > EventCapacity ? num - EventCapacity : 0;
+        vector<pair<const char*, int64_t>> events;
+        events.reserve(num - oldest);
+        for (size_t i = oldest; i < num; i++) {
+            const Event& e = buffer->events[i % EventCapacity];
+            events.emplace_back(e.name.load(memory_order_relaxed), e.ns.load(memory_order_relaxed));
+        }
+        atomic_thread_fence(memory_order_acquire);
+        // slot numAfter may be in the middle of a write
+        size_t numAfter = buffer->num.load(memory_order_relaxed);
+        size_t valid = numAfter + 1 > EventCapacity ? numAfter + 1 - EventCapacity : 0;
+        size_t skip = valid > oldest ? min(valid - oldest, events.size()) : 0;
+
+        // match begin/end pairs, emit complete events clipped to the frame range
+        // ends whose begin left the ring are skipped
+        vector<pair<const char*, int64_t>> stack;
+        for (size_t i = skip; i < events.size(); i++) {
+            const auto& [name, ns] = events[i];
+            if (name) {
+                stack.emplace_back(name, ns);
+                continue;
+            }
+            if (stack.empty())
+                continue;
+
+            auto [bName, bNs] = stack.back();
+            stack.pop_back();
+            if (ns < begin || bNs >= end)
+                continue;
+
+            int64_t ts = max(bNs, begin);
+            int64_t te = min(ns, end);
+            sep() << "{\"name\":\"";
+            WriteEscaped(os, bName);
+            os << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << buffer->tid
+                << ",\"ts\":" << ts / 1000. << ",\"dur\":" << (te - ts) / 1000. << '}';
+        }
+    }
+
+    os << "\n]}\n";
+    os.flags(flags);
+    os.precision(precision);
+}
+
+bool Profiler::WriteChromeTraceFile(const string& path, size_t firstFrame, size_t count) const {
+    ofstream ofs(path);
+    if (!ofs.is_open())
+        return false;
+    WriteChromeTrace(ofs, firstFrame, count);
+    return true;
+}
@@ -0,0 +1,52 @@
+#include <UDXRenderer/RetireQueue.h>
+
+#include <cassert>
+#include <limits>
+#include <vector>
+
+using namespace Ubpa;
+using namespace std;
+
+RetireQueue::~RetireQueue() {
+    assert(entries.empty());
+}
+
+void RetireQueue::Retire(uint64_t fence, function<void()> release) {
+    lock_guard<mutex> lock(m);
+    entries.push_back({ fence, move(release) });
+}
+
+size_t RetireQueue::Collect(uint64_t completedFence) {
+    vector<function<void()>> ready;
+    {
+        lock_guard<mutex> lock(m);
+        while (!entries.empty() && entries.front().fence <= completedFence) {
+            ready.push_back(move(entries.front().release));
+            entries.pop_front();
+        }
+        releasedNum += ready.size();
+    }
+
+    // a release may retire more objects
+    for (auto& release : ready)
+        release();
+
+    return ready.size();
+}
+
+size_t RetireQueue::Flush() {
+    size_t num = 0;
+    while (size_t n = Collect(numeric_limits<uint64_t>::max()))
+        num += n;
+    return num;
+}
+
+size_t RetireQueue::GetPendingNum() const {
+    lock_guard<mutex> lock(m);
+    return entries.size();
+}
+
+uint64_t RetireQueue::GetReleasedNum() const {
+    lock_guard<mutex> lock(m);
+    return releasedNum;
+}
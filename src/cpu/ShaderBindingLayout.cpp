@@ -0,0 +1,173 @@
+#include <UDXRenderer/ShaderBindingLayout.h>
+
+#include <algorithm>
+#include <tuple>
+
+using namespace Ubpa;
+using namespace std;
+
+namespace {
+    using Binding = ShaderBindingLayout::Binding;
+    using ResourceType = ShaderBindingLayout::ResourceType;
+
+    constexpr uint32_t MaxSize = 64; // DWORDs of a root signature
+
+    // register class: b, t, u, s
+    int ClassOf(ResourceType type) noexcept {
+        switch (type)
+        {
+        case ResourceType::CBV: return 0;
+        case ResourceType::SRV:
+        case ResourceType::BufferSRV: return 1;
+        case ResourceType::UAV:
+        case ResourceType::BufferUAV: return 2;
+        default: return 3;
+        }
+    }
+
+    uint64_t End(const Binding& binding) noexcept {
+        return binding.count == ShaderBindingLayout::UnboundedCount ?
+            UINT64_MAX : uint64_t{ binding.reg } + binding.count;
+    }
+
+    bool Overlap(const Binding& lhs, const Binding& rhs) noexcept {
+        return ClassOf(lhs.type) == ClassOf(rhs.type) && lhs.space == rhs.space
+            && lhs.reg < End(rhs) && rhs.reg < End(lhs);
+    }
+
+    bool IsRootCandidate(const Binding& binding) noexcept {
+        return binding.count == 1 && (binding.type == ResourceType::CBV
+            || binding.type == ResourceType::BufferSRV || binding.type == ResourceType::BufferUAV);
+    }
+
+    ShaderBindingLayout::ParamType RootParamType(ResourceType type) noexcept {
+        switch (ClassOf(type))
+        {
+        case 0: return ShaderBindingLayout::ParamType::CBV;
+        case 1: return ShaderBindingLayout::ParamType::SRV;
+        default: return ShaderBindingLayout::ParamType::UAV;
+        }
+    }
+}
+
+ShaderBindingLayout::BuildResult ShaderBindingLayout::Build(const vector<Binding>* stages, size_t stageNum) {
+    return Build(stages, stageNum, Config{});
+}
+
+ShaderBindingLayout::BuildResult ShaderBindingLayout::Build(const vector<Binding>* stages, size_t stageNum,
+    const Config& config)
+{
+    bindings.clear();
+    slots.clear();
+    params.clear();
+    staticSamplers.clear();
+
+    // merge, a register shared by stages with different visibilities is visible to all
+    vector<Binding> merged;
+    for (size_t s = 0; s < stageNum; s++) {
+        for (const auto& binding : stages[s]) {
+            auto target = find_if(merged.begin(), merged.end(), [&](const Binding& m) {
+                return Overlap(m, binding);
+            });
+            if (target == merged.end()) {
+                merged.push_back(binding);
+                continue;
+            }
+            if (target->reg != binding.reg || target->type != binding.type || target->count != binding.count)
+                return BuildResult::Conflict;
+            if (target->visibility != binding.visibility)
+                target->visibility = Visibility::All;
+        }
+    }
+    sort(merged.begin(), merged.end(), [](const Binding& lhs, const Binding& rhs) {
+        return make_tuple(ClassOf(lhs.type), lhs.space, lhs.reg) < make_tuple(ClassOf(rhs.type), rhs.space, rhs.reg);
+    });
+
+    vector<size_t> roots;
+    if (config.useRootDescriptors) {
+        for (size_t i = 0; i < merged.size(); i++) {
+            if (IsRootCandidate(merged[i]))
+                roots.push_back(i);
+        }
+    }
+
+    // fewer root descriptors until the layout fits
+    for (size_t rootNum = roots.size(); ; rootNum--) {
+        params.clear();
+        slots.assign(merged.size(), Slot{});
+        staticSamplers.clear();
+        vector<bool> isRoot(merged.size(), false);
+
+        for (size_t k = 0; k < rootNum; k++) {
+            const auto& binding = merged[roots[k]];
+            isRoot[roots[k]] = true;
+            slots[roots[k]].rootIndex = static_cast<uint32_t>(params.size());
+            params.push_back({ RootParamType(binding.type), binding.visibility, binding.reg, binding.space, {} });
+        }
+
+        // bounded ranges share the table of their visibility, an unbounded range is alone in its table
+        auto addRanges = [&](bool samplers, bool unbounded) {
+            ParamType tableType = samplers ? ParamType::SamplerTable : ParamType::Table;
+            size_t firstTable = params.size();
+            for (size_t i = 0; i < merged.size(); i++) {
+                const auto& binding = merged[i];
+                if (isRoot[i] || (binding.type == ResourceType::Sampler) != samplers
+                    || (binding.count == UnboundedCount) != unbounded)
+                    continue;
+                if (samplers && binding.space == 0 && binding.count == 1 && binding.reg < config.staticSamplerNum) {
+                    staticSamplers.push_back(binding.reg);
+                    continue;
+                }
+
+                auto table = params.end();
+                if (!unbounded) {
+                    table = find_if(params.begin() + firstTable, params.end(), [&](const Param& param) {
+                        return param.visibility == binding.visibility;
+                    });
+                }
+                if (table == params.end()) {
+                    params.push_back({ tableType, binding.visibility, 0, 0, {} });
+                    table = params.end() - 1;
+                }
+
+                uint32_t offset = 0;
+                if (!table->ranges.empty())
+                    offset = table->ranges.back().offset + table->ranges.back().count;
+                table->ranges.push_back({ binding.type, binding.reg, binding.space, binding.count, offset });
+                slots[i].rootIndex = static_cast<uint32_t>(table - params.begin());
+                slots[i].tableOffset = offset;
+            }
+        };
+        addRanges(false, false);
+        addRanges(false, true);
+        addRanges(true, false);
+        addRanges(true, true);
+
+        if (GetSize() <= MaxSize)
+            break;
+        if (rootNum == 0) {
+            slots.clear();
+            params.clear();
+            staticSamplers.clear();
+            return BuildResult::TooLarge;
+        }
+    }
+
+    bindings = move(merged);
+    return BuildResult::Success;
+}
+
+uint32_t ShaderBindingLayout::GetSize() const noexcept {
+    uint32_t size = 0;
+    for (const auto& param : params)
+        size += param.type == ParamType::Table || param.type == ParamType::SamplerTable ? 1 : 2;
+    return size;
+}
+
+ShaderBindingLayout::Slot ShaderBindingLayout::GetSlot(string_view name) const noexcept {
+    for (size_t i = 0; i < bindings.size(); i++) {
+        if (bindings[i].name == name)
+            return slots[i];
+    }
+    return {};
+}
@@ -0,0 +1,187 @@
+#include <UDXRenderer/ShaderDependencyGraph.h>
+
+#include <fstream>
+#include <set>
+#include <sstream>
+
+using namespace Ubpa;
+using namespace std;
+
+namespace {
+    // comments replaced by a space, newlines kept
+    string StripComments(string_view source) {
+        string result;
+        result.reserve(source.size());
+        for (size_t i = 0; i < source.size(); i++) {
+            if (source[i] == '/' && i + 1 < source.size() && source[i + 1] == '/') {
+                while (i < source.size() && source[i] != '\n')
+                    i++;
+                if (i < source.size())
+                    result += '\n';
+            }
+            else if (source[i] == '/' && i + 1 < source.size() && source[i + 1] == '*') {
+                i += 2;
+                while (i < source.size() && !(source[i] == '*' && i + 1 < source.size() && source[i + 1] == '/')) {
+                    if (source[i] == '\n')
+                        result += '\n';
+                    i++;
+                }
+                i++; // the '/'
+                result += ' ';
+            }
+            else
+                result += source[i];
+        }
+        return result;
+    }
+
+    bool IsSpace(char c) noexcept {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+}
+
+vector<string> ShaderDependencyGraph::ScanIncludes(string_view source) {
+    vector<string> names;
+    string stripped = StripComments(source);
+    string_view text = stripped;
+    size_t lineBegin = 0;
+    while (lineBegin < text.size()) {
+        size_t lineEnd = text.find('\n', lineBegin);
+        if (lineEnd == string_view::npos)
+            lineEnd = text.size();
+        string_view line = text.substr(lineBegin, lineEnd - lineBegin);
+        lineBegin = lineEnd + 1;
+
+        // # include "name" | <name>, spaces allowed around '#'
+        size_t i = 0;
+        while (i < line.size() && IsSpace(line[i]))
+            i++;
+        if (i == line.size() || line[i] != '#')
+            continue;
+        i++;
+        while (i < line.size() && IsSpace(line[i]))
+            i++;
+        if (line.substr(i, 7) != "include")
+            continue;
+        i += 7;
+        while (i < line.size() && IsSpace(line[i]))
+            i++;
+        if (i == line.size() || (line[i] != '"' && line[i] != '<'))
+            continue;
+        char close = line[i] == '"' ? '"' : '>';
+        size_t end = line.find(close, i + 1);
+        if (end == string_view::npos)
+            continue;
+        names.emplace_back(line.substr(i + 1, end - i - 1));
+    }
+    return names;
+}
+
+filesystem::path ShaderDependencyGraph::Normalize(const filesystem::path& path) {
+    return filesystem::absolute(path).lexically_normal();
+}
+
+void ShaderDependencyGraph::AddShader(string name, const filesystem::path& file) {
+    auto normalized = Normalize(file);
+    Scan(normalized);
+    shaders[move(name)] = move(normalized);
+}
+
+void ShaderDependencyGraph::RemoveShader(const string& name) {
+    if (shaders.erase(name) != 0)
+        Prune();
+}
+
+void ShaderDependencyGraph::Rescan(const filesystem::path& file) {
+    auto normalized = Normalize(file);
+    if (includes.find(normalized) == includes.end())
+        return;
+    includes.erase(normalized);
+    Scan(normalized);
+    Prune();
+}
+
+void ShaderDependencyGraph::Scan(const filesystem::path& file) {
+    if (includes.find(file) != includes.end())
+        return;
+
+    // inserted first, include cycles end here
+    // a missing or unreadable file has no includes until it is rescanned
+    auto& fileIncludes = includes[file];
+    ifstream in(file, ios::binary);
+    if (!in)
+        return;
+    stringstream source;
+    source << in.rdbuf();
+
+    vector<filesystem::path> found;
+    for (const auto& name : ScanIncludes(source.str()))
+        found.push_back((file.parent_path() / filesystem::u8path(name)).lexically_normal());
+    fileIncludes = found; // map references stay valid while Scan inserts
+
+    for (const auto& include : found)
+        Scan(include);
+}
+
+void ShaderDependencyGraph::Prune() {
+    set<filesystem::path> reached;
+    vector<filesystem::path> stack;
+    for (const auto& [name, file] : shaders)
+        stack.push_back(file);
+    while (!stack.empty()) {
+        auto current = move(stack.back());
+        stack.pop_back();
+        if (!reached.insert(current).second)
+            continue;
+        auto target = includes.find(current);
+        if (target != includes.end())
+            stack.insert(stack.end(), target->second.begin(), target->second.end());
+    }
+
+    for (auto file = includes.begin(); file != includes.end();) {
+        if (reached.find(file->first) == reached.end())
+            file = includes.erase(file);
+        else
+            ++file;
+    }
+}
+
+vector<string> ShaderDependencyGraph::GetAffectedShaders(const vector<filesystem::path>& files) const {
+    set<filesystem::path> changed;
+    for (const auto& file : files)
+        changed.insert(Normalize(file));
+
+    vector<string> affected;
+    for (const auto& [name, file] : shaders) {
+        // depth-first over the includes, a file may be included more than once
+        set<filesystem::path> visited;
+        vector<filesystem::path> stack{ file };
+        bool isAffected = false;
+        while (!stack.empty() && !isAffected) {
+            auto current = move(stack.back());
+            stack.pop_back();
+            if (!visited.insert(current).second)
+                continue;
+            isAffected = changed.find(current) != changed.end();
+            auto target = includes.find(current);
+            if (target != includes.end())
+                stack.insert(stack.end(), target->second.begin(), target->second.end());
+        }
+        if (isAffected)
+            affected.push_back(name);
+    }
+    return affected;
+}
+
+vector<filesystem::path> ShaderDependencyGraph::GetFiles() const {
+    vector<filesystem::path> files;
+    for (const auto& [file, fileIncludes] : includes)
+        files.push_back(file);
+    return files;
+}
+
+const vector<filesystem::path>& ShaderDependencyGraph::GetIncludes(const filesystem::path& file) const {
+    static const vector<filesystem::path> none;
+    auto target = includes.find(Normalize(file));
+    return target != includes.end() ? target->second : none;
+}
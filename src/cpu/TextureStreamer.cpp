@@ -0,0 +1,277 @@
+#include <UDXRenderer/TextureStreamer.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <queue>
+
+using namespace Ubpa;
+using namespace std;
+
+namespace {
+    constexpr float NoRequest = numeric_limits<float>::infinity();
+
+    void Load(const void* base, size_t stride, uint32_t index, float* dst, size_t num) noexcept {
+        memcpy(dst, static_cast<const uint8_t*>(base) + index * stride, num * sizeof(float));
+    }
+}
+
+float TextureStreamer::EstimateMip(uint32_t textureSize, float uvDensity, float distance,
+    float projScaleY, float viewportHeight) noexcept
+{
+    if (distance <= 0.f || uvDensity <= 0.f)
+        return 0.f;
+
+    // pixels per world unit: viewportHeight * projScaleY / (2 * distance)
+    float texelsPerPixel = uvDensity * static_cast<float>(textureSize) * 2.f * distance
+        / (projScaleY * viewportHeight);
+    return texelsPerPixel > 1.f ? log2(texelsPerPixel) : 0.f;
+}
+
+float TextureStreamer::ComputeUVDensity(const uint32_t* indices, size_t indexNum,
+    const void* positions, size_t positionStride,
+    const void* uvs, size_t uvStride) noexcept
+{
+    double uvArea = 0.;
+    double area = 0.;
+    for (size_t i = 0; i + 2 < indexNum; i += 3) {
+        float p[3][3];
+        float uv[3][2];
+        for (size_t k = 0; k < 3; k++) {
+            Load(positions, positionStride, indices[i + k], p[k], 3);
+            Load(uvs, uvStride, indices[i + k], uv[k], 2);
+        }
+
+        float e0[3], e1[3];
+        for (size_t k = 0; k < 3; k++) {
+            e0[k] = p[1][k] - p[0][k];
+            e1[k] = p[2][k] - p[0][k];
+        }
+        float cx = e0[1] * e1[2] - e0[2] * e1[1];
+        float cy = e0[2] * e1[0] - e0[0] * e1[2];
+        float cz = e0[0] * e1[1] - e0[1] * e1[0];
+        area += 0.5 * sqrt(double(cx) * cx + double(cy) * cy + double(cz) * cz);
+
+        float cuv = (uv[1][0] - uv[0][0]) * (uv[2][1] - uv[0][1])
+            - (uv[1][1] - uv[0][1]) * (uv[2][0] - uv[0][0]);
+        uvArea += 0.5 * fabs(double(cuv));
+    }
+    return area > 0. ? static_cast<float>(sqrt(uvArea / area)) : 0.f;
+}
+
+TextureStreamer::TextureStreamer()
+    : TextureStreamer(Config{}) {}
+
+TextureStreamer::TextureStreamer(Config config)
+    : config{ config } {}
+
+TextureStreamer::TextureID TextureStreamer::Register(const Desc& desc) {
+    assert(!desc.residentBytes.empty());
+
+    TextureID id;
+    if (!freeIDs.empty()) {
+        id = freeIDs.back();
+        freeIDs.pop_back();
+    }
+    else {
+        id = static_cast<TextureID>(textures.size());
+        textures.emplace_back();
+    }
+
+    auto& tex = textures[id];
+    tex.residentBytes = desc.residentBytes;
+    tex.request = NoRequest;
+
+    auto mipNum = static_cast<uint32_t>(desc.residentBytes.size());
+    auto minResidentMips = clamp<uint32_t>(desc.minResidentMips, 1, mipNum);
+    auto& state = tex.state;
+    state.mipNum = mipNum;
+    state.minResidentMip = mipNum - minResidentMips;
+    state.residentMip = state.minResidentMip;
+    state.pendingMip = state.minResidentMip;
+    state.wantedMip = state.minResidentMip;
+    state.lastRequest = updateIndex;
+
+    residentBytes += tex.residentBytes[state.residentMip];
+    return id;
+}
+
+void TextureStreamer::Unregister(TextureID id) {
+    auto& tex = textures[id];
+    assert(!tex.residentBytes.empty());
+
+    CancelStreamIn(id);
+    residentBytes -= tex.residentBytes[tex.state.residentMip];
+    tex.residentBytes.clear();
+    freeIDs.push_back(id);
+}
+
+void TextureStreamer::Request(TextureID id, float mip) noexcept {
+    auto& tex = textures[id];
+    tex.request = min(tex.request, mip);
+}
+
+const vector<TextureStreamer::Op>& TextureStreamer::Update() {
+    ops.clear();
+
+    // wanted mips from the requests of this update
+    for (auto& tex : textures) {
+        if (tex.residentBytes.empty())
+            continue;
+        auto& state = tex.state;
+        if (tex.request != NoRequest) {
+            auto mip = tex.request > 0.f ? static_cast<uint32_t>(tex.request) : 0u;
+            state.wantedMip = min(mip, state.minResidentMip);
+            state.lastRequest = updateIndex;
+        }
+        else if (updateIndex - state.lastRequest > config.requestLifetime)
+            state.wantedMip = state.minResidentMip;
+        tex.request = NoRequest;
+    }
+
+    // stream-ins: the most missing mips first, then the latest request
+    auto streamInLess = [this](TextureID lhs, TextureID rhs) {
+        const auto& l = textures[lhs].state;
+        const auto& r = textures[rhs].state;
+        uint32_t lGap = l.residentMip - l.wantedMip;
+        uint32_t rGap = r.residentMip - r.wantedMip;
+        if (lGap != rGap)
+            return lGap < rGap;
+        if (l.lastRequest != r.lastRequest)
+            return l.lastRequest < r.lastRequest;
+        return lhs > rhs;
+    };
+    // evictions: the oldest request first, then the most unneeded bytes
+    auto evictLess = [this](TextureID lhs, TextureID rhs) {
+        const auto& l = textures[lhs];
+        const auto& r = textures[rhs];
+        if (l.state.lastRequest != r.state.lastRequest)
+            return l.state.lastRequest > r.state.lastRequest;
+        uint64_t lExcess = l.residentBytes[l.state.residentMip] - l.residentBytes[l.state.wantedMip];
+        uint64_t rExcess = r.residentBytes[r.state.residentMip] - r.residentBytes[r.state.wantedMip];
+        if (lExcess != rExcess)
+            return lExcess < rExcess;
+        return lhs > rhs;
+    };
+    priority_queue<TextureID, vector<TextureID>, decltype(streamInLess)> streamIns(streamInLess);
+    priority_queue<TextureID, vector<TextureID>, decltype(evictLess)> evicts(evictLess);
+
+    // the two sets are disjoint, a texture in flight is in neither
+    uint64_t evictableBytes = 0;
+    for (TextureID id = 0; id < textures.size(); id++) {
+        const auto& tex = textures[id];
+        if (tex.residentBytes.empty())
+            continue;
+        const auto& state = tex.state;
+        if (state.pendingMip != state.residentMip)
+            continue;
+        if (state.wantedMip < state.residentMip)
+            streamIns.push(id);
+        else if (state.wantedMip > state.residentMip) {
+            evicts.push(id);
+            evictableBytes += tex.residentBytes[state.residentMip] - tex.residentBytes[state.wantedMip];
+        }
+    }
+
+    auto evictNext = [&]() {
+        TextureID id = evicts.top();
+        evicts.pop();
+        auto& tex = textures[id];
+        auto& state = tex.state;
+        uint64_t freed = tex.residentBytes[state.residentMip] - tex.residentBytes[state.wantedMip];
+        residentBytes -= freed;
+        evictableBytes -= freed;
+        ops.push_back({ OpType::Evict, id, state.wantedMip, state.residentMip });
+        state.residentMip = state.wantedMip;
+        state.pendingMip = state.wantedMip;
+        evictNum++;
+    };
+
+    uint64_t startedBytes = 0;
+    while (!streamIns.empty() && pendingNum < config.maxPendingNum) {
+        TextureID id = streamIns.top();
+        streamIns.pop();
+        auto& tex = textures[id];
+        auto& state = tex.state;
+
+        // the finest mip that fits once every unneeded mip is evicted
+        uint32_t mip = state.wantedMip;
+        while (mip < state.residentMip && UsedBytes() - evictableBytes + tex.residentBytes[mip] > config.budget)
+            mip++;
+        if (mip == state.residentMip)
+            continue;
+
+        uint64_t bytes = tex.residentBytes[mip];
+        if (startedBytes > 0 && startedBytes + bytes > config.maxStreamInBytesPerUpdate)
+            break;
+
+        while (UsedBytes() + bytes > config.budget)
+            evictNext();
+
+        state.pendingMip = mip;
+        pendingBytes += bytes;
+        pendingNum++;
+        startedBytes += bytes;
+        ops.push_back({ OpType::StreamIn, id, mip, state.residentMip });
+        streamInNum++;
+    }
+
+    // the budget may have been lowered
+    while (UsedBytes() > config.budget && !evicts.empty())
+        evictNext();
+
+    updateIndex++;
+    return ops;
+}
+
+void TextureStreamer::OnStreamedIn(TextureID id) {
+    auto& tex = textures[id];
+    auto& state = tex.state;
+    assert(state.pendingMip != state.residentMip);
+
+    pendingBytes -= tex.residentBytes[state.pendingMip];
+    pendingNum--;
+    residentBytes -= tex.residentBytes[state.residentMip];
+    residentBytes += tex.residentBytes[state.pendingMip];
+    state.residentMip = state.pendingMip;
+}
+
+void TextureStreamer::CancelStreamIn(TextureID id) {
+    auto& tex = textures[id];
+    auto& state = tex.state;
+    if (state.pendingMip == state.residentMip)
+        return;
+
+    pendingBytes -= tex.residentBytes[state.pendingMip];
+    pendingNum--;
+    state.pendingMip = state.residentMip;
+}
+
+void TextureStreamer::CancelEvict(TextureID id, uint32_t mip) {
+    auto& tex = textures[id];
+    auto& state = tex.state;
+    assert(state.pendingMip == state.residentMip && mip <= state.residentMip);
+
+    residentBytes += tex.residentBytes[mip] - tex.residentBytes[state.residentMip];
+    state.residentMip = mip;
+    state.pendingMip = mip;
+    evictNum--;
+}
+
+TextureStreamer::Stats TextureStreamer::GetStats() const noexcept {
+    Stats stats;
+    stats.budget = config.budget;
+    stats.residentBytes = residentBytes;
+    stats.pendingBytes = pendingBytes;
+    stats.textureNum = textures.size() - freeIDs.size();
+    stats.pendingNum = pendingNum;
+    stats.streamInNum = streamInNum;
+    stats.evictNum = evictNum;
+    for (const auto& tex : textures) {
+        if (!tex.residentBytes.empty())
+            stats.wantedBytes += tex.residentBytes[tex.state.wantedMip];
+    }
+    return stats;
+}
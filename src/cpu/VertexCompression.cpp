@@ -0,0 +1,461 @@
+#include <UDXRenderer/VertexCompression.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+
+using namespace Ubpa;
+using namespace Ubpa::VertexCompression;
+using namespace std;
+
+namespace {
+    uint32_t ElementSize(ElementFormat format) {
+        switch (format) {
+        case ElementFormat::Float2: return 8;
+        case ElementFormat::Float3: return 12;
+        case ElementFormat::Unorm16x4: return 8;
+        case ElementFormat::Snorm8x2: return 2;
+        case ElementFormat::Snorm8x4: return 4;
+        case ElementFormat::Snorm16x2: return 4;
+        case ElementFormat::Snorm16x4: return 8;
+        case ElementFormat::Half2: return 4;
+        default: assert(false); return 0;
+        }
+    }
+
+    const char* HLSLType(ElementFormat format) {
+        switch (format) {
+        case ElementFormat::Float3: return "float3";
+        case ElementFormat::Unorm16x4:
+        case ElementFormat::Snorm8x4:
+        case ElementFormat::Snorm16x4: return "float4";
+        default: return "float2";
+        }
+    }
+
+    const Element* FindElement(const Layout& layout, const char* semantic) {
+        for (const auto& e : layout.elements) {
+            if (strcmp(e.semantic, semantic) == 0)
+                return &e;
+        }
+        return nullptr;
+    }
+
+    const float* Load(const Stream& stream, size_t i) {
+        return reinterpret_cast<const float*>(static_cast<const uint8_t*>(stream.data) + i * stream.stride);
+    }
+
+    void Normalize(float v[3]) {
+        float len = sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+        if (len > 0.f) {
+            v[0] /= len;
+            v[1] /= len;
+            v[2] /= len;
+        }
+    }
+
+    float AngleDeg(const float a[3], const float b[3]) {
+        float na[3] = { a[0], a[1], a[2] };
+        float nb[3] = { b[0], b[1], b[2] };
+        Normalize(na);
+        Normalize(nb);
+        float d = clamp(na[0] * nb[0] + na[1] * nb[1] + na[2] * nb[2], -1.f, 1.f);
+        return acosf(d) * 57.2957795f;
+    }
+
+    int32_t MaxSnorm(uint32_t bits) { return (1 << (bits - 1)) - 1; }
+
+    // octahedral snorm encoding, tries the 4 roundings of the two components and keeps the closest
+    void OctEncodeSnorm(const float n[3], uint32_t bits, int32_t q[2]) {
+        float e[2];
+        OctEncode(n, e);
+        int32_t maxQ = MaxSnorm(bits);
+        int32_t base[2] = {
+            static_cast<int32_t>(floorf(e[0] * maxQ)),
+            static_cast<int32_t>(floorf(e[1] * maxQ))
+        };
+
+        float bestDot = -2.f;
+        for (int32_t dx = 0; dx <= 1; dx++) {
+            for (int32_t dy = 0; dy <= 1; dy++) {
+                int32_t c[2] = { clamp(base[0] + dx, -maxQ, maxQ), clamp(base[1] + dy, -maxQ, maxQ) };
+                float ce[2] = { static_cast<float>(c[0]) / maxQ, static_cast<float>(c[1]) / maxQ };
+                float d[3];
+                OctDecode(ce, d);
+                float dot = n[0] * d[0] + n[1] * d[1] + n[2] * d[2];
+                if (dot > bestDot) {
+                    bestDot = dot;
+                    q[0] = c[0];
+                    q[1] = c[1];
+                }
+            }
+        }
+    }
+
+    // writes a direction at dst, component 0/1 (or 2/3 when packed second)
+    void WriteDirection(uint8_t* dst, ElementFormat format, size_t first, const float n[3]) {
+        switch (format) {
+        case ElementFormat::Float3:
+            memcpy(dst, n, 3 * sizeof(float));
+            break;
+        case ElementFormat::Snorm8x2:
+        case ElementFormat::Snorm8x4: {
+            int32_t q[2];
+            OctEncodeSnorm(n, 8, q);
+            int8_t v[2] = { static_cast<int8_t>(q[0]), static_cast<int8_t>(q[1]) };
+            memcpy(dst + first * sizeof(int8_t), v, sizeof(v));
+            break;
+        }
+        case ElementFormat::Snorm16x2:
+        case ElementFormat::Snorm16x4: {
+            int32_t q[2];
+            OctEncodeSnorm(n, 16, q);
+            int16_t v[2] = { static_cast<int16_t>(q[0]), static_cast<int16_t>(q[1]) };
+            memcpy(dst + first * sizeof(int16_t), v, sizeof(v));
+            break;
+        }
+        default:
+            assert(false);
+        }
+    }
+
+    void ReadDirection(const uint8_t* src, ElementFormat format, size_t first, float n[3]) {
+        float e[2];
+        switch (format) {
+        case ElementFormat::Float3:
+            memcpy(n, src, 3 * sizeof(float));
+            return;
+        case ElementFormat::Snorm8x2:
+        case ElementFormat::Snorm8x4: {
+            int8_t v[2];
+            memcpy(v, src + first * sizeof(int8_t), sizeof(v));
+            // D3D snorm: -128 and -127 both map to -1
+            e[0] = max(v[0] / 127.f, -1.f);
+            e[1] = max(v[1] / 127.f, -1.f);
+            break;
+        }
+        case ElementFormat::Snorm16x2:
+        case ElementFormat::Snorm16x4: {
+            int16_t v[2];
+            memcpy(v, src + first * sizeof(int16_t), sizeof(v));
+            e[0] = max(v[0] / 32767.f, -1.f);
+            e[1] = max(v[1] / 32767.f, -1.f);
+            break;
+        }
+        default:
+            assert(false);
+            return;
+        }
+        OctDecode(e, n);
+    }
+}
+
+void VertexCompression::OctEncode(const float n[3], float e[2]) noexcept {
+    float l1 = fabsf(n[0]) + fabsf(n[1]) + fabsf(n[2]);
+    float x = l1 > 0.f ? n[0] / l1 : 0.f;
+    float y = l1 > 0.f ? n[1] / l1 : 0.f;
+    if (n[2] < 0.f) {
+        float fx = (1.f - fabsf(y)) * (x >= 0.f ? 1.f : -1.f);
+        float fy = (1.f - fabsf(x)) * (y >= 0.f ? 1.f : -1.f);
+        x = fx;
+        y = fy;
+    }
+    e[0] = x;
+    e[1] = y;
+}
+
+void VertexCompression::OctDecode(const float e[2], float n[3]) noexcept {
+    n[0] = e[0];
+    n[1] = e[1];
+    n[2] = 1.f - fabsf(e[0]) - fabsf(e[1]);
+    float t = max(-n[2], 0.f);
+    n[0] += n[0] >= 0.f ? -t : t;
+    n[1] += n[1] >= 0.f ? -t : t;
+    Normalize(n);
+}
+
+uint16_t VertexCompression::FloatToHalf(float f) noexcept {
+    uint32_t x;
+    memcpy(&x, &f, sizeof(x));
+    uint32_t sign = (x >> 16) & 0x8000;
+    uint32_t absX = x & 0x7fffffff;
+
+    if (absX >= 0x7f800000) // inf, nan
+        return static_cast<uint16_t>(sign | 0x7c00 | (absX > 0x7f800000 ? 0x200 : 0));
+    if (absX >= 0x477ff000) // rounds to inf
+        return static_cast<uint16_t>(sign | 0x7c00);
+    if (absX < 0x38800000) { // subnormal half
+        float absF;
+        memcpy(&absF, &absX, sizeof(absF));
+        return static_cast<uint16_t>(sign | static_cast<uint32_t>(nearbyintf(absF * 16777216.f)));
+    }
+
+    // rebias the exponent, round the mantissa to nearest even
+    absX += 0xc8000fff + ((absX >> 13) & 1);
+    return static_cast<uint16_t>(sign | (absX >> 13));
+}
+
+float VertexCompression::HalfToFloat(uint16_t h) noexcept {
+    uint32_t sign = static_cast<uint32_t>(h & 0x8000) << 16;
+    uint32_t exponent = (h >> 10) & 0x1f;
+    uint32_t mantissa = h & 0x3ff;
+
+    if (exponent == 0) {
+        float f = mantissa / 16777216.f;
+        return sign ? -f : f;
+    }
+
+    uint32_t x = exponent == 31
+        ? sign | 0x7f800000 | (mantissa << 13)
+        : sign | ((exponent + 112) << 23) | (mantissa << 13);
+    float f;
+    memcpy(&f, &x, sizeof(f));
+    return f;
+}
+
+Layout VertexCompression::MakeLayout(const Desc& desc) {
+    Layout layout;
+    layout.desc = desc;
+    uint32_t offset = 0;
+    auto add = [&](const char* semantic, ElementFormat format) {
+        layout.elements.push_back({ semantic, format, offset });
+        offset += (ElementSize(format) + 3) & ~3u; // 4-byte aligned elements
+    };
+
+    add("POSITION", desc.position == PositionFormat::Float3 ? ElementFormat::Float3 : ElementFormat::Unorm16x4);
+
+    auto directionFormat = [](DirectionFormat format) {
+        switch (format) {
+        case DirectionFormat::Float3: return ElementFormat::Float3;
+        case DirectionFormat::Oct8: return ElementFormat::Snorm8x2;
+        default: return ElementFormat::Snorm16x2;
+        }
+    };
+
+    bool octPair = desc.normal == desc.tangent
+        && (desc.normal == DirectionFormat::Oct8 || desc.normal == DirectionFormat::Oct16);
+    if (octPair) {
+        layout.packedNormalTangent = true;
+        add("NORMAL", desc.normal == DirectionFormat::Oct8 ? ElementFormat::Snorm8x4 : ElementFormat::Snorm16x4);
+    }
+    else {
+        if (desc.normal != DirectionFormat::None)
+            add("NORMAL", directionFormat(desc.normal));
+        if (desc.tangent != DirectionFormat::None)
+            add("TANGENT", directionFormat(desc.tangent));
+    }
+
+    if (desc.uv != UVFormat::None)
+        add("TEXCOORD", desc.uv == UVFormat::Float2 ? ElementFormat::Float2 : ElementFormat::Half2);
+
+    layout.stride = offset;
+    return layout;
+}
+
+EncodedMesh VertexCompression::Encode(const SourceMesh& mesh, const Desc& desc) {
+    assert(mesh.positions.data);
+    assert(desc.normal == DirectionFormat::None || mesh.normals.data);
+    assert(desc.tangent == DirectionFormat::None || mesh.tangents.data);
+    assert(desc.uv == UVFormat::None || mesh.uvs.data);
+
+    EncodedMesh rst;
+    rst.layout = MakeLayout(desc);
+    rst.vertexNum = mesh.vertexNum;
+    rst.vertices.resize(mesh.vertexNum * rst.layout.stride, 0);
+
+    // bounds
+    if (mesh.vertexNum > 0) {
+        float lo[3], hi[3];
+        const float* p0 = Load(mesh.positions, 0);
+        for (size_t k = 0; k < 3; k++)
+            lo[k] = hi[k] = p0[k];
+        for (size_t i = 1; i < mesh.vertexNum; i++) {
+            const float* p = Load(mesh.positions, i);
+            for (size_t k = 0; k < 3; k++) {
+                lo[k] = min(lo[k], p[k]);
+                hi[k] = max(hi[k], p[k]);
+            }
+        }
+        for (size_t k = 0; k < 3; k++) {
+            rst.quantization.min[k] = lo[k];
+            rst.quantization.extent[k] = hi[k] > lo[k] ? hi[k] - lo[k] : 1.f;
+        }
+    }
+
+    const Element* position = FindElement(rst.layout, "POSITION");
+    const Element* normal = FindElement(rst.layout, "NORMAL");
+    const Element* tangent = FindElement(rst.layout, "TANGENT");
+    const Element* uv = FindElement(rst.layout, "TEXCOORD");
+
+    for (size_t i = 0; i < mesh.vertexNum; i++) {
+        uint8_t* dst = rst.vertices.data() + i * rst.layout.stride;
+
+        const float* p = Load(mesh.positions, i);
+        if (position->format == ElementFormat::Float3)
+            memcpy(dst + position->offset, p, 3 * sizeof(float));
+        else {
+            uint16_t q[4] = { 0, 0, 0, 65535 };
+            for (size_t k = 0; k < 3; k++) {
+                float t = (p[k] - rst.quantization.min[k]) / rst.quantization.extent[k];
+                q[k] = static_cast<uint16_t>(nearbyintf(clamp(t, 0.f, 1.f) * 65535.f));
+            }
+            memcpy(dst + position->offset, q, sizeof(q));
+        }
+
+        if (desc.normal != DirectionFormat::None) {
+            float n[3] = { Load(mesh.normals, i)[0], Load(mesh.normals, i)[1], Load(mesh.normals, i)[2] };
+            Normalize(n);
+            WriteDirection(dst + normal->offset, normal->format, 0, n);
+        }
+        if (desc.tangent != DirectionFormat::None) {
+            float t[3] = { Load(mesh.tangents, i)[0], Load(mesh.tangents, i)[1], Load(mesh.tangents, i)[2] };
+            Normalize(t);
+            if (rst.layout.packedNormalTangent)
+                WriteDirection(dst + normal->offset, normal->format, 2, t);
+            else
+                WriteDirection(dst + tangent->offset, tangent->format, 0, t);
+        }
+
+        if (uv) {
+            const float* t = Load(mesh.uvs, i);
+            if (uv->format == ElementFormat::Float2)
+                memcpy(dst + uv->offset, t, 2 * sizeof(float));
+            else {
+                uint16_t h[2] = { FloatToHalf(t[0]), FloatToHalf(t[1]) };
+                memcpy(dst + uv->offset, h, sizeof(h));
+            }
+        }
+    }
+
+    // error metrics by decoding
+    double sumSq = 0.;
+    for (size_t i = 0; i < mesh.vertexNum; i++) {
+        DecodedVertex v = Decode(rst, i);
+
+        const float* p = Load(mesh.positions, i);
+        float d2 = 0.f;
+        for (size_t k = 0; k < 3; k++)
+            d2 += (v.position[k] - p[k]) * (v.position[k] - p[k]);
+        rst.error.maxPositionError = max(rst.error.maxPositionError, sqrtf(d2));
+        sumSq += d2;
+
+        if (desc.normal != DirectionFormat::None)
+            rst.error.maxNormalErrorDeg = max(rst.error.maxNormalErrorDeg, AngleDeg(Load(mesh.normals, i), v.normal));
+        if (desc.tangent != DirectionFormat::None)
+            rst.error.maxTangentErrorDeg = max(rst.error.maxTangentErrorDeg, AngleDeg(Load(mesh.tangents, i), v.tangent));
+        if (uv) {
+            const float* t = Load(mesh.uvs, i);
+            rst.error.maxUVError = max({ rst.error.maxUVError, fabsf(v.uv[0] - t[0]), fabsf(v.uv[1] - t[1]) });
+        }
+    }
+    if (mesh.vertexNum > 0)
+        rst.error.rmsPositionError = static_cast<float>(sqrt(sumSq / mesh.vertexNum));
+
+    return rst;
+}
+
+DecodedVertex VertexCompression::Decode(const EncodedMesh& mesh, size_t vertex) {
+    assert(vertex < mesh.vertexNum);
+    const Layout& layout = mesh.layout;
+    const uint8_t* src = mesh.vertices.data() + vertex * layout.stride;
+    DecodedVertex v;
+
+    const Element* position = FindElement(layout, "POSITION");
+    if (position->format == ElementFormat::Float3)
+        memcpy(v.position, src + position->offset, 3 * sizeof(float));
+    else {
+        uint16_t q[4];
+        memcpy(q, src + position->offset, sizeof(q));
+        for (size_t k = 0; k < 3; k++)
+            v.position[k] = mesh.quantization.min[k] + q[k] / 65535.f * mesh.quantization.extent[k];
+    }
+
+    if (const Element* normal = FindElement(layout, "NORMAL")) {
+        ReadDirection(src + normal->offset, normal->format, 0, v.normal);
+        if (layout.packedNormalTangent)
+            ReadDirection(src + normal->offset, normal->format, 2, v.tangent);
+    }
+    if (const Element* tangent = FindElement(layout, "TANGENT"))
+        ReadDirection(src + tangent->offset, tangent->format, 0, v.tangent);
+
+    if (const Element* uv = FindElement(layout, "TEXCOORD")) {
+        if (uv->format == ElementFormat::Float2)
+            memcpy(v.uv, src + uv->offset, 2 * sizeof(float));
+        else {
+            uint16_t h[2];
+            memcpy(h, src + uv->offset, sizeof(h));
+            v.uv[0] = HalfToFloat(h[0]);
+            v.uv[1] = HalfToFloat(h[1]);
+        }
+    }
+
+    return v;
+}
+
+string VertexCompression::GenerateHLSL(const Layout& layout) {
+    const Element* position = FindElement(layout, "POSITION");
+    const Element* normal = FindElement(layout, "NORMAL");
+    const Element* tangent = FindElement(layout, "TANGENT");
+    const Element* uv = FindElement(layout, "TEXCOORD");
+    bool octNormal = normal && normal->format != ElementFormat::Float3;
+    bool octTangent = tangent && tangent->format != ElementFormat::Float3;
+
+    ostringstream ss;
+    ss << "// generated by Ubpa::VertexCompression::GenerateHLSL, stride " << layout.stride << " bytes\n\n";
+
+    ss << "struct VertexIn\n{\n";
+    ss << "    " << HLSLType(position->format) << " PosQ : POSITION;\n";
+    if (normal)
+        ss << "    " << HLSLType(normal->format) << " NormalQ : NORMAL;\n";
+    if (tangent)
+        ss << "    " << HLSLType(tangent->format) << " TangentQ : TANGENT;\n";
+    if (uv)
+        ss << "    float2 TexC : TEXCOORD;\n";
+    ss << "};\n\n";
+
+    ss << "struct DecodedVertex\n{\n"
+        "    float3 PosL;\n"
+        "    float3 NormalL;\n"
+        "    float3 TangentL;\n"
+        "    float2 TexC;\n"
+        "};\n\n";
+
+    if (octNormal || octTangent) {
+        ss << "float3 OctDecode(float2 e)\n{\n"
+            "    float3 n = float3(e, 1.0f - abs(e.x) - abs(e.y));\n"
+            "    float t = saturate(-n.z);\n"
+            "    n.xy += n.xy >= 0.0f ? -t : t;\n"
+            "    return normalize(n);\n"
+            "}\n\n";
+    }
+
+    ss << "DecodedVertex DecodeVertex(VertexIn vin, float3 quantMin, float3 quantExtent)\n{\n";
+    ss << "    DecodedVertex v;\n";
+    if (position->format == ElementFormat::Float3)
+        ss << "    v.PosL = vin.PosQ;\n";
+    else
+        ss << "    v.PosL = quantMin + vin.PosQ.xyz * quantExtent;\n";
+
+    if (!normal)
+        ss << "    v.NormalL = float3(0.0f, 0.0f, 0.0f);\n";
+    else if (!octNormal)
+        ss << "    v.NormalL = vin.NormalQ;\n";
+    else
+        ss << "    v.NormalL = OctDecode(vin.NormalQ.xy);\n";
+
+    if (layout.packedNormalTangent)
+        ss << "    v.TangentL = OctDecode(vin.NormalQ.zw);\n";
+    else if (!tangent)
+        ss << "    v.TangentL = float3(0.0f, 0.0f, 0.0f);\n";
+    else if (!octTangent)
+        ss << "    v.TangentL = vin.TangentQ;\n";
+    else
+        ss << "    v.TangentL = OctDecode(vin.TangentQ.xy);\n";
+
+    ss << (uv ? "    v.TexC = vin.TexC;\n" : "    v.TexC = float2(0.0f, 0.0f);\n");
+    ss << "    return v;\n}\n";
+
+    return ss.str();
+}
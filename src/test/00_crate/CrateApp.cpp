@@ -395,8 +395,7 @@ void DeferApp::Draw(const GameTimer& gt)
 	uCmdQueue.Execute(uGCmdList.raw.Get());
 
     // Swap the back and front buffers
-    ThrowIfFailed(mSwapChain->Present(0, 0));
-	mCurrBackBuffer = (mCurrBackBuffer + 1) % SwapChainBufferCount;
+	Present();
 
     //// Advance the fence value to mark commands up to this fence point.
     //mCurrFrameRsrcMngr->Fence = ++mCurrentFence;
@@ -8,16 +8,64 @@
 #include <UDX12/UploadBuffer.h>
 #include "../common/GeometryGenerator.h"
 
+#include <UDXRenderer/D3D12MaterialTable.h>
+#include <UDXRenderer/D3D12TimestampSource.h>
+#include <UDXRenderer/D3D12TransientDescriptorHeap.h>
+#include <UDXRenderer/D3D12VertexCompression.h>
+#include <UDXRenderer/DrawList.h>
+#include <UDXRenderer/LodSelector.h>
+#include <UDXRenderer/MappedFile.h>
+#include <UDXRenderer/MeshAsset.h>
+#include <UDXRenderer/PackArchive.h>
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <optional>
+#include <set>
+
 using Microsoft::WRL::ComPtr;
 using namespace DirectX;
 using namespace DirectX::PackedVector;
 
 const int gNumFrameResources = 3;
 
+// Generated files (cooked meshes, root signatures), outside the tracked data directory.
+const wchar_t gCacheDir[] = L"..\\cache\\01_defer";
+
+// Settings of the static mesh cook, part of the content key of the cooked shapes.
+const Ubpa::Meshlets::Config gMeshletConfig;
+const Ubpa::MeshSimplifier::LodConfig gLodConfig;
+
+// The heaps of UDX12::DescriptorHeapMngr in the order of its Init arguments, the memory tracker
+// records each under the address of its entry.
+struct DescriptorHeapEntry
+{
+	const char* Name;
+	D3D12_DESCRIPTOR_HEAP_TYPE Type;
+};
+const DescriptorHeapEntry gDescriptorHeaps[] = {
+	{ "CSU heap", D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV },
+	{ "RTV heap", D3D12_DESCRIPTOR_HEAP_TYPE_RTV },
+	{ "DSV heap", D3D12_DESCRIPTOR_HEAP_TYPE_DSV },
+	{ "shader-visible CSU heap", D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV },
+	{ "shader-visible sampler heap", D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER },
+};
+const size_t gShaderVisibleCSUHeap = 3;
+
 struct ObjectConstants
 {
 	DirectX::XMFLOAT4X4 World = MathHelper::Identity4x4();
 	DirectX::XMFLOAT4X4 TexTransform = MathHelper::Identity4x4();
+	// Dequantization of the 16-bit unorm positions, PosL = min + q * extent.
+	DirectX::XMFLOAT4 PosQuantMin = { 0.0f, 0.0f, 0.0f, 0.0f };
+	DirectX::XMFLOAT4 PosQuantExtent = { 1.0f, 1.0f, 1.0f, 0.0f };
+	// Element of gMaterials the shaders read.
+	UINT MaterialIndex = 0;
+	UINT ObjPad0 = 0;
+	UINT ObjPad1 = 0;
+	UINT ObjPad2 = 0;
 };
 
 struct PassConstants
@@ -46,13 +94,6 @@ struct PassConstants
 	Light Lights[MaxLights];
 };
 
-struct Vertex
-{
-	DirectX::XMFLOAT3 Pos;
-	DirectX::XMFLOAT3 Normal;
-	DirectX::XMFLOAT2 TexC;
-};
-
 // Lightweight structure stores parameters to draw a shape.  This will
 // vary from app-to-app.
 struct RenderItem
@@ -75,17 +116,84 @@ struct RenderItem
 	// Index into GPU constant buffer corresponding to the ObjectCB for this render item.
 	UINT ObjCBIndex = -1;
 
-	Material* Mat = nullptr;
+	Ubpa::MaterialTable::MaterialID Mat = Ubpa::MaterialTable::InvalidID;
 	Ubpa::UDX12::MeshGeometry* Geo = nullptr;
+	// Set instead of Geo for meshes in a mesh pool, all of them share one VB/IB binding.
+	const Ubpa::D3D12MeshPool* Pool = nullptr;
+	// Bounds the compressed positions of the mesh are quantized against.
+	Ubpa::VertexCompression::QuantizationInfo PosQuantization;
+
+	// Item of the draw list, which picks the LOD, culls the meshlets, sorts the items
+	// and records their draws.
+	size_t DrawID = 0;
+
+	// UV units per mesh unit, with the distance it picks the mips of the streamed textures.
+	float UVDensity = 0.0f;
 	//std::string Geo;
 
     // Primitive topology.
     D3D12_PRIMITIVE_TOPOLOGY PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+};
+
+// Records the draws of a Ubpa::DrawList into the command list, item i of the list is ritems[i].
+class CommandListDrawDevice : public Ubpa::DrawDevice
+{
+public:
+	CommandListDrawDevice(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems,
+		D3D12_GPU_VIRTUAL_ADDRESS objectCB, UINT objectSlot)
+		: mCmdList(cmdList), mRitems(ritems), mObjectCB(objectCB), mObjectSlot(objectSlot) { }
+
+	void SetBuffers(size_t item)override
+	{
+		auto ri = mRitems[item];
+		if(ri->Pool)
+		{
+			auto vbv = ri->Pool->VertexBufferView();
+			auto ibv = ri->Pool->IndexBufferView();
+			mCmdList->IASetVertexBuffers(0, 1, &vbv);
+			mCmdList->IASetIndexBuffer(&ibv);
+		}
+		else
+		{
+			mCmdList->IASetVertexBuffers(0, 1, &ri->Geo->VertexBufferView());
+			mCmdList->IASetIndexBuffer(&ri->Geo->IndexBufferView());
+		}
+	}
 
-    // DrawIndexedInstanced parameters.
-    UINT IndexCount = 0;
-    UINT StartIndexLocation = 0;
-    int BaseVertexLocation = 0;
+	void SetItem(size_t item)override
+	{
+		auto ri = mRitems[item];
+		UINT objCBByteSize = Ubpa::UDX12::Util::CalcConstantBufferByteSize(sizeof(ObjectConstants));
+		mCmdList->IASetPrimitiveTopology(ri->PrimitiveType);
+		mCmdList->SetGraphicsRootConstantBufferView(mObjectSlot, mObjectCB + ri->ObjCBIndex*objCBByteSize);
+	}
+
+	void DrawIndexed(std::uint32_t indexNum, std::uint32_t startIndex, std::int32_t baseVertex)override
+	{
+		mCmdList->DrawIndexedInstanced(indexNum, 1, startIndex, baseVertex, 0);
+	}
+
+private:
+	ID3D12GraphicsCommandList* mCmdList;
+	const std::vector<RenderItem*>& mRitems;
+	D3D12_GPU_VIRTUAL_ADDRESS mObjectCB;
+	UINT mObjectSlot;
+};
+
+// A generated mesh, input of the cook.
+struct ShapeSource
+{
+	std::string Name;
+	GeometryGenerator::MeshData Mesh;
+};
+
+// CPU-side data of a static mesh, kept alive until the mesh asset is serialized.
+struct CookedMesh
+{
+	std::vector<std::uint8_t> Vertices;
+	std::vector<std::uint32_t> Indices;
+	std::vector<Ubpa::MeshSimplifier::Lod> Lods;
+	Ubpa::Meshlets::MeshletMesh Meshlets;
 };
 
 class DeferApp : public D3DApp
@@ -106,9 +214,14 @@ private:
     virtual void OnMouseDown(WPARAM btnState, int x, int y)override;
     virtual void OnMouseUp(WPARAM btnState, int x, int y)override;
     virtual void OnMouseMove(WPARAM btnState, int x, int y)override;
+    virtual void OnHeadlessFrame(UINT frameIndex, UINT numFrames)override;
 
     void OnKeyboardInput(const GameTimer& gt);
 	void UpdateCamera(const GameTimer& gt);
+	void UpdateTextureStreaming(const GameTimer& gt);
+	void TrackFrameGraphRsrc(const Ubpa::UDX12::FG::RsrcMngr* rsrcMngr, size_t rsrcNode,
+		const D3D12_RESOURCE_DESC& desc, std::string name);
+	void UntrackFrameGraphRsrcs(const Ubpa::UDX12::FG::RsrcMngr* rsrcMngr);
 	void AnimateMaterials(const GameTimer& gt);
 	void UpdateObjectCBs(const GameTimer& gt);
 	void UpdateMaterialCBs(const GameTimer& gt);
@@ -119,11 +232,17 @@ private:
 	void BuildDescriptorHeaps();
     void BuildShadersAndInputLayout();
     void BuildShapeGeometry();
+	std::vector<ShapeSource> GenerateShapes();
+	std::uint64_t ShapesContentKey(const std::vector<ShapeSource>& shapes)const;
+	std::vector<std::uint8_t> CookShapes(std::vector<ShapeSource>& shapes, std::uint64_t contentKey);
+	Ubpa::MeshAsset::SubmeshSource CookStaticMesh(const std::string& name,
+		GeometryGenerator::MeshData& mesh, CookedMesh& cooked);
+	void RegisterStaticMesh(const Ubpa::MeshAsset::View& asset, const Ubpa::MeshAsset::Submesh& submesh);
     void BuildPSOs();
     void BuildFrameResources();
     void BuildMaterials();
     void BuildRenderItems();
-    void DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems);
+    void DrawRenderItems(ID3D12GraphicsCommandList* cmdList);
 
 private:
 
@@ -131,9 +250,35 @@ private:
 	Ubpa::UDX12::FrameRsrcMngr* mCurrFrameRsrcMngr = nullptr;
     int mCurrFrameRsrcMngrIndex = 0;
 
-	std::unordered_map<std::string, std::unique_ptr<Material>> mMaterials;
+	// Parameters of all materials, one structured buffer per frame resource.
+	std::unique_ptr<Ubpa::D3D12MaterialTable> mMaterials;
+
+	// Root parameters of the root signatures generated from the shaders, by HLSL name.
+	UINT mGeometryTexturesSlot = 0;
+	UINT mGeometryObjectSlot = 0;
+	UINT mGeometryPassSlot = 0;
+	UINT mGeometryMaterialsSlot = 0;
+	UINT mLightingGBufferSlot = 0;
+	UINT mLightingPassSlot = 0;
 
     std::vector<D3D12_INPUT_ELEMENT_DESC> mInputLayout;
+
+	// Compressed vertex format of the static meshes: 16-bit unorm position,
+	// 16-bit octahedral normal and half float uv, 16 bytes per vertex.
+	Ubpa::VertexCompression::Desc mVertexDesc;
+	std::unordered_map<std::string, Ubpa::VertexCompression::QuantizationInfo> mPosQuantizations;
+	std::unordered_map<std::string, float> mUVDensities;
+
+	// CPU stages of the opaque draws: LOD selection and meshlet culling, sorting and
+	// recording, the same code the headless CPU benchmark runs without a device.
+	Ubpa::DrawList mDrawList;
+
+	// UDX12 creates the temporal resources of a frame-graph resource manager on first use and
+	// pools them until Clear.  The nodes tracked in the memory tracker, by manager; the key of
+	// each is the address of its element, which std::set keeps until it is erased.
+	std::map<const Ubpa::UDX12::FG::RsrcMngr*, std::set<size_t>> mTrackedFrameGraphRsrcs;
+
+	std::unordered_map<std::string, Ubpa::LodSelector> mLodSelectors;
  
 	// List of all the render items.
 	std::vector<std::unique_ptr<RenderItem>> mAllRitems;
@@ -158,6 +303,16 @@ private:
 	Ubpa::UDX12::FG::Executor fgExecutor;
 	Ubpa::UFG::Compiler fgCompiler;
 	Ubpa::UFG::FrameGraph fg;
+
+	// per-pass GPU timings, published into mFrameStats as "gpu <pass>"
+	std::unique_ptr<Ubpa::D3D12TimestampSource> mGpuTimestamps;
+	std::unique_ptr<Ubpa::GpuProfiler> mGpuProfiler;
+
+	// per-frame SRV tables, retired by the frame fence
+	std::unique_ptr<Ubpa::D3D12TransientDescriptorHeap> mTransientSrvs;
+
+	// Packed textures and shaders, the loose files under ../data are used if it isn't there.
+	Ubpa::PackArchive mAssets;
 };
 
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE prevInstance,
@@ -171,6 +326,27 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE prevInstance,
     try
     {
         DeferApp theApp(hInstance);
+
+        // DeferApp.exe [-headless [numFrames] [timings.csv|timings.json]] [-fps <rate>]
+        std::istringstream args(cmdLine);
+        std::vector<std::string> tokens{ std::istream_iterator<std::string>(args), std::istream_iterator<std::string>() };
+        auto hasValue = [&](size_t i) { return i + 1 < tokens.size() && tokens[i + 1][0] != '-'; };
+        for(size_t i = 0; i < tokens.size(); ++i)
+        {
+            if(tokens[i] == "-headless")
+            {
+                UINT numFrames = 300;
+                std::string timingsPath = "frame_timings.csv";
+                if(hasValue(i))
+                    numFrames = (UINT)std::stoul(tokens[++i]);
+                if(hasValue(i))
+                    timingsPath = tokens[++i];
+                theApp.EnableHeadless(numFrames, timingsPath);
+            }
+            else if(tokens[i] == "-fps" && hasValue(i))
+                theApp.SetTargetFrameRate(std::stod(tokens[++i]));
+        }
+
         if(!theApp.Initialize())
             return 0;
 
@@ -195,6 +371,19 @@ DeferApp::~DeferApp()
 {
     if(!uDevice.IsNull())
         FlushCommandQueue();
+
+	auto& memory = Ubpa::DXRenderer::Instance().GetMemoryTracker();
+	for(auto& frsrc : mFrameResources)
+	{
+		auto fgRsrcMngr = frsrc->GetResource<std::shared_ptr<Ubpa::UDX12::FG::RsrcMngr>>("FrameGraphRsrcMngr");
+		UntrackFrameGraphRsrcs(fgRsrcMngr.get());
+		memory.Untrack(frsrc->GetResource<Ubpa::UDX12::ArrayUploadBuffer<PassConstants>>("gbPass constants")
+			.GetResource());
+		memory.Untrack(frsrc->GetResource<Ubpa::UDX12::ArrayUploadBuffer<ObjectConstants>>("ArrayUploadBuffer<ObjectConstants>")
+			.GetResource());
+	}
+	for(const auto& heap : gDescriptorHeaps)
+		memory.Untrack(&heap);
 }
 
 bool DeferApp::Initialize()
@@ -202,9 +391,58 @@ bool DeferApp::Initialize()
     if(!D3DApp::Initialize())
         return false;
 
-	Ubpa::DXRenderer::Instance().Init(uDevice.raw.Get());
+	// The shader-visible CSU heap can't grow: it holds every SRV page the renderer may add,
+	// the bindless table, the per-frame SRV tables and the frame-graph views.
+	const UINT bindlessCapacity = 256;
+	const UINT transientSrvCapacity = 64;
+	Ubpa::DXRenderer::Instance().Init(uDevice.raw.Get(), 64, 32);
+	// Descriptors per heap, in the order of gDescriptorHeaps.
+	const UINT descriptorHeapNums[] = { 1024, 1024, 1024,
+		Ubpa::DXRenderer::Instance().GetSrvCapacity() + bindlessCapacity + transientSrvCapacity + 1024, 1024 };
+	Ubpa::UDX12::DescriptorHeapMngr::Instance().Init(uDevice.raw.Get(), descriptorHeapNums[0],
+		descriptorHeapNums[1], descriptorHeapNums[2], descriptorHeapNums[3], descriptorHeapNums[4]);
+	Ubpa::DXRenderer::Instance().EnableBindless(bindlessCapacity);
+	Ubpa::DXRenderer::Instance().EnableTransferEngine(32ull << 20);
+#if defined(DEBUG) || defined(_DEBUG)
+	// Saving a .hlsl file under data/shaders/01_defer recompiles the shaders using it.
+	Ubpa::DXRenderer::Instance().EnableShaderHotReload();
+#endif
+	Ubpa::TextureStreamer::Config streamingConfig;
+	streamingConfig.budget = 64ull << 20;
+	Ubpa::DXRenderer::Instance().EnableTextureStreaming(streamingConfig);
+
+	// Report when the textures outgrow the streaming budget.
+	auto& memory = Ubpa::DXRenderer::Instance().GetMemoryTracker();
+	memory.SetBudget(Ubpa::MemoryTracker::Category::Texture, streamingConfig.budget);
+	memory.SetBudgetCallback([](const Ubpa::MemoryTracker::BudgetEvent& e) {
+		std::ostringstream msg;
+		msg << "memory budget " << (e.exceeded ? "exceeded" : "restored") << ": "
+			<< Ubpa::MemoryTracker::ToString(e.category) << " " << e.liveBytes << " / " << e.budget << " bytes\n";
+		OutputDebugStringA(msg.str().c_str());
+	});
+	mTransientSrvs = std::make_unique<Ubpa::D3D12TransientDescriptorHeap>(
+		uDevice.raw.Get(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, transientSrvCapacity, &memory, "transient srvs");
+
+	// The bindless table and the transient SRVs are ranges of the shader-visible CSU heap that
+	// their owners track, the heap's entry covers the rest.
+	for(size_t i = 0; i < std::size(gDescriptorHeaps); ++i)
+	{
+		UINT64 descriptorSize = uDevice->GetDescriptorHandleIncrementSize(gDescriptorHeaps[i].Type);
+		UINT num = descriptorHeapNums[i];
+		if(i == gShaderVisibleCSUHeap)
+			num -= bindlessCapacity + transientSrvCapacity;
+		memory.Track(&gDescriptorHeaps[i], Ubpa::MemoryTracker::Category::DescriptorHeap,
+			gDescriptorHeaps[i].Name, num * descriptorSize, descriptorSize);
+	}
+
+	mGpuTimestamps = std::make_unique<Ubpa::D3D12TimestampSource>(
+		uDevice.raw.Get(), uCmdQueue.raw.Get(), gNumFrameResources);
+	mGpuProfiler = std::make_unique<Ubpa::GpuProfiler>(*mGpuTimestamps, gNumFrameResources);
+	Ubpa::GpuProfiler::RegisterStage(mFrameStats, "GBuffer Pass");
+	Ubpa::GpuProfiler::RegisterStage(mFrameStats, "Defer Lighting");
 
-	Ubpa::UDX12::DescriptorHeapMngr::Instance().Init(uDevice.raw.Get(), 1024, 1024, 1024, 1024, 1024);
+	// Built by the pack tool: UDXRenderer_tool_pack ../data ../data/01_defer.upak
+	mAssets.Open(L"..\\data\\01_defer.upak");
 
 	//fgRsrcMngr.Init(uGCmdList, uDevice);
 
@@ -215,12 +453,10 @@ bool DeferApp::Initialize()
 	// so we have to query this information.
     //mCbvSrvDescriptorSize = uDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
 
-	Ubpa::DXRenderer::Instance().GetUpload().Begin();
- 
 	LoadTextures();
+    BuildShadersAndInputLayout();
     BuildRootSignature();
 	BuildDescriptorHeaps();
-    BuildShadersAndInputLayout();
     BuildShapeGeometry();
 	BuildMaterials();
     BuildRenderItems();
@@ -231,10 +467,10 @@ bool DeferApp::Initialize()
     ThrowIfFailed(uGCmdList->Close());
 	uCmdQueue.Execute(uGCmdList.raw.Get());
 
-	Ubpa::DXRenderer::Instance().GetUpload().End(uCmdQueue.raw.Get());
-
-    // Wait until initialization is complete.
-    FlushCommandQueue();
+	// Textures and meshes are uploaded on the copy queue, the first frame waits for them
+	// on the GPU instead of flushing the command queue.
+	auto& transfer = Ubpa::DXRenderer::Instance().GetTransferEngine();
+	transfer.QueueWait(uCmdQueue.raw.Get(), transfer.Submit());
 
     return true;
 }
@@ -247,17 +483,58 @@ void DeferApp::OnResize()
     XMMATRIX P = XMMatrixPerspectiveFovLH(0.25f*MathHelper::Pi, AspectRatio(), 1.0f, 1000.0f);
     XMStoreFloat4x4(&mProj, P);
 
-	auto clearFGRsrcMngr = [](void* rsrcMngr) {
-		reinterpret_cast<Ubpa::UDX12::FG::RsrcMngr*>(rsrcMngr)->Clear();
-	};
 	for (auto& frsrc : mFrameResources)
+	{
+		// Untracked by the manager they were tracked with in Draw.
+		auto fgRsrcMngr = frsrc->GetResource<std::shared_ptr<Ubpa::UDX12::FG::RsrcMngr>>("FrameGraphRsrcMngr").get();
+		auto clearFGRsrcMngr = [this, fgRsrcMngr](void* rsrcMngr) {
+			reinterpret_cast<Ubpa::UDX12::FG::RsrcMngr*>(rsrcMngr)->Clear();
+			UntrackFrameGraphRsrcs(fgRsrcMngr);
+		};
 		frsrc->DelayUpdateResource("FrameGraphRsrcMngr", clearFGRsrcMngr);
+	}
+}
+
+void DeferApp::TrackFrameGraphRsrc(const Ubpa::UDX12::FG::RsrcMngr* rsrcMngr, size_t rsrcNode,
+	const D3D12_RESOURCE_DESC& desc, std::string name)
+{
+	// Tracked when registered, the resource manager creates it in this frame's Execute.
+	auto [node, inserted] = mTrackedFrameGraphRsrcs[rsrcMngr].insert(rsrcNode);
+	if(!inserted)
+		return;
+	auto info = uDevice->GetResourceAllocationInfo(0, 1, &desc);
+	Ubpa::DXRenderer::Instance().GetMemoryTracker().Track(&*node, Ubpa::MemoryTracker::Category::RenderTarget,
+		std::move(name), info.SizeInBytes, info.Alignment);
+}
+
+void DeferApp::UntrackFrameGraphRsrcs(const Ubpa::UDX12::FG::RsrcMngr* rsrcMngr)
+{
+	auto target = mTrackedFrameGraphRsrcs.find(rsrcMngr);
+	if(target == mTrackedFrameGraphRsrcs.end())
+		return;
+	auto& memory = Ubpa::DXRenderer::Instance().GetMemoryTracker();
+	for(const size_t& node : target->second)
+		memory.Untrack(&node);
+	mTrackedFrameGraphRsrcs.erase(target);
 }
 
 void DeferApp::Update(const GameTimer& gt)
 {
+	// Recompiled shaders are swapped in before the frame records, the old PSOs are
+	// released once the frames in flight complete.
+	Ubpa::DXRenderer::Instance().UpdateShaderHotReload(mCurrentFence);
+
     OnKeyboardInput(gt);
 	UpdateCamera(gt);
+	{
+		Ubpa::FrameStats::ScopedStage stage(mFrameStats, mCullStage);
+		mDrawList.Cull(&mView.m[0][0], &mProj.m[0][0], &mEyePos.x, (float)mClientHeight);
+	}
+	{
+		Ubpa::FrameStats::ScopedStage stage(mFrameStats, mSortStage);
+		mDrawList.Sort(&mView.m[0][0]);
+	}
+	UpdateTextureStreaming(gt);
 
     // Cycle through the circular frame resource array.
     mCurrFrameRsrcMngrIndex = (mCurrFrameRsrcMngrIndex + 1) % gNumFrameResources;
@@ -275,6 +552,8 @@ void DeferApp::Update(const GameTimer& gt)
 
 void DeferApp::Draw(const GameTimer& gt)
 {
+	std::optional<Ubpa::FrameStats::ScopedStage> recordStage(std::in_place, mFrameStats, mRecordStage);
+
 	auto cmdListAlloc = mCurrFrameRsrcMngr->GetResource<Microsoft::WRL::ComPtr<ID3D12CommandAllocator>>("CommandAllocator");
 
     // Reuse the memory associated with command recording.
@@ -284,6 +563,14 @@ void DeferApp::Draw(const GameTimer& gt)
     // A command list can be reset after it has been added to the command queue via ExecuteCommandList.
     // Reusing the command list reuses memory.
 	ThrowIfFailed(uGCmdList->Reset(cmdListAlloc.Get(), nullptr));
+
+	// The frame resource fence was waited in Update(), so this slot's old queries are ready.
+	mGpuTimestamps->SetCommandList(uGCmdList.raw.Get());
+	mGpuProfiler->BeginFrame();
+
+	mTransientSrvs->Reclaim(mFence->GetCompletedValue());
+	Ubpa::DXRenderer::Instance().CollectRetired(mFence->GetCompletedValue());
+
 	uGCmdList.SetDescriptorHeaps(Ubpa::UDX12::DescriptorHeapMngr::Instance().GetCSUGpuDH()->GetDescriptorHeap());
 
 	uGCmdList->RSSetViewports(1, &mScreenViewport);
@@ -315,18 +602,14 @@ void DeferApp::Draw(const GameTimer& gt)
 		{ backbuffer }
 	);
 
+	const DXGI_FORMAT gbufferFormat = DXGI_FORMAT_R32G32B32A32_FLOAT;
 	(*fgRsrcMngr)
 		.RegisterTemporalRsrc(gbuffer0,
-			Ubpa::UDX12::FG::RsrcType::RT2D(DXGI_FORMAT_R32G32B32A32_FLOAT, mClientWidth, mClientHeight, Colors::Black))
+			Ubpa::UDX12::FG::RsrcType::RT2D(gbufferFormat, mClientWidth, mClientHeight, Colors::Black))
 		.RegisterTemporalRsrc(gbuffer1,
-			Ubpa::UDX12::FG::RsrcType::RT2D(DXGI_FORMAT_R32G32B32A32_FLOAT, mClientWidth, mClientHeight, Colors::Black))
+			Ubpa::UDX12::FG::RsrcType::RT2D(gbufferFormat, mClientWidth, mClientHeight, Colors::Black))
 		.RegisterTemporalRsrc(gbuffer2,
-			Ubpa::UDX12::FG::RsrcType::RT2D(DXGI_FORMAT_R32G32B32A32_FLOAT, mClientWidth, mClientHeight, Colors::Black))
-
-		.RegisterRsrcTable({
-			{gbuffer0,Ubpa::UDX12::Desc::SRV::Tex2D(DXGI_FORMAT_R32G32B32A32_FLOAT)},
-			{gbuffer1,Ubpa::UDX12::Desc::SRV::Tex2D(DXGI_FORMAT_R32G32B32A32_FLOAT)},
-			{gbuffer2,Ubpa::UDX12::Desc::SRV::Tex2D(DXGI_FORMAT_R32G32B32A32_FLOAT)} })
+			Ubpa::UDX12::FG::RsrcType::RT2D(gbufferFormat, mClientWidth, mClientHeight, Colors::Black))
 
 		.RegisterImportedRsrc(backbuffer, { CurrentBackBuffer(), D3D12_RESOURCE_STATE_PRESENT })
 		.RegisterImportedRsrc(depthstencil, { mDepthStencilBuffer.Get(), D3D12_RESOURCE_STATE_DEPTH_WRITE })
@@ -347,19 +630,26 @@ void DeferApp::Draw(const GameTimer& gt)
 			Ubpa::UDX12::FG::RsrcImplDesc_RTV_Null{})*/
 
 		.RegisterPassRsrcs(deferLightingPass, gbuffer0, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
-			Ubpa::UDX12::Desc::SRV::Tex2D(DXGI_FORMAT_R32G32B32A32_FLOAT))
+			Ubpa::UDX12::Desc::SRV::Tex2D(gbufferFormat))
 		.RegisterPassRsrcs(deferLightingPass, gbuffer1, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
-			Ubpa::UDX12::Desc::SRV::Tex2D(DXGI_FORMAT_R32G32B32A32_FLOAT))
+			Ubpa::UDX12::Desc::SRV::Tex2D(gbufferFormat))
 		.RegisterPassRsrcs(deferLightingPass, gbuffer2, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
-			Ubpa::UDX12::Desc::SRV::Tex2D(DXGI_FORMAT_R32G32B32A32_FLOAT))
+			Ubpa::UDX12::Desc::SRV::Tex2D(gbufferFormat))
 
 		.RegisterPassRsrcs(deferLightingPass, backbuffer, D3D12_RESOURCE_STATE_RENDER_TARGET,
 			Ubpa::UDX12::FG::RsrcImplDesc_RTV_Null{})
 		;
 
+	auto gbufferDesc = CD3DX12_RESOURCE_DESC::Tex2D(gbufferFormat, mClientWidth, mClientHeight,
+		1, 1, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET);
+	TrackFrameGraphRsrc(fgRsrcMngr.get(), gbuffer0, gbufferDesc, "GBuffer0");
+	TrackFrameGraphRsrc(fgRsrcMngr.get(), gbuffer1, gbufferDesc, "GBuffer1");
+	TrackFrameGraphRsrc(fgRsrcMngr.get(), gbuffer2, gbufferDesc, "GBuffer2");
+
 	fgExecutor.RegisterPassFunc(
 		gbPass,
 		[&](const Ubpa::UDX12::FG::PassRsrcs& rsrcs) {
+			Ubpa::GpuProfiler::ScopedPass gpuPass(*mGpuProfiler, "GBuffer Pass");
 			uGCmdList->SetPipelineState(Ubpa::DXRenderer::Instance().GetPSO("geometry"));
 			auto gb0 = rsrcs.find(gbuffer0)->second;
 			auto gb1 = rsrcs.find(gbuffer1)->second;
@@ -377,13 +667,17 @@ void DeferApp::Draw(const GameTimer& gt)
 			uGCmdList->OMSetRenderTargets(rts.size(), rts.data(), false, &ds.cpuHandle);
 
 			uGCmdList->SetGraphicsRootSignature(Ubpa::DXRenderer::Instance().GetRootSignature("geometry"));
+			// all textures at once, materials index the table
+			uGCmdList->SetGraphicsRootDescriptorTable(mGeometryTexturesSlot, Ubpa::DXRenderer::Instance().GetBindlessTable());
 
 			auto passCB = mCurrFrameRsrcMngr
 				->GetResource<Ubpa::UDX12::ArrayUploadBuffer<PassConstants>>("gbPass constants")
 				.GetResource();
-			uGCmdList->SetGraphicsRootConstantBufferView(2, passCB->GetGPUVirtualAddress());
+			uGCmdList->SetGraphicsRootConstantBufferView(mGeometryPassSlot, passCB->GetGPUVirtualAddress());
+			// all materials at once, draws index them with gMaterialIndex
+			uGCmdList->SetGraphicsRootShaderResourceView(mGeometryMaterialsSlot, mMaterials->GetGpuAddress(mCurrFrameRsrcMngrIndex));
 
-			DrawRenderItems(uGCmdList.raw.Get(), mOpaqueRitems);
+			DrawRenderItems(uGCmdList.raw.Get());
 		}
 	);
 
@@ -417,6 +711,7 @@ void DeferApp::Draw(const GameTimer& gt)
 	fgExecutor.RegisterPassFunc(
 		deferLightingPass,
 		[&](const Ubpa::UDX12::FG::PassRsrcs& rsrcs) {
+			Ubpa::GpuProfiler::ScopedPass gpuPass(*mGpuProfiler, "Defer Lighting");
 			uGCmdList->SetPipelineState(Ubpa::DXRenderer::Instance().GetPSO("defer lighting"));
 			auto gb0 = rsrcs.find(gbuffer0)->second;
 			auto gb1 = rsrcs.find(gbuffer1)->second;
@@ -435,7 +730,19 @@ void DeferApp::Draw(const GameTimer& gt)
 
 			uGCmdList->SetGraphicsRootSignature(Ubpa::DXRenderer::Instance().GetRootSignature("defer lighting"));
 
-			uGCmdList->SetGraphicsRootDescriptorTable(0, gb0.gpuHandle);
+			// the gbuffer table lives for this frame only
+			auto gbTable = mTransientSrvs->Allocate(3);
+			auto gbSrvDesc = Ubpa::UDX12::Desc::SRV::Tex2D(gbufferFormat);
+			uDevice->CreateShaderResourceView(gb0.resource, &gbSrvDesc, gbTable.GetCpuHandle(0));
+			uDevice->CreateShaderResourceView(gb1.resource, &gbSrvDesc, gbTable.GetCpuHandle(1));
+			uDevice->CreateShaderResourceView(gb2.resource, &gbSrvDesc, gbTable.GetCpuHandle(2));
+			uGCmdList->SetGraphicsRootDescriptorTable(mLightingGBufferSlot, gbTable.GetGpuHandle());
+
+			// the lights and the eye position
+			auto passCB = mCurrFrameRsrcMngr
+				->GetResource<Ubpa::UDX12::ArrayUploadBuffer<PassConstants>>("gbPass constants")
+				.GetResource();
+			uGCmdList->SetGraphicsRootConstantBufferView(mLightingPassSlot, passCB->GetGPUVirtualAddress());
 
 			uGCmdList->IASetVertexBuffers(0, 0, nullptr);
 			uGCmdList->IASetIndexBuffer(nullptr);
@@ -450,20 +757,33 @@ void DeferApp::Draw(const GameTimer& gt)
 		flag = true;
 	}
 
-	auto [success, crst] = fgCompiler.Compile(fg);
-	fgExecutor.Execute(crst, *fgRsrcMngr);
+	auto [success, crst] = [&]() {
+		UDXR_PROFILE_ZONE("FrameGraph::Compile");
+		Ubpa::FrameStats::ScopedStage stage(mFrameStats, mFGCompileStage);
+		return fgCompiler.Compile(fg);
+	}();
+	{
+		UDXR_PROFILE_ZONE("FrameGraph::Execute");
+		fgExecutor.Execute(crst, *fgRsrcMngr);
+	}
+
+	mGpuProfiler->EndFrame();
+	mGpuProfiler->Publish(mFrameStats);
 
     // Done recording commands.
     ThrowIfFailed(uGCmdList->Close());
+	recordStage.reset();
+
+	Ubpa::FrameStats::ScopedStage submitStage(mFrameStats, mSubmitStage);
 
     // Add the command list to the queue for execution.
 	uCmdQueue.Execute(uGCmdList.raw.Get());
 
     // Swap the back and front buffers
-    ThrowIfFailed(mSwapChain->Present(0, 0));
-	mCurrBackBuffer = (mCurrBackBuffer + 1) % SwapChainBufferCount;
+	Present();
 
 	mCurrFrameRsrcMngr->Signal(uCmdQueue.raw.Get(), ++mCurrentFence);
+	mTransientSrvs->EndFrame(mCurrentFence);
 }
 
 void DeferApp::OnMouseDown(WPARAM btnState, int x, int y)
@@ -511,6 +831,17 @@ void DeferApp::OnMouseMove(WPARAM btnState, int x, int y)
     mLastMousePos.y = y;
 }
  
+void DeferApp::OnHeadlessFrame(UINT frameIndex, UINT numFrames)
+{
+	// Scripted camera path: one full orbit around the scene, bobbing up and down
+	// and dollying in and out, so every run renders exactly the same frames.
+	float t = numFrames > 1 ? static_cast<float>(frameIndex) / (numFrames - 1) : 0.0f;
+
+	mTheta = 1.3f*XM_PI + XM_2PI*t;
+	mPhi = MathHelper::Clamp(0.4f*XM_PI + 0.15f*XM_PI*sinf(2.0f*XM_2PI*t), 0.1f, MathHelper::Pi - 0.1f);
+	mRadius = 2.5f + 2.0f*(0.5f - 0.5f*cosf(XM_2PI*t));
+}
+
 void DeferApp::OnKeyboardInput(const GameTimer& gt)
 {
 }
@@ -531,6 +862,54 @@ void DeferApp::UpdateCamera(const GameTimer& gt)
 	XMStoreFloat4x4(&mView, view);
 }
 
+void DeferApp::UpdateTextureStreaming(const GameTimer& gt)
+{
+	auto& renderer = Ubpa::DXRenderer::Instance();
+
+	// Materials are named after their texture.
+	XMVECTOR eyePos = XMLoadFloat3(&mEyePos);
+	for(auto& e : mAllRitems)
+	{
+		const std::string& texture = mMaterials->GetTable().GetName(e->Mat);
+		if(!renderer.IsStreamedTexture(texture))
+			continue;
+
+		const auto& quant = e->PosQuantization;
+		XMVECTOR extent = XMVectorSet(quant.extent[0], quant.extent[1], quant.extent[2], 0.0f);
+		XMVECTOR centerL = XMVectorSet(quant.min[0], quant.min[1], quant.min[2], 1.0f) + 0.5f*extent;
+		XMMATRIX world = XMLoadFloat4x4(&e->World);
+		XMVECTOR centerW = XMVector3TransformCoord(centerL, world);
+		float scale = XMVectorGetX(XMVectorMax(XMVector3Length(world.r[0]),
+			XMVectorMax(XMVector3Length(world.r[1]), XMVector3Length(world.r[2]))));
+		float radius = 0.5f*scale*XMVectorGetX(XMVector3Length(extent));
+
+		// The nearest point of the bounding sphere, not closer than the near plane.
+		float distance = XMVectorGetX(XMVector3Length(centerW - eyePos)) - radius;
+		distance = distance > 1.0f ? distance : 1.0f;
+
+		float mip = Ubpa::TextureStreamer::EstimateMip(renderer.GetStreamedTextureSize(texture),
+			e->UVDensity / scale, distance, mProj(1, 1), (float)mClientHeight);
+		renderer.RequestTextureMip(texture, mip);
+	}
+
+	// The next frame signals mCurrentFence + 1, replaced textures are released after it.
+	renderer.UpdateTextureStreaming(mCurrentFence + 1);
+	// One copy submission carries the uploads of the frame.
+	renderer.GetTransferEngine().Submit();
+
+	// New mips come with new SRVs.
+	auto& materials = mMaterials->GetTable();
+	auto diffuseMapIndex = materials.FindParam("DiffuseMapIndex");
+	for(Ubpa::MaterialTable::MaterialID id = 0; id < materials.GetIDBound(); id++)
+	{
+		if(!materials.IsAlive(id))
+			continue;
+		UINT index = renderer.GetTextureBindlessIndex(materials.GetName(id));
+		if(index != *static_cast<const UINT*>(materials.Get(id, diffuseMapIndex)))
+			materials.Set(id, diffuseMapIndex, index);
+	}
+}
+
 void DeferApp::AnimateMaterials(const GameTimer& gt)
 {
 	
@@ -552,6 +931,10 @@ void DeferApp::UpdateObjectCBs(const GameTimer& gt)
 			ObjectConstants objConstants;
 			XMStoreFloat4x4(&objConstants.World, XMMatrixTranspose(world));
 			XMStoreFloat4x4(&objConstants.TexTransform, XMMatrixTranspose(texTransform));
+			const auto& quant = e->PosQuantization;
+			objConstants.PosQuantMin = { quant.min[0], quant.min[1], quant.min[2], 0.0f };
+			objConstants.PosQuantExtent = { quant.extent[0], quant.extent[1], quant.extent[2], 0.0f };
+			objConstants.MaterialIndex = e->Mat;
 
 			currObjectCB.Set(e->ObjCBIndex, objConstants);
 
@@ -563,29 +946,8 @@ void DeferApp::UpdateObjectCBs(const GameTimer& gt)
 
 void DeferApp::UpdateMaterialCBs(const GameTimer& gt)
 {
-	auto& currMaterialCB = mCurrFrameRsrcMngr
-		->GetResource<Ubpa::UDX12::ArrayUploadBuffer<MaterialConstants>>("ArrayUploadBuffer<MaterialConstants>");
-	for(auto& e : mMaterials)
-	{
-		// Only update the cbuffer data if the constants have changed.  If the cbuffer
-		// data changes, it needs to be updated for each FrameResource.
-		Material* mat = e.second.get();
-		if(mat->NumFramesDirty > 0)
-		{
-			XMMATRIX matTransform = XMLoadFloat4x4(&mat->MatTransform);
-
-			MaterialConstants matConstants;
-			matConstants.DiffuseAlbedo = mat->DiffuseAlbedo;
-			matConstants.FresnelR0 = mat->FresnelR0;
-			matConstants.Roughness = mat->Roughness;
-			XMStoreFloat4x4(&matConstants.MatTransform, XMMatrixTranspose(matTransform));
-
-			currMaterialCB.Set(mat->MatCBIndex, matConstants);
-
-			// Next FrameResource need to be updated too.
-			mat->NumFramesDirty--;
-		}
-	}
+	// Only the materials changed since this frame resource was last used are copied.
+	mMaterials->Upload(mCurrFrameRsrcMngrIndex);
 }
 
 void DeferApp::UpdateMainPassCB(const GameTimer& gt)
@@ -626,84 +988,87 @@ void DeferApp::UpdateMainPassCB(const GameTimer& gt)
 
 void DeferApp::LoadTextures()
 {
+	if(mAssets.IsOpen())
+	{
+		std::array<std::string_view, 3> ironTextures{
+			"textures/iron/albedo.dds",
+			"textures/iron/roughness.dds",
+			"textures/iron/metalness.dds"
+		};
+
+		Ubpa::DXRenderer::Instance().RegisterStreamedDDSTextureArrayFromArchive(
+			"iron", mAssets,
+			ironTextures.data(), (UINT)ironTextures.size());
+		return;
+	}
+
 	std::array<std::wstring_view, 3> ironTextures{
 		L"../data/textures/iron/albedo.dds",
 		L"../data/textures/iron/roughness.dds",
 		L"../data/textures/iron/metalness.dds"
 	};
 
-	Ubpa::DXRenderer::Instance().RegisterDDSTextureArrayFromFile(
-		Ubpa::DXRenderer::Instance().GetUpload(),
-		"iron",
-		ironTextures.data(), ironTextures.size());
+	// Streamed textures keep their files in memory, the larger mips are loaded from them.
+	std::vector<std::vector<std::uint8_t>> files;
+	for(auto filename : ironTextures)
+	{
+		std::ifstream file(std::filesystem::path(filename), std::ios::binary);
+		if(!file)
+			ThrowIfFailed(HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND));
+		files.emplace_back(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	}
+
+	Ubpa::DXRenderer::Instance().RegisterStreamedDDSTextureArrayFromMemory(
+		"iron", std::move(files));
 }
 
 void DeferApp::BuildRootSignature()
 {
-	{ // geometry
-		CD3DX12_DESCRIPTOR_RANGE texTable;
-		texTable.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 3, 0);
-
-		// Root parameter can be a table, root descriptor or root constants.
-		CD3DX12_ROOT_PARAMETER slotRootParameter[4];
-
-		// Perfomance TIP: Order from most frequent to least frequent.
-		slotRootParameter[0].InitAsDescriptorTable(1, &texTable, D3D12_SHADER_VISIBILITY_PIXEL);
-		slotRootParameter[1].InitAsConstantBufferView(0);
-		slotRootParameter[2].InitAsConstantBufferView(1);
-		slotRootParameter[3].InitAsConstantBufferView(2);
-
-		auto staticSamplers = Ubpa::DXRenderer::Instance().GetStaticSamplers();
-
-		// A root signature is an array of root parameters.
-		CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(4, slotRootParameter,
-			(UINT)staticSamplers.size(), staticSamplers.data(),
-			D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
-
-		Ubpa::DXRenderer::Instance().RegisterRootSignature("geometry", &rootSigDesc);
-	}
+	auto& renderer = Ubpa::DXRenderer::Instance();
 
-	{ // screen
-		CD3DX12_DESCRIPTOR_RANGE texTable;
-		texTable.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0);
+	// Blobs of the last launch, their root signatures are created before the registrations hit them.
+	const std::filesystem::path cachePath = std::filesystem::path(gCacheDir) / L"root_signatures.rscache";
+	renderer.LoadRootSignatureCache(cachePath);
 
-		// Root parameter can be a table, root descriptor or root constants.
-		CD3DX12_ROOT_PARAMETER slotRootParameter[1];
-
-		// Perfomance TIP: Order from most frequent to least frequent.
-		slotRootParameter[0].InitAsDescriptorTable(1, &texTable, D3D12_SHADER_VISIBILITY_PIXEL);
-
-		auto staticSamplers = Ubpa::DXRenderer::Instance().GetStaticSamplers();
-
-		// A root signature is an array of root parameters.
-		CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(1, slotRootParameter,
-			(UINT)staticSamplers.size(), staticSamplers.data(),
-			D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
+	// A binding the shaders no longer use has no root parameter.
+	auto getSlot = [](const Ubpa::ShaderBindingLayout& layout, const char* name)
+	{
+		auto slot = layout.GetSlot(name);
+		if(slot.rootIndex == Ubpa::ShaderBindingLayout::InvalidIndex)
+			ThrowIfFailed(E_INVALIDARG);
+		return slot;
+	};
 
-		Ubpa::DXRenderer::Instance().RegisterRootSignature("screen", &rootSigDesc);
+	// Generated from the bindings of the VS and PS, the static samplers are the renderer's.
+	std::string geometry[] = { "geometryVS", "geometryPS" };
+	renderer.RegisterRootSignature("geometry", geometry, 2);
+	const auto& geometryLayout = renderer.GetRootSignatureLayout("geometry");
+	mGeometryTexturesSlot = getSlot(geometryLayout, "gTextures").rootIndex;
+	mGeometryObjectSlot = getSlot(geometryLayout, "cbPerObject").rootIndex;
+	mGeometryPassSlot = getSlot(geometryLayout, "cbPass").rootIndex;
+	mGeometryMaterialsSlot = getSlot(geometryLayout, "gMaterials").rootIndex;
+
+	std::string screen[] = { "screenVS", "screenPS" };
+	renderer.RegisterRootSignature("screen", screen, 2);
+
+	// gbuffer0..2 are one table, in this order, Draw fills it from descriptor 0 on.
+	std::string deferLighting[] = { "deferLightingVS", "deferLightingPS" };
+	renderer.RegisterRootSignature("defer lighting", deferLighting, 2);
+	const auto& lightingLayout = renderer.GetRootSignatureLayout("defer lighting");
+	const char* gbuffers[] = { "gbuffer0", "gbuffer1", "gbuffer2" };
+	mLightingGBufferSlot = getSlot(lightingLayout, gbuffers[0]).rootIndex;
+	for(UINT i = 0; i < 3; ++i)
+	{
+		auto slot = getSlot(lightingLayout, gbuffers[i]);
+		if(slot.rootIndex != mLightingGBufferSlot || slot.tableOffset != i)
+			ThrowIfFailed(E_INVALIDARG);
 	}
-	{ // defer lighting
-		CD3DX12_DESCRIPTOR_RANGE texTable;
-		texTable.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 3, 0);
+	mLightingPassSlot = getSlot(lightingLayout, "cbPass").rootIndex;
 
-		// Root parameter can be a table, root descriptor or root constants.
-		CD3DX12_ROOT_PARAMETER slotRootParameter[4];
-
-		// Perfomance TIP: Order from most frequent to least frequent.
-		slotRootParameter[0].InitAsDescriptorTable(1, &texTable, D3D12_SHADER_VISIBILITY_PIXEL);
-		slotRootParameter[1].InitAsConstantBufferView(0);
-		slotRootParameter[2].InitAsConstantBufferView(1);
-		slotRootParameter[3].InitAsConstantBufferView(2);
-
-		auto staticSamplers = Ubpa::DXRenderer::Instance().GetStaticSamplers();
-
-		// A root signature is an array of root parameters.
-		CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(4, slotRootParameter,
-			(UINT)staticSamplers.size(), staticSamplers.data(),
-			D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
-
-		Ubpa::DXRenderer::Instance().RegisterRootSignature("defer lighting", &rootSigDesc);
-	}
+	// Only the blobs registered above are written, those of edited shaders drop out.
+	std::error_code ec;
+	std::filesystem::create_directories(cachePath.parent_path(), ec);
+	renderer.SaveRootSignatureCache(cachePath);
 }
 
 void DeferApp::BuildDescriptorHeaps()
@@ -712,62 +1077,180 @@ void DeferApp::BuildDescriptorHeaps()
 
 void DeferApp::BuildShadersAndInputLayout()
 {
-	Ubpa::DXRenderer::Instance().RegisterShaderByteCode("standardVS",
-		L"..\\data\\shaders\\01_defer\\Default.hlsl", nullptr, "VS", "vs_5_0");
-	Ubpa::DXRenderer::Instance().RegisterShaderByteCode("opaquePS",
-		L"..\\data\\shaders\\01_defer\\Default.hlsl", nullptr, "PS", "ps_5_0");
-	Ubpa::DXRenderer::Instance().RegisterShaderByteCode("screenVS",
-		L"..\\data\\shaders\\01_defer\\Screen.hlsl", nullptr, "VS", "vs_5_0");
-	Ubpa::DXRenderer::Instance().RegisterShaderByteCode("screenPS",
-		L"..\\data\\shaders\\01_defer\\Screen.hlsl", nullptr, "PS", "ps_5_0");
-	Ubpa::DXRenderer::Instance().RegisterShaderByteCode("geometryVS",
-		L"..\\data\\shaders\\01_defer\\Geometry.hlsl", nullptr, "VS", "vs_5_0");
-	Ubpa::DXRenderer::Instance().RegisterShaderByteCode("geometryPS",
-		L"..\\data\\shaders\\01_defer\\Geometry.hlsl", nullptr, "PS", "ps_5_0");
-	Ubpa::DXRenderer::Instance().RegisterShaderByteCode("deferLightingVS",
-		L"..\\data\\shaders\\01_defer\\deferLighting.hlsl", nullptr, "VS", "vs_5_0");
-	Ubpa::DXRenderer::Instance().RegisterShaderByteCode("deferLightingPS",
-		L"..\\data\\shaders\\01_defer\\deferLighting.hlsl", nullptr, "PS", "ps_5_0");
+	auto registerShader = [this](const char* name, const char* file, const char* entrypoint, const char* target)
+	{
+		// Hot reload watches the source files, not the archive.
+		if(mAssets.IsOpen() && !Ubpa::DXRenderer::Instance().IsShaderHotReloadEnabled())
+		{
+			Ubpa::DXRenderer::Instance().RegisterShaderByteCode(name, mAssets,
+				std::string("shaders/01_defer/") + file, nullptr, entrypoint, target);
+		}
+		else
+		{
+			Ubpa::DXRenderer::Instance().RegisterShaderByteCode(name,
+				L"..\\data\\shaders\\01_defer\\" + std::wstring(file, file + strlen(file)), nullptr, entrypoint, target);
+		}
+	};
+
+	registerShader("standardVS", "Default.hlsl", "VS", "vs_5_0");
+	registerShader("opaquePS", "Default.hlsl", "PS", "ps_5_0");
+	registerShader("screenVS", "Screen.hlsl", "VS", "vs_5_0");
+	registerShader("screenPS", "Screen.hlsl", "PS", "ps_5_0");
+	registerShader("geometryVS", "Geometry.hlsl", "VS", "vs_5_1");
+	registerShader("geometryPS", "Geometry.hlsl", "PS", "ps_5_1");
+	registerShader("deferLightingVS", "deferLighting.hlsl", "VS", "vs_5_0");
+	registerShader("deferLightingPS", "deferLighting.hlsl", "PS", "ps_5_0");
 	
-    mInputLayout =
-    {
-        { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-        { "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 24, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-    };
+    mInputLayout = Ubpa::VertexCompression::ToD3D12InputLayout(
+		Ubpa::VertexCompression::MakeLayout(mVertexDesc));
 }
 
 void DeferApp::BuildShapeGeometry()
 {
-    GeometryGenerator geoGen;
-	GeometryGenerator::MeshData box = geoGen.CreateBox(1.0f, 1.0f, 1.0f, 3);
- 
-	Ubpa::UDX12::SubmeshGeometry boxSubmesh;
-	boxSubmesh.IndexCount = (UINT)box.Indices32.size();
-	boxSubmesh.StartIndexLocation = 0;
-	boxSubmesh.BaseVertexLocation = 0;
+	// The shapes are cooked once into a mesh asset and mapped on later launches, its vertex
+	// and index sections are uploaded as they are.  Generating them is cheap, the cook is not:
+	// the asset is keyed by the generated meshes and the cook settings.
+	const UINT vertexStride = Ubpa::VertexCompression::MakeLayout(mVertexDesc).stride;
+	const std::filesystem::path assetPath = std::filesystem::path(gCacheDir) / L"shapes.umesh";
+	std::vector<ShapeSource> shapes = GenerateShapes();
+	const std::uint64_t contentKey = ShapesContentKey(shapes);
+
+	Ubpa::MappedFile file;
+	Ubpa::MeshAsset::View asset;
+	std::vector<std::uint8_t> cooked;
+	if(Ubpa::MeshAsset::Load(assetPath, file, asset) != Ubpa::MeshAsset::Error::None
+		|| asset.GetHeader().contentKey != contentKey
+		|| asset.GetHeader().vertexStride != vertexStride)
+	{
+		file.Close();
+		cooked = CookShapes(shapes, contentKey);
+		// Without a writable cache directory the shapes are just cooked on every launch.
+		std::error_code ec;
+		std::filesystem::create_directories(assetPath.parent_path(), ec);
+		Ubpa::MeshAsset::Save(assetPath, cooked);
+		ThrowIfFailed(asset.Init(cooked.data(), cooked.size()) == Ubpa::MeshAsset::Error::None ? S_OK : E_FAIL);
+	}
 
- 
-	std::vector<Vertex> vertices(box.Vertices.size());
+	// Static meshes share the buffers of one pool, uploaded through the transfer engine.
+	// The cook writes 16-bit indices unless a shape has more than 65536 vertices (Init
+	// has checked the size is 2 or 4).
+	const DXGI_FORMAT indexFormat = asset.GetHeader().indexSize == sizeof(std::uint16_t)
+		? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+	Ubpa::DXRenderer::Instance().RegisterMeshPool("static",
+		vertexStride, 64 * 1024, indexFormat, 192 * 1024);
+
+	for(size_t i = 0; i < asset.GetSubmeshNum(); ++i)
+		RegisterStaticMesh(asset, asset.GetSubmesh(i));
+}
 
-	for(size_t i = 0; i < box.Vertices.size(); ++i)
+std::vector<ShapeSource> DeferApp::GenerateShapes()
+{
+    GeometryGenerator geoGen;
+	std::vector<ShapeSource> shapes;
+	shapes.push_back({ "box", geoGen.CreateBox(1.0f, 1.0f, 1.0f, 3) });
+	shapes.push_back({ "sphere", geoGen.CreateSphere(0.5f, 40, 40) });
+	return shapes;
+}
+
+std::uint64_t DeferApp::ShapesContentKey(const std::vector<ShapeSource>& shapes)const
+{
+	// A change of the generated meshes (generator arguments or code) or of a cook setting
+	// changes the key.
+	const Ubpa::MeshOptimizer::Config optimizerConfig; // GeometryGenerator::MeshData::Optimize
+	std::uint64_t key = Ubpa::MeshAsset::HashContent(&mVertexDesc, sizeof(mVertexDesc));
+	key = Ubpa::MeshAsset::HashContent(&optimizerConfig, sizeof(optimizerConfig), key);
+	key = Ubpa::MeshAsset::HashContent(&gMeshletConfig, sizeof(gMeshletConfig), key);
+	key = Ubpa::MeshAsset::HashContent(&gLodConfig, sizeof(gLodConfig), key);
+	for(const auto& shape : shapes)
 	{
-		vertices[i].Pos = box.Vertices[i].Position;
-		vertices[i].Normal = box.Vertices[i].Normal;
-		vertices[i].TexC = box.Vertices[i].TexC;
+		key = Ubpa::MeshAsset::HashContent(shape.Name.data(), shape.Name.size(), key);
+		key = Ubpa::MeshAsset::HashContent(shape.Mesh.Vertices.data(),
+			shape.Mesh.Vertices.size() * sizeof(GeometryGenerator::Vertex), key);
+		key = Ubpa::MeshAsset::HashContent(shape.Mesh.Indices32.data(),
+			shape.Mesh.Indices32.size() * sizeof(std::uint32_t), key);
 	}
+	return key;
+}
 
-	std::vector<std::uint16_t> indices = box.GetIndices16();
+std::vector<std::uint8_t> DeferApp::CookShapes(std::vector<ShapeSource>& shapes, std::uint64_t contentKey)
+{
+	std::vector<CookedMesh> cookedMeshes(shapes.size());
+	std::vector<Ubpa::MeshAsset::SubmeshSource> submeshes;
+	for(size_t i = 0; i < shapes.size(); ++i)
+		submeshes.push_back(CookStaticMesh(shapes[i].Name, shapes[i].Mesh, cookedMeshes[i]));
+
+	Ubpa::MeshAsset::Config config;
+	config.vertexStride = Ubpa::VertexCompression::MakeLayout(mVertexDesc).stride;
+	config.vertexDesc = mVertexDesc;
+	config.contentKey = contentKey;
+	return Ubpa::MeshAsset::Serialize(submeshes, config);
+}
 
-    const UINT vbByteSize = (UINT)vertices.size() * sizeof(Vertex);
-    const UINT ibByteSize = (UINT)indices.size()  * sizeof(std::uint16_t);
+Ubpa::MeshAsset::SubmeshSource DeferApp::CookStaticMesh(const std::string& name,
+	GeometryGenerator::MeshData& mesh, CookedMesh& cooked)
+{
+	mesh.Optimize();
+	const void* positions = &mesh.Vertices[0].Position;
+	const size_t positionStride = sizeof(GeometryGenerator::Vertex);
+
+	// LOD 0 in meshlet order, each meshlet is a contiguous index range.  The coarser
+	// LODs are simplified from it and appended to the same indices.
+	cooked.Meshlets = Ubpa::Meshlets::Build(mesh.Indices32.data(), mesh.Indices32.size(),
+		positions, mesh.Vertices.size(), positionStride, gMeshletConfig);
+	std::vector<std::uint32_t> meshletIndices(cooked.Meshlets.GetTriangleNum() * 3);
+	Ubpa::Meshlets::UnpackIndices(cooked.Meshlets, meshletIndices.data());
+	auto lodChain = Ubpa::MeshSimplifier::GenerateLods(meshletIndices.data(), meshletIndices.size(),
+		positions, mesh.Vertices.size(), positionStride, gLodConfig);
+	cooked.Indices = std::move(lodChain.indices);
+	cooked.Lods = std::move(lodChain.lods);
+
+	Ubpa::VertexCompression::SourceMesh source;
+	source.vertexNum = mesh.Vertices.size();
+	source.positions = { positions, positionStride };
+	source.normals = { &mesh.Vertices[0].Normal, positionStride };
+	source.uvs = { &mesh.Vertices[0].TexC, positionStride };
+	auto vertices = Ubpa::VertexCompression::Encode(source, mVertexDesc);
+	cooked.Vertices = std::move(vertices.vertices);
+
+	Ubpa::MeshAsset::SubmeshSource submesh;
+	submesh.name = name;
+	submesh.vertices = cooked.Vertices.data();
+	submesh.vertexNum = vertices.vertexNum;
+	submesh.indices = cooked.Indices.data();
+	submesh.indexNum = cooked.Indices.size();
+	submesh.lods = cooked.Lods.data();
+	submesh.lodNum = cooked.Lods.size();
+	submesh.meshlets = &cooked.Meshlets;
+	submesh.quantization = vertices.quantization;
+	submesh.uvDensity = Ubpa::TextureStreamer::ComputeUVDensity(mesh.Indices32.data(), mesh.Indices32.size(),
+		positions, positionStride, &mesh.Vertices[0].TexC, positionStride);
+
+	// Bounding sphere of the quantization bounds.
+	const auto& quant = vertices.quantization;
+	for(int i = 0; i < 3; ++i)
+		submesh.center[i] = quant.min[i] + 0.5f*quant.extent[i];
+	submesh.radius = 0.5f*sqrtf(quant.extent[0]*quant.extent[0]
+		+ quant.extent[1]*quant.extent[1] + quant.extent[2]*quant.extent[2]);
+	return submesh;
+}
 
-	Ubpa::DXRenderer::Instance()
-		.RegisterStaticMeshGeometry(
-			Ubpa::DXRenderer::Instance().GetUpload(), "boxGeo",
-			vertices.data(), (UINT)vertices.size(), sizeof(Vertex),
-			indices.data(), (UINT)indices.size(), DXGI_FORMAT_R16_UINT)
-		.submeshGeometries["box"] = boxSubmesh;
+void DeferApp::RegisterStaticMesh(const Ubpa::MeshAsset::View& asset, const Ubpa::MeshAsset::Submesh& submesh)
+{
+	std::string name(asset.GetName(submesh));
+
+	// The staging copy reads the vertices and indices straight from the asset.
+	Ubpa::DXRenderer::Instance().UploadPooledMeshGeometry(
+		"static", name,
+		asset.GetVertices(submesh), submesh.vertexNum,
+		asset.GetIndices(submesh), submesh.indexNum);
+	Ubpa::DXRenderer::Instance().RegisterMeshlets(name, asset.GetMeshlets(submesh));
+	mPosQuantizations[name] = asset.GetQuantization(submesh);
+	mUVDensities[name] = submesh.uvDensity;
+
+	const Ubpa::MeshSimplifier::Lod* lods = asset.GetLods(submesh);
+	mLodSelectors.emplace(name, Ubpa::LodSelector::FromErrors(lods, submesh.lodNum, submesh.radius));
+	Ubpa::DXRenderer::Instance().RegisterMeshLods(name,
+		std::vector<Ubpa::MeshSimplifier::Lod>(lods, lods + submesh.lodNum));
 }
 
 void DeferApp::BuildPSOs()
@@ -820,12 +1303,14 @@ void DeferApp::BuildFrameResources()
 		fr->RegisterResource("gbPass constants",
 			Ubpa::UDX12::ArrayUploadBuffer<PassConstants>{ uDevice.raw.Get(), 1, true });
 
-		fr->RegisterResource("ArrayUploadBuffer<MaterialConstants>",
-			Ubpa::UDX12::ArrayUploadBuffer<MaterialConstants>{ uDevice.raw.Get(), mMaterials.size(), true });
-
 		fr->RegisterResource("ArrayUploadBuffer<ObjectConstants>",
 			Ubpa::UDX12::ArrayUploadBuffer<ObjectConstants>{ uDevice.raw.Get(), mAllRitems.size(), true });
 
+		TrackResource(fr->GetResource<Ubpa::UDX12::ArrayUploadBuffer<PassConstants>>("gbPass constants").GetResource(),
+			Ubpa::MemoryTracker::Category::Upload, "pass constants " + std::to_string(i));
+		TrackResource(fr->GetResource<Ubpa::UDX12::ArrayUploadBuffer<ObjectConstants>>("ArrayUploadBuffer<ObjectConstants>").GetResource(),
+			Ubpa::MemoryTracker::Category::Upload, "object constants " + std::to_string(i));
+
 		auto fgRsrcMngr = std::make_shared<Ubpa::UDX12::FG::RsrcMngr>();
 		fgRsrcMngr->Init(uGCmdList, uDevice);
 		fr->RegisterResource("FrameGraphRsrcMngr", fgRsrcMngr);
@@ -836,62 +1321,80 @@ void DeferApp::BuildFrameResources()
 
 void DeferApp::BuildMaterials()
 {
-	auto woodCrate = std::make_unique<Material>();
-	woodCrate->Name = "iron";
-	woodCrate->MatCBIndex = 0;
-	woodCrate->DiffuseSrvGpuHandle = Ubpa::DXRenderer::Instance().GetTextureSrvGpuHandle("iron");
-	woodCrate->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
-	woodCrate->FresnelR0 = XMFLOAT3(0.05f, 0.05f, 0.05f);
-	woodCrate->Roughness = 0.2f;
-
-	mMaterials["woodCrate"] = std::move(woodCrate);
+	auto& renderer = Ubpa::DXRenderer::Instance();
+
+	// The layout of MaterialData comes from the pixel shader, no CPU mirror of the struct.
+	auto layout = Ubpa::D3D12MaterialTable::Reflect(renderer.GetShaderByteCode("geometryPS"), "gMaterials");
+	mMaterials = std::make_unique<Ubpa::D3D12MaterialTable>(uDevice.raw.Get(), std::move(layout),
+		64, gNumFrameResources, &renderer.GetMemoryTracker(), "materials");
+
+	// Materials are named after their texture.
+	auto& materials = mMaterials->GetTable();
+	XMFLOAT4X4 matTransform;
+	XMStoreFloat4x4(&matTransform, XMMatrixTranspose(XMMatrixIdentity()));
+	auto iron = materials.Create("iron");
+	materials.Set(iron, materials.FindParam("DiffuseAlbedo"), XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f));
+	materials.Set(iron, materials.FindParam("FresnelR0"), XMFLOAT3(0.05f, 0.05f, 0.05f));
+	materials.Set(iron, materials.FindParam("Roughness"), 0.2f);
+	materials.Set(iron, materials.FindParam("MatTransform"), matTransform);
+	materials.Set(iron, materials.FindParam("DiffuseMapIndex"), renderer.GetTextureBindlessIndex("iron"));
 }
 
 void DeferApp::BuildRenderItems()
 {
-	auto boxRitem = std::make_unique<RenderItem>();
-	boxRitem->ObjCBIndex = 0;
-	boxRitem->Mat = mMaterials["woodCrate"].get();
-	boxRitem->Geo = &Ubpa::DXRenderer::Instance().GetMeshGeometry("boxGeo");
-	boxRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	boxRitem->IndexCount = boxRitem->Geo->submeshGeometries["box"].IndexCount;
-	boxRitem->StartIndexLocation = boxRitem->Geo->submeshGeometries["box"].StartIndexLocation;
-	boxRitem->BaseVertexLocation = boxRitem->Geo->submeshGeometries["box"].BaseVertexLocation;
-	mAllRitems.push_back(std::move(boxRitem));
-
-	// All the render items are opaque.
+	auto& renderer = Ubpa::DXRenderer::Instance();
+	auto makeRitem = [&](const std::string& mesh, UINT objCBIndex, FXMMATRIX world)
+	{
+		auto ritem = std::make_unique<RenderItem>();
+		XMStoreFloat4x4(&ritem->World, world);
+		ritem->ObjCBIndex = objCBIndex;
+		ritem->Mat = mMaterials->GetTable().Find("iron");
+		ritem->Pool = &renderer.GetPooledMeshGeometryPool(mesh);
+		ritem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+		ritem->PosQuantization = mPosQuantizations[mesh];
+		ritem->UVDensity = mUVDensities[mesh];
+
+		const auto& pooledMesh = renderer.GetPooledMeshGeometry(mesh);
+		const auto& lods = renderer.GetMeshLods(mesh);
+		Ubpa::DrawList::Item item;
+		item.buffers = ritem->Pool;
+		std::copy(&ritem->World.m[0][0], &ritem->World.m[0][0] + 16, item.world);
+		// Bounding sphere of the quantization bounds.
+		const auto& quant = ritem->PosQuantization;
+		for(int i = 0; i < 3; ++i)
+			item.center[i] = quant.min[i] + 0.5f*quant.extent[i];
+		item.radius = 0.5f*sqrtf(quant.extent[0]*quant.extent[0] + quant.extent[1]*quant.extent[1] + quant.extent[2]*quant.extent[2]);
+		item.indexNum = lods[0].indexNum;
+		item.startIndex = pooledMesh.StartIndexLocation();
+		item.baseVertex = pooledMesh.BaseVertexLocation();
+		item.lods = lods.data();
+		item.lodNum = lods.size();
+		item.lodSelector = &mLodSelectors.at(mesh);
+		item.meshlets = &renderer.GetMeshlets(mesh);
+		ritem->DrawID = mDrawList.Add(item);
+		return ritem;
+	};
+
+	mAllRitems.push_back(makeRitem("box", 0, XMMatrixIdentity()));
+	mAllRitems.push_back(makeRitem("sphere", 1, XMMatrixTranslation(0.0f, 1.25f, 0.0f)));
+
+	// All the render items are opaque, DrawRenderItems maps the ids of the draw list back to them.
 	for(auto& e : mAllRitems)
+	{
+		assert(e->DrawID == mOpaqueRitems.size());
 		mOpaqueRitems.push_back(e.get());
+	}
 }
 
-void DeferApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems)
+void DeferApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList)
 {
-    UINT objCBByteSize = Ubpa::UDX12::Util::CalcConstantBufferByteSize(sizeof(ObjectConstants));
-    UINT matCBByteSize = Ubpa::UDX12::Util::CalcConstantBufferByteSize(sizeof(MaterialConstants));
- 
+	UDXR_PROFILE_FUNCTION();
+
 	auto objectCB = mCurrFrameRsrcMngr
 		->GetResource<Ubpa::UDX12::ArrayUploadBuffer<ObjectConstants>>("ArrayUploadBuffer<ObjectConstants>")
 		.GetResource();
-	auto matCB = mCurrFrameRsrcMngr
-		->GetResource<Ubpa::UDX12::ArrayUploadBuffer<MaterialConstants>>("ArrayUploadBuffer<MaterialConstants>")
-		.GetResource();
 
-    // For each render item...
-    for(size_t i = 0; i < ritems.size(); ++i)
-    {
-        auto ri = ritems[i];
-
-        cmdList->IASetVertexBuffers(0, 1, &ri->Geo->VertexBufferView());
-        cmdList->IASetIndexBuffer(&ri->Geo->IndexBufferView());
-        cmdList->IASetPrimitiveTopology(ri->PrimitiveType);
-
-        D3D12_GPU_VIRTUAL_ADDRESS objCBAddress = objectCB->GetGPUVirtualAddress() + ri->ObjCBIndex*objCBByteSize;
-		D3D12_GPU_VIRTUAL_ADDRESS matCBAddress = matCB->GetGPUVirtualAddress() + ri->Mat->MatCBIndex*matCBByteSize;
-
-		cmdList->SetGraphicsRootDescriptorTable(0, ri->Mat->DiffuseSrvGpuHandle);
-        cmdList->SetGraphicsRootConstantBufferView(1, objCBAddress);
-        cmdList->SetGraphicsRootConstantBufferView(3, matCBAddress);
-
-        cmdList->DrawIndexedInstanced(ri->IndexCount, 1, ri->StartIndexLocation, ri->BaseVertexLocation, 0);
-    }
+	// The LODs and visible meshlets were picked by the cull stage in Update.
+	CommandListDrawDevice device(cmdList, mOpaqueRitems, objectCB->GetGPUVirtualAddress(), mGeometryObjectSlot);
+	mDrawList.Record(device);
 }
@@ -0,0 +1,279 @@
+// Runs the CPU stages of a 01_defer frame without a device, so CI can track renderer CPU
+// regressions on every platform: the scripted camera (update), LOD selection and meshlet
+// culling (cull), sorting (sort), recording into a StubDrawDevice (record) and, if UFG is
+// available, the frame graph compile (fg_compile).
+// usage: UDXRenderer_test_bench_cpu_frame [frames] [timings path, .json or .csv]
+
+#include <UDXRenderer/DrawList.h>
+#include <UDXRenderer/FrameStats.h>
+
+#if __has_include(<UFG/UFG.h>)
+#include <UFG/UFG.h>
+#define UDXR_BENCH_FRAME_GRAPH 1
+#else
+#define UDXR_BENCH_FRAME_GRAPH 0
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+	const float Pi = 3.14159265f;
+
+	struct Float3
+	{
+		float x, y, z;
+	};
+
+	Float3 Sub(const Float3& a, const Float3& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+	float Dot(const Float3& a, const Float3& b) { return a.x*b.x + a.y*b.y + a.z*b.z; }
+	Float3 Cross(const Float3& a, const Float3& b)
+	{
+		return { a.y*b.z - a.z*b.y, a.z*b.x - a.x*b.z, a.x*b.y - a.y*b.x };
+	}
+	Float3 Normalize(const Float3& a)
+	{
+		float l = sqrtf(Dot(a, a));
+		return { a.x / l, a.y / l, a.z / l };
+	}
+
+	// The cooked static mesh of 01_defer: LOD 0 in meshlet order, then the coarser LODs.
+	struct Mesh
+	{
+		vector<Float3> Positions;
+		Ubpa::Meshlets::MeshletMesh Meshlets;
+		Ubpa::MeshSimplifier::LodChain Lods;
+		unique_ptr<Ubpa::LodSelector> LodSelector;
+	};
+
+	// Unit UV sphere, front faces point outwards.
+	Mesh CreateSphere(uint32_t slices, uint32_t stacks)
+	{
+		Mesh mesh;
+		auto& positions = mesh.Positions;
+		for(uint32_t i = 0; i <= stacks; ++i)
+		{
+			float phi = Pi*i / stacks;
+			for(uint32_t j = 0; j <= slices; ++j)
+			{
+				float theta = 2.0f*Pi*j / slices;
+				positions.push_back({ sinf(phi)*cosf(theta), cosf(phi), sinf(phi)*sinf(theta) });
+			}
+		}
+		vector<uint32_t> indices;
+		auto add = [&](uint32_t a, uint32_t b, uint32_t c)
+		{
+			Float3 n = Cross(Sub(positions[b], positions[a]), Sub(positions[c], positions[a]));
+			if(Dot(n, n) < 1e-14f)
+				return; // degenerate at the poles
+			if(Dot(n, positions[a]) < 0.0f)
+				swap(b, c);
+			indices.insert(indices.end(), { a, b, c });
+		};
+		for(uint32_t i = 0; i < stacks; ++i)
+		{
+			for(uint32_t j = 0; j < slices; ++j)
+			{
+				uint32_t v00 = i*(slices + 1) + j;
+				uint32_t v10 = v00 + slices + 1;
+				add(v00, v10, v00 + 1);
+				add(v00 + 1, v10, v10 + 1);
+			}
+		}
+
+		mesh.Meshlets = Ubpa::Meshlets::Build(indices.data(), indices.size(),
+			positions.data(), positions.size(), sizeof(Float3));
+		vector<uint32_t> meshletIndices(mesh.Meshlets.GetTriangleNum() * 3);
+		Ubpa::Meshlets::UnpackIndices(mesh.Meshlets, meshletIndices.data());
+		mesh.Lods = Ubpa::MeshSimplifier::GenerateLods(meshletIndices.data(), meshletIndices.size(),
+			positions.data(), positions.size(), sizeof(Float3));
+		mesh.LodSelector = make_unique<Ubpa::LodSelector>(
+			Ubpa::LodSelector::FromErrors(mesh.Lods.lods.data(), mesh.Lods.lods.size(), 1.0f));
+		return mesh;
+	}
+
+	// XMMatrixLookAtLH
+	void LookAt(const Float3& eye, const Float3& target, float view[16])
+	{
+		Float3 z = Normalize(Sub(target, eye));
+		Float3 x = Normalize(Cross({ 0.0f, 1.0f, 0.0f }, z));
+		Float3 y = Cross(z, x);
+		const float m[16] = {
+			x.x, y.x, z.x, 0.0f,
+			x.y, y.y, z.y, 0.0f,
+			x.z, y.z, z.z, 0.0f,
+			-Dot(x, eye), -Dot(y, eye), -Dot(z, eye), 1.0f };
+		copy(m, m + 16, view);
+	}
+
+	// XMMatrixPerspectiveFovLH, the projection of D3DApp::OnResize
+	void Perspective(float aspect, float proj[16])
+	{
+		float yScale = 1.0f / tanf(0.125f*Pi);
+		float n = 1.0f;
+		float f = 1000.0f;
+		const float m[16] = {
+			yScale / aspect, 0.0f, 0.0f, 0.0f,
+			0.0f, yScale, 0.0f, 0.0f,
+			0.0f, 0.0f, f / (f - n), 1.0f,
+			0.0f, 0.0f, -n*f / (f - n), 0.0f };
+		copy(m, m + 16, proj);
+	}
+
+#if UDXR_BENCH_FRAME_GRAPH
+	// The frame graph of DeferApp::Draw.
+	bool CompileFrameGraph(Ubpa::UFG::FrameGraph& fg, Ubpa::UFG::Compiler& compiler)
+	{
+		fg.Clear();
+		auto gbuffer0 = fg.RegisterResourceNode("GBuffer0");
+		auto gbuffer1 = fg.RegisterResourceNode("GBuffer1");
+		auto gbuffer2 = fg.RegisterResourceNode("GBuffer2");
+		auto backbuffer = fg.RegisterResourceNode("Back Buffer");
+		auto depthstencil = fg.RegisterResourceNode("Depth Stencil");
+		fg.RegisterPassNode(
+			"GBuffer Pass",
+			{},
+			{ gbuffer0,gbuffer1,gbuffer2,depthstencil }
+		);
+		fg.RegisterPassNode(
+			"Defer Lighting",
+			{ gbuffer0,gbuffer1,gbuffer2 },
+			{ backbuffer }
+		);
+		auto [success, crst] = compiler.Compile(fg);
+		return success;
+	}
+#endif
+}
+
+int main(int argc, char** argv)
+{
+	int frameNum = argc > 1 ? max(1, atoi(argv[1])) : 1000;
+	string timingsPath = argc > 2 ? argv[2] : "";
+
+	const uint32_t width = 1280;
+	const uint32_t height = 720;
+
+	// A grid of spheres in two mesh pools, every other one at a finer tessellation.
+	Mesh meshes[2] = { CreateSphere(96, 64), CreateSphere(48, 32) };
+	const int gridSize = 24;
+	const float spacing = 3.0f;
+	Ubpa::DrawList drawList;
+	for(int i = 0; i < gridSize; ++i)
+	{
+		for(int j = 0; j < gridSize; ++j)
+		{
+			const Mesh& mesh = meshes[(i + j) % 2];
+			Ubpa::DrawList::Item item;
+			item.buffers = &mesh;
+			float scale = 0.5f + 0.25f*((i*7 + j*3) % 5);
+			item.world[0] = item.world[5] = item.world[10] = scale;
+			item.world[12] = spacing*(i - 0.5f*(gridSize - 1));
+			item.world[13] = scale;
+			item.world[14] = spacing*(j - 0.5f*(gridSize - 1));
+			item.radius = 1.0f;
+			item.indexNum = mesh.Lods.lods[0].indexNum;
+			item.lods = mesh.Lods.lods.data();
+			item.lodNum = mesh.Lods.lods.size();
+			item.lodSelector = mesh.LodSelector.get();
+			item.meshlets = &mesh.Meshlets;
+			drawList.Add(item);
+		}
+	}
+
+	Ubpa::FrameStats stats(frameNum);
+	size_t updateStage = stats.RegisterStage("update");
+	size_t cullStage = stats.RegisterStage("cull");
+	size_t sortStage = stats.RegisterStage("sort");
+	size_t recordStage = stats.RegisterStage("record");
+
+	Ubpa::StubDrawDevice device;
+#if UDXR_BENCH_FRAME_GRAPH
+	size_t fgCompileStage = stats.RegisterStage("fg_compile");
+	Ubpa::UFG::FrameGraph fg;
+	Ubpa::UFG::Compiler fgCompiler;
+#endif
+
+	float proj[16];
+	Perspective(static_cast<float>(width) / height, proj);
+	for(int frame = 0; frame < frameNum; ++frame)
+	{
+		stats.BeginFrame();
+
+		float view[16];
+		Float3 eye;
+		{
+			// The scripted camera of DeferApp::OnHeadlessFrame, around the grid.
+			Ubpa::FrameStats::ScopedStage stage(stats, updateStage);
+			float t = frameNum > 1 ? static_cast<float>(frame) / (frameNum - 1) : 0.0f;
+			float theta = 1.3f*Pi + 2.0f*Pi*t;
+			float phi = min(max(0.4f*Pi + 0.15f*Pi*sinf(4.0f*Pi*t), 0.1f), Pi - 0.1f);
+			float radius = 10.0f + 50.0f*(0.5f - 0.5f*cosf(2.0f*Pi*t));
+			eye = { radius*sinf(phi)*cosf(theta), radius*cosf(phi), radius*sinf(phi)*sinf(theta) };
+			LookAt(eye, { 0.0f, 0.0f, 0.0f }, view);
+		}
+		{
+			Ubpa::FrameStats::ScopedStage stage(stats, cullStage);
+			drawList.Cull(view, proj, &eye.x, static_cast<float>(height));
+		}
+		{
+			Ubpa::FrameStats::ScopedStage stage(stats, sortStage);
+			drawList.Sort(view);
+		}
+		{
+			Ubpa::FrameStats::ScopedStage stage(stats, recordStage);
+			drawList.Record(device);
+		}
+#if UDXR_BENCH_FRAME_GRAPH
+		{
+			Ubpa::FrameStats::ScopedStage stage(stats, fgCompileStage);
+			if(!CompileFrameGraph(fg, fgCompiler))
+			{
+				cerr << "the frame graph doesn't compile" << endl;
+				return 1;
+			}
+		}
+#endif
+
+		stats.EndFrame();
+	}
+
+	const auto& counts = device.GetStats();
+	cout << frameNum << " frames, " << drawList.GetItemNum() << " items, per frame: "
+		<< counts.drawNum / frameNum << " draws, "
+		<< counts.bufferBindNum / frameNum << " buffer binds, "
+		<< counts.indexNum / 3 / frameNum << " triangles" << endl;
+#if !UDXR_BENCH_FRAME_GRAPH
+	cout << "UFG not found, fg_compile isn't timed" << endl;
+#endif
+
+	auto summary = stats.Summarize();
+	cout << fixed << setprecision(3)
+		<< left << setw(12) << "stage" << right << setw(10) << "mean" << setw(10) << "p50"
+		<< setw(10) << "p95" << setw(10) << "p99" << setw(10) << "max" << "  ms" << endl;
+	auto report = [](const string& name, const Ubpa::FrameStats::Percentiles& p)
+	{
+		cout << left << setw(12) << name << right << setw(10) << p.mean << setw(10) << p.p50
+			<< setw(10) << p.p95 << setw(10) << p.p99 << setw(10) << p.max << endl;
+	};
+	report("frame", summary.frame);
+	for(size_t i = 0; i < stats.GetStageNum(); ++i)
+		report(stats.GetStageName(i), summary.stages[i]);
+
+	if(!timingsPath.empty() && !stats.WriteFile(timingsPath))
+	{
+		cerr << "can't write " << timingsPath << endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,121 @@
+// Times GeometryGenerator on large meshes, single-threaded and on every hardware thread.
+// usage: UDXRenderer_test_bench_geometry [repeat]
+
+#include "../../common/GeometryGenerator.h"
+
+#include <UDXRenderer/Clock.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+	using uint32 = GeometryGenerator::uint32;
+
+	struct Output
+	{
+		vector<GeometryGenerator::Vertex> Vertices;
+		vector<uint32> Indices;
+
+		void Resize(GeometryGenerator::MeshSize size)
+		{
+			Vertices.resize(size.VertexCount);
+			Indices.resize(size.IndexCount);
+		}
+
+		bool operator==(const Output& rhs) const
+		{
+			return Indices == rhs.Indices && Vertices.size() == rhs.Vertices.size()
+				&& memcmp(Vertices.data(), rhs.Vertices.data(), Vertices.size()*sizeof(GeometryGenerator::Vertex)) == 0;
+		}
+	};
+
+	// Best of repeat runs, in milliseconds.
+	template<typename Func>
+	double Time(int repeat, const Func& func)
+	{
+		auto& clock = Ubpa::SteadyClock::Instance();
+		double best = numeric_limits<double>::max();
+		for(int i = 0; i < repeat; ++i)
+		{
+			auto begin = clock.Now();
+			func();
+			best = min(best, Ubpa::Clock::ToMilliseconds(clock.Now() - begin));
+		}
+		return best;
+	}
+
+	void Report(const string& name, GeometryGenerator::MeshSize size, double single, double parallel)
+	{
+		cout << left << setw(28) << name
+			<< right << setw(10) << size.VertexCount << " vertices"
+			<< fixed << setprecision(1)
+			<< setw(10) << single << " ms"
+			<< setw(10) << parallel << " ms"
+			<< setprecision(2) << setw(8) << single / parallel << "x" << endl;
+	}
+
+	bool BenchGrid(int repeat, uint32 m, uint32 n)
+	{
+		GeometryGenerator geoGen;
+		auto size = GeometryGenerator::GetGridSize(m, n);
+		Output single, parallel;
+		single.Resize(size);
+		parallel.Resize(size);
+
+		double singleMs = Time(repeat, [&]() {
+			geoGen.CreateGrid(100.0f, 100.0f, m, n, single.Vertices.data(), single.Indices.data(), 1);
+		});
+		double parallelMs = Time(repeat, [&]() {
+			geoGen.CreateGrid(100.0f, 100.0f, m, n, parallel.Vertices.data(), parallel.Indices.data(), 0);
+		});
+		Report("CreateGrid " + to_string(m) + "x" + to_string(n), size, singleMs, parallelMs);
+		return single == parallel;
+	}
+
+	bool BenchGeosphere(int repeat, uint32 numSubdivisions)
+	{
+		GeometryGenerator geoGen;
+		auto size = GeometryGenerator::GetGeosphereSize(numSubdivisions);
+		Output single, parallel;
+		single.Resize(size);
+		parallel.Resize(size);
+
+		double singleMs = Time(repeat, [&]() {
+			geoGen.CreateGeosphere(1.0f, numSubdivisions, single.Vertices.data(), single.Indices.data(), 1);
+		});
+		double parallelMs = Time(repeat, [&]() {
+			geoGen.CreateGeosphere(1.0f, numSubdivisions, parallel.Vertices.data(), parallel.Indices.data(), 0);
+		});
+		Report("CreateGeosphere " + to_string(numSubdivisions), size, singleMs, parallelMs);
+		return single == parallel;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int repeat = argc > 1 ? max(1, atoi(argv[1])) : 5;
+	cout << "best of " << repeat << ", 1 thread vs " << thread::hardware_concurrency() << " threads" << endl;
+
+	bool same = true;
+	same &= BenchGrid(repeat, 1024, 1024);
+	same &= BenchGrid(repeat, 2048, 2048);
+	same &= BenchGeosphere(repeat, 7);
+	same &= BenchGeosphere(repeat, 9);
+
+	if(!same)
+	{
+		cerr << "the parallel and single-threaded results differ" << endl;
+		return 1;
+	}
+	return 0;
+}
@@ -2,16 +2,12 @@
 // GameTimer.cpp by Frank Luna (C) 2011 All Rights Reserved.
 //***************************************************************************************
 
-#include <windows.h>
 #include "GameTimer.h"
 
-GameTimer::GameTimer()
-: mSecondsPerCount(0.0), mDeltaTime(-1.0), mBaseTime(0), 
-  mPausedTime(0), mPrevTime(0), mCurrTime(0), mStopped(false)
+GameTimer::GameTimer(const Ubpa::Clock& clock)
+: mClock(clock), mDeltaTime(-1.0), mBaseTime(0), 
+  mPausedTime(0), mStopTime(0), mPrevTime(0), mCurrTime(0), mStopped(false)
 {
-	__int64 countsPerSec;
-	QueryPerformanceFrequency((LARGE_INTEGER*)&countsPerSec);
-	mSecondsPerCount = 1.0 / (double)countsPerSec;
 }
 
 // Returns the total time elapsed since Reset() was called, NOT counting any
@@ -29,7 +25,7 @@ float GameTimer::TotalTime()const
 
 	if( mStopped )
 	{
-		return (float)(((mStopTime - mPausedTime)-mBaseTime)*mSecondsPerCount);
+		return (float)Ubpa::Clock::ToSeconds((mStopTime - mPausedTime)-mBaseTime);
 	}
 
 	// The distance mCurrTime - mBaseTime includes paused time,
@@ -44,7 +40,7 @@ float GameTimer::TotalTime()const
 	
 	else
 	{
-		return (float)(((mCurrTime-mPausedTime)-mBaseTime)*mSecondsPerCount);
+		return (float)Ubpa::Clock::ToSeconds((mCurrTime-mPausedTime)-mBaseTime);
 	}
 }
 
@@ -55,8 +51,7 @@ float GameTimer::DeltaTime()const
 
 void GameTimer::Reset()
 {
-	__int64 currTime;
-	QueryPerformanceCounter((LARGE_INTEGER*)&currTime);
+	std::int64_t currTime = mClock.Now();
 
 	mBaseTime = currTime;
 	mPrevTime = currTime;
@@ -66,8 +61,7 @@ void GameTimer::Reset()
 
 void GameTimer::Start()
 {
-	__int64 startTime;
-	QueryPerformanceCounter((LARGE_INTEGER*)&startTime);
+	std::int64_t startTime = mClock.Now();
 
 
 	// Accumulate the time elapsed between stop and start pairs.
@@ -90,8 +84,7 @@ void GameTimer::Stop()
 {
 	if( !mStopped )
 	{
-		__int64 currTime;
-		QueryPerformanceCounter((LARGE_INTEGER*)&currTime);
+		std::int64_t currTime = mClock.Now();
 
 		mStopTime = currTime;
 		mStopped  = true;
@@ -106,12 +99,10 @@ void GameTimer::Tick()
 		return;
 	}
 
-	__int64 currTime;
-	QueryPerformanceCounter((LARGE_INTEGER*)&currTime);
-	mCurrTime = currTime;
+	mCurrTime = mClock.Now();
 
 	// Time difference between this frame and the previous.
-	mDeltaTime = (mCurrTime - mPrevTime)*mSecondsPerCount;
+	mDeltaTime = Ubpa::Clock::ToSeconds(mCurrTime - mPrevTime);
 
 	// Prepare for next frame.
 	mPrevTime = mCurrTime;
@@ -125,3 +116,7 @@ void GameTimer::Tick()
 	}
 }
 
+void GameTimer::SetDeltaTime(double seconds)
+{
+	mDeltaTime = seconds < 0.0 ? 0.0 : seconds;
+}
@@ -5,10 +5,15 @@
 #ifndef GAMETIMER_H
 #define GAMETIMER_H
 
+#include <UDXRenderer/Clock.h>
+
+#include <cstdint>
+
+// Portable: reads a Ubpa::Clock (std::chrono::steady_clock by default) in nanoseconds.
 class GameTimer
 {
 public:
-	GameTimer();
+	explicit GameTimer(const Ubpa::Clock& clock = Ubpa::SteadyClock::Instance());
 
 	float TotalTime()const; // in seconds
 	float DeltaTime()const; // in seconds
@@ -18,15 +23,19 @@ public:
 	void Stop();  // Call when paused.
 	void Tick();  // Call every frame.
 
+	// Replace this frame's delta time, e.g. by the smoothed delta of a frame pacer.
+	void SetDeltaTime(double seconds);
+
 private:
-	double mSecondsPerCount;
+	const Ubpa::Clock& mClock;
+
 	double mDeltaTime;
 
-	__int64 mBaseTime;
-	__int64 mPausedTime;
-	__int64 mStopTime;
-	__int64 mPrevTime;
-	__int64 mCurrTime;
+	std::int64_t mBaseTime;
+	std::int64_t mPausedTime;
+	std::int64_t mStopTime;
+	std::int64_t mPrevTime;
+	std::int64_t mCurrTime;
 
 	bool mStopped;
 };
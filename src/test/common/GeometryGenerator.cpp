@@ -4,9 +4,274 @@
 
 #include "GeometryGenerator.h"
 #include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <unordered_map>
 
 using namespace DirectX;
 
+namespace
+{
+	using uint32 = GeometryGenerator::uint32;
+	using Vertex = GeometryGenerator::Vertex;
+	using MeshSize = GeometryGenerator::MeshSize;
+
+	// Smaller jobs are not worth a thread.
+	const uint32 gMinVerticesPerThread = 16*1024;
+	const uint32 gMinEdgesPerThread = 64*1024;
+
+	// Threads to split count elements over, so that each gets at least minBlockSize.
+	// threadCount 0 means one per hardware thread.
+	uint32 ThreadCount(uint32 count, uint32 threadCount, uint32 minBlockSize)
+	{
+		if(threadCount == 0)
+			threadCount = std::max(1u, std::thread::hardware_concurrency());
+		return std::min(threadCount, std::max(1u, count / std::max(1u, minBlockSize)));
+	}
+
+	// Splits [0, count) into contiguous blocks of at least minBlockSize, one per thread,
+	// and runs func(begin, end) on each.  threadCount 0 means one per hardware thread.
+	template<typename Func>
+	void ParallelFor(uint32 count, uint32 threadCount, uint32 minBlockSize, const Func& func)
+	{
+		threadCount = ThreadCount(count, threadCount, minBlockSize);
+		if(threadCount <= 1)
+		{
+			func(0u, count);
+			return;
+		}
+
+		uint32 blockSize = (count + threadCount - 1) / threadCount;
+		std::vector<std::thread> threads;
+		threads.reserve(threadCount - 1);
+		for(uint32 t = 1; t < threadCount; ++t)
+		{
+			uint32 begin = std::min(count, t*blockSize);
+			uint32 end = std::min(count, begin + blockSize);
+			threads.emplace_back([&func, begin, end]() { func(begin, end); });
+		}
+		func(0u, std::min(count, blockSize));
+		for(auto& thread : threads)
+			thread.join();
+	}
+
+	// Each subdivision adds a vertex per edge, splits each edge in two and adds three
+	// edges and three faces per face.
+	MeshSize SubdividedSize(uint32 vertexCount, uint32 edgeCount, uint32 faceCount,
+		uint32 numSubdivisions)
+	{
+		for(uint32 i = 0; i < numSubdivisions; ++i)
+		{
+			vertexCount += edgeCount;
+			edgeCount = 2*edgeCount + 3*faceCount;
+			faceCount *= 4;
+		}
+
+		MeshSize size;
+		size.VertexCount = vertexCount;
+		size.IndexCount = faceCount*3;
+		return size;
+	}
+
+	Vertex MidPoint(const Vertex& v0, const Vertex& v1)
+	{
+		XMVECTOR p0 = XMLoadFloat3(&v0.Position);
+		XMVECTOR p1 = XMLoadFloat3(&v1.Position);
+
+		XMVECTOR n0 = XMLoadFloat3(&v0.Normal);
+		XMVECTOR n1 = XMLoadFloat3(&v1.Normal);
+
+		XMVECTOR tan0 = XMLoadFloat3(&v0.TangentU);
+		XMVECTOR tan1 = XMLoadFloat3(&v1.TangentU);
+
+		XMVECTOR tex0 = XMLoadFloat2(&v0.TexC);
+		XMVECTOR tex1 = XMLoadFloat2(&v1.TexC);
+
+		// Compute the midpoints of all the attributes.  Vectors need to be normalized
+		// since linear interpolating can make them not unit length.  
+		XMVECTOR pos = 0.5f*(p0 + p1);
+		XMVECTOR normal = XMVector3Normalize(0.5f*(n0 + n1));
+		XMVECTOR tangent = XMVector3Normalize(0.5f*(tan0+tan1));
+		XMVECTOR tex = 0.5f*(tex0 + tex1);
+
+		Vertex v;
+		XMStoreFloat3(&v.Position, pos);
+		XMStoreFloat3(&v.Normal, normal);
+		XMStoreFloat3(&v.TangentU, tangent);
+		XMStoreFloat2(&v.TexC, tex);
+
+		return v;
+	}
+
+	// Splits each triangle in four.  The midpoints are appended to vertices, each edge
+	// (shared by two triangles) gets one.  Returns the new vertex count.
+	//
+	// Edge j runs from corner j of its triangle to the next corner.  The edges are hashed
+	// into one map per thread (by key), which records the first edge j with each key; the
+	// midpoints are then numbered in the order of their first edge, so the result is the
+	// same for any threadCount.
+	uint32 SubdivideOnce(Vertex* vertices, uint32 vertexCount,
+		const uint32* indices, uint32 indexCount, uint32* dstIndices, bool positionsOnly,
+		uint32 threadCount)
+	{
+		//       v1
+		//       *
+		//      / \
+		//     /   \
+		//  m0*-----*m1
+		//   / \   / \
+		//  /   \ /   \
+		// *-----*-----*
+		// v0    m2     v2
+
+		const uint32 edgeCount = indexCount;
+		auto edgeEnds = [indices](uint32 j, uint32& a, uint32& b)
+		{
+			a = indices[j];
+			b = indices[j%3 == 2 ? j - 2 : j + 1];
+		};
+		auto edgeKey = [&](uint32 j)
+		{
+			uint32 a, b;
+			edgeEnds(j, a, b);
+			return a < b ? ((std::uint64_t)a << 32 | b) : ((std::uint64_t)b << 32 | a);
+		};
+
+		const uint32 shardCount = ThreadCount(edgeCount, threadCount, gMinEdgesPerThread);
+		auto shardOf = [shardCount](std::uint64_t key)
+		{
+			return (uint32)((key*0x9E3779B97F4A7C15ull) >> 32) % shardCount;
+		};
+
+		// firstEdge[j]: the first edge with the key of edge j
+		std::vector<uint32> firstEdge(edgeCount);
+		ParallelFor(shardCount, shardCount, 1, [&](uint32 begin, uint32 end)
+		{
+			for(uint32 shard = begin; shard < end; ++shard)
+			{
+				std::unordered_map<std::uint64_t, uint32> firsts;
+				firsts.reserve(edgeCount/2/shardCount + 1);
+				for(uint32 j = 0; j < edgeCount; ++j)
+				{
+					std::uint64_t key = edgeKey(j);
+					if(shardOf(key) == shard)
+						firstEdge[j] = firsts.try_emplace(key, j).first->second;
+				}
+			}
+		});
+
+		// Count the first edges of each block, then number and build their midpoints.
+		const uint32 blockSize = (edgeCount + shardCount - 1) / shardCount;
+		std::vector<uint32> blockOffsets(shardCount + 1, 0);
+		ParallelFor(shardCount, shardCount, 1, [&](uint32 begin, uint32 end)
+		{
+			for(uint32 block = begin; block < end; ++block)
+			{
+				uint32 count = 0;
+				for(uint32 j = block*blockSize; j < std::min(edgeCount, (block + 1)*blockSize); ++j)
+					count += firstEdge[j] == j;
+				blockOffsets[block + 1] = count;
+			}
+		});
+		blockOffsets[0] = vertexCount;
+		for(uint32 block = 0; block < shardCount; ++block)
+			blockOffsets[block + 1] += blockOffsets[block];
+
+		std::vector<uint32> midPoints(edgeCount);
+		ParallelFor(shardCount, shardCount, 1, [&](uint32 begin, uint32 end)
+		{
+			for(uint32 block = begin; block < end; ++block)
+			{
+				uint32 midPoint = blockOffsets[block];
+				for(uint32 j = block*blockSize; j < std::min(edgeCount, (block + 1)*blockSize); ++j)
+				{
+					if(firstEdge[j] != j)
+						continue;
+
+					uint32 a, b;
+					edgeEnds(j, a, b);
+					if(positionsOnly)
+					{
+						XMVECTOR p0 = XMLoadFloat3(&vertices[a].Position);
+						XMVECTOR p1 = XMLoadFloat3(&vertices[b].Position);
+						XMStoreFloat3(&vertices[midPoint].Position, 0.5f*(p0 + p1));
+					}
+					else
+						vertices[midPoint] = MidPoint(vertices[a], vertices[b]);
+					midPoints[j] = midPoint++;
+				}
+			}
+		});
+
+		uint32 numTris = indexCount/3;
+		ParallelFor(numTris, threadCount, gMinEdgesPerThread/3, [&](uint32 begin, uint32 end)
+		{
+			for(uint32 i = begin; i < end; ++i)
+			{
+				uint32 v0 = indices[i*3+0];
+				uint32 v1 = indices[i*3+1];
+				uint32 v2 = indices[i*3+2];
+
+				uint32 m0 = midPoints[firstEdge[i*3+0]];
+				uint32 m1 = midPoints[firstEdge[i*3+1]];
+				uint32 m2 = midPoints[firstEdge[i*3+2]];
+
+				//
+				// Add new geometry.
+				//
+
+				uint32* dst = dstIndices + (size_t)i*12;
+				dst[0] = v0; dst[1]  = m0; dst[2]  = m2;
+				dst[3] = m0; dst[4]  = m1; dst[5]  = m2;
+				dst[6] = m2; dst[7]  = m1; dst[8]  = v2;
+				dst[9] = m0; dst[10] = v1; dst[11] = m1;
+			}
+		});
+
+		return blockOffsets[shardCount];
+	}
+
+	// The vertices of a level are a prefix of the next one, so they are built in place in
+	// vertices (sized with SubdividedSize).  The indices of the intermediate levels ping-pong
+	// between two scratch buffers, the last level is written to dstIndices.
+	uint32 Subdivide(Vertex* vertices, uint32 vertexCount,
+		const uint32* indices, uint32 indexCount, uint32 numSubdivisions,
+		uint32* dstIndices, bool positionsOnly, uint32 threadCount)
+	{
+		if(numSubdivisions == 0)
+		{
+			std::copy(indices, indices + indexCount, dstIndices);
+			return vertexCount;
+		}
+
+		std::vector<uint32> current(indices, indices + indexCount);
+		std::vector<uint32> next;
+		for(uint32 i = 0; i < numSubdivisions; ++i)
+		{
+			bool isLast = i + 1 == numSubdivisions;
+			if(!isLast)
+				next.resize(current.size()*4);
+			uint32* dst = isLast ? dstIndices : next.data();
+			vertexCount = SubdivideOnce(vertices, vertexCount, current.data(), (uint32)current.size(), dst,
+				positionsOnly, threadCount);
+			current.swap(next);
+		}
+		return vertexCount;
+	}
+}
+
+Ubpa::MeshOptimizer::Report GeometryGenerator::MeshData::Optimize()
+{
+	auto report = Ubpa::MeshOptimizer::Optimize(Indices32,
+		Vertices.data(), Vertices.size(), sizeof(Vertex), offsetof(Vertex, Position));
+	Vertices.resize(report.vertexNumAfter);
+
+	// The 16-bit copy is stale now.
+	mIndices16.clear();
+
+	return report;
+}
+
 GeometryGenerator::MeshData GeometryGenerator::CreateBox(float width, float height, float depth, uint32 numSubdivisions)
 {
     MeshData meshData;
@@ -57,7 +322,11 @@ GeometryGenerator::MeshData GeometryGenerator::CreateBox(float width, float heig
 	v[22] = Vertex(+w2, +h2, +d2, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f);
 	v[23] = Vertex(+w2, -h2, +d2, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f);
 
-	meshData.Vertices.assign(&v[0], &v[24]);
+	// Faces do not share vertices, 5 edges and 2 faces each.
+	numSubdivisions = std::min<uint32>(numSubdivisions, 6u);
+	MeshSize size = SubdividedSize(24, 30, 12, numSubdivisions);
+	meshData.Vertices.resize(size.VertexCount);
+	std::copy(&v[0], &v[24], meshData.Vertices.begin());
  
 	//
 	// Create the indices.
@@ -89,13 +358,8 @@ GeometryGenerator::MeshData GeometryGenerator::CreateBox(float width, float heig
 	i[30] = 20; i[31] = 21; i[32] = 22;
 	i[33] = 20; i[34] = 22; i[35] = 23;
 
-	meshData.Indices32.assign(&i[0], &i[36]);
-
-    // Put a cap on the number of subdivisions.
-    numSubdivisions = std::min<uint32>(numSubdivisions, 6u);
-
-    for(uint32 i = 0; i < numSubdivisions; ++i)
-        Subdivide(meshData);
+	meshData.Indices32.resize(size.IndexCount);
+	Subdivide(meshData.Vertices.data(), 24, i, 36, numSubdivisions, meshData.Indices32.data(), false, 0);
 
     return meshData;
 }
@@ -104,6 +368,25 @@ GeometryGenerator::MeshData GeometryGenerator::CreateSphere(float radius, uint32
 {
     MeshData meshData;
 
+	MeshSize size = GetSphereSize(sliceCount, stackCount);
+	meshData.Vertices.resize(size.VertexCount);
+	meshData.Indices32.resize(size.IndexCount);
+	CreateSphere(radius, sliceCount, stackCount, meshData.Vertices.data(), meshData.Indices32.data());
+
+    return meshData;
+}
+
+GeometryGenerator::MeshSize GeometryGenerator::GetSphereSize(uint32 sliceCount, uint32 stackCount)
+{
+	MeshSize size;
+	size.VertexCount = (stackCount-1)*(sliceCount+1) + 2;
+	size.IndexCount = 2*sliceCount*3 + (stackCount-2)*sliceCount*6;
+	return size;
+}
+
+void GeometryGenerator::CreateSphere(float radius, uint32 sliceCount, uint32 stackCount,
+	Vertex* vertices, uint32* indices, uint32 threadCount)
+{
 	//
 	// Compute the vertices stating at the top pole and moving down the stacks.
 	//
@@ -114,58 +397,63 @@ GeometryGenerator::MeshData GeometryGenerator::CreateSphere(float radius, uint32
 	Vertex topVertex(0.0f, +radius, 0.0f, 0.0f, +1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f);
 	Vertex bottomVertex(0.0f, -radius, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f);
 
-	meshData.Vertices.push_back( topVertex );
+	vertices[0] = topVertex;
 
 	float phiStep   = XM_PI/stackCount;
 	float thetaStep = 2.0f*XM_PI/sliceCount;
+    uint32 ringVertexCount = sliceCount + 1;
+
+	// Every ring uses the same slice angles, compute their sines and cosines once.
+	std::vector<XMFLOAT2> sliceSinCos(ringVertexCount);
+	for(uint32 j = 0; j <= sliceCount; ++j)
+		XMScalarSinCos(&sliceSinCos[j].x, &sliceSinCos[j].y, j*thetaStep);
 
 	// Compute vertices for each stack ring (do not count the poles as rings).
-	for(uint32 i = 1; i <= stackCount-1; ++i)
+	uint32 minRings = std::max(1u, gMinVerticesPerThread / ringVertexCount);
+	ParallelFor(stackCount-1, threadCount, minRings, [&](uint32 begin, uint32 end)
 	{
-		float phi = i*phiStep;
-
-		// Vertices of ring.
-        for(uint32 j = 0; j <= sliceCount; ++j)
+		for(uint32 i = begin+1; i <= end; ++i)
 		{
-			float theta = j*thetaStep;
+			float phi = i*phiStep;
+			float sinPhi, cosPhi;
+			XMScalarSinCos(&sinPhi, &cosPhi, phi);
 
-			Vertex v;
+			// Vertices of ring.
+			Vertex* ring = vertices + 1 + (size_t)(i-1)*ringVertexCount;
+			for(uint32 j = 0; j <= sliceCount; ++j)
+			{
+				float sinTheta = sliceSinCos[j].x;
+				float cosTheta = sliceSinCos[j].y;
 
-			// spherical to cartesian
-			v.Position.x = radius*sinf(phi)*cosf(theta);
-			v.Position.y = radius*cosf(phi);
-			v.Position.z = radius*sinf(phi)*sinf(theta);
+				Vertex& v = ring[j];
 
-			// Partial derivative of P with respect to theta
-			v.TangentU.x = -radius*sinf(phi)*sinf(theta);
-			v.TangentU.y = 0.0f;
-			v.TangentU.z = +radius*sinf(phi)*cosf(theta);
+				// spherical to cartesian
+				v.Position = XMFLOAT3(radius*sinPhi*cosTheta, radius*cosPhi, radius*sinPhi*sinTheta);
+				v.Normal = XMFLOAT3(sinPhi*cosTheta, cosPhi, sinPhi*sinTheta);
 
-			XMVECTOR T = XMLoadFloat3(&v.TangentU);
-			XMStoreFloat3(&v.TangentU, XMVector3Normalize(T));
+				// Partial derivative of P with respect to theta, normalized.
+				v.TangentU = XMFLOAT3(-sinTheta, 0.0f, cosTheta);
 
-			XMVECTOR p = XMLoadFloat3(&v.Position);
-			XMStoreFloat3(&v.Normal, XMVector3Normalize(p));
-
-			v.TexC.x = theta / XM_2PI;
-			v.TexC.y = phi / XM_PI;
-
-			meshData.Vertices.push_back( v );
+				v.TexC = XMFLOAT2(j*thetaStep / XM_2PI, phi / XM_PI);
+			}
 		}
-	}
+	});
 
-	meshData.Vertices.push_back( bottomVertex );
+	// South pole vertex is last.
+	uint32 southPoleIndex = (stackCount-1)*ringVertexCount + 1;
+	vertices[southPoleIndex] = bottomVertex;
 
 	//
 	// Compute indices for top stack.  The top stack was written first to the vertex buffer
 	// and connects the top pole to the first ring.
 	//
 
+	uint32* dst = indices;
     for(uint32 i = 1; i <= sliceCount; ++i)
 	{
-		meshData.Indices32.push_back(0);
-		meshData.Indices32.push_back(i+1);
-		meshData.Indices32.push_back(i);
+		*dst++ = 0;
+		*dst++ = i+1;
+		*dst++ = i;
 	}
 	
 	//
@@ -175,141 +463,64 @@ GeometryGenerator::MeshData GeometryGenerator::CreateSphere(float radius, uint32
 	// Offset the indices to the index of the first vertex in the first ring.
 	// This is just skipping the top pole vertex.
     uint32 baseIndex = 1;
-    uint32 ringVertexCount = sliceCount + 1;
-	for(uint32 i = 0; i < stackCount-2; ++i)
+	ParallelFor(stackCount-2, threadCount, minRings, [&](uint32 begin, uint32 end)
 	{
-		for(uint32 j = 0; j < sliceCount; ++j)
+		uint32* stackDst = indices + sliceCount*3 + (size_t)begin*sliceCount*6;
+		for(uint32 i = begin; i < end; ++i)
 		{
-			meshData.Indices32.push_back(baseIndex + i*ringVertexCount + j);
-			meshData.Indices32.push_back(baseIndex + i*ringVertexCount + j+1);
-			meshData.Indices32.push_back(baseIndex + (i+1)*ringVertexCount + j);
-
-			meshData.Indices32.push_back(baseIndex + (i+1)*ringVertexCount + j);
-			meshData.Indices32.push_back(baseIndex + i*ringVertexCount + j+1);
-			meshData.Indices32.push_back(baseIndex + (i+1)*ringVertexCount + j+1);
+			for(uint32 j = 0; j < sliceCount; ++j)
+			{
+				*stackDst++ = baseIndex + i*ringVertexCount + j;
+				*stackDst++ = baseIndex + i*ringVertexCount + j+1;
+				*stackDst++ = baseIndex + (i+1)*ringVertexCount + j;
+
+				*stackDst++ = baseIndex + (i+1)*ringVertexCount + j;
+				*stackDst++ = baseIndex + i*ringVertexCount + j+1;
+				*stackDst++ = baseIndex + (i+1)*ringVertexCount + j+1;
+			}
 		}
-	}
+	});
+	dst += (size_t)(stackCount-2)*sliceCount*6;
 
 	//
 	// Compute indices for bottom stack.  The bottom stack was written last to the vertex buffer
 	// and connects the bottom pole to the bottom ring.
 	//
 
-	// South pole vertex was added last.
-	uint32 southPoleIndex = (uint32)meshData.Vertices.size()-1;
-
 	// Offset the indices to the index of the first vertex in the last ring.
 	baseIndex = southPoleIndex - ringVertexCount;
 	
 	for(uint32 i = 0; i < sliceCount; ++i)
 	{
-		meshData.Indices32.push_back(southPoleIndex);
-		meshData.Indices32.push_back(baseIndex+i);
-		meshData.Indices32.push_back(baseIndex+i+1);
+		*dst++ = southPoleIndex;
+		*dst++ = baseIndex+i;
+		*dst++ = baseIndex+i+1;
 	}
-
-    return meshData;
 }
  
-void GeometryGenerator::Subdivide(MeshData& meshData)
+GeometryGenerator::MeshData GeometryGenerator::CreateGeosphere(float radius, uint32 numSubdivisions)
 {
-	// Save a copy of the input geometry.
-	MeshData inputCopy = meshData;
-
-
-	meshData.Vertices.resize(0);
-	meshData.Indices32.resize(0);
-
-	//       v1
-	//       *
-	//      / \
-	//     /   \
-	//  m0*-----*m1
-	//   / \   / \
-	//  /   \ /   \
-	// *-----*-----*
-	// v0    m2     v2
-
-	uint32 numTris = (uint32)inputCopy.Indices32.size()/3;
-	for(uint32 i = 0; i < numTris; ++i)
-	{
-		Vertex v0 = inputCopy.Vertices[ inputCopy.Indices32[i*3+0] ];
-		Vertex v1 = inputCopy.Vertices[ inputCopy.Indices32[i*3+1] ];
-		Vertex v2 = inputCopy.Vertices[ inputCopy.Indices32[i*3+2] ];
-
-		//
-		// Generate the midpoints.
-		//
-
-        Vertex m0 = MidPoint(v0, v1);
-        Vertex m1 = MidPoint(v1, v2);
-        Vertex m2 = MidPoint(v0, v2);
-
-		//
-		// Add new geometry.
-		//
-
-		meshData.Vertices.push_back(v0); // 0
-		meshData.Vertices.push_back(v1); // 1
-		meshData.Vertices.push_back(v2); // 2
-		meshData.Vertices.push_back(m0); // 3
-		meshData.Vertices.push_back(m1); // 4
-		meshData.Vertices.push_back(m2); // 5
- 
-		meshData.Indices32.push_back(i*6+0);
-		meshData.Indices32.push_back(i*6+3);
-		meshData.Indices32.push_back(i*6+5);
-
-		meshData.Indices32.push_back(i*6+3);
-		meshData.Indices32.push_back(i*6+4);
-		meshData.Indices32.push_back(i*6+5);
+    MeshData meshData;
 
-		meshData.Indices32.push_back(i*6+5);
-		meshData.Indices32.push_back(i*6+4);
-		meshData.Indices32.push_back(i*6+2);
+	MeshSize size = GetGeosphereSize(numSubdivisions);
+	meshData.Vertices.resize(size.VertexCount);
+	meshData.Indices32.resize(size.IndexCount);
+	CreateGeosphere(radius, numSubdivisions, meshData.Vertices.data(), meshData.Indices32.data());
 
-		meshData.Indices32.push_back(i*6+3);
-		meshData.Indices32.push_back(i*6+1);
-		meshData.Indices32.push_back(i*6+4);
-	}
+    return meshData;
 }
 
-GeometryGenerator::Vertex GeometryGenerator::MidPoint(const Vertex& v0, const Vertex& v1)
+GeometryGenerator::MeshSize GeometryGenerator::GetGeosphereSize(uint32 numSubdivisions)
 {
-    XMVECTOR p0 = XMLoadFloat3(&v0.Position);
-    XMVECTOR p1 = XMLoadFloat3(&v1.Position);
-
-    XMVECTOR n0 = XMLoadFloat3(&v0.Normal);
-    XMVECTOR n1 = XMLoadFloat3(&v1.Normal);
-
-    XMVECTOR tan0 = XMLoadFloat3(&v0.TangentU);
-    XMVECTOR tan1 = XMLoadFloat3(&v1.TangentU);
-
-    XMVECTOR tex0 = XMLoadFloat2(&v0.TexC);
-    XMVECTOR tex1 = XMLoadFloat2(&v1.TexC);
-
-    // Compute the midpoints of all the attributes.  Vectors need to be normalized
-    // since linear interpolating can make them not unit length.  
-    XMVECTOR pos = 0.5f*(p0 + p1);
-    XMVECTOR normal = XMVector3Normalize(0.5f*(n0 + n1));
-    XMVECTOR tangent = XMVector3Normalize(0.5f*(tan0+tan1));
-    XMVECTOR tex = 0.5f*(tex0 + tex1);
-
-    Vertex v;
-    XMStoreFloat3(&v.Position, pos);
-    XMStoreFloat3(&v.Normal, normal);
-    XMStoreFloat3(&v.TangentU, tangent);
-    XMStoreFloat2(&v.TexC, tex);
-
-    return v;
+	// Icosahedron.
+	return SubdividedSize(12, 30, 20, std::min<uint32>(numSubdivisions, MaxGeosphereSubdivisions));
 }
 
-GeometryGenerator::MeshData GeometryGenerator::CreateGeosphere(float radius, uint32 numSubdivisions)
+void GeometryGenerator::CreateGeosphere(float radius, uint32 numSubdivisions,
+	Vertex* vertices, uint32* indices, uint32 threadCount)
 {
-    MeshData meshData;
-
 	// Put a cap on the number of subdivisions.
-    numSubdivisions = std::min<uint32>(numSubdivisions, 6u);
+    numSubdivisions = std::min<uint32>(numSubdivisions, MaxGeosphereSubdivisions);
 
 	// Approximate a sphere by tessellating an icosahedron.
 
@@ -334,49 +545,49 @@ GeometryGenerator::MeshData GeometryGenerator::CreateGeosphere(float radius, uin
 		10,1,6, 11,0,9, 2,11,9, 5,2,9,  11,2,7 
 	};
 
-    meshData.Vertices.resize(12);
-    meshData.Indices32.assign(&k[0], &k[60]);
-
 	for(uint32 i = 0; i < 12; ++i)
-		meshData.Vertices[i].Position = pos[i];
+		vertices[i].Position = pos[i];
 
-	for(uint32 i = 0; i < numSubdivisions; ++i)
-		Subdivide(meshData);
+	// Only the positions are subdivided, the other attributes are derived after the projection.
+	uint32 vertexCount = Subdivide(vertices, 12, k, 60, numSubdivisions, indices, true, threadCount);
 
 	// Project vertices onto sphere and scale.
-	for(uint32 i = 0; i < meshData.Vertices.size(); ++i)
+	ParallelFor(vertexCount, threadCount, gMinVerticesPerThread, [&](uint32 begin, uint32 end)
 	{
-		// Project onto unit sphere.
-		XMVECTOR n = XMVector3Normalize(XMLoadFloat3(&meshData.Vertices[i].Position));
+		for(uint32 i = begin; i < end; ++i)
+		{
+			Vertex& v = vertices[i];
 
-		// Project onto sphere.
-		XMVECTOR p = radius*n;
+			// Project onto unit sphere.
+			XMVECTOR n = XMVector3Normalize(XMLoadFloat3(&v.Position));
 
-		XMStoreFloat3(&meshData.Vertices[i].Position, p);
-		XMStoreFloat3(&meshData.Vertices[i].Normal, n);
+			// Project onto sphere.
+			XMVECTOR p = radius*n;
 
-		// Derive texture coordinates from spherical coordinates.
-        float theta = atan2f(meshData.Vertices[i].Position.z, meshData.Vertices[i].Position.x);
+			XMStoreFloat3(&v.Position, p);
+			XMStoreFloat3(&v.Normal, n);
 
-        // Put in [0, 2pi].
-        if(theta < 0.0f)
-            theta += XM_2PI;
+			// Derive texture coordinates from spherical coordinates.
+			float theta = atan2f(v.Position.z, v.Position.x);
 
-		float phi = acosf(meshData.Vertices[i].Position.y / radius);
+			// Put in [0, 2pi].
+			if(theta < 0.0f)
+				theta += XM_2PI;
 
-		meshData.Vertices[i].TexC.x = theta/XM_2PI;
-		meshData.Vertices[i].TexC.y = phi/XM_PI;
+			float phi = acosf(v.Position.y / radius);
 
-		// Partial derivative of P with respect to theta
-		meshData.Vertices[i].TangentU.x = -radius*sinf(phi)*sinf(theta);
-		meshData.Vertices[i].TangentU.y = 0.0f;
-		meshData.Vertices[i].TangentU.z = +radius*sinf(phi)*cosf(theta);
+			v.TexC.x = theta/XM_2PI;
+			v.TexC.y = phi/XM_PI;
 
-		XMVECTOR T = XMLoadFloat3(&meshData.Vertices[i].TangentU);
-		XMStoreFloat3(&meshData.Vertices[i].TangentU, XMVector3Normalize(T));
-	}
+			// Partial derivative of P with respect to theta
+			v.TangentU.x = -radius*sinf(phi)*sinf(theta);
+			v.TangentU.y = 0.0f;
+			v.TangentU.z = +radius*sinf(phi)*cosf(theta);
 
-    return meshData;
+			XMVECTOR T = XMLoadFloat3(&v.TangentU);
+			XMStoreFloat3(&v.TangentU, XMVector3Normalize(T));
+		}
+	});
 }
 
 GeometryGenerator::MeshData GeometryGenerator::CreateCylinder(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount)
@@ -552,9 +763,25 @@ GeometryGenerator::MeshData GeometryGenerator::CreateGrid(float width, float dep
 {
     MeshData meshData;
 
-	uint32 vertexCount = m*n;
-	uint32 faceCount   = (m-1)*(n-1)*2;
+	MeshSize size = GetGridSize(m, n);
+	meshData.Vertices.resize(size.VertexCount);
+	meshData.Indices32.resize(size.IndexCount);
+	CreateGrid(width, depth, m, n, meshData.Vertices.data(), meshData.Indices32.data());
 
+    return meshData;
+}
+
+GeometryGenerator::MeshSize GeometryGenerator::GetGridSize(uint32 m, uint32 n)
+{
+	MeshSize size;
+	size.VertexCount = m*n;
+	size.IndexCount = (m-1)*(n-1)*2*3; // 3 indices per face
+	return size;
+}
+
+void GeometryGenerator::CreateGrid(float width, float depth, uint32 m, uint32 n,
+	Vertex* vertices, uint32* indices, uint32 threadCount)
+{
 	//
 	// Create the vertices.
 	//
@@ -568,49 +795,51 @@ GeometryGenerator::MeshData GeometryGenerator::CreateGrid(float width, float dep
 	float du = 1.0f / (n-1);
 	float dv = 1.0f / (m-1);
 
-	meshData.Vertices.resize(vertexCount);
-	for(uint32 i = 0; i < m; ++i)
+	uint32 minRows = std::max(1u, gMinVerticesPerThread / n);
+	ParallelFor(m, threadCount, minRows, [&](uint32 begin, uint32 end)
 	{
-		float z = halfDepth - i*dz;
-		for(uint32 j = 0; j < n; ++j)
+		for(uint32 i = begin; i < end; ++i)
 		{
-			float x = -halfWidth + j*dx;
-
-			meshData.Vertices[i*n+j].Position = XMFLOAT3(x, 0.0f, z);
-			meshData.Vertices[i*n+j].Normal   = XMFLOAT3(0.0f, 1.0f, 0.0f);
-			meshData.Vertices[i*n+j].TangentU = XMFLOAT3(1.0f, 0.0f, 0.0f);
-
-			// Stretch texture over grid.
-			meshData.Vertices[i*n+j].TexC.x = j*du;
-			meshData.Vertices[i*n+j].TexC.y = i*dv;
+			float z = halfDepth - i*dz;
+			Vertex* row = vertices + (size_t)i*n;
+			for(uint32 j = 0; j < n; ++j)
+			{
+				float x = -halfWidth + j*dx;
+
+				row[j].Position = XMFLOAT3(x, 0.0f, z);
+				row[j].Normal   = XMFLOAT3(0.0f, 1.0f, 0.0f);
+				row[j].TangentU = XMFLOAT3(1.0f, 0.0f, 0.0f);
+
+				// Stretch texture over grid.
+				row[j].TexC = XMFLOAT2(j*du, i*dv);
+			}
 		}
-	}
+	});
  
     //
 	// Create the indices.
 	//
 
-	meshData.Indices32.resize(faceCount*3); // 3 indices per face
-
 	// Iterate over each quad and compute indices.
-	uint32 k = 0;
-	for(uint32 i = 0; i < m-1; ++i)
+	ParallelFor(m-1, threadCount, minRows, [&](uint32 begin, uint32 end)
 	{
-		for(uint32 j = 0; j < n-1; ++j)
+		uint32* dst = indices + (size_t)begin*(n-1)*6;
+		for(uint32 i = begin; i < end; ++i)
 		{
-			meshData.Indices32[k]   = i*n+j;
-			meshData.Indices32[k+1] = i*n+j+1;
-			meshData.Indices32[k+2] = (i+1)*n+j;
-
-			meshData.Indices32[k+3] = (i+1)*n+j;
-			meshData.Indices32[k+4] = i*n+j+1;
-			meshData.Indices32[k+5] = (i+1)*n+j+1;
-
-			k += 6; // next quad
+			for(uint32 j = 0; j < n-1; ++j)
+			{
+				dst[0] = i*n+j;
+				dst[1] = i*n+j+1;
+				dst[2] = (i+1)*n+j;
+
+				dst[3] = (i+1)*n+j;
+				dst[4] = i*n+j+1;
+				dst[5] = (i+1)*n+j+1;
+
+				dst += 6; // next quad
+			}
 		}
-	}
-
-    return meshData;
+	});
 }
 
 GeometryGenerator::MeshData GeometryGenerator::CreateQuad(float x, float y, float w, float h, float depth)
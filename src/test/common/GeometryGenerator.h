@@ -18,6 +18,8 @@
 #include <DirectXMath.h>
 #include <vector>
 
+#include <UDXRenderer/MeshOptimizer.h>
+
 class GeometryGenerator
 {
 public:
@@ -70,10 +72,29 @@ public:
 			return mIndices16;
         }
 
+		///<summary>
+		/// Reorders the triangles for the post-transform vertex cache and overdraw, then
+		/// the vertices for fetch locality.  Returns ACMR/ATVR before and after.
+		///</summary>
+		Ubpa::MeshOptimizer::Report Optimize();
+
 	private:
 		std::vector<uint16> mIndices16;
 	};
 
+	///<summary>
+	/// Exact vertex and index counts of a generator's output, to size caller-provided
+	/// (e.g. upload-mapped) memory before writing into it.
+	///</summary>
+	struct MeshSize
+	{
+		uint32 VertexCount = 0;
+		uint32 IndexCount = 0;
+	};
+
+	// Subdivisions of CreateGeosphere are clamped to this.
+	static constexpr uint32 MaxGeosphereSubdivisions = 10;
+
 	///<summary>
 	/// Creates a box centered at the origin with the given dimensions, where each
     /// face has m rows and n columns of vertices.
@@ -86,12 +107,30 @@ public:
 	///</summary>
     MeshData CreateSphere(float radius, uint32 sliceCount, uint32 stackCount);
 
+	///<summary>
+	/// Writes the sphere to vertices and indices, of at least GetSphereSize() elements.
+	/// The stacks are split across threadCount threads (0: one per hardware thread).
+	///</summary>
+	void CreateSphere(float radius, uint32 sliceCount, uint32 stackCount,
+		Vertex* vertices, uint32* indices, uint32 threadCount = 0);
+	static MeshSize GetSphereSize(uint32 sliceCount, uint32 stackCount);
+
 	///<summary>
 	/// Creates a geosphere centered at the origin with the given radius.  The
 	/// depth controls the level of tessellation.
 	///</summary>
     MeshData CreateGeosphere(float radius, uint32 numSubdivisions);
 
+	///<summary>
+	/// Writes the geosphere to vertices and indices, of at least GetGeosphereSize() elements.
+	/// Each subdivision shares the midpoints of the edges, so no vertex is duplicated.
+	/// The subdivisions and the projection are split across threadCount threads
+	/// (0: one per hardware thread), the result doesn't depend on it.
+	///</summary>
+	void CreateGeosphere(float radius, uint32 numSubdivisions,
+		Vertex* vertices, uint32* indices, uint32 threadCount = 0);
+	static MeshSize GetGeosphereSize(uint32 numSubdivisions);
+
 	///<summary>
 	/// Creates a cylinder parallel to the y-axis, and centered about the origin.  
 	/// The bottom and top radius can vary to form various cone shapes rather than true
@@ -105,14 +144,20 @@ public:
 	///</summary>
     MeshData CreateGrid(float width, float depth, uint32 m, uint32 n);
 
+	///<summary>
+	/// Writes the grid to vertices and indices, of at least GetGridSize() elements.
+	/// The rows are split across threadCount threads (0: one per hardware thread).
+	///</summary>
+	void CreateGrid(float width, float depth, uint32 m, uint32 n,
+		Vertex* vertices, uint32* indices, uint32 threadCount = 0);
+	static MeshSize GetGridSize(uint32 m, uint32 n);
+
 	///<summary>
 	/// Creates a quad aligned with the screen.  This is useful for postprocessing and screen effects.
 	///</summary>
     MeshData CreateQuad(float x, float y, float w, float h, float depth);
 
 private:
-	void Subdivide(MeshData& meshData);
-    Vertex MidPoint(const Vertex& v0, const Vertex& v1);
     void BuildCylinderTopCap(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount, MeshData& meshData);
     void BuildCylinderBottomCap(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount, MeshData& meshData);
 };
@@ -35,6 +35,11 @@ D3DApp::~D3DApp()
 {
 	if(!uDevice.IsNull())
 		FlushCommandQueue();
+
+	auto& memory = Ubpa::DXRenderer::Instance().GetMemoryTracker();
+	for (int i = 0; i < SwapChainBufferCount; ++i)
+		memory.Untrack(mSwapChainBuffer[i].Get());
+	memory.Untrack(mDepthStencilBuffer.Get());
 }
 
 HINSTANCE D3DApp::AppInst()const
@@ -64,16 +69,55 @@ void D3DApp::Set4xMsaaState(bool value)
         m4xMsaaState = value;
 
         // Recreate the swapchain and buffers with new multisample settings.
-        CreateSwapChain();
+        if(!mHeadless)
+            CreateSwapChain();
         OnResize();
     }
 }
 
+void D3DApp::EnableHeadless(UINT numFrames, std::string timingsPath)
+{
+    // The window and swap chain are chosen in Initialize().
+    assert(uDevice.IsNull());
+
+    mHeadless = true;
+    mHeadlessFrameCount = numFrames;
+    mHeadlessTimingsPath = std::move(timingsPath);
+
+    // Every frame of the run is exported, none may be overwritten in the ring.
+    if(mFrameStats.GetCapacity() < numFrames)
+        mFrameStats.SetCapacity(numFrames);
+}
+
+bool D3DApp::IsHeadless()const
+{
+    return mHeadless;
+}
+
+void D3DApp::SetTargetFrameRate(double fps)
+{
+    if(fps <= 0.0)
+        mFramePacer.reset();
+    else if(mFramePacer)
+        mFramePacer->SetTargetFps(fps);
+    else
+    {
+        Ubpa::FramePacer::Desc desc;
+        desc.targetFps = fps;
+        mFramePacer = std::make_unique<Ubpa::FramePacer>(Ubpa::SteadyClock::Instance(), desc);
+    }
+}
+
 int D3DApp::Run()
 {
+	if(mHeadless)
+		return RunHeadless();
+
 	MSG msg = {0};
  
 	mTimer.Reset();
+	if(mFramePacer)
+		mFramePacer->Reset();
 
 	while(msg.message != WM_QUIT)
 	{
@@ -86,13 +130,26 @@ int D3DApp::Run()
 		// Otherwise, do animation/game stuff.
 		else
         {	
-			mTimer.Tick();
+			if( !mAppPaused )
+				PaceFrame();
+			else
+				mTimer.Tick();
 
 			if( !mAppPaused )
 			{
+				UDXR_PROFILE_FRAME();
 				CalculateFrameStats();
-				Update(mTimer);	
-                Draw(mTimer);
+				mFrameStats.BeginFrame();
+				{
+					UDXR_PROFILE_ZONE("Update");
+					Ubpa::FrameStats::ScopedStage stage(mFrameStats, mUpdateStage);
+					Update(mTimer);
+				}
+				{
+					UDXR_PROFILE_ZONE("Draw");
+					Draw(mTimer);
+				}
+				mFrameStats.EndFrame();
 			}
 			else
 			{
@@ -104,9 +161,61 @@ int D3DApp::Run()
 	return (int)msg.wParam;
 }
 
+int D3DApp::RunHeadless()
+{
+	mFrameStats.Clear();
+	mTimer.Reset();
+	if(mFramePacer)
+		mFramePacer->Reset();
+
+	for(UINT i = 0; i < mHeadlessFrameCount; ++i)
+	{
+		UDXR_PROFILE_FRAME();
+		PaceFrame();
+		OnHeadlessFrame(i, mHeadlessFrameCount);
+
+		mFrameStats.BeginFrame();
+		{
+			UDXR_PROFILE_ZONE("Update");
+			Ubpa::FrameStats::ScopedStage stage(mFrameStats, mUpdateStage);
+			Update(mTimer);
+		}
+		{
+			UDXR_PROFILE_ZONE("Draw");
+			Draw(mTimer);
+		}
+		mFrameStats.EndFrame();
+	}
+
+	FlushCommandQueue();
+
+	if(!mHeadlessTimingsPath.empty())
+	{
+		if(!mFrameStats.WriteFile(mHeadlessTimingsPath))
+			return 1;
+		std::ofstream memory(mHeadlessTimingsPath + ".memory.txt");
+		Ubpa::DXRenderer::Instance().GetMemoryTracker().Dump(memory);
+		if(mFramePacer)
+		{
+			const auto& error = mFramePacer->GetErrorStats();
+			std::ofstream pacing(mHeadlessTimingsPath + ".pacing.txt");
+			pacing << "target_fps " << mFramePacer->GetTargetFps() << "\n"
+				<< "frames " << error.frameNum << "\n"
+				<< "mean_abs_error_ms " << error.meanAbsMs << "\n"
+				<< "max_abs_error_ms " << error.maxAbsMs << "\n"
+				<< "missed " << error.missedNum << "\n";
+		}
+#if UDXR_PROFILER_ENABLED
+		Ubpa::Profiler::Instance().WriteChromeTraceFile(mHeadlessTimingsPath + ".trace.json");
+#endif
+	}
+
+	return 0;
+}
+
 bool D3DApp::Initialize()
 {
-	if(!InitMainWindow())
+	if(!mHeadless && !InitMainWindow())
 		return false;
 
 	if(!InitDirect3D())
@@ -141,7 +250,7 @@ void D3DApp::CreateRtvAndDsvDescriptorHeaps()
 void D3DApp::OnResize()
 {
 	assert(!uDevice.IsNull());
-	assert(mSwapChain);
+	assert(mHeadless || mSwapChain);
     assert(mDirectCmdListAlloc);
 
 	// Flush before changing any resources.
@@ -150,25 +259,39 @@ void D3DApp::OnResize()
     ThrowIfFailed(uGCmdList->Reset(mDirectCmdListAlloc.Get(), nullptr));
 
 	// Release the previous resources we will be recreating.
+	auto& memory = Ubpa::DXRenderer::Instance().GetMemoryTracker();
 	for (int i = 0; i < SwapChainBufferCount; ++i)
+	{
+		memory.Untrack(mSwapChainBuffer[i].Get());
 		mSwapChainBuffer[i].Reset();
+	}
+	memory.Untrack(mDepthStencilBuffer.Get());
     mDepthStencilBuffer.Reset();
 	
 	// Resize the swap chain.
-    ThrowIfFailed(mSwapChain->ResizeBuffers(
-		SwapChainBufferCount, 
-		mClientWidth, mClientHeight, 
-		mBackBufferFormat, 
-		DXGI_SWAP_CHAIN_FLAG_ALLOW_MODE_SWITCH));
+	if(mHeadless)
+		CreateOffscreenBuffers();
+	else
+	{
+		ThrowIfFailed(mSwapChain->ResizeBuffers(
+			SwapChainBufferCount, 
+			mClientWidth, mClientHeight, 
+			mBackBufferFormat, 
+			DXGI_SWAP_CHAIN_FLAG_ALLOW_MODE_SWITCH));
+
+		for (UINT i = 0; i < SwapChainBufferCount; i++)
+			ThrowIfFailed(mSwapChain->GetBuffer(i, IID_PPV_ARGS(&mSwapChainBuffer[i])));
+	}
 
 	mCurrBackBuffer = 0;
  
 	CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHeapHandle(mRtvHeap->GetCPUDescriptorHandleForHeapStart());
 	for (UINT i = 0; i < SwapChainBufferCount; i++)
 	{
-		ThrowIfFailed(mSwapChain->GetBuffer(i, IID_PPV_ARGS(&mSwapChainBuffer[i])));
 		uDevice->CreateRenderTargetView(mSwapChainBuffer[i].Get(), nullptr, rtvHeapHandle);
 		rtvHeapHandle.Offset(1, mRtvDescriptorSize);
+		TrackResource(mSwapChainBuffer[i].Get(), Ubpa::MemoryTracker::Category::RenderTarget,
+			(mHeadless ? "offscreen buffer " : "swap chain buffer ") + std::to_string(i));
 	}
 
     // Create the depth/stencil buffer and view.
@@ -203,6 +326,7 @@ void D3DApp::OnResize()
 		D3D12_RESOURCE_STATE_COMMON,
         &optClear,
         IID_PPV_ARGS(mDepthStencilBuffer.GetAddressOf())));
+	TrackResource(mDepthStencilBuffer.Get(), Ubpa::MemoryTracker::Category::RenderTarget, "depth stencil buffer");
 
     // Create descriptor to mip level 0 of entire resource using the format of the resource.
 	D3D12_DEPTH_STENCIL_VIEW_DESC dsvDesc;
@@ -251,6 +375,8 @@ LRESULT D3DApp::MsgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 		{
 			mAppPaused = false;
 			mTimer.Start();
+			if(mFramePacer)
+				mFramePacer->Reset();
 		}
 		return 0;
 
@@ -471,7 +597,8 @@ bool D3DApp::InitDirect3D()
 #endif
 
 	CreateCommandObjects();
-    CreateSwapChain();
+	if(!mHeadless)
+		CreateSwapChain();
     CreateRtvAndDsvDescriptorHeaps();
 
 	return true;
@@ -530,6 +657,35 @@ void D3DApp::CreateSwapChain()
 		mSwapChain.GetAddressOf()));
 }
 
+void D3DApp::CreateOffscreenBuffers()
+{
+	// Stand-ins for the swap chain buffers.  They start (and end every frame) in
+	// D3D12_RESOURCE_STATE_PRESENT, like real back buffers, so the frame graph
+	// imports them unchanged.
+	D3D12_RESOURCE_DESC desc = CD3DX12_RESOURCE_DESC::Tex2D(
+		mBackBufferFormat, mClientWidth, mClientHeight, 1, 1,
+		m4xMsaaState ? 4 : 1, m4xMsaaState ? (m4xMsaaQuality - 1) : 0,
+		D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET);
+
+	for (int i = 0; i < SwapChainBufferCount; ++i)
+	{
+		ThrowIfFailed(uDevice->CreateCommittedResource(
+			&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+			D3D12_HEAP_FLAG_NONE,
+			&desc,
+			D3D12_RESOURCE_STATE_PRESENT,
+			nullptr,
+			IID_PPV_ARGS(mSwapChainBuffer[i].GetAddressOf())));
+	}
+}
+
+void D3DApp::Present()
+{
+	if(!mHeadless)
+		ThrowIfFailed(mSwapChain->Present(0, 0));
+	mCurrBackBuffer = (mCurrBackBuffer + 1) % SwapChainBufferCount;
+}
+
 void D3DApp::FlushCommandQueue()
 {
 	// Advance the fence value to mark commands up to this fence point.
@@ -572,12 +728,36 @@ D3D12_CPU_DESCRIPTOR_HANDLE D3DApp::DepthStencilView()const
 	return mDsvHeap->GetCPUDescriptorHandleForHeapStart();
 }
 
+void D3DApp::TrackResource(ID3D12Resource* resource, Ubpa::MemoryTracker::Category category, std::string name)const
+{
+	auto desc = resource->GetDesc();
+	auto info = uDevice->GetResourceAllocationInfo(0, 1, &desc);
+	Ubpa::DXRenderer::Instance().GetMemoryTracker().Track(resource, category, std::move(name),
+		info.SizeInBytes, info.Alignment);
+}
+
+void D3DApp::PaceFrame()
+{
+	if(!mFramePacer)
+	{
+		mTimer.Tick();
+		return;
+	}
+
+	mFramePacer->Wait();
+	mTimer.Tick();
+	mTimer.SetDeltaTime(mFramePacer->GetSmoothedDelta());
+}
+
 void D3DApp::CalculateFrameStats()
 {
 	// Code computes the average frames per second, and also the 
 	// average time it takes to render one frame.  These stats 
 	// are appended to the window caption bar.
     
+	if(mHeadless)
+		return;
+
 	static int frameCnt = 0;
 	static float timeElapsed = 0.0f;
 
@@ -592,9 +772,22 @@ void D3DApp::CalculateFrameStats()
         wstring fpsStr = to_wstring(fps);
         wstring mspfStr = to_wstring(mspf);
 
+        // Averages hide the slow frames, so also show the tail of the recent frames.
+        auto summary = mFrameStats.Summarize();
+
         wstring windowText = mMainWndCaption +
             L"    fps: " + fpsStr +
-            L"   mspf: " + mspfStr;
+            L"   mspf: " + mspfStr +
+            L"   p99: " + to_wstring(summary.frame.p99) +
+            L"   1% low: " + to_wstring(summary.low1PercentFps) +
+            L"   stutters: " + to_wstring(summary.stutters.size());
+        if(mFramePacer)
+        {
+            const auto& error = mFramePacer->GetErrorStats();
+            windowText += L"   pacing error: " + to_wstring(error.meanAbsMs) +
+                L" (max " + to_wstring(error.maxAbsMs) + L") ms" +
+                L"   missed: " + to_wstring(error.missedNum);
+        }
 
         SetWindowText(mhMainWnd, windowText.c_str());
 		
@@ -13,6 +13,10 @@
 
 #include "GameTimer.h"
 
+#include <UDXRenderer/FrameStats.h>
+#include <UDXRenderer/Profiler.h>
+#include <UDXRenderer/FramePacer.h>
+
 // Link necessary d3d12 libraries.
 // add lib by cmake
 //#pragma comment(lib,"d3dcompiler.lib")
@@ -40,6 +44,19 @@ public:
     void Set4xMsaaState(bool value);
 
 	int Run();
+
+    // Call before Initialize().  Renders numFrames frames to offscreen targets,
+    // without a window or swap chain, and writes the per-frame CPU timings to
+    // timingsPath (".json" for JSON, CSV otherwise), and the GPU memory dump of
+    // DXRenderer to timingsPath + ".memory.txt".  With a target frame rate the
+    // pacing error goes to timingsPath + ".pacing.txt".
+    void EnableHeadless(UINT numFrames, std::string timingsPath);
+    bool IsHeadless()const;
+
+    // Pace frames to a fixed rate and feed Update() the smoothed delta time, in
+    // windowed and headless runs.  The pacing error is shown in the window caption.
+    // fps <= 0 turns pacing off (the default).
+    void SetTargetFrameRate(double fps);
  
     virtual bool Initialize();
     virtual LRESULT MsgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
@@ -55,20 +72,33 @@ protected:
 	virtual void OnMouseUp(WPARAM btnState, int x, int y)  { }
 	virtual void OnMouseMove(WPARAM btnState, int x, int y){ }
 
+	// Called at the start of every headless frame, before Update(); drives the scripted camera.
+	virtual void OnHeadlessFrame(UINT frameIndex, UINT numFrames) { }
+
 protected:
 
 	bool InitMainWindow();
 	bool InitDirect3D();
 	void CreateCommandObjects();
     void CreateSwapChain();
+    void CreateOffscreenBuffers();
+    int RunHeadless();
 
 	void FlushCommandQueue();
 
+	// Presents the swap chain (skipped in headless mode) and advances the back buffer.
+	void Present();
+
 	ID3D12Resource* CurrentBackBuffer()const;
 	D3D12_CPU_DESCRIPTOR_HANDLE CurrentBackBufferView()const;
 	D3D12_CPU_DESCRIPTOR_HANDLE DepthStencilView()const;
 
+	// Records the resource in the renderer's memory tracker, sized from its desc.
+	void TrackResource(ID3D12Resource* resource, Ubpa::MemoryTracker::Category category, std::string name)const;
+
 	void CalculateFrameStats();
+	// Waits for the frame's deadline and hands its smoothed delta time to mTimer.
+	void PaceFrame();
 
     void LogAdapters();
     void LogAdapterOutputs(IDXGIAdapter* adapter);
@@ -92,6 +122,25 @@ protected:
 
 	// Used to keep track of the delta-time?and game time (?.4).
 	GameTimer mTimer;
+
+	// Headless benchmark mode: no window, no present.
+	bool        mHeadless = false;
+	UINT        mHeadlessFrameCount = 0;
+	std::string mHeadlessTimingsPath;
+
+	// Per-frame CPU timings of the most recent frames, in both windowed and
+	// headless runs.  Derived classes time their own stages in Update() and Draw();
+	// stages are exclusive, so cull, sort and fg_compile aren't counted again in the
+	// update and record stages they run in.
+	Ubpa::FrameStats mFrameStats;
+	size_t mUpdateStage = mFrameStats.RegisterStage("update");
+	size_t mCullStage = mFrameStats.RegisterStage("cull");
+	size_t mSortStage = mFrameStats.RegisterStage("sort");
+	size_t mRecordStage = mFrameStats.RegisterStage("record");
+	size_t mSubmitStage = mFrameStats.RegisterStage("submit");
+	size_t mFGCompileStage = mFrameStats.RegisterStage("fg_compile");
+
+	std::unique_ptr<Ubpa::FramePacer> mFramePacer;
 	
     Microsoft::WRL::ComPtr<IDXGIFactory4> mdxgiFactory;
     Microsoft::WRL::ComPtr<IDXGISwapChain> mSwapChain;
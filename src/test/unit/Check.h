@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdlib>
+#include <iostream>
+
+// [summary]
+// assert of the unit tests, kept in release builds
+// a failed check prints its expression and location, and exits with 1
+#define UDXR_CHECK(cond) \
+	do { \
+		if (!(cond)) { \
+			std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #cond << std::endl; \
+			std::exit(1); \
+		} \
+	} while (false)
@@ -0,0 +1,239 @@
+#include "../Check.h"
+
+#include <UDXRenderer/DescriptorAllocator.h>
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace Ubpa;
+using namespace std;
+
+namespace {
+    bool Near(double a, double b) {
+        return fabs(a - b) < 1e-9;
+    }
+
+    void TestAllocateFree() {
+        DescriptorAllocator allocator(16, 1);
+        auto a = allocator.Allocate(4);
+        auto b = allocator.Allocate(4);
+        auto c = allocator.Allocate(8);
+        UDXR_CHECK(!a.IsNull() && !b.IsNull() && !c.IsNull());
+        UDXR_CHECK(a.page == 0 && b.page == 0 && c.page == 0);
+        UDXR_CHECK(a.offset == 0 && b.offset == 4 && c.offset == 8);
+        UDXR_CHECK(c.num == 8);
+
+        // the only page is full
+        UDXR_CHECK(allocator.Allocate(1).IsNull());
+        // empty, or larger than a page
+        UDXR_CHECK(allocator.Allocate(0).IsNull());
+        UDXR_CHECK(allocator.Allocate(17).IsNull());
+
+        // first fit: the hole of b is reused from its start
+        allocator.Free(b);
+        auto d = allocator.Allocate(2);
+        UDXR_CHECK(d.offset == 4);
+        // 2 free descriptors left at 6, too few for 3
+        UDXR_CHECK(allocator.Allocate(3).IsNull());
+
+        // the lowest range that fits wins
+        allocator.Free(a);
+        auto e = allocator.Allocate(2);
+        UDXR_CHECK(e.offset == 0);
+        auto f = allocator.Allocate(2);
+        UDXR_CHECK(f.offset == 2);
+        auto g = allocator.Allocate(2);
+        UDXR_CHECK(g.offset == 6);
+
+        // freeing a null allocation is a no-op
+        allocator.Free({});
+        UDXR_CHECK(allocator.GetStats().liveNum == 16);
+
+        for (const auto& x : { c, d, e, f, g })
+            allocator.Free(x);
+        UDXR_CHECK(allocator.GetStats().liveNum == 0);
+        UDXR_CHECK(allocator.Allocate(16).offset == 0);
+    }
+
+    void TestStats() {
+        DescriptorAllocator allocator(16, 1);
+        auto stats = allocator.GetStats();
+        UDXR_CHECK(stats.pageNum == 0 && stats.capacity == 0 && stats.freeNum == 0);
+        UDXR_CHECK(Near(stats.fragmentation, 0.));
+
+        DescriptorAllocator::Allocation a[4];
+        for (auto& x : a)
+            x = allocator.Allocate(4);
+
+        stats = allocator.GetStats();
+        UDXR_CHECK(stats.pageNum == 1 && stats.capacity == 16);
+        UDXR_CHECK(stats.liveNum == 16 && stats.freeNum == 0);
+        UDXR_CHECK(stats.allocationNum == 4);
+        UDXR_CHECK(stats.freeRangeNum == 0 && stats.largestFreeRange == 0);
+
+        // two holes of 4: half of the free space is out of reach of the largest range
+        allocator.Free(a[0]);
+        allocator.Free(a[2]);
+        stats = allocator.GetStats();
+        UDXR_CHECK(stats.liveNum == 8 && stats.freeNum == 8);
+        UDXR_CHECK(stats.allocationNum == 2);
+        UDXR_CHECK(stats.freeRangeNum == 2 && stats.largestFreeRange == 4);
+        UDXR_CHECK(Near(stats.fragmentation, 0.5));
+
+        // freeing the range between them merges both neighbours
+        allocator.Free(a[1]);
+        stats = allocator.GetStats();
+        UDXR_CHECK(stats.freeRangeNum == 1 && stats.largestFreeRange == 12);
+        UDXR_CHECK(Near(stats.fragmentation, 0.));
+
+        allocator.Free(a[3]);
+        stats = allocator.GetStats();
+        UDXR_CHECK(stats.liveNum == 0 && stats.allocationNum == 0);
+        UDXR_CHECK(stats.freeRangeNum == 1 && stats.largestFreeRange == 16);
+    }
+
+    void TestGrow() {
+        vector<uint32_t> newPages;
+        bool refuse = false;
+        DescriptorAllocator allocator(8, 4, [&](uint32_t page) {
+            newPages.push_back(page);
+            return !refuse;
+        });
+        UDXR_CHECK(allocator.GetPageNum() == 0);
+
+        // pages are added on demand
+        auto a = allocator.Allocate(8);
+        auto b = allocator.Allocate(8);
+        UDXR_CHECK(!a.IsNull() && !b.IsNull());
+        UDXR_CHECK(a.page != b.page);
+        UDXR_CHECK(allocator.GetPageNum() == 2);
+        UDXR_CHECK((newPages == vector<uint32_t>{ 0, 1 }));
+
+        // the callback declines: no page, no allocation
+        refuse = true;
+        UDXR_CHECK(allocator.Allocate(1).IsNull());
+        UDXR_CHECK(allocator.GetPageNum() == 2);
+        UDXR_CHECK((newPages == vector<uint32_t>{ 0, 1, 2 }));
+
+        // free space in an existing page doesn't need the callback
+        allocator.Free(a);
+        auto c = allocator.Allocate(8);
+        UDXR_CHECK(c.page == a.page && c.offset == 0);
+        UDXR_CHECK(newPages.size() == 3);
+
+        // the callback accepts again, up to maxPageNum
+        refuse = false;
+        UDXR_CHECK(!allocator.Allocate(8).IsNull());
+        UDXR_CHECK(!allocator.Allocate(8).IsNull());
+        UDXR_CHECK(allocator.GetPageNum() == 4);
+        UDXR_CHECK(allocator.Allocate(1).IsNull());
+        UDXR_CHECK((newPages == vector<uint32_t>{ 0, 1, 2, 2, 3 }));
+    }
+
+    void TestRangesStayInPages() {
+        DescriptorAllocator allocator(8, 2);
+        auto a = allocator.Allocate(6);
+        auto b = allocator.Allocate(6);
+        UDXR_CHECK(a.page != b.page);
+
+        // 4 free descriptors, but 2 at the tail of each page
+        auto stats = allocator.GetStats();
+        UDXR_CHECK(stats.freeNum == 4 && stats.largestFreeRange == 2);
+        // every page's free space is one range: not fragmented
+        UDXR_CHECK(Near(stats.fragmentation, 0.));
+        UDXR_CHECK(allocator.Allocate(4).IsNull());
+        UDXR_CHECK(!allocator.Allocate(2).IsNull());
+        UDXR_CHECK(!allocator.Allocate(2).IsNull());
+        UDXR_CHECK(allocator.GetStats().freeNum == 0);
+    }
+
+    void TestConcurrent() {
+        const uint32_t pageSize = 64;
+        // enough pages that fragmentation never makes an allocation fail
+        const uint32_t maxPageNum = 256;
+        const int threadNum = 8;
+        const int iterNum = 20000;
+        const size_t maxLiveNum = 16;
+        const uint32_t maxNum = 8;
+
+        atomic<bool> growing{ false };
+        atomic<uint32_t> newPageNum{ 0 };
+        DescriptorAllocator allocator(pageSize, maxPageNum, [&](uint32_t page) {
+            // runs under the growth lock, pages come in order
+            UDXR_CHECK(!growing.exchange(true));
+            UDXR_CHECK(page == newPageNum.load());
+            newPageNum++;
+            growing.store(false);
+            return true;
+        });
+
+        // owner of every descriptor, 0: free
+        unique_ptr<atomic<int>[]> owners{ new atomic<int>[maxPageNum * pageSize] };
+        for (uint32_t i = 0; i < maxPageNum * pageSize; i++)
+            owners[i].store(0);
+
+        auto claim = [&](const DescriptorAllocator::Allocation& x, int from, int to) {
+            UDXR_CHECK(x.page < allocator.GetPageNum());
+            UDXR_CHECK(x.offset + x.num <= pageSize);
+            for (uint32_t i = 0; i < x.num; i++) {
+                int expected = from;
+                UDXR_CHECK(owners[x.page * pageSize + x.offset + i].compare_exchange_strong(expected, to));
+            }
+        };
+
+        vector<thread> threads;
+        for (int t = 0; t < threadNum; t++) {
+            threads.emplace_back([&, t]() {
+                mt19937 rng(t);
+                vector<DescriptorAllocator::Allocation> live;
+                for (int i = 0; i < iterNum; i++) {
+                    if (live.size() < maxLiveNum && (live.empty() || rng() % 2 == 0)) {
+                        auto x = allocator.Allocate(1 + rng() % maxNum);
+                        UDXR_CHECK(!x.IsNull());
+                        claim(x, 0, t + 1);
+                        live.push_back(x);
+                    }
+                    else {
+                        size_t k = rng() % live.size();
+                        claim(live[k], t + 1, 0);
+                        allocator.Free(live[k]);
+                        live[k] = live.back();
+                        live.pop_back();
+                    }
+                }
+                for (const auto& x : live) {
+                    claim(x, t + 1, 0);
+                    allocator.Free(x);
+                }
+            });
+        }
+        for (auto& t : threads)
+            t.join();
+
+        // one thread alone keeps more than a page live
+        auto stats = allocator.GetStats();
+        UDXR_CHECK(stats.pageNum > 1);
+        UDXR_CHECK(stats.pageNum == newPageNum.load());
+        UDXR_CHECK(stats.liveNum == 0 && stats.allocationNum == 0);
+        // everything merged back: every page is one free range
+        UDXR_CHECK(stats.freeRangeNum == stats.pageNum);
+        UDXR_CHECK(stats.largestFreeRange == pageSize);
+        UDXR_CHECK(Near(stats.fragmentation, 0.));
+    }
+}
+
+int main() {
+    TestAllocateFree();
+    TestStats();
+    TestGrow();
+    TestRangesStayInPages();
+    TestConcurrent();
+    cout << "DescriptorAllocator: ok" << endl;
+    return 0;
+}
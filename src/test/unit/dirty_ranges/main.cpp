@@ -0,0 +1,124 @@
+#include "../Check.h"
+
+#include <UDXRenderer/DirtyRanges.h>
+
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace Ubpa;
+using namespace std;
+
+namespace {
+    using Range = DirtyRanges::Range;
+
+    bool Equal(const vector<Range>& ranges, const vector<Range>& expected) {
+        if (ranges.size() != expected.size())
+            return false;
+        for (size_t i = 0; i < ranges.size(); i++) {
+            if (ranges[i].first != expected[i].first || ranges[i].num != expected[i].num)
+                return false;
+        }
+        return true;
+    }
+
+    void TestCoalesce() {
+        vector<Range> ranges;
+        DirtyRanges::Coalesce(ranges);
+        UDXR_CHECK(ranges.empty());
+
+        // unsorted, overlapping, adjacent, contained and apart
+        ranges = { { 20, 5 }, { 0, 4 }, { 4, 2 }, { 2, 3 }, { 21, 2 }, { 10, 1 } };
+        DirtyRanges::Coalesce(ranges);
+        UDXR_CHECK(Equal(ranges, { { 0, 6 }, { 10, 1 }, { 20, 5 } }));
+
+        // a gap of one element stays
+        ranges = { { 0, 2 }, { 3, 2 } };
+        DirtyRanges::Coalesce(ranges);
+        UDXR_CHECK(Equal(ranges, { { 0, 2 }, { 3, 2 } }));
+    }
+
+    void TestForward() {
+        DirtyRanges ranges(3);
+        UDXR_CHECK(ranges.GetCopyNum() == 3);
+
+        // frame 0 writes [0, 4) and [4, 6)
+        ranges.Add(4, 2);
+        ranges.Add(0, 4);
+        ranges.Add(9, 0); // ignored
+        UDXR_CHECK(ranges.GetDirtyNum() == 6);
+        UDXR_CHECK(Equal(ranges.Commit(0), { { 0, 6 } }));
+        UDXR_CHECK(ranges.GetPending(0).empty());
+        UDXR_CHECK(Equal(ranges.GetPending(1), { { 0, 6 } }) && Equal(ranges.GetPending(2), { { 0, 6 } }));
+
+        // frame 1 writes [5, 8): its copy gets both frames' ranges, counted once
+        ranges.Add(5, 3);
+        UDXR_CHECK(ranges.GetDirtyNum() == 3);
+        UDXR_CHECK(Equal(ranges.Commit(1), { { 0, 8 } }));
+        UDXR_CHECK(Equal(ranges.GetPending(0), { { 5, 3 } }));
+        UDXR_CHECK(ranges.GetPending(1).empty());
+        UDXR_CHECK(Equal(ranges.GetPending(2), { { 0, 8 } }));
+
+        // frame 2 writes nothing and still catches up
+        UDXR_CHECK(ranges.GetDirtyNum() == 0);
+        UDXR_CHECK(Equal(ranges.Commit(2), { { 0, 8 } }));
+
+        // frame 3 uses copy 0 again
+        ranges.Add(20, 1);
+        UDXR_CHECK(Equal(ranges.Commit(0), { { 5, 3 }, { 20, 1 } }));
+        UDXR_CHECK(Equal(ranges.GetPending(1), { { 20, 1 } }) && Equal(ranges.GetPending(2), { { 20, 1 } }));
+
+        // a single copy never has anything pending
+        DirtyRanges single(1);
+        single.Add(3, 3);
+        UDXR_CHECK(Equal(single.Commit(0), { { 3, 3 } }));
+        UDXR_CHECK(single.Commit(0).empty() && single.GetPending(0).empty());
+    }
+
+    // stands in for the upload buffers of D3D12DynamicMesh: a copy used by a frame must match the shadow
+    void TestFakeCopies() {
+        constexpr uint32_t size = 256;
+        constexpr size_t copyNum = 3;
+        vector<uint8_t> shadow(size, 0);
+        vector<vector<uint8_t>> copies(copyNum, shadow);
+        DirtyRanges ranges(copyNum);
+        mt19937 rng(1);
+        uint64_t dirtyNum = 0;
+        uint64_t copiedNum = 0;
+
+        for (uint64_t frame = 0; frame < 1000; frame++) {
+            size_t writeNum = rng() % 4;
+            for (size_t i = 0; i < writeNum; i++) {
+                uint32_t first = rng() % size;
+                uint32_t num = rng() % (size - first + 1);
+                ranges.Add(first, num);
+                for (uint32_t j = first; j < first + num; j++)
+                    shadow[j] = static_cast<uint8_t>(rng());
+            }
+            dirtyNum += ranges.GetDirtyNum();
+
+            size_t current = frame % copyNum;
+            const auto& committed = ranges.Commit(current);
+            for (size_t i = 0; i < committed.size(); i++) {
+                UDXR_CHECK(committed[i].num != 0 && committed[i].first + committed[i].num <= size);
+                // sorted and merged
+                UDXR_CHECK(i == 0 || committed[i].first > committed[i - 1].first + committed[i - 1].num);
+                for (uint32_t j = committed[i].first; j < committed[i].first + committed[i].num; j++)
+                    copies[current][j] = shadow[j];
+                copiedNum += committed[i].num;
+            }
+            UDXR_CHECK(copies[current] == shadow);
+        }
+        // forwarding copies more than was dirtied, but never more than every copy rewritten per dirty element
+        UDXR_CHECK(copiedNum >= dirtyNum && copiedNum <= dirtyNum * copyNum);
+    }
+}
+
+int main() {
+    TestCoalesce();
+    TestForward();
+    TestFakeCopies();
+    cout << "DirtyRanges: ok" << endl;
+    return 0;
+}
@@ -0,0 +1,296 @@
+#include "../Check.h"
+
+#include <UDXRenderer/DrawList.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <optional>
+#include <vector>
+
+using namespace Ubpa;
+using namespace std;
+
+namespace {
+    struct Float3 {
+        float x, y, z;
+    };
+
+    Float3 Sub(const Float3& a, const Float3& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+    float Dot(const Float3& a, const Float3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+    Float3 Cross(const Float3& a, const Float3& b) {
+        return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+    }
+    float Length(const Float3& a) { return sqrtf(Dot(a, a)); }
+    Float3 Normalize(const Float3& a) {
+        float l = Length(a);
+        return { a.x / l, a.y / l, a.z / l };
+    }
+
+    // unit UV sphere, front faces point outwards
+    void CreateSphere(uint32_t slices, uint32_t stacks, vector<Float3>& positions, vector<uint32_t>& indices) {
+        const float pi = 3.14159265f;
+        for (uint32_t i = 0; i <= stacks; i++) {
+            float phi = pi * i / stacks;
+            for (uint32_t j = 0; j <= slices; j++) {
+                float theta = 2.f * pi * j / slices;
+                positions.push_back({ sinf(phi) * cosf(theta), cosf(phi), sinf(phi) * sinf(theta) });
+            }
+        }
+        auto add = [&](uint32_t a, uint32_t b, uint32_t c) {
+            Float3 n = Cross(Sub(positions[b], positions[a]), Sub(positions[c], positions[a]));
+            if (Length(n) < 1e-7f)
+                return; // degenerate at the poles
+            if (Dot(n, positions[a]) < 0.f)
+                swap(b, c);
+            indices.insert(indices.end(), { a, b, c });
+        };
+        for (uint32_t i = 0; i < stacks; i++) {
+            for (uint32_t j = 0; j < slices; j++) {
+                uint32_t v00 = i * (slices + 1) + j;
+                uint32_t v01 = v00 + 1;
+                uint32_t v10 = v00 + slices + 1;
+                uint32_t v11 = v10 + 1;
+                add(v00, v10, v01);
+                add(v01, v10, v11);
+            }
+        }
+    }
+
+    // XMMatrixLookAtLH
+    void LookAt(const Float3& eye, const Float3& target, float view[16]) {
+        Float3 z = Normalize(Sub(target, eye));
+        Float3 x = Normalize(Cross({ 0.f, 1.f, 0.f }, z));
+        Float3 y = Cross(z, x);
+        const float m[16] = {
+            x.x, y.x, z.x, 0.f,
+            x.y, y.y, z.y, 0.f,
+            x.z, y.z, z.z, 0.f,
+            -Dot(x, eye), -Dot(y, eye), -Dot(z, eye), 1.f };
+        copy(m, m + 16, view);
+    }
+
+    // XMMatrixPerspectiveFovLH, 60 degrees, 16:9
+    void Perspective(float proj[16]) {
+        float yScale = 1.f / tanf(0.5f * 1.04719755f);
+        float n = 0.1f;
+        float f = 1000.f;
+        const float m[16] = {
+            yScale * 9.f / 16.f, 0.f, 0.f, 0.f,
+            0.f, yScale, 0.f, 0.f,
+            0.f, 0.f, f / (f - n), 1.f,
+            0.f, 0.f, -n * f / (f - n), 0.f };
+        copy(m, m + 16, proj);
+    }
+
+    struct Call {
+        enum class Type { SetBuffers, SetItem, Draw } type;
+        size_t item;
+        uint32_t indexNum;
+        uint32_t startIndex;
+        int32_t baseVertex;
+    };
+
+    class RecordingDevice : public DrawDevice {
+    public:
+        vector<Call> calls;
+
+        void SetBuffers(size_t item) override { calls.push_back({ Call::Type::SetBuffers, item, 0, 0, 0 }); }
+        void SetItem(size_t item) override { calls.push_back({ Call::Type::SetItem, item, 0, 0, 0 }); }
+        void DrawIndexed(uint32_t indexNum, uint32_t startIndex, int32_t baseVertex) override {
+            calls.push_back({ Call::Type::Draw, calls.empty() ? 0 : calls.back().item, indexNum, startIndex, baseVertex });
+        }
+
+        size_t Count(Call::Type type) const {
+            return count_if(calls.begin(), calls.end(), [=](const Call& c) { return c.type == type; });
+        }
+    };
+
+    struct Mesh {
+        vector<Float3> positions;
+        Meshlets::MeshletMesh meshlets;
+        MeshSimplifier::LodChain chain; // LOD 0 in meshlet order
+        optional<LodSelector> selector;
+
+        Mesh() {
+            vector<uint32_t> indices;
+            CreateSphere(64, 48, positions, indices);
+            meshlets = Meshlets::Build(indices.data(), indices.size(), positions.data(), positions.size(), sizeof(Float3));
+            vector<uint32_t> meshletIndices(meshlets.GetTriangleNum() * 3);
+            Meshlets::UnpackIndices(meshlets, meshletIndices.data());
+            chain = MeshSimplifier::GenerateLods(meshletIndices.data(), meshletIndices.size(),
+                positions.data(), positions.size(), sizeof(Float3));
+            selector = LodSelector::FromErrors(chain.lods.data(), chain.lods.size(), 1.f);
+        }
+
+        DrawList::Item MakeItem(uint32_t startIndex, int32_t baseVertex) const {
+            DrawList::Item item;
+            item.buffers = this;
+            item.radius = 1.f;
+            item.indexNum = chain.lods[0].indexNum;
+            item.startIndex = startIndex;
+            item.baseVertex = baseVertex;
+            item.lods = chain.lods.data();
+            item.lodNum = chain.lods.size();
+            item.lodSelector = &*selector;
+            item.meshlets = &meshlets;
+            return item;
+        }
+    };
+
+    void TestMeshletDraws(const Mesh& mesh) {
+        UDXR_CHECK(mesh.chain.lods.size() > 1);
+
+        DrawList list;
+        auto id = list.Add(mesh.MakeItem(100, 7));
+        float view[16], proj[16];
+        Perspective(proj);
+        const float eye[3] = { 0.f, 0.f, -5.f };
+        LookAt({ eye[0], eye[1], eye[2] }, { 0.f, 0.f, 0.f }, view);
+
+        auto stats = list.Cull(view, proj, eye, 720.f);
+        UDXR_CHECK(list.GetLod(id) == 0);
+        UDXR_CHECK(stats.meshlets.meshletNum == mesh.meshlets.meshlets.size());
+        UDXR_CHECK(stats.meshlets.backfaceCulledNum > 0);
+        UDXR_CHECK(stats.indexNum == 3 * stats.meshlets.visibleTriangleNum);
+        // runs of consecutive meshlets are merged
+        size_t visibleNum = stats.meshlets.meshletNum - stats.meshlets.frustumCulledNum - stats.meshlets.backfaceCulledNum;
+        UDXR_CHECK(stats.drawNum > 0 && stats.drawNum <= visibleNum);
+
+        RecordingDevice device;
+        list.Record(device);
+        UDXR_CHECK(device.Count(Call::Type::SetBuffers) == 1);
+        UDXR_CHECK(device.Count(Call::Type::SetItem) == 1);
+        UDXR_CHECK(device.Count(Call::Type::Draw) == stats.drawNum);
+        size_t indexNum = 0;
+        uint32_t end = 0;
+        for (const auto& call : device.calls) {
+            if (call.type != Call::Type::Draw)
+                continue;
+            // ascending, disjoint and inside LOD 0
+            UDXR_CHECK(call.startIndex >= max<uint32_t>(end, 100));
+            end = call.startIndex + call.indexNum;
+            UDXR_CHECK(end <= 100 + mesh.chain.lods[0].indexNum);
+            UDXR_CHECK(call.baseVertex == 7);
+            indexNum += call.indexNum;
+        }
+        UDXR_CHECK(indexNum == stats.indexNum);
+
+        // scaled by 2 and moved, seen from twice as far: the same meshlets in object space
+        DrawList moved;
+        auto item = mesh.MakeItem(100, 7);
+        item.world[0] = item.world[5] = item.world[10] = 2.f;
+        item.world[12] = 10.f;
+        item.world[13] = -3.f;
+        moved.Add(item);
+        const float movedEye[3] = { 10.f, -3.f, -10.f };
+        LookAt({ movedEye[0], movedEye[1], movedEye[2] }, { 10.f, -3.f, 0.f }, view);
+        auto movedStats = moved.Cull(view, proj, movedEye, 720.f);
+        UDXR_CHECK(moved.GetLod(0) == 0);
+        UDXR_CHECK(movedStats.meshlets.backfaceCulledNum == stats.meshlets.backfaceCulledNum);
+        UDXR_CHECK(movedStats.meshlets.frustumCulledNum == stats.meshlets.frustumCulledNum);
+        UDXR_CHECK(movedStats.indexNum == stats.indexNum);
+
+        // looking away: everything is frustum culled, nothing is recorded
+        LookAt({ eye[0], eye[1], eye[2] }, { 0.f, 0.f, -10.f }, view);
+        stats = list.Cull(view, proj, eye, 720.f);
+        UDXR_CHECK(stats.meshlets.frustumCulledNum == mesh.meshlets.meshlets.size());
+        UDXR_CHECK(stats.drawNum == 0 && stats.indexNum == 0);
+        device.calls.clear();
+        list.Record(device);
+        UDXR_CHECK(device.calls.empty());
+    }
+
+    void TestLod(const Mesh& mesh) {
+        DrawList list;
+        auto id = list.Add(mesh.MakeItem(0, 0));
+        float view[16], proj[16];
+        Perspective(proj);
+        const float eye[3] = { 0.f, 0.f, -400.f };
+        LookAt({ eye[0], eye[1], eye[2] }, { 0.f, 0.f, 0.f }, view);
+
+        // a few pixels: a coarser LOD, drawn whole without meshlet culling
+        auto stats = list.Cull(view, proj, eye, 720.f);
+        auto lod = list.GetLod(id);
+        UDXR_CHECK(lod > 0 && lod < mesh.chain.lods.size());
+        UDXR_CHECK(stats.meshlets.meshletNum == 0);
+        UDXR_CHECK(stats.drawNum == 1 && stats.indexNum == mesh.chain.lods[lod].indexNum);
+
+        RecordingDevice device;
+        list.Record(device);
+        UDXR_CHECK(device.calls.size() == 3);
+        UDXR_CHECK(device.calls[2].startIndex == mesh.chain.lods[lod].indexOffset);
+        UDXR_CHECK(device.calls[2].indexNum == mesh.chain.lods[lod].indexNum);
+
+        // no selector: always LOD 0
+        auto item = mesh.MakeItem(0, 0);
+        item.lodSelector = nullptr;
+        item.meshlets = nullptr;
+        list.GetItem(id) = item;
+        stats = list.Cull(view, proj, eye, 720.f);
+        UDXR_CHECK(list.GetLod(id) == 0);
+        UDXR_CHECK(stats.drawNum == 1 && stats.indexNum == mesh.chain.lods[0].indexNum);
+    }
+
+    void TestSort() {
+        // two buffers, interleaved in Add order, at different depths along +z
+        const int buffers[2] = { 0, 1 };
+        const float depths[6] = { 5.f, 3.f, 9.f, 1.f, 7.f, 2.f };
+        DrawList list;
+        for (size_t i = 0; i < 6; i++) {
+            DrawList::Item item;
+            item.buffers = &buffers[i % 2];
+            item.world[14] = depths[i];
+            item.indexNum = 3;
+            item.startIndex = static_cast<uint32_t>(3 * i);
+            list.Add(item);
+        }
+
+        float view[16], proj[16];
+        Perspective(proj);
+        const float eye[3] = { 0.f, 0.f, 0.f };
+        LookAt({ 0.f, 0.f, 0.f }, { 0.f, 0.f, 1.f }, view);
+        list.Cull(view, proj, eye, 720.f);
+
+        // Add order until the first Sort: every item rebinds
+        StubDrawDevice stub;
+        list.Record(stub);
+        UDXR_CHECK(stub.GetStats().bufferBindNum == 6);
+        UDXR_CHECK(stub.GetStats().itemNum == 6);
+        UDXR_CHECK(stub.GetStats().drawNum == 6);
+        UDXR_CHECK(stub.GetStats().indexNum == 18);
+
+        list.Sort(view);
+        stub.Reset();
+        list.Record(stub);
+        UDXR_CHECK(stub.GetStats().bufferBindNum == 2);
+        UDXR_CHECK(stub.GetStats().drawNum == 6);
+
+        // grouped by buffers, front to back in each group
+        RecordingDevice device;
+        list.Record(device);
+        vector<size_t> items;
+        for (const auto& call : device.calls) {
+            if (call.type == Call::Type::SetItem)
+                items.push_back(call.item);
+        }
+        UDXR_CHECK(items.size() == 6);
+        for (size_t i = 1; i < 6; i++) {
+            const auto& prev = list.GetItem(items[i - 1]);
+            const auto& cur = list.GetItem(items[i]);
+            if (prev.buffers == cur.buffers)
+                UDXR_CHECK(prev.world[14] < cur.world[14]);
+        }
+        UDXR_CHECK(list.GetItem(items[0]).buffers != list.GetItem(items[5]).buffers);
+    }
+}
+
+int main() {
+    Mesh mesh;
+    TestMeshletDraws(mesh);
+    TestLod(mesh);
+    TestSort();
+    cout << "DrawList: ok" << endl;
+    return 0;
+}
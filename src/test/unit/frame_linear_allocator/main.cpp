@@ -0,0 +1,214 @@
+#include "../Check.h"
+
+#include <UDXRenderer/FrameLinearAllocator.h>
+
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <random>
+#include <utility>
+#include <vector>
+
+using namespace Ubpa;
+using namespace std;
+
+namespace {
+    constexpr uint64_t Invalid = FrameLinearAllocator::InvalidOffset;
+
+    // stands in for an ID3D12Fence: the "GPU" completes frames when the test says so
+    struct SimulatedFence {
+        uint64_t signaled{ 0 };
+        uint64_t completed{ 0 };
+
+        uint64_t Signal() { return ++signaled; }
+        void CompleteUpTo(uint64_t value) { completed = value; }
+    };
+
+    void TestAllocate() {
+        FrameLinearAllocator ring(100);
+        UDXR_CHECK(ring.Allocate(10) == 0);
+        UDXR_CHECK(ring.Allocate(20) == 10);
+        // aligned up from 30, the padding counts as used
+        UDXR_CHECK(ring.Allocate(5, 16) == 32);
+        UDXR_CHECK(ring.GetUsedNum() == 37);
+
+        UDXR_CHECK(ring.Allocate(0) == Invalid);
+        UDXR_CHECK(ring.Allocate(101) == Invalid);
+        UDXR_CHECK(ring.GetUsedNum() == 37);
+    }
+
+    void TestWrapAround() {
+        SimulatedFence fence;
+        FrameLinearAllocator ring(100);
+
+        UDXR_CHECK(ring.Allocate(60) == 0);
+        uint64_t f1 = fence.Signal();
+        ring.EndFrame(f1);
+        UDXR_CHECK(ring.Allocate(30) == 60);
+        uint64_t f2 = fence.Signal();
+        ring.EndFrame(f2);
+        UDXR_CHECK(ring.GetPendingFrameNum() == 2);
+
+        // 10 free at the end of the ring, the front is still used by frame 1
+        ring.Reclaim(fence.completed);
+        UDXR_CHECK(ring.Allocate(20) == Invalid);
+
+        fence.CompleteUpTo(f1);
+        ring.Reclaim(fence.completed);
+        UDXR_CHECK(ring.GetPendingFrameNum() == 1);
+        UDXR_CHECK(ring.GetUsedNum() == 30);
+
+        // a range never wraps: the 10 at the end are skipped and retired with this frame
+        UDXR_CHECK(ring.Allocate(20) == 0);
+        UDXR_CHECK(ring.GetUsedNum() == 60);
+        UDXR_CHECK(ring.Allocate(40) == 20);
+        UDXR_CHECK(ring.GetUsedNum() == 100);
+        uint64_t f3 = fence.Signal();
+        ring.EndFrame(f3);
+
+        fence.CompleteUpTo(f2);
+        ring.Reclaim(fence.completed);
+        UDXR_CHECK(ring.GetUsedNum() == 70);
+        // frame 3 freed the skipped tail too
+        fence.CompleteUpTo(f3);
+        ring.Reclaim(fence.completed);
+        UDXR_CHECK(ring.GetUsedNum() == 0);
+        UDXR_CHECK(ring.GetPendingFrameNum() == 0);
+        UDXR_CHECK(ring.GetPeakUsedNum() == 100);
+
+        // an empty ring starts over at 0
+        UDXR_CHECK(ring.Allocate(100) == 0);
+    }
+
+    void TestAlignedAtTail() {
+        SimulatedFence fence;
+        FrameLinearAllocator ring(64);
+
+        UDXR_CHECK(ring.Allocate(40) == 0);
+        uint64_t f1 = fence.Signal();
+        ring.EndFrame(f1);
+        UDXR_CHECK(ring.Allocate(10) == 40);
+        uint64_t f2 = fence.Signal();
+        ring.EndFrame(f2);
+        fence.CompleteUpTo(f1);
+        ring.Reclaim(fence.completed);
+        // in use: [40, 50)
+
+        // unaligned it would fit at 50, aligned to 16 it would end at 72: wraps to 0
+        UDXR_CHECK(ring.Allocate(8, 16) == 0);
+        UDXR_CHECK(ring.GetUsedNum() == 10 + 14 + 8);
+        // [8, 40) is free, aligned to 16 the range starts at 16
+        UDXR_CHECK(ring.Allocate(4, 16) == 16);
+        UDXR_CHECK(ring.GetUsedNum() == 32 + 8 + 4);
+        // aligned to 32 it would end past the frame in use at 40
+        UDXR_CHECK(ring.Allocate(16, 32) == Invalid);
+        UDXR_CHECK(ring.GetUsedNum() == 44);
+        // without the alignment it fits
+        UDXR_CHECK(ring.Allocate(16) == 20);
+        UDXR_CHECK(ring.Allocate(4, 4) == 36);
+        UDXR_CHECK(ring.GetUsedNum() == 64);
+
+        // a range that fits at the tail once aligned isn't moved to the front
+        FrameLinearAllocator other(64);
+        UDXR_CHECK(other.Allocate(50) == 0);
+        UDXR_CHECK(other.Allocate(6, 8) == 56);
+        UDXR_CHECK(other.GetUsedNum() == 62);
+    }
+
+    void TestFull() {
+        SimulatedFence fence;
+        FrameLinearAllocator ring(32);
+
+        UDXR_CHECK(ring.Allocate(32) == 0);
+        UDXR_CHECK(ring.Allocate(1) == Invalid);
+        uint64_t f1 = fence.Signal();
+        ring.EndFrame(f1);
+
+        // a frame without allocations retires nothing
+        uint64_t f2 = fence.Signal();
+        ring.EndFrame(f2);
+        UDXR_CHECK(ring.GetPendingFrameNum() == 1);
+
+        // full until the GPU passes the fence of frame 1
+        ring.Reclaim(fence.completed);
+        UDXR_CHECK(ring.Allocate(1) == Invalid);
+        UDXR_CHECK(ring.GetUsedNum() == 32);
+
+        fence.CompleteUpTo(f2);
+        ring.Reclaim(fence.completed);
+        UDXR_CHECK(ring.GetUsedNum() == 0);
+        UDXR_CHECK(ring.Allocate(1) == 0);
+        UDXR_CHECK(ring.GetPeakUsedNum() == 32);
+    }
+
+    void TestFramesInFlight() {
+        SimulatedFence fence;
+        const uint64_t capacity = 1024;
+        const uint64_t frameLatency = 3;
+        FrameLinearAllocator ring(capacity);
+
+        // frame that owns every slot, 0: free
+        vector<uint64_t> owners(capacity, 0);
+        struct Range {
+            uint64_t offset;
+            uint64_t num;
+        };
+        deque<pair<uint64_t, vector<Range>>> pending; // per frame fence
+
+        mt19937 rng(0);
+        for (size_t f = 0; f < 2000; f++) {
+            // the GPU lags frameLatency - 1 frames behind
+            if (fence.signaled >= frameLatency)
+                fence.CompleteUpTo(fence.signaled - (frameLatency - 1));
+            ring.Reclaim(fence.completed);
+            while (!pending.empty() && pending.front().first <= fence.completed) {
+                for (const auto& r : pending.front().second) {
+                    for (uint64_t i = r.offset; i < r.offset + r.num; i++)
+                        owners[i] = 0;
+                }
+                pending.pop_front();
+            }
+            UDXR_CHECK(ring.GetPendingFrameNum() == pending.size());
+
+            // at most 8 * (16 + 15 padding) per frame, 3 frames always fit
+            uint64_t frame = fence.signaled + 1;
+            vector<Range> ranges;
+            size_t allocationNum = rng() % 9;
+            for (size_t i = 0; i < allocationNum; i++) {
+                uint64_t num = 1 + rng() % 16;
+                uint64_t alignment = uint64_t{ 1 } << (rng() % 5);
+                uint64_t offset = ring.Allocate(num, alignment);
+                UDXR_CHECK(offset != Invalid);
+                UDXR_CHECK(offset % alignment == 0);
+                UDXR_CHECK(offset + num <= capacity);
+                for (uint64_t j = offset; j < offset + num; j++) {
+                    // never handed out while a pending frame uses it
+                    UDXR_CHECK(owners[j] == 0);
+                    owners[j] = frame;
+                }
+                ranges.push_back({ offset, num });
+            }
+
+            UDXR_CHECK(fence.Signal() == frame);
+            ring.EndFrame(frame);
+            if (!ranges.empty())
+                pending.emplace_back(frame, move(ranges));
+        }
+
+        fence.CompleteUpTo(fence.signaled);
+        ring.Reclaim(fence.completed);
+        UDXR_CHECK(ring.GetUsedNum() == 0);
+        UDXR_CHECK(ring.GetPendingFrameNum() == 0);
+        UDXR_CHECK(ring.GetPeakUsedNum() <= capacity);
+    }
+}
+
+int main() {
+    TestAllocate();
+    TestWrapAround();
+    TestAlignedAtTail();
+    TestFull();
+    TestFramesInFlight();
+    cout << "FrameLinearAllocator: ok" << endl;
+    return 0;
+}
@@ -0,0 +1,150 @@
+#include "../Check.h"
+
+#include <UDXRenderer/FramePacer.h>
+
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+
+using namespace Ubpa;
+using namespace std;
+
+namespace {
+    constexpr int64_t Ms = 1'000'000;
+
+    bool Near(double a, double b, double eps = 1e-9) {
+        return fabs(a - b) < eps;
+    }
+
+    FramePacer::Desc MakeDesc(double fps) {
+        FramePacer::Desc desc;
+        desc.targetFps = fps;
+        desc.spinThresholdNs = 2 * Ms;
+        desc.smoothingWindow = 4;
+        return desc;
+    }
+
+    void TestOnTime() {
+        // 100 fps: 10 ms periods, the clock oversleeps less than the spin threshold
+        ManualClock clock;
+        clock.SetOversleep(Ms / 2);
+        clock.SetSpinStep(1000);
+        FramePacer pacer(clock, MakeDesc(100.));
+
+        for (int i = 0; i < 10; i++) {
+            clock.Advance(3 * Ms); // the frame's work
+            double dt = pacer.Wait();
+            UDXR_CHECK(clock.Now() == (i + 1) * 10 * Ms);
+            UDXR_CHECK(Near(dt, 0.01));
+        }
+        const auto& error = pacer.GetErrorStats();
+        UDXR_CHECK(error.frameNum == 10);
+        UDXR_CHECK(error.maxAbsMs == 0.);
+        UDXR_CHECK(error.missedNum == 0);
+    }
+
+    void TestOversleepDoesNotDrift() {
+        // sleeping overshoots the deadline by 1 ms every frame
+        ManualClock clock;
+        clock.SetOversleep(3 * Ms);
+        FramePacer pacer(clock, MakeDesc(100.));
+
+        for (int i = 0; i < 20; i++) {
+            pacer.Wait();
+            // deadlines advance by whole periods, the error doesn't accumulate
+            UDXR_CHECK(clock.Now() == (i + 1) * 10 * Ms + Ms);
+            UDXR_CHECK(Near(pacer.GetErrorStats().lastMs, 1.));
+        }
+        const auto& error = pacer.GetErrorStats();
+        UDXR_CHECK(Near(error.meanAbsMs, 1.));
+        UDXR_CHECK(Near(error.maxAbsMs, 1.));
+        UDXR_CHECK(error.missedNum == 0);
+    }
+
+    void TestMissedFrameRestartsSchedule() {
+        ManualClock clock;
+        FramePacer pacer(clock, MakeDesc(100.));
+        pacer.Wait();
+        UDXR_CHECK(clock.Now() == 10 * Ms);
+
+        // a 35 ms hitch: more than a period late, no burst of frames to catch up
+        clock.Advance(35 * Ms);
+        pacer.Wait();
+        UDXR_CHECK(clock.Now() == 45 * Ms);
+        UDXR_CHECK(pacer.GetErrorStats().missedNum == 1);
+        UDXR_CHECK(Near(pacer.GetErrorStats().lastMs, 25.));
+        UDXR_CHECK(Near(pacer.GetRawDelta(), 0.035));
+
+        pacer.Wait();
+        UDXR_CHECK(clock.Now() == 55 * Ms);
+        UDXR_CHECK(Near(pacer.GetErrorStats().lastMs, 0.));
+        UDXR_CHECK(pacer.GetErrorStats().missedNum == 1);
+    }
+
+    void TestSmoothing() {
+        ManualClock clock;
+        FramePacer pacer(clock, MakeDesc(100.));
+
+        // window of 4: the 35 ms hitch is averaged with three 10 ms frames
+        pacer.Wait();
+        clock.Advance(35 * Ms);
+        double dt = pacer.Wait();
+        UDXR_CHECK(Near(dt, (0.01 * 3 + 0.035) / 4));
+
+        for (int i = 0; i < 4; i++)
+            dt = pacer.Wait();
+        UDXR_CHECK(Near(dt, 0.01));
+        UDXR_CHECK(Near(pacer.GetSmoothedDelta(), 0.01));
+    }
+
+    void TestResetAndTargetFps() {
+        ManualClock clock;
+        FramePacer pacer(clock, MakeDesc(100.));
+        pacer.Wait();
+
+        // a long pause (e.g. loading) doesn't count as a missed frame after Reset()
+        clock.Advance(500 * Ms);
+        pacer.Reset();
+        UDXR_CHECK(pacer.GetErrorStats().frameNum == 0);
+        pacer.Wait();
+        UDXR_CHECK(clock.Now() == 520 * Ms);
+        UDXR_CHECK(pacer.GetErrorStats().missedNum == 0);
+
+        pacer.SetTargetFps(50.);
+        pacer.Reset();
+        pacer.Wait();
+        UDXR_CHECK(clock.Now() == 540 * Ms);
+        UDXR_CHECK(Near(pacer.GetSmoothedDelta(), 0.02));
+    }
+
+    void TestSteadyClock() {
+        auto& clock = SteadyClock::Instance();
+        int64_t t0 = clock.Now();
+        clock.SleepFor(2 * Ms);
+        int64_t t1 = clock.Now();
+        UDXR_CHECK(t1 - t0 >= 2 * Ms);
+        clock.SleepFor(-Ms); // returns at once
+        clock.Spin();
+        UDXR_CHECK(clock.Now() >= t1);
+
+        // 10 frames at 200 fps on the real clock, each wakes at or after its deadline
+        FramePacer pacer(clock, MakeDesc(200.));
+        int64_t begin = clock.Now();
+        for (int i = 0; i < 10; i++)
+            pacer.Wait();
+        UDXR_CHECK(clock.Now() - begin >= 10 * 5 * Ms - Ms);
+        UDXR_CHECK(pacer.GetErrorStats().frameNum == 10);
+        UDXR_CHECK(pacer.GetErrorStats().lastMs >= 0.); // spinning never wakes early
+    }
+}
+
+int main() {
+    TestOnTime();
+    TestOversleepDoesNotDrift();
+    TestMissedFrameRestartsSchedule();
+    TestSmoothing();
+    TestResetAndTargetFps();
+    TestSteadyClock();
+    cout << "FramePacer: ok" << endl;
+    return 0;
+}
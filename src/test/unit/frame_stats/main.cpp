@@ -0,0 +1,328 @@
+#include "../Check.h"
+
+#include <UDXRenderer/FrameStats.h>
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Ubpa;
+using namespace std;
+
+namespace {
+    constexpr int64_t Ms = 1000000;
+
+    bool Near(double a, double b) {
+        return fabs(a - b) < 1e-9;
+    }
+
+    bool Contains(const string& text, const string& part) {
+        return text.find(part) != string::npos;
+    }
+
+    // one frame of frameMs, the first stageMs of it in stage
+    void RecordFrame(FrameStats& stats, ManualClock& clock, size_t stage, int64_t frameMs, int64_t stageMs) {
+        stats.BeginFrame();
+        {
+            FrameStats::ScopedStage s(stats, stage);
+            clock.Advance(stageMs * Ms);
+        }
+        clock.Advance((frameMs - stageMs) * Ms);
+        stats.EndFrame();
+    }
+
+    void TestStages() {
+        FrameStats stats;
+        size_t update = stats.RegisterStage("update");
+        size_t render = stats.RegisterStage("render");
+        UDXR_CHECK(update == 0 && render == 1);
+        UDXR_CHECK(stats.RegisterStage("update") == update);
+        UDXR_CHECK(stats.GetStageNum() == 2);
+        UDXR_CHECK(stats.FindStage("render") == render);
+        UDXR_CHECK(stats.FindStage("present") == FrameStats::InvalidStage);
+        UDXR_CHECK(stats.GetStageName(render) == "render");
+    }
+
+    void TestPercentiles() {
+        ManualClock clock;
+        FrameStats stats(256, clock);
+        size_t update = stats.RegisterStage("update");
+
+        // frame i takes i + 1 ms, half of it in update (rounded down)
+        for (int64_t i = 0; i < 100; i++)
+            RecordFrame(stats, clock, update, i + 1, (i + 1) / 2);
+
+        auto summary = stats.Summarize();
+        UDXR_CHECK(summary.frameNum == 100);
+        UDXR_CHECK(Near(summary.frame.mean, 50.5));
+        UDXR_CHECK(Near(summary.frame.p50, 50.));
+        UDXR_CHECK(Near(summary.frame.p95, 95.));
+        UDXR_CHECK(Near(summary.frame.p99, 99.));
+        UDXR_CHECK(Near(summary.frame.max, 100.));
+        UDXR_CHECK(Near(summary.avgFps, 1000. / 50.5));
+        // the slowest 1% is the 100 ms frame
+        UDXR_CHECK(Near(summary.low1PercentFps, 10.));
+
+        UDXR_CHECK(summary.stages.size() == 1);
+        UDXR_CHECK(Near(summary.stages[update].p50, 25.));
+        UDXR_CHECK(Near(summary.stages[update].max, 50.));
+
+        // steady ramp: no stutter, and nothing beyond the 100 ms hitch threshold
+        UDXR_CHECK(summary.stutters.empty());
+        UDXR_CHECK(summary.hitches.empty());
+    }
+
+    void TestStuttersAndHitches() {
+        ManualClock clock;
+        FrameStats stats(256, clock);
+        size_t update = stats.RegisterStage("update");
+
+        // 10 ms frames, 35 twice the median, 38 a hitch, 39 just under twice the median
+        for (size_t i = 0; i < 40; i++) {
+            int64_t ms = 10;
+            if (i == 35)
+                ms = 25;
+            else if (i == 38)
+                ms = 150;
+            else if (i == 39)
+                ms = 19;
+            RecordFrame(stats, clock, update, ms, 1);
+        }
+        auto summary = stats.Summarize();
+        UDXR_CHECK((summary.stutters == vector<size_t>{ 35, 38 }));
+        UDXR_CHECK((summary.hitches == vector<size_t>{ 38 }));
+
+        FrameStats::SummaryConfig config;
+        config.stutterRatio = 1.5;
+        config.hitchMs = 20.;
+        summary = stats.Summarize(config);
+        UDXR_CHECK((summary.stutters == vector<size_t>{ 35, 38, 39 }));
+        UDXR_CHECK((summary.hitches == vector<size_t>{ 35, 38 }));
+
+        // the window needs stutterWindow frames before a frame is judged
+        FrameStats early(256, clock);
+        size_t earlyUpdate = early.RegisterStage("update");
+        for (size_t i = 0; i < 10; i++)
+            RecordFrame(early, clock, earlyUpdate, i == 5 ? 50 : 10, 1);
+        UDXR_CHECK(early.Summarize().stutters.empty());
+    }
+
+    void TestNestedStages() {
+        ManualClock clock;
+        FrameStats stats(16, clock);
+        size_t record = stats.RegisterStage("record");
+        size_t cull = stats.RegisterStage("cull");
+
+        stats.BeginFrame();
+        {
+            FrameStats::ScopedStage r(stats, record);
+            clock.Advance(2 * Ms);
+            {
+                FrameStats::ScopedStage c(stats, cull);
+                clock.Advance(3 * Ms);
+            }
+            clock.Advance(1 * Ms);
+            {
+                // entered twice in a frame: accumulates
+                FrameStats::ScopedStage c(stats, cull);
+                clock.Advance(4 * Ms);
+            }
+        }
+        {
+            FrameStats::ScopedStage c(stats, cull);
+            clock.Advance(1 * Ms);
+        }
+        stats.EndFrame();
+
+        auto samples = stats.Snapshot();
+        UDXR_CHECK(samples.size() == 1);
+        UDXR_CHECK(Near(samples[0].frameMs, 11.));
+        // exclusive: record doesn't count the cull scopes inside it
+        UDXR_CHECK(Near(samples[0].stageMs[record], 3.));
+        UDXR_CHECK(Near(samples[0].stageMs[cull], 8.));
+
+        // a stage of another FrameStats inside a stage isn't subtracted from it
+        FrameStats other(16, clock);
+        size_t load = other.RegisterStage("load");
+        stats.BeginFrame();
+        other.BeginFrame();
+        {
+            FrameStats::ScopedStage r(stats, record);
+            clock.Advance(1 * Ms);
+            {
+                FrameStats::ScopedStage l(other, load);
+                clock.Advance(2 * Ms);
+            }
+        }
+        other.EndFrame();
+        stats.EndFrame();
+        UDXR_CHECK(Near(stats.Snapshot().back().stageMs[record], 3.));
+        UDXR_CHECK(Near(other.Snapshot().back().stageMs[load], 2.));
+    }
+
+    void TestHistogram() {
+        ManualClock clock;
+        FrameStats stats(16, clock);
+        size_t update = stats.RegisterStage("update");
+        for (int64_t ms : { 1, 4, 5, 9, 12, 19, 20, 100 })
+            RecordFrame(stats, clock, update, ms, 0);
+
+        // [0, 5) [5, 10) [10, 15) [15, 20), 20 and 100 overflow
+        auto histogram = stats.ComputeHistogram(5., 4);
+        UDXR_CHECK(Near(histogram.binMs, 5.));
+        UDXR_CHECK((histogram.bins == vector<size_t>{ 2, 2, 1, 1 }));
+        UDXR_CHECK(histogram.overflow == 2);
+
+        histogram = stats.ComputeHistogram(50., 4);
+        UDXR_CHECK((histogram.bins == vector<size_t>{ 7, 0, 1, 0 }));
+        UDXR_CHECK(histogram.overflow == 0);
+    }
+
+    void TestExport() {
+        ManualClock clock;
+        FrameStats stats(16, clock);
+        size_t update = stats.RegisterStage("update");
+        size_t render = stats.RegisterStage("render");
+
+        stats.BeginFrame();
+        stats.AddStageTime(render, 2.5);
+        clock.Advance(10 * Ms);
+        stats.EndFrame();
+        RecordFrame(stats, clock, update, 20, 4);
+
+        ostringstream csv;
+        stats.WriteCSV(csv);
+        UDXR_CHECK(csv.str() ==
+            "frame,frame_ms,update_ms,render_ms\n"
+            "0,10,0,2.5\n"
+            "1,20,4,0\n");
+
+        ostringstream json;
+        stats.WriteJSON(json);
+        string text = json.str();
+        UDXR_CHECK(Contains(text, "\"stages\": [\"update\", \"render\"]"));
+        UDXR_CHECK(Contains(text, "\"frames\": 2,"));
+        UDXR_CHECK(Contains(text, "\"frame_ms\": { \"mean\": 15, \"p50\": 10, \"p95\": 20, \"p99\": 20, \"max\": 20 }"));
+        UDXR_CHECK(Contains(text, "\"render\": { \"mean\": 1.25, \"p50\": 0, \"p95\": 2.5, \"p99\": 2.5, \"max\": 2.5 }"));
+        UDXR_CHECK(Contains(text, "\"stutters\": []"));
+        UDXR_CHECK(Contains(text, "\"hitches\": []"));
+        UDXR_CHECK(Contains(text, "\"overflow\": 0 }"));
+        UDXR_CHECK(Contains(text, "{ \"frame\": 0, \"frame_ms\": 10, \"update\": 0, \"render\": 2.5 }"));
+        UDXR_CHECK(Contains(text, "{ \"frame\": 1, \"frame_ms\": 20, \"update\": 4, \"render\": 0 }"));
+
+        // the bins of the 10 and 20 ms frames in the default 1 ms histogram
+        size_t bins = text.find("\"bins\": [");
+        UDXR_CHECK(bins != string::npos);
+        UDXR_CHECK(text.compare(bins, 42, "\"bins\": [0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, ") == 0);
+
+        // by extension
+        auto csvPath = filesystem::temp_directory_path() / "udxr_frame_stats.csv";
+        auto jsonPath = filesystem::temp_directory_path() / "udxr_frame_stats.json";
+        UDXR_CHECK(stats.WriteFile(csvPath.string()));
+        UDXR_CHECK(stats.WriteFile(jsonPath.string()));
+        {
+            ifstream csvFile(csvPath);
+            stringstream csvText;
+            csvText << csvFile.rdbuf();
+            UDXR_CHECK(csvText.str() == csv.str());
+            ifstream jsonFile(jsonPath);
+            stringstream jsonText;
+            jsonText << jsonFile.rdbuf();
+            UDXR_CHECK(jsonText.str() == text);
+        }
+        filesystem::remove(csvPath);
+        filesystem::remove(jsonPath);
+        UDXR_CHECK(!stats.WriteFile((filesystem::temp_directory_path() / "udxr_missing_dir" / "stats.csv").string()));
+    }
+
+    void TestRingOverwrite() {
+        ManualClock clock;
+        FrameStats stats(8, clock);
+        size_t update = stats.RegisterStage("update");
+
+        // frame i takes i + 1 ms
+        for (int64_t i = 0; i < 20; i++)
+            RecordFrame(stats, clock, update, i + 1, 1);
+
+        // the 8 most recent frames, oldest first
+        UDXR_CHECK(stats.GetCapacity() == 8);
+        UDXR_CHECK(stats.GetFrameNum() == 8);
+        auto samples = stats.Snapshot();
+        UDXR_CHECK(samples.size() == 8);
+        for (size_t i = 0; i < samples.size(); i++) {
+            UDXR_CHECK(samples[i].frameIndex == 12 + i);
+            UDXR_CHECK(Near(samples[i].frameMs, 13. + i));
+        }
+        auto summary = stats.Summarize();
+        UDXR_CHECK(summary.frameNum == 8);
+        UDXR_CHECK(Near(summary.frame.max, 20.));
+
+        stats.Clear();
+        UDXR_CHECK(stats.GetFrameNum() == 0);
+        UDXR_CHECK(stats.Snapshot().empty());
+        UDXR_CHECK(stats.Summarize().frameNum == 0);
+
+        // frame indices restart, a smaller ring keeps fewer frames
+        stats.SetCapacity(3);
+        for (int64_t i = 0; i < 5; i++)
+            RecordFrame(stats, clock, update, 1, 0);
+        samples = stats.Snapshot();
+        UDXR_CHECK(samples.size() == 3);
+        UDXR_CHECK(samples.front().frameIndex == 2 && samples.back().frameIndex == 4);
+    }
+
+    void TestConcurrentReader() {
+        ManualClock clock;
+        FrameStats stats(64, clock);
+        size_t update = stats.RegisterStage("update");
+        const size_t frameNum = 20000;
+
+        // frame i takes i % 7 + 1 ms, update i % 7 ms of it
+        auto frameMsOf = [](size_t i) { return static_cast<int64_t>(i % 7 + 1); };
+        auto stageMsOf = [](size_t i) { return static_cast<int64_t>(i % 7); };
+
+        atomic<bool> done{ false };
+        thread reader([&]() {
+            while (!done.load(memory_order_acquire)) {
+                auto samples = stats.Snapshot();
+                UDXR_CHECK(samples.size() <= stats.GetCapacity());
+                for (size_t i = 0; i < samples.size(); i++) {
+                    const auto& sample = samples[i];
+                    // never a torn sample: both fields belong to the same frame
+                    UDXR_CHECK(Near(sample.frameMs, Clock::ToMilliseconds(frameMsOf(sample.frameIndex) * Ms)));
+                    UDXR_CHECK(Near(sample.stageMs[update], Clock::ToMilliseconds(stageMsOf(sample.frameIndex) * Ms)));
+                    UDXR_CHECK(i == 0 || samples[i - 1].frameIndex < sample.frameIndex);
+                }
+            }
+        });
+
+        for (size_t i = 0; i < frameNum; i++)
+            RecordFrame(stats, clock, update, frameMsOf(i), stageMsOf(i));
+        done.store(true, memory_order_release);
+        reader.join();
+
+        auto samples = stats.Snapshot();
+        UDXR_CHECK(samples.size() == 64);
+        UDXR_CHECK(samples.back().frameIndex == frameNum - 1);
+    }
+}
+
+int main() {
+    TestStages();
+    TestPercentiles();
+    TestStuttersAndHitches();
+    TestNestedStages();
+    TestHistogram();
+    TestExport();
+    TestRingOverwrite();
+    TestConcurrentReader();
+    cout << "FrameStats: ok" << endl;
+    return 0;
+}
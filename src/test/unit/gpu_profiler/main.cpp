@@ -0,0 +1,173 @@
+#include "../Check.h"
+
+#include <UDXRenderer/GpuProfiler.h>
+
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+using namespace Ubpa;
+using namespace std;
+
+namespace {
+    // GPU timestamps from a counter the test advances, resolved queries are copied
+    // aside like the readback buffer of D3D12TimestampSource
+    class FakeQuerySource : public GpuProfiler::QuerySource {
+    public:
+        FakeQuerySource(size_t slotNum, size_t capacity)
+            : capacity{ capacity }, written(slotNum * capacity), resolved(slotNum * capacity) {}
+
+        virtual size_t GetQueryCapacity() const override { return capacity; }
+        virtual uint64_t GetFrequency() const override { return 1000000; } // 1 tick = 1 us
+
+        virtual void WriteTimestamp(size_t slot, size_t query) override {
+            UDXR_CHECK(query < capacity);
+            written[slot * capacity + query] = gpuTicks;
+            writeNum++;
+        }
+        virtual void Resolve(size_t slot, size_t queryNum) override {
+            for (size_t i = 0; i < queryNum; i++)
+                resolved[slot * capacity + i] = written[slot * capacity + i];
+            resolveNum++;
+        }
+        virtual void ReadBack(size_t slot, size_t queryNum, uint64_t* ticks) override {
+            for (size_t i = 0; i < queryNum; i++)
+                ticks[i] = resolved[slot * capacity + i];
+            readBackNum++;
+        }
+
+        uint64_t gpuTicks{ 0 };
+        size_t writeNum{ 0 };
+        size_t resolveNum{ 0 };
+        size_t readBackNum{ 0 };
+
+    private:
+        size_t capacity;
+        vector<uint64_t> written;
+        vector<uint64_t> resolved;
+    };
+
+    bool Near(double a, double b) {
+        return fabs(a - b) < 1e-9;
+    }
+
+    // frame f: "A" takes f + 1 ms, "B" takes 2 ms
+    void RecordFrame(GpuProfiler& profiler, FakeQuerySource& source, size_t f) {
+        profiler.BeginFrame();
+        size_t a = profiler.BeginPass("A");
+        source.gpuTicks += (f + 1) * 1000;
+        profiler.EndPass(a);
+        size_t b = profiler.BeginPass("B");
+        source.gpuTicks += 2000;
+        profiler.EndPass(b);
+        profiler.EndFrame();
+    }
+
+    void TestLatency() {
+        const size_t latency = 3;
+        FakeQuerySource source(latency, 8);
+        GpuProfiler profiler(source, latency);
+
+        for (size_t f = 0; f < latency; f++) {
+            RecordFrame(profiler, source, f);
+            UDXR_CHECK(profiler.GetLatestFrameIndex() == static_cast<size_t>(-1));
+            UDXR_CHECK(profiler.GetLatestTimings().empty());
+        }
+        UDXR_CHECK(source.readBackNum == 0);
+        UDXR_CHECK(source.resolveNum == latency);
+
+        // frame f reads back frame f - latency, when its slot comes around again
+        for (size_t f = latency; f < 10; f++) {
+            RecordFrame(profiler, source, f);
+            UDXR_CHECK(profiler.GetLatestFrameIndex() == f - latency);
+            const auto& timings = profiler.GetLatestTimings();
+            UDXR_CHECK(timings.size() == 2);
+            UDXR_CHECK(timings[0].name == "A" && Near(timings[0].ms, double(f - latency + 1)));
+            UDXR_CHECK(timings[1].name == "B" && Near(timings[1].ms, 2.));
+        }
+        UDXR_CHECK(source.readBackNum == 10 - latency);
+    }
+
+    void TestNestedAndUnended() {
+        FakeQuerySource source(1, 8);
+        GpuProfiler profiler(source, 1);
+
+        profiler.BeginFrame();
+        size_t outer = profiler.BeginPass("outer");
+        source.gpuTicks += 1000;
+        size_t inner = profiler.BeginPass("inner");
+        source.gpuTicks += 3000;
+        profiler.EndPass(inner);
+        source.gpuTicks += 1000;
+        profiler.EndPass(outer);
+        profiler.BeginPass("unended");
+        profiler.EndFrame();
+
+        profiler.BeginFrame();
+        const auto& timings = profiler.GetLatestTimings();
+        UDXR_CHECK(timings.size() == 2); // the unended pass is left out
+        UDXR_CHECK(timings[0].name == "outer" && Near(timings[0].ms, 5.));
+        UDXR_CHECK(timings[1].name == "inner" && Near(timings[1].ms, 3.));
+        profiler.EndFrame();
+    }
+
+    void TestOutOfQueries() {
+        // room for two passes per frame
+        FakeQuerySource source(2, 4);
+        GpuProfiler profiler(source, 2);
+
+        profiler.BeginFrame();
+        size_t a = profiler.BeginPass("a");
+        size_t b = profiler.BeginPass("b");
+        size_t c = profiler.BeginPass("c");
+        UDXR_CHECK(a != static_cast<size_t>(-1) && b != static_cast<size_t>(-1));
+        UDXR_CHECK(c == static_cast<size_t>(-1));
+        profiler.EndPass(c); // no-op
+        profiler.EndPass(b);
+        profiler.EndPass(a);
+        profiler.EndFrame();
+        UDXR_CHECK(profiler.GetDroppedPassNum() == 1);
+        UDXR_CHECK(source.writeNum == 4);
+
+        // the next frame starts with a full slot again
+        profiler.BeginFrame();
+        UDXR_CHECK(profiler.BeginPass("a") != static_cast<size_t>(-1));
+        profiler.EndFrame();
+        UDXR_CHECK(profiler.GetDroppedPassNum() == 1);
+    }
+
+    void TestPublish() {
+        FakeQuerySource source(1, 8);
+        GpuProfiler profiler(source, 1);
+
+        FrameStats stats;
+        size_t aStage = GpuProfiler::RegisterStage(stats, "A");
+        UDXR_CHECK(stats.GetStageName(aStage) == "gpu A");
+        UDXR_CHECK(GpuProfiler::RegisterStage(stats, "A") == aStage);
+        UDXR_CHECK(stats.GetStageNum() == 1);
+
+        RecordFrame(profiler, source, 4);
+        RecordFrame(profiler, source, 0); // reads back the first frame
+
+        // "B" has no stage, it is skipped instead of registered mid-frame
+        stats.BeginFrame();
+        profiler.Publish(stats);
+        stats.EndFrame();
+        UDXR_CHECK(stats.GetStageNum() == 1);
+        UDXR_CHECK(stats.FindStage("gpu B") == FrameStats::InvalidStage);
+
+        auto samples = stats.Snapshot();
+        UDXR_CHECK(samples.size() == 1);
+        UDXR_CHECK(Near(samples[0].stageMs[aStage], 5.));
+    }
+}
+
+int main() {
+    TestLatency();
+    TestNestedAndUnended();
+    TestOutOfQueries();
+    TestPublish();
+    cout << "GpuProfiler: ok" << endl;
+    return 0;
+}
@@ -0,0 +1,250 @@
+#include "../Check.h"
+
+#include <UDXRenderer/LodSelector.h>
+#include <UDXRenderer/MeshSimplifier.h>
+
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <vector>
+
+using namespace Ubpa;
+using namespace std;
+
+namespace {
+    struct Float3 {
+        float x, y, z;
+    };
+
+    Float3 Sub(const Float3& a, const Float3& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+    float Dot(const Float3& a, const Float3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+    Float3 Cross(const Float3& a, const Float3& b) {
+        return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+    }
+
+    Float3 Normal(const vector<Float3>& positions, const uint32_t* t) {
+        return Cross(Sub(positions[t[1]], positions[t[0]]), Sub(positions[t[2]], positions[t[0]]));
+    }
+
+    // n x n quads over [0, 1]^2, z = height(x, y), front faces point to +z
+    template<typename Height>
+    void CreateGrid(uint32_t n, Height height, vector<Float3>& positions, vector<uint32_t>& indices) {
+        for (uint32_t y = 0; y <= n; y++) {
+            for (uint32_t x = 0; x <= n; x++) {
+                float u = float(x) / n;
+                float v = float(y) / n;
+                positions.push_back({ u, v, height(u, v) });
+            }
+        }
+        for (uint32_t y = 0; y < n; y++) {
+            for (uint32_t x = 0; x < n; x++) {
+                uint32_t v00 = y * (n + 1) + x;
+                uint32_t v10 = v00 + 1;
+                uint32_t v01 = v00 + n + 1;
+                uint32_t v11 = v01 + 1;
+                indices.insert(indices.end(), { v00, v10, v01, v10, v11, v01 });
+            }
+        }
+    }
+
+    // unit UV sphere, front faces point outwards
+    void CreateSphere(uint32_t slices, uint32_t stacks, vector<Float3>& positions, vector<uint32_t>& indices) {
+        const float pi = 3.14159265f;
+        // one vertex per pole, no seam: the sphere is closed and nothing is locked
+        positions.push_back({ 0.f, 1.f, 0.f });
+        for (uint32_t i = 1; i < stacks; i++) {
+            float phi = pi * i / stacks;
+            for (uint32_t j = 0; j < slices; j++) {
+                float theta = 2.f * pi * j / slices;
+                positions.push_back({ sinf(phi) * cosf(theta), cosf(phi), sinf(phi) * sinf(theta) });
+            }
+        }
+        positions.push_back({ 0.f, -1.f, 0.f });
+        auto ring = [&](uint32_t i, uint32_t j) { return 1 + (i - 1) * slices + j % slices; };
+        auto add = [&](uint32_t a, uint32_t b, uint32_t c) {
+            Float3 n = Cross(Sub(positions[b], positions[a]), Sub(positions[c], positions[a]));
+            if (Dot(n, positions[a]) < 0.f)
+                swap(b, c);
+            indices.insert(indices.end(), { a, b, c });
+        };
+        const uint32_t south = static_cast<uint32_t>(positions.size() - 1);
+        for (uint32_t j = 0; j < slices; j++) {
+            add(0, ring(1, j), ring(1, j + 1));
+            add(south, ring(stacks - 1, j + 1), ring(stacks - 1, j));
+            for (uint32_t i = 1; i + 1 < stacks; i++) {
+                add(ring(i, j), ring(i + 1, j), ring(i, j + 1));
+                add(ring(i, j + 1), ring(i + 1, j), ring(i + 1, j + 1));
+            }
+        }
+    }
+
+    double SignedAreaZ(const vector<Float3>& positions, const vector<uint32_t>& indices, size_t indexNum) {
+        double area = 0.;
+        for (size_t i = 0; i < indexNum; i += 3)
+            area += 0.5 * Normal(positions, &indices[i]).z;
+        return area;
+    }
+
+    // a plane simplifies without error, the locked border keeps its outline
+    void TestPlane() {
+        vector<Float3> positions;
+        vector<uint32_t> indices;
+        CreateGrid(32, [](float, float) { return 0.f; }, positions, indices);
+        const double area = SignedAreaZ(positions, indices, indices.size());
+
+        float error = -1.f;
+        vector<uint32_t> dst(indices.size());
+        size_t num = MeshSimplifier::Simplify(dst.data(), indices.data(), indices.size(),
+            positions.data(), positions.size(), sizeof(Float3), 0, 0.f, &error);
+        UDXR_CHECK(num < indices.size() / 4);
+        UDXR_CHECK(num % 3 == 0);
+        UDXR_CHECK(error == 0.f);
+        UDXR_CHECK(fabs(SignedAreaZ(positions, dst, num) - area) < 1e-4);
+        for (size_t i = 0; i < num; i += 3)
+            UDXR_CHECK(Normal(positions, &dst[i]).z > 0.f);
+    }
+
+    // a collapse is never taken past targetError
+    void TestErrorBound() {
+        vector<Float3> positions;
+        vector<uint32_t> indices;
+        CreateSphere(48, 32, positions, indices);
+        vector<uint32_t> dst(indices.size());
+
+        // every collapse of a curved surface costs something
+        size_t num = MeshSimplifier::Simplify(dst.data(), indices.data(), indices.size(),
+            positions.data(), positions.size(), sizeof(Float3), 0, 0.f);
+        UDXR_CHECK(num == indices.size());
+
+        size_t lastNum = indices.size();
+        for (float targetError : { 0.001f, 0.01f, 0.05f, 0.2f }) {
+            float error = -1.f;
+            num = MeshSimplifier::Simplify(dst.data(), indices.data(), indices.size(),
+                positions.data(), positions.size(), sizeof(Float3), 0, targetError, &error);
+            UDXR_CHECK(error >= 0.f && error <= targetError);
+            UDXR_CHECK(num <= lastNum);
+            lastNum = num;
+
+            // still closed around the center
+            for (size_t i = 0; i < num; i += 3)
+                UDXR_CHECK(Dot(Normal(positions, &dst[i]), positions[dst[i]]) > 0.f);
+        }
+        UDXR_CHECK(lastNum < indices.size() / 4);
+
+        // targetIndexNum stops it first
+        num = MeshSimplifier::Simplify(dst.data(), indices.data(), indices.size(),
+            positions.data(), positions.size(), sizeof(Float3), indices.size() / 2, 1.f);
+        UDXR_CHECK(num <= indices.size() / 2 && num > indices.size() / 4);
+    }
+
+    // a nearly flat, noisy height field: with no error bound, the collapses that would fold a triangle over are rejected
+    void TestFlipRejection() {
+        mt19937 rng(11);
+        uniform_real_distribution<float> noise(0.f, 0.002f);
+        vector<Float3> positions;
+        vector<uint32_t> indices;
+        CreateGrid(48, [&](float, float) { return noise(rng); }, positions, indices);
+
+        vector<uint32_t> dst(indices.size());
+        size_t num = MeshSimplifier::Simplify(dst.data(), indices.data(), indices.size(),
+            positions.data(), positions.size(), sizeof(Float3), 0, numeric_limits<float>::max());
+        UDXR_CHECK(num < indices.size() / 4);
+        for (size_t i = 0; i < num; i += 3)
+            UDXR_CHECK(Normal(positions, &dst[i]).z > 0.f);
+    }
+
+    void TestLodChain() {
+        vector<Float3> positions;
+        vector<uint32_t> indices;
+        CreateSphere(64, 48, positions, indices);
+        auto chain = MeshSimplifier::GenerateLods(indices.data(), indices.size(),
+            positions.data(), positions.size(), sizeof(Float3));
+
+        UDXR_CHECK(chain.lods.size() > 1);
+        UDXR_CHECK(chain.lods[0].indexOffset == 0);
+        UDXR_CHECK(chain.lods[0].indexNum == indices.size());
+        UDXR_CHECK(chain.lods[0].error == 0.f);
+        UDXR_CHECK(equal(indices.begin(), indices.end(), chain.indices.begin()));
+        for (size_t i = 1; i < chain.lods.size(); i++) {
+            const auto& prev = chain.lods[i - 1];
+            const auto& lod = chain.lods[i];
+            UDXR_CHECK(lod.indexOffset == prev.indexOffset + prev.indexNum);
+            UDXR_CHECK(lod.indexNum < prev.indexNum);
+            UDXR_CHECK(lod.error >= prev.error);
+        }
+        const auto& last = chain.lods.back();
+        UDXR_CHECK(last.indexOffset + last.indexNum == chain.indices.size());
+    }
+
+    void TestScreenSize() {
+        // radius 1 at distance 10, 90 degree fov (proj._22 = 1), 1000 pixels: 50 pixels
+        UDXR_CHECK(fabsf(LodSelector::ScreenSize(1.f, 10.f, 1.f, 1000.f) - 50.f) < 1e-4f);
+        UDXR_CHECK(LodSelector::ScreenSize(1.f, 0.5f, 1.f, 1000.f) == numeric_limits<float>::infinity());
+    }
+
+    void TestFromErrors() {
+        MeshSimplifier::Lod lods[3] = { { 0, 300, 0.f }, { 300, 100, 0.01f }, { 400, 30, 0.04f } };
+        auto selector = LodSelector::FromErrors(lods, 3, 1.f, 1.f);
+        const auto& thresholds = selector.GetThresholds();
+        UDXR_CHECK(selector.GetLodNum() == 3);
+        UDXR_CHECK(thresholds[0] == numeric_limits<float>::infinity());
+        // the error of a LOD projects to one pixel at its threshold
+        UDXR_CHECK(fabsf(thresholds[1] - 100.f) < 1e-3f);
+        UDXR_CHECK(fabsf(thresholds[2] - 25.f) < 1e-3f);
+    }
+
+    void TestHysteresis() {
+        LodSelector selector({ numeric_limits<float>::infinity(), 100.f, 50.f }, 0.1f);
+
+        // a new item takes the coarsest LOD that fits
+        UDXR_CHECK(selector.Select(0, 200.f) == 0);
+        UDXR_CHECK(selector.Select(0, 75.f) == 1);
+        UDXR_CHECK(selector.Select(0, 10.f) == 2);
+
+        // moving away: LOD 0 is kept down to 90 % of the threshold
+        UDXR_CHECK(selector.Select(0, 95.f) == 0);
+        UDXR_CHECK(selector.Select(0, 91.f) == 0);
+        UDXR_CHECK(selector.Select(0, 89.f) == 1);
+        // moving closer: LOD 1 is kept up to 110 % of the threshold
+        UDXR_CHECK(selector.Select(1, 105.f) == 1);
+        UDXR_CHECK(selector.Select(1, 109.f) == 1);
+        UDXR_CHECK(selector.Select(1, 111.f) == 0);
+        // the band around LOD 1's coarse end
+        UDXR_CHECK(selector.Select(1, 46.f) == 1);
+        UDXR_CHECK(selector.Select(1, 44.f) == 2);
+        UDXR_CHECK(selector.Select(2, 54.f) == 2);
+        UDXR_CHECK(selector.Select(2, 56.f) == 1);
+
+        // a size oscillating around a threshold never switches
+        uint32_t lod = selector.Select(0, 120.f);
+        uint32_t switches = 0;
+        for (int i = 0; i < 100; i++) {
+            uint32_t next = selector.Select(lod, i % 2 == 0 ? 96.f : 104.f);
+            switches += next != lod;
+            lod = next;
+        }
+        UDXR_CHECK(switches == 0);
+
+        // an out-of-range current LOD is clamped
+        UDXR_CHECK(selector.Select(7, 10.f) == 2);
+        UDXR_CHECK(selector.Select(7, 200.f) == 0);
+
+        // a single LOD
+        LodSelector single({ numeric_limits<float>::infinity() });
+        UDXR_CHECK(single.Select(0, 0.f) == 0);
+    }
+}
+
+int main() {
+    TestPlane();
+    TestErrorBound();
+    TestFlipRejection();
+    TestLodChain();
+    TestScreenSize();
+    TestFromErrors();
+    TestHysteresis();
+    cout << "MeshSimplifier / LodSelector: ok" << endl;
+    return 0;
+}
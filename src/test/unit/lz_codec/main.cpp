@@ -0,0 +1,151 @@
+#include "../Check.h"
+
+#include <UDXRenderer/LZCodec.h>
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace Ubpa;
+using namespace std;
+
+namespace {
+    constexpr size_t Failed = static_cast<size_t>(-1);
+
+    vector<uint8_t> Compress(const vector<uint8_t>& src) {
+        vector<uint8_t> packed(LZCodec::CompressBound(src.size()));
+        size_t size = LZCodec::Compress(src.data(), src.size(), packed.data(), packed.size());
+        UDXR_CHECK(size != 0 && size <= packed.size());
+        packed.resize(size);
+        return packed;
+    }
+
+    void CheckRoundTrip(const vector<uint8_t>& src) {
+        auto packed = Compress(src);
+        vector<uint8_t> dst(src.size() + 1, 0xcd);
+        UDXR_CHECK(LZCodec::Decompress(packed.data(), packed.size(), dst.data(), src.size()) == src.size());
+        UDXR_CHECK(src.empty() || memcmp(dst.data(), src.data(), src.size()) == 0);
+        UDXR_CHECK(dst.back() == 0xcd); // nothing past dstCapacity
+    }
+
+    vector<uint8_t> Text(size_t num) {
+        const string words[] = { "vertex ", "index ", "buffer ", "texture ", "mip ", "root ", "signature " };
+        mt19937 rng(1);
+        vector<uint8_t> text;
+        while (text.size() < num) {
+            const auto& word = words[rng() % size(words)];
+            text.insert(text.end(), word.begin(), word.end());
+        }
+        text.resize(num);
+        return text;
+    }
+
+    vector<uint8_t> Noise(size_t size) {
+        mt19937 rng(2);
+        vector<uint8_t> noise(size);
+        for (auto& b : noise)
+            b = static_cast<uint8_t>(rng());
+        return noise;
+    }
+
+    void TestRoundTrip() {
+        // shorter than a match may start
+        for (size_t size = 0; size <= 16; size++)
+            CheckRoundTrip(Text(size));
+
+        // long literal runs and long matches need extra length bytes
+        CheckRoundTrip(Noise(1000));
+        CheckRoundTrip(vector<uint8_t>(100000, 7)); // offset 1, overlapping copies
+        CheckRoundTrip(Text(64 * 1024));
+
+        // a match farther back than the 64 KB window is not taken
+        auto far = Noise(70000);
+        far.insert(far.end(), far.begin(), far.begin() + 1000);
+        CheckRoundTrip(far);
+
+        auto mixed = Noise(3000);
+        auto text = Text(5000);
+        mixed.insert(mixed.end(), text.begin(), text.end());
+        mixed.insert(mixed.end(), 300, 0);
+        CheckRoundTrip(mixed);
+
+        UDXR_CHECK(Compress(Text(64 * 1024)).size() < 64 * 1024 / 2);
+        UDXR_CHECK(Compress(vector<uint8_t>(100000, 7)).size() < 1000);
+        UDXR_CHECK(Compress(Noise(1000)).size() <= LZCodec::CompressBound(1000));
+    }
+
+    void TestCapacity() {
+        auto src = Text(4096);
+        auto packed = Compress(src);
+
+        // the compressor gives up instead of overrunning
+        vector<uint8_t> small(packed.size() - 1);
+        UDXR_CHECK(LZCodec::Compress(src.data(), src.size(), small.data(), small.size()) == 0);
+        UDXR_CHECK(LZCodec::Compress(src.data(), src.size(), nullptr, 0) == 0);
+
+        // so does the decompressor
+        vector<uint8_t> dst(src.size());
+        UDXR_CHECK(LZCodec::Decompress(packed.data(), packed.size(), dst.data(), src.size() - 1) == Failed);
+        UDXR_CHECK(LZCodec::Decompress(packed.data(), packed.size(), dst.data(), 0) == Failed);
+    }
+
+    void TestTruncated() {
+        auto src = Text(4096);
+        auto packed = Compress(src);
+        vector<uint8_t> dst(src.size());
+
+        UDXR_CHECK(LZCodec::Decompress(packed.data(), 0, dst.data(), dst.size()) == Failed);
+        // every prefix fails, or stops at a sequence boundary with less output
+        for (size_t size = 1; size < packed.size(); size++) {
+            vector<uint8_t> prefix(packed.begin(), packed.begin() + size); // exact size for the sanitizers
+            size_t rst = LZCodec::Decompress(prefix.data(), prefix.size(), dst.data(), dst.size());
+            UDXR_CHECK(rst == Failed || rst < src.size());
+        }
+    }
+
+    void TestCorrupted() {
+        vector<uint8_t> dst(256);
+
+        // offset 0
+        const uint8_t zeroOffset[] = { 0x10, 'a', 0, 0, 0x00 };
+        UDXR_CHECK(LZCodec::Decompress(zeroOffset, sizeof(zeroOffset), dst.data(), dst.size()) == Failed);
+        // offset before the start of the output
+        const uint8_t farOffset[] = { 0x10, 'a', 2, 0, 0x00 };
+        UDXR_CHECK(LZCodec::Decompress(farOffset, sizeof(farOffset), dst.data(), dst.size()) == Failed);
+        // a valid one for comparison: "a" then 4 copies of it
+        const uint8_t valid[] = { 0x10, 'a', 1, 0, 0x00 };
+        UDXR_CHECK(LZCodec::Decompress(valid, sizeof(valid), dst.data(), dst.size()) == 5);
+        UDXR_CHECK(memcmp(dst.data(), "aaaaa", 5) == 0);
+        // literal extra length that doesn't end
+        const uint8_t openLength[] = { 0xf0, 255, 255 };
+        UDXR_CHECK(LZCodec::Decompress(openLength, sizeof(openLength), dst.data(), dst.size()) == Failed);
+        // match longer than the output
+        const uint8_t longMatch[] = { 0x1f, 'a', 1, 0, 255, 0, 0x00 };
+        UDXR_CHECK(LZCodec::Decompress(longMatch, sizeof(longMatch), dst.data(), dst.size()) == Failed);
+
+        // random damage never writes past dstCapacity or reads past the input
+        auto src = Text(4096);
+        auto packed = Compress(src);
+        mt19937 rng(3);
+        for (int i = 0; i < 2000; i++) {
+            auto damaged = packed;
+            for (int j = 0; j < 1 + i % 4; j++)
+                damaged[rng() % damaged.size()] = static_cast<uint8_t>(rng());
+            vector<uint8_t> out(src.size());
+            size_t rst = LZCodec::Decompress(damaged.data(), damaged.size(), out.data(), out.size());
+            UDXR_CHECK(rst == Failed || rst <= out.size());
+        }
+    }
+}
+
+int main() {
+    TestRoundTrip();
+    TestCapacity();
+    TestTruncated();
+    TestCorrupted();
+    cout << "LZCodec: ok" << endl;
+    return 0;
+}
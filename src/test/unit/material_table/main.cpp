@@ -0,0 +1,144 @@
+#include "../Check.h"
+
+#include <UDXRenderer/MaterialTable.h>
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+using namespace Ubpa;
+using namespace std;
+
+namespace {
+    using ParamType = MaterialTable::ParamType;
+
+    struct Float3 {
+        float x, y, z;
+    };
+
+    // as the defer demo's material constants
+    MaterialTable::Layout Layout() {
+        MaterialTable::Layout layout;
+        layout.Add("DiffuseAlbedo", ParamType::Float4)
+            .Add("FresnelR0", ParamType::Float3)
+            .Add("Roughness", ParamType::Float)
+            .Add("DiffuseMapIndex", ParamType::Uint);
+        return layout;
+    }
+
+    float GetFloat(const MaterialTable& table, MaterialTable::MaterialID id, MaterialTable::ParamID param) {
+        float value;
+        memcpy(&value, table.Get(id, param), sizeof(float));
+        return value;
+    }
+
+    void TestLayout() {
+        auto layout = Layout();
+        UDXR_CHECK(layout.stride == 36);
+        UDXR_CHECK(layout.params[1].offset == 16 && layout.params[2].offset == 28 && layout.params[3].offset == 32);
+        UDXR_CHECK(layout.Find("Roughness") == 2 && layout.Find("gRoughness") == MaterialTable::InvalidParam);
+
+        // reflected offsets keep their gaps, the stride covers the last one
+        MaterialTable::Layout reflected;
+        reflected.Add("MatTransform", ParamType::Float4x4, 16).Add("Roughness", ParamType::Float, 4);
+        UDXR_CHECK(reflected.stride == 80);
+        reflected.Add("Index", ParamType::Uint);
+        UDXR_CHECK(reflected.params[2].offset == 80 && reflected.stride == 84);
+    }
+
+    void TestCreateDestroy() {
+        MaterialTable table(Layout(), 3, 2);
+        auto roughness = table.FindParam("Roughness");
+        table.SetDefault(roughness, 0.5f);
+
+        auto a = table.Create("a");
+        auto b = table.Create("b");
+        auto c = table.Create("c");
+        UDXR_CHECK(a == 0 && b == 1 && c == 2);
+        UDXR_CHECK(table.Create("d") == MaterialTable::InvalidID);
+        UDXR_CHECK(table.Find("b") == b && table.GetName(b) == "b" && table.GetStats().materialNum == 3);
+        UDXR_CHECK(GetFloat(table, b, roughness) == 0.5f);
+
+        table.Set(b, roughness, 0.2f);
+        UDXR_CHECK(GetFloat(table, b, roughness) == 0.2f);
+
+        // the freed ID is reused and starts as the defaults again
+        table.Destroy(b);
+        UDXR_CHECK(!table.IsAlive(b) && table.Find("b") == MaterialTable::InvalidID);
+        UDXR_CHECK(table.GetStats().materialNum == 2 && table.GetIDBound() == 3);
+        table.SetDefault(roughness, 0.7f);
+        auto d = table.Create("d");
+        UDXR_CHECK(d == b && table.IsAlive(d) && table.Find("d") == d);
+        UDXR_CHECK(GetFloat(table, d, roughness) == 0.7f);
+        // the others kept the old defaults
+        UDXR_CHECK(GetFloat(table, a, roughness) == 0.5f);
+
+        // the most recently freed first
+        table.Destroy(a);
+        table.Destroy(c);
+        UDXR_CHECK(table.Create("e") == c && table.Create("f") == a);
+    }
+
+    void TestUpload() {
+        constexpr uint32_t capacity = 130; // three bitset words
+        MaterialTable table(Layout(), capacity, 2);
+        const uint32_t stride = table.GetLayout().stride;
+        auto roughness = table.FindParam("Roughness");
+        auto fresnel = table.FindParam("FresnelR0");
+        vector<vector<uint8_t>> buffers(2, vector<uint8_t>(size_t{ capacity } * stride, 0xcd));
+
+        for (uint32_t i = 0; i < capacity; i++)
+            table.Create("m" + to_string(i));
+        UDXR_CHECK(table.IsDirty(0, 0) && table.IsDirty(1, capacity - 1));
+
+        // everything once per frame
+        UDXR_CHECK(table.Upload(0, buffers[0].data()) == size_t{ capacity } * stride);
+        UDXR_CHECK(!table.IsDirty(0, 0) && table.IsDirty(1, 0));
+        UDXR_CHECK(table.Upload(0, buffers[0].data()) == 0);
+        UDXR_CHECK(table.Upload(1, buffers[1].data()) == size_t{ capacity } * stride);
+        UDXR_CHECK(buffers[0] == buffers[1]);
+        UDXR_CHECK(memcmp(buffers[0].data(), table.GetData(), buffers[0].size()) == 0);
+
+        // the span from the first to the last dirty material, across words
+        table.Set(5, roughness, 1.f);
+        table.Set(129, fresnel, Float3{ 1.f, 2.f, 3.f });
+        table.Set(70, roughness, 2.f);
+        UDXR_CHECK(table.IsDirty(0, 5) && table.IsDirty(0, 70) && table.IsDirty(0, 129) && !table.IsDirty(0, 6));
+        UDXR_CHECK(table.IsDirty(1, 5) && table.IsDirty(1, 129));
+
+        // the span lands where the shader reads it, nothing outside it is written
+        vector<uint8_t> marked(buffers[0].size(), 0xee);
+        UDXR_CHECK(table.Upload(0, marked.data()) == size_t{ 129 - 5 + 1 } * stride);
+        UDXR_CHECK(marked[size_t{ 5 } * stride - 1] == 0xee);
+        UDXR_CHECK(memcmp(marked.data() + size_t{ 5 } * stride, static_cast<const uint8_t*>(table.GetData()) + size_t{ 5 } * stride,
+            size_t{ 125 } * stride) == 0);
+        UDXR_CHECK(!table.IsDirty(0, 5) && !table.IsDirty(0, 129));
+
+        // frame 1 still has the same span dirty, a single material after that
+        UDXR_CHECK(table.Upload(1, buffers[1].data()) == size_t{ 125 } * stride);
+        table.Set(64, roughness, 3.f);
+        UDXR_CHECK(table.Upload(1, buffers[1].data()) == stride);
+        UDXR_CHECK(GetFloat(table, 64, roughness) == 3.f);
+        float uploaded;
+        memcpy(&uploaded, buffers[1].data() + size_t{ 64 } * stride + table.GetLayout().params[roughness].offset, sizeof(float));
+        UDXR_CHECK(uploaded == 3.f);
+
+        // MarkDirty marks every frame
+        table.Upload(0, buffers[0].data());
+        table.MarkDirty(100);
+        UDXR_CHECK(table.IsDirty(0, 100) && table.IsDirty(1, 100));
+
+        auto stats = table.GetStats();
+        UDXR_CHECK(stats.materialNum == capacity && stats.uploadNum == 6);
+        UDXR_CHECK(stats.uploadedBytes == (size_t{ capacity } * 2 + 125 * 2 + 1 + 1) * stride);
+    }
+}
+
+int main() {
+    TestLayout();
+    TestCreateDestroy();
+    TestUpload();
+    cout << "MaterialTable: ok" << endl;
+    return 0;
+}
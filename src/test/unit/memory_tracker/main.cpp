@@ -0,0 +1,187 @@
+#include "../Check.h"
+
+#include <UDXRenderer/MemoryTracker.h>
+
+#include <cstdint>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+using namespace Ubpa;
+using namespace std;
+
+namespace {
+    using Category = MemoryTracker::Category;
+
+    const MemoryTracker::Usage& Usage(const MemoryTracker::Stats& stats, Category category) {
+        return stats.categories[static_cast<size_t>(category)];
+    }
+
+    void TestTrack() {
+        MemoryTracker tracker;
+        int a, b, c;
+
+        tracker.Track(&a, Category::Texture, "iron", 100, 256);
+        tracker.Track(&b, Category::Texture, "iron", 50);
+        tracker.Track(&c, Category::Mesh, "cube", 30);
+        UDXR_CHECK(tracker.IsTracked(&a) && tracker.IsTracked(&b) && tracker.IsTracked(&c));
+        auto stats = tracker.GetStats();
+        UDXR_CHECK(Usage(stats, Category::Texture).liveBytes == 150 && Usage(stats, Category::Texture).liveNum == 2);
+        UDXR_CHECK(Usage(stats, Category::Mesh).liveBytes == 30 && Usage(stats, Category::Mesh).liveNum == 1);
+        UDXR_CHECK(stats.total.liveBytes == 180 && stats.total.liveNum == 3 && stats.total.trackNum == 3);
+
+        // a tracked key is updated, also across categories
+        tracker.Track(&b, Category::Upload, "staging", 20);
+        stats = tracker.GetStats();
+        UDXR_CHECK(Usage(stats, Category::Texture).liveBytes == 100 && Usage(stats, Category::Texture).liveNum == 1);
+        UDXR_CHECK(Usage(stats, Category::Upload).liveBytes == 20 && Usage(stats, Category::Upload).liveNum == 1);
+        UDXR_CHECK(stats.total.liveBytes == 150 && stats.total.liveNum == 3 && stats.total.trackNum == 4);
+
+        // peaks stay
+        tracker.Untrack(&a);
+        UDXR_CHECK(!tracker.IsTracked(&a));
+        stats = tracker.GetStats();
+        UDXR_CHECK(Usage(stats, Category::Texture).liveBytes == 0 && Usage(stats, Category::Texture).peakBytes == 150);
+        UDXR_CHECK(stats.total.liveBytes == 50 && stats.total.peakBytes == 180 && stats.total.liveNum == 2);
+
+        // unknown keys are ignored
+        tracker.Untrack(&a);
+        tracker.Rekey(&a, &b);
+        UDXR_CHECK(tracker.GetStats().total.liveBytes == 50 && tracker.IsTracked(&b));
+
+        // the allocation moves with its bytes
+        tracker.Rekey(&c, &a);
+        UDXR_CHECK(tracker.IsTracked(&a) && !tracker.IsTracked(&c));
+        stats = tracker.GetStats();
+        UDXR_CHECK(Usage(stats, Category::Mesh).liveBytes == 30 && stats.total.liveNum == 2);
+        tracker.Untrack(&a);
+        tracker.Untrack(&b);
+        stats = tracker.GetStats();
+        UDXR_CHECK(stats.total.liveBytes == 0 && stats.total.liveNum == 0 && stats.total.trackNum == 4);
+    }
+
+    void TestBudget() {
+        MemoryTracker tracker;
+        vector<MemoryTracker::BudgetEvent> events;
+        tracker.SetBudget(Category::Texture, 100);
+        tracker.SetTotalBudget(150);
+        // the lock is released, the callback may query the tracker
+        tracker.SetBudgetCallback([&](const MemoryTracker::BudgetEvent& e) {
+            UDXR_CHECK(tracker.GetStats().total.liveBytes == e.liveBytes || e.category != Category::Num);
+            events.push_back(e);
+        });
+        int a, b, c;
+
+        // at the budget isn't over it
+        tracker.Track(&a, Category::Texture, "a", 100);
+        UDXR_CHECK(events.empty());
+        tracker.Track(&b, Category::Texture, "b", 10);
+        UDXR_CHECK(events.size() == 1);
+        UDXR_CHECK(events[0].category == Category::Texture && events[0].exceeded);
+        UDXR_CHECK(events[0].liveBytes == 110 && events[0].budget == 100);
+
+        // only crossings fire
+        tracker.Track(&b, Category::Texture, "b", 20);
+        UDXR_CHECK(events.size() == 1);
+
+        // the total budget, other categories don't touch the texture budget
+        tracker.Track(&c, Category::Mesh, "c", 40);
+        UDXR_CHECK(events.size() == 2);
+        UDXR_CHECK(events[1].category == Category::Num && events[1].exceeded && events[1].liveBytes == 160);
+
+        // both back under with one untrack
+        tracker.Untrack(&a);
+        UDXR_CHECK(events.size() == 4);
+        UDXR_CHECK(events[2].category == Category::Texture && !events[2].exceeded && events[2].liveBytes == 20);
+        UDXR_CHECK(events[3].category == Category::Num && !events[3].exceeded && events[3].liveBytes == 60);
+
+        // no budget, no events
+        tracker.SetBudget(Category::Texture, 0);
+        tracker.SetTotalBudget(0);
+        tracker.Track(&a, Category::Texture, "a", 1000);
+        UDXR_CHECK(events.size() == 4);
+        UDXR_CHECK(tracker.GetStats().categories[static_cast<size_t>(Category::Texture)].budget == 0);
+    }
+
+    void TestReport() {
+        MemoryTracker tracker;
+        int keys[5];
+        tracker.Track(&keys[0], Category::Mesh, "cube", 10);
+        tracker.Track(&keys[1], Category::Texture, "iron", 30);
+        tracker.Track(&keys[2], Category::Texture, "iron", 40);
+        tracker.Track(&keys[3], Category::Mesh, "iron", 50);
+        tracker.Track(&keys[4], Category::Upload, "staging", 20, 65536);
+
+        // summed by (category, name), largest first
+        auto usages = tracker.GetNameUsages();
+        UDXR_CHECK(usages.size() == 4);
+        UDXR_CHECK(usages[0].name == "iron" && usages[0].category == Category::Texture);
+        UDXR_CHECK(usages[0].liveBytes == 70 && usages[0].liveNum == 2);
+        UDXR_CHECK(usages[1].name == "iron" && usages[1].category == Category::Mesh && usages[1].liveBytes == 50);
+        UDXR_CHECK(usages[2].name == "staging" && usages[3].name == "cube");
+
+        ostringstream os;
+        tracker.Dump(os);
+        string dump = os.str();
+        for (size_t i = 0; i <= MemoryTracker::CategoryNum; i++)
+            UDXR_CHECK(dump.find(string(MemoryTracker::ToString(static_cast<Category>(i))) + ": live") != string::npos);
+        // by category, then by size
+        auto texture40 = dump.find("[texture] iron: 40 bytes");
+        auto texture30 = dump.find("[texture] iron: 30 bytes");
+        auto mesh50 = dump.find("[mesh] iron: 50 bytes");
+        auto upload = dump.find("[upload] staging: 20 bytes, alignment 65536");
+        UDXR_CHECK(texture40 != string::npos && texture30 != string::npos && mesh50 != string::npos && upload != string::npos);
+        UDXR_CHECK(texture40 < texture30 && texture30 < mesh50 && mesh50 < upload);
+
+        // nothing left, nothing listed
+        for (const auto& key : keys)
+            tracker.Untrack(&key);
+        UDXR_CHECK(tracker.GetNameUsages().empty());
+        os.str({});
+        tracker.Dump(os);
+        UDXR_CHECK(os.str().find("  [") == string::npos);
+    }
+
+    void TestThreads() {
+        constexpr size_t threadNum = 4;
+        constexpr size_t keyNum = 1000;
+        MemoryTracker tracker;
+        tracker.SetTotalBudget(threadNum * keyNum);
+        size_t eventNum = 0; // fired on the recording threads
+        mutex eventMutex;
+        tracker.SetBudgetCallback([&](const MemoryTracker::BudgetEvent&) {
+            lock_guard<mutex> lock(eventMutex);
+            eventNum++;
+        });
+
+        vector<char> keys(threadNum * keyNum);
+        vector<thread> threads;
+        for (size_t t = 0; t < threadNum; t++) {
+            threads.emplace_back([&, t]() {
+                for (size_t i = 0; i < keyNum; i++)
+                    tracker.Track(&keys[t * keyNum + i], Category::Other, "thread", 2);
+                for (size_t i = 0; i < keyNum; i += 2)
+                    tracker.Untrack(&keys[t * keyNum + i]);
+            });
+        }
+        for (auto& thread : threads)
+            thread.join();
+
+        auto stats = tracker.GetStats();
+        UDXR_CHECK(stats.total.liveNum == threadNum * keyNum / 2 && stats.total.liveBytes == threadNum * keyNum);
+        UDXR_CHECK(stats.total.trackNum == threadNum * keyNum);
+        UDXR_CHECK(stats.total.peakBytes > threadNum * keyNum && stats.total.peakBytes <= 2 * threadNum * keyNum);
+        // ends at the budget: every time over was followed by back under
+        UDXR_CHECK(eventNum >= 2 && eventNum % 2 == 0);
+    }
+}
+
+int main() {
+    TestTrack();
+    TestBudget();
+    TestReport();
+    TestThreads();
+    cout << "MemoryTracker: ok" << endl;
+    return 0;
+}
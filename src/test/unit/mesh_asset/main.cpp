@@ -0,0 +1,254 @@
+#include "../Check.h"
+
+#include <UDXRenderer/MappedFile.h>
+#include <UDXRenderer/MeshAsset.h>
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <vector>
+
+using namespace Ubpa;
+using namespace std;
+
+namespace {
+    constexpr uint32_t Stride = 12; // float3 positions, no compression
+
+    // a (n + 1) x (n + 1) grid, cooked as the demos do: meshlets and a two-LOD chain
+    struct Source {
+        string name;
+        vector<float> positions;
+        vector<uint32_t> indices;
+        vector<MeshSimplifier::Lod> lods;
+        Meshlets::MeshletMesh meshlets;
+
+        Source(string name, uint32_t n, float z) : name{ move(name) } {
+            for (uint32_t y = 0; y <= n; y++) {
+                for (uint32_t x = 0; x <= n; x++)
+                    positions.insert(positions.end(), { float(x), float(y), z });
+            }
+            for (uint32_t y = 0; y < n; y++) {
+                for (uint32_t x = 0; x < n; x++) {
+                    uint32_t v00 = y * (n + 1) + x;
+                    indices.insert(indices.end(), { v00, v00 + 1, v00 + n + 1, v00 + 1, v00 + n + 2, v00 + n + 1 });
+                }
+            }
+            meshlets = Meshlets::Build(indices.data(), indices.size(), positions.data(), GetVertexNum(), Stride);
+            Meshlets::UnpackIndices(meshlets, indices.data());
+            // LOD 1: the two corner triangles
+            uint32_t lod0Num = static_cast<uint32_t>(indices.size());
+            uint32_t c = n * (n + 1);
+            indices.insert(indices.end(), { 0, n, c, n, c + n, c });
+            lods = { { 0, lod0Num, 0.f }, { lod0Num, 6, 0.5f } };
+        }
+
+        size_t GetVertexNum() const { return positions.size() / 3; }
+
+        MeshAsset::SubmeshSource ToSubmesh() const {
+            MeshAsset::SubmeshSource submesh;
+            submesh.name = name;
+            submesh.vertices = positions.data();
+            submesh.vertexNum = GetVertexNum();
+            submesh.indices = indices.data();
+            submesh.indexNum = indices.size();
+            submesh.lods = lods.data();
+            submesh.lodNum = lods.size();
+            submesh.meshlets = &meshlets;
+            submesh.quantization.min[2] = positions[2];
+            submesh.center[0] = submesh.center[1] = 2.f;
+            submesh.radius = 3.f;
+            submesh.uvDensity = 0.25f;
+            return submesh;
+        }
+    };
+
+    MeshAsset::Config MakeConfig() {
+        MeshAsset::Config config;
+        config.vertexStride = Stride;
+        config.vertexDesc.position = VertexCompression::PositionFormat::Float3;
+        config.vertexDesc.normal = VertexCompression::DirectionFormat::None;
+        config.vertexDesc.uv = VertexCompression::UVFormat::None;
+        config.contentKey = 0x0123456789abcdefull;
+        return config;
+    }
+
+    void CheckSubmesh(const MeshAsset::View& view, const Source& source) {
+        size_t i = view.FindSubmesh(source.name);
+        UDXR_CHECK(i < view.GetSubmeshNum());
+        const auto& submesh = view.GetSubmesh(i);
+        UDXR_CHECK(view.GetName(submesh) == source.name);
+        UDXR_CHECK(submesh.vertexNum == source.GetVertexNum());
+        UDXR_CHECK(submesh.indexNum == source.indices.size());
+        UDXR_CHECK(memcmp(view.GetVertices(submesh), source.positions.data(), source.positions.size() * sizeof(float)) == 0);
+
+        const uint32_t indexSize = view.GetHeader().indexSize;
+        auto indices = static_cast<const uint8_t*>(view.GetIndices(submesh));
+        for (size_t k = 0; k < source.indices.size(); k++) {
+            uint32_t index = 0;
+            memcpy(&index, indices + k * indexSize, indexSize); // little-endian
+            UDXR_CHECK(index == source.indices[k]);
+        }
+
+        UDXR_CHECK(submesh.lodNum == source.lods.size());
+        for (size_t k = 0; k < source.lods.size(); k++) {
+            const auto& lod = view.GetLods(submesh)[k];
+            UDXR_CHECK(lod.indexOffset == source.lods[k].indexOffset);
+            UDXR_CHECK(lod.indexNum == source.lods[k].indexNum);
+            UDXR_CHECK(lod.error == source.lods[k].error);
+        }
+
+        auto meshlets = view.GetMeshlets(submesh);
+        UDXR_CHECK(meshlets.vertices == source.meshlets.vertices);
+        UDXR_CHECK(meshlets.primitives == source.meshlets.primitives);
+        UDXR_CHECK(meshlets.meshlets.size() == source.meshlets.meshlets.size());
+        UDXR_CHECK(memcmp(meshlets.meshlets.data(), source.meshlets.meshlets.data(),
+            meshlets.meshlets.size() * sizeof(Meshlets::Meshlet)) == 0);
+        UDXR_CHECK(memcmp(meshlets.bounds.data(), source.meshlets.bounds.data(),
+            meshlets.bounds.size() * sizeof(Meshlets::Bounds)) == 0);
+
+        UDXR_CHECK(view.GetQuantization(submesh).min[2] == source.positions[2]);
+        UDXR_CHECK(submesh.radius == 3.f);
+        UDXR_CHECK(submesh.uvDensity == 0.25f);
+    }
+
+    void TestRoundTrip() {
+        Source a("a", 8, 0.f);
+        Source b("bb", 5, 1.f);
+        auto file = MeshAsset::Serialize({ a.ToSubmesh(), b.ToSubmesh() }, MakeConfig());
+
+        MeshAsset::View view;
+        UDXR_CHECK(view.Init(file.data(), file.size()) == MeshAsset::Error::None);
+        UDXR_CHECK(view.IsValid());
+        const auto& header = view.GetHeader();
+        UDXR_CHECK(header.magic == MeshAsset::Magic);
+        UDXR_CHECK(header.version == MeshAsset::Version);
+        UDXR_CHECK(header.fileSize == file.size());
+        UDXR_CHECK(header.contentKey == MakeConfig().contentKey);
+        UDXR_CHECK(header.vertexStride == Stride);
+        UDXR_CHECK(header.indexSize == 2);
+        UDXR_CHECK(view.GetVertexDesc().position == VertexCompression::PositionFormat::Float3);
+        UDXR_CHECK(view.GetVertexDesc().normal == VertexCompression::DirectionFormat::None);
+        for (const auto& section : header.sections)
+            UDXR_CHECK(section.offset % MeshAsset::SectionAlignment == 0);
+
+        UDXR_CHECK(view.GetSubmeshNum() == 2);
+        UDXR_CHECK(view.FindSubmesh("c") == 2);
+        CheckSubmesh(view, a);
+        CheckSubmesh(view, b);
+        // the submeshes follow each other in the shared sections
+        UDXR_CHECK(view.GetSubmesh(1).baseVertex == a.GetVertexNum());
+        UDXR_CHECK(view.GetSubmesh(1).indexOffset == a.indices.size());
+    }
+
+    void TestIndices32() {
+        // 257 x 257 vertices do not fit 16-bit indices
+        Source big("big", 256, 0.f);
+        auto file = MeshAsset::Serialize({ big.ToSubmesh() }, MakeConfig());
+        MeshAsset::View view;
+        UDXR_CHECK(view.Init(file.data(), file.size()) == MeshAsset::Error::None);
+        UDXR_CHECK(view.GetHeader().indexSize == 4);
+        CheckSubmesh(view, big);
+    }
+
+    void TestSaveLoad() {
+        Source a("a", 8, 0.f);
+        auto bytes = MeshAsset::Serialize({ a.ToSubmesh() }, MakeConfig());
+        auto path = filesystem::temp_directory_path() / "udxrenderer_mesh_asset_test.umesh";
+        UDXR_CHECK(MeshAsset::Save(path, bytes));
+
+        {
+            MappedFile file;
+            MeshAsset::View view;
+            UDXR_CHECK(MeshAsset::Load(path, file, view) == MeshAsset::Error::None);
+            UDXR_CHECK(file.GetSize() == bytes.size());
+            CheckSubmesh(view, a);
+        }
+        filesystem::remove(path);
+
+        MappedFile file;
+        MeshAsset::View view;
+        UDXR_CHECK(MeshAsset::Load(path, file, view) == MeshAsset::Error::CannotOpen);
+        UDXR_CHECK(!view.IsValid());
+    }
+
+    // every corruption is reported, and leaves the view invalid
+    void TestCorrupt() {
+        Source a("a", 8, 0.f);
+        const auto good = MeshAsset::Serialize({ a.ToSubmesh() }, MakeConfig());
+
+        auto check = [&](MeshAsset::Error expected, auto corrupt, size_t size = 0) {
+            // 8-byte aligned copy
+            vector<uint64_t> storage(good.size() / 8 + 2);
+            auto bytes = reinterpret_cast<uint8_t*>(storage.data());
+            memcpy(bytes, good.data(), good.size());
+            corrupt(*reinterpret_cast<MeshAsset::Header*>(bytes), bytes);
+
+            MeshAsset::View view;
+            UDXR_CHECK(view.Init(bytes, size ? size : good.size()) == expected);
+            UDXR_CHECK(!view.IsValid());
+        };
+        auto submesh = [](uint8_t* bytes) {
+            auto& header = *reinterpret_cast<MeshAsset::Header*>(bytes);
+            return reinterpret_cast<MeshAsset::Submesh*>(
+                bytes + header.sections[static_cast<size_t>(MeshAsset::Section::Submeshes)].offset);
+        };
+        using MeshAsset::Error;
+        using MeshAsset::Section;
+
+        check(Error::TooSmall, [](auto&, auto) {}, sizeof(MeshAsset::Header) - 1);
+        check(Error::TooSmall, [](auto&, auto) {}, good.size() - 1); // truncated
+        check(Error::BadMagic, [](auto& h, auto) { h.magic ^= 1; });
+        check(Error::BadVersion, [](auto& h, auto) { h.version++; });
+        check(Error::BadSection, [](auto& h, auto) { h.indexSize = 3; });
+        check(Error::BadSection, [](auto& h, auto) { h.vertexStride = 0; });
+        check(Error::BadSection, [](auto& h, auto) { h.sections[static_cast<size_t>(Section::Indices)].offset += 8; });
+        check(Error::BadSection, [](auto& h, auto) { h.sections[static_cast<size_t>(Section::Vertices)].size += 1; });
+        check(Error::BadSection, [](auto& h, auto) { h.sections[static_cast<size_t>(Section::Names)].size = h.fileSize; });
+        check(Error::BadSection, [](auto& h, auto) { h.submeshNum = 2; });
+        check(Error::BadSection, [](auto& h, auto) { h.sections[static_cast<size_t>(Section::MeshletBounds)].size = 0; });
+        check(Error::BadSubmesh, [&](auto&, auto bytes) { submesh(bytes)->vertexNum += 1; });
+        check(Error::BadSubmesh, [&](auto&, auto bytes) { submesh(bytes)->indexNum += 3; });
+        check(Error::BadSubmesh, [&](auto&, auto bytes) { submesh(bytes)->nameLength = 1000; });
+        check(Error::BadSubmesh, [&](auto&, auto bytes) { submesh(bytes)->lodNum = 3; });
+        check(Error::BadSubmesh, [&](auto&, auto bytes) { submesh(bytes)->meshletNum += 1; });
+        check(Error::BadSubmesh, [&](auto& h, auto bytes) {
+            // a LOD past the indices of its submesh
+            auto lods = reinterpret_cast<MeshSimplifier::Lod*>(bytes + h.sections[static_cast<size_t>(Section::Lods)].offset);
+            lods[1].indexOffset = submesh(bytes)->indexNum;
+        });
+        check(Error::BadSubmesh, [&](auto& h, auto bytes) {
+            auto meshlets = reinterpret_cast<Meshlets::Meshlet*>(bytes + h.sections[static_cast<size_t>(Section::Meshlets)].offset);
+            meshlets[0].primitiveNum = submesh(bytes)->meshletPrimitiveNum + 1;
+        });
+
+        // misaligned data
+        vector<uint64_t> storage(good.size() / 8 + 2);
+        auto bytes = reinterpret_cast<uint8_t*>(storage.data()) + 1;
+        memcpy(bytes, good.data(), good.size());
+        MeshAsset::View view;
+        UDXR_CHECK(view.Init(bytes, good.size()) == Error::Misaligned);
+
+        // the errors have names
+        UDXR_CHECK(strcmp(MeshAsset::ToString(Error::BadSubmesh), "bad submesh") == 0);
+    }
+
+    void TestHashContent() {
+        const char data[] = "shapes";
+        uint64_t key = MeshAsset::HashContent(data, 6);
+        UDXR_CHECK(key == MeshAsset::HashContent(data, 6));
+        UDXR_CHECK(key != MeshAsset::HashContent(data, 5));
+        UDXR_CHECK(MeshAsset::HashContent(data + 3, 3, MeshAsset::HashContent(data, 3)) == key); // chained
+        UDXR_CHECK(MeshAsset::HashContent(nullptr, 0) == 14695981039346656037ull);
+    }
+}
+
+int main() {
+    TestRoundTrip();
+    TestIndices32();
+    TestSaveLoad();
+    TestCorrupt();
+    TestHashContent();
+    cout << "MeshAsset: ok" << endl;
+    return 0;
+}
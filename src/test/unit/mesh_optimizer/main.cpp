@@ -0,0 +1,144 @@
+#include "../Check.h"
+
+#include <UDXRenderer/MeshOptimizer.h>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace Ubpa;
+using namespace std;
+
+namespace {
+    struct Vertex {
+        float position[3];
+        float uv[2];
+    };
+
+    // n x n quads in the xy plane, triangles shuffled as an exporter without optimization would leave them
+    void CreateShuffledGrid(uint32_t n, vector<Vertex>& vertices, vector<uint32_t>& indices) {
+        vertices.clear();
+        indices.clear();
+        for (uint32_t y = 0; y <= n; y++) {
+            for (uint32_t x = 0; x <= n; x++) {
+                float u = float(x) / n;
+                float v = float(y) / n;
+                vertices.push_back({ { u, v, 0.f }, { u, v } });
+            }
+        }
+        vector<array<uint32_t, 3>> triangles;
+        for (uint32_t y = 0; y < n; y++) {
+            for (uint32_t x = 0; x < n; x++) {
+                uint32_t v00 = y * (n + 1) + x;
+                uint32_t v10 = v00 + 1;
+                uint32_t v01 = v00 + n + 1;
+                uint32_t v11 = v01 + 1;
+                triangles.push_back({ v00, v01, v10 });
+                triangles.push_back({ v10, v01, v11 });
+            }
+        }
+        shuffle(triangles.begin(), triangles.end(), mt19937(7));
+        for (const auto& t : triangles)
+            indices.insert(indices.end(), t.begin(), t.end());
+    }
+
+    // triangles as sorted position keys: a triangle may be rotated but must keep its winding
+    vector<array<float, 9>> TriangleSet(const vector<uint32_t>& indices, const vector<Vertex>& vertices) {
+        vector<array<float, 9>> set;
+        for (size_t i = 0; i < indices.size(); i += 3) {
+            // rotate the smallest vertex first, keeps the winding
+            array<uint32_t, 3> t{ indices[i], indices[i + 1], indices[i + 2] };
+            array<array<float, 3>, 3> p;
+            for (size_t k = 0; k < 3; k++)
+                p[k] = { vertices[t[k]].position[0], vertices[t[k]].position[1], vertices[t[k]].position[2] };
+            size_t first = min_element(p.begin(), p.end()) - p.begin();
+            array<float, 9> key;
+            for (size_t k = 0; k < 3; k++)
+                copy(p[(first + k) % 3].begin(), p[(first + k) % 3].end(), key.begin() + k * 3);
+            set.push_back(key);
+        }
+        sort(set.begin(), set.end());
+        return set;
+    }
+
+    void TestAnalyze() {
+        // a single triangle: 3 misses, every vertex once
+        uint32_t triangle[3] = { 0, 1, 2 };
+        auto stats = MeshOptimizer::AnalyzeVertexCache(triangle, 3, 3);
+        UDXR_CHECK(stats.transformNum == 3);
+        UDXR_CHECK(stats.acmr == 3.f);
+        UDXR_CHECK(stats.atvr == 1.f);
+
+        // two triangles sharing an edge: the second misses once
+        uint32_t quad[6] = { 0, 1, 2, 2, 1, 3 };
+        stats = MeshOptimizer::AnalyzeVertexCache(quad, 6, 4);
+        UDXR_CHECK(stats.transformNum == 4);
+        UDXR_CHECK(stats.acmr == 2.f);
+    }
+
+    // ACMR before / after on a generated mesh
+    void TestOptimize() {
+        vector<Vertex> vertices;
+        vector<uint32_t> indices;
+        CreateShuffledGrid(64, vertices, indices);
+        const auto trianglesBefore = TriangleSet(indices, vertices);
+
+        auto report = MeshOptimizer::Optimize(indices, vertices.data(), vertices.size(),
+            sizeof(Vertex), offsetof(Vertex, position));
+        cout << "grid 64x64: ACMR " << report.cacheBefore.acmr << " -> " << report.cacheAfter.acmr
+            << ", overfetch " << report.fetchBefore.overfetch << " -> " << report.fetchAfter.overfetch << endl;
+
+        // a shuffled grid misses nearly every vertex, an optimized one shares most of them
+        UDXR_CHECK(report.cacheBefore.acmr > 2.f);
+        UDXR_CHECK(report.cacheAfter.acmr < 0.8f);
+        UDXR_CHECK(report.fetchAfter.overfetch <= report.fetchBefore.overfetch);
+        UDXR_CHECK(report.vertexNumBefore == vertices.size());
+        UDXR_CHECK(report.vertexNumAfter == vertices.size()); // every vertex is referenced
+
+        // the reports match an independent analysis of the result
+        auto after = MeshOptimizer::AnalyzeVertexCache(indices.data(), indices.size(), report.vertexNumAfter);
+        UDXR_CHECK(after.transformNum == report.cacheAfter.transformNum);
+
+        // same triangles with the same winding, the vertices moved with their indices
+        UDXR_CHECK(TriangleSet(indices, vertices) == trianglesBefore);
+
+        // vertex fetch order: vertices are first used in ascending order
+        uint32_t next = 0;
+        for (auto index : indices) {
+            UDXR_CHECK(index <= next);
+            if (index == next)
+                next++;
+        }
+    }
+
+    void TestVertexFetchRemap() {
+        // vertex 1 is unreferenced
+        uint32_t indices[6] = { 3, 0, 2, 2, 0, 4 };
+        uint32_t remap[5];
+        size_t num = MeshOptimizer::OptimizeVertexFetchRemap(remap, indices, 6, 5);
+        UDXR_CHECK(num == 4);
+        UDXR_CHECK(remap[3] == 0 && remap[0] == 1 && remap[2] == 2 && remap[4] == 3);
+        UDXR_CHECK(remap[1] == static_cast<uint32_t>(-1));
+
+        MeshOptimizer::RemapIndexBuffer(indices, indices, 6, remap);
+        uint32_t expected[6] = { 0, 1, 2, 2, 1, 3 };
+        UDXR_CHECK(equal(begin(indices), end(indices), begin(expected)));
+
+        float vertices[5] = { 10.f, 11.f, 12.f, 13.f, 14.f };
+        float remapped[4];
+        MeshOptimizer::RemapVertexBuffer(remapped, vertices, 5, sizeof(float), remap);
+        UDXR_CHECK(remapped[0] == 13.f && remapped[1] == 10.f && remapped[2] == 12.f && remapped[3] == 14.f);
+    }
+}
+
+int main() {
+    TestAnalyze();
+    TestOptimize();
+    TestVertexFetchRemap();
+    cout << "MeshOptimizer: ok" << endl;
+    return 0;
+}
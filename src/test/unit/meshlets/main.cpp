@@ -0,0 +1,203 @@
+#include "../Check.h"
+
+#include <UDXRenderer/Meshlets.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+using namespace Ubpa;
+using namespace std;
+
+namespace {
+    struct Float3 {
+        float x, y, z;
+    };
+
+    Float3 Sub(const Float3& a, const Float3& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+    float Dot(const Float3& a, const Float3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+    Float3 Cross(const Float3& a, const Float3& b) {
+        return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+    }
+    float Length(const Float3& a) { return sqrtf(Dot(a, a)); }
+
+    // unit UV sphere, front faces point outwards
+    void CreateSphere(uint32_t slices, uint32_t stacks, vector<Float3>& positions, vector<uint32_t>& indices) {
+        const float pi = 3.14159265f;
+        for (uint32_t i = 0; i <= stacks; i++) {
+            float phi = pi * i / stacks;
+            for (uint32_t j = 0; j <= slices; j++) {
+                float theta = 2.f * pi * j / slices;
+                positions.push_back({ sinf(phi) * cosf(theta), cosf(phi), sinf(phi) * sinf(theta) });
+            }
+        }
+        auto add = [&](uint32_t a, uint32_t b, uint32_t c) {
+            Float3 n = Cross(Sub(positions[b], positions[a]), Sub(positions[c], positions[a]));
+            if (Length(n) < 1e-7f)
+                return; // degenerate at the poles
+            if (Dot(n, positions[a]) < 0.f)
+                swap(b, c);
+            indices.insert(indices.end(), { a, b, c });
+        };
+        for (uint32_t i = 0; i < stacks; i++) {
+            for (uint32_t j = 0; j < slices; j++) {
+                uint32_t v00 = i * (slices + 1) + j;
+                uint32_t v01 = v00 + 1;
+                uint32_t v10 = v00 + slices + 1;
+                uint32_t v11 = v10 + 1;
+                add(v00, v10, v01);
+                add(v01, v10, v11);
+            }
+        }
+    }
+
+    Float3 MeshVertex(const Meshlets::MeshletMesh& mesh, const vector<Float3>& positions,
+        const Meshlets::Meshlet& meshlet, uint32_t local)
+    {
+        return positions[mesh.vertices[meshlet.vertexOffset + local]];
+    }
+
+    void TestPack() {
+        uint32_t i0, i1, i2;
+        Meshlets::UnpackTriangle(Meshlets::PackTriangle(1023, 0, 517), i0, i1, i2);
+        UDXR_CHECK(i0 == 1023 && i1 == 0 && i2 == 517);
+    }
+
+    void TestBuild(const vector<Float3>& positions, const vector<uint32_t>& indices, const Meshlets::MeshletMesh& mesh) {
+        Meshlets::Config config;
+        UDXR_CHECK(mesh.bounds.size() == mesh.meshlets.size());
+        UDXR_CHECK(mesh.GetTriangleNum() * 3 == indices.size());
+
+        for (size_t m = 0; m < mesh.meshlets.size(); m++) {
+            const auto& meshlet = mesh.meshlets[m];
+            const auto& bounds = mesh.bounds[m];
+            UDXR_CHECK(meshlet.vertexNum <= config.maxVertices);
+            UDXR_CHECK(meshlet.primitiveNum <= config.maxTriangles);
+
+            // the sphere holds every vertex
+            Float3 center{ bounds.center[0], bounds.center[1], bounds.center[2] };
+            for (uint32_t i = 0; i < meshlet.vertexNum; i++)
+                UDXR_CHECK(Length(Sub(MeshVertex(mesh, positions, meshlet, i), center)) <= bounds.radius * 1.0001f + 1e-6f);
+
+            // the cone holds every normal: dot(n, axis) >= cos of the half angle
+            if (bounds.coneCutoff < 1.f) {
+                Float3 axis{ bounds.coneAxis[0], bounds.coneAxis[1], bounds.coneAxis[2] };
+                float cosHalfAngle = sqrtf(1.f - bounds.coneCutoff * bounds.coneCutoff);
+                for (uint32_t t = 0; t < meshlet.primitiveNum; t++) {
+                    uint32_t i0, i1, i2;
+                    Meshlets::UnpackTriangle(mesh.primitives[meshlet.primitiveOffset + t], i0, i1, i2);
+                    UDXR_CHECK(i0 < meshlet.vertexNum && i1 < meshlet.vertexNum && i2 < meshlet.vertexNum);
+                    Float3 a = MeshVertex(mesh, positions, meshlet, i0);
+                    Float3 n = Cross(Sub(MeshVertex(mesh, positions, meshlet, i1), a),
+                        Sub(MeshVertex(mesh, positions, meshlet, i2), a));
+                    UDXR_CHECK(Dot(n, axis) >= (cosHalfAngle - 1e-4f) * Length(n));
+                }
+            }
+        }
+
+        // the unpacked indices are the input triangles, each once, winding kept
+        vector<uint32_t> unpacked(indices.size());
+        Meshlets::UnpackIndices(mesh, unpacked.data());
+        auto canonical = [](const vector<uint32_t>& src) {
+            vector<vector<uint32_t>> triangles;
+            for (size_t i = 0; i < src.size(); i += 3) {
+                vector<uint32_t> t{ src[i], src[i + 1], src[i + 2] };
+                rotate(t.begin(), min_element(t.begin(), t.end()), t.end());
+                triangles.push_back(t);
+            }
+            sort(triangles.begin(), triangles.end());
+            return triangles;
+        };
+        UDXR_CHECK(canonical(unpacked) == canonical(indices));
+    }
+
+    void TestDeterministic(const vector<Float3>& positions, const vector<uint32_t>& indices) {
+        // small chunks so that several threads build them, the result does not depend on the thread number
+        Meshlets::Config one;
+        one.chunkTriangleNum = 256;
+        one.threadNum = 1;
+        Meshlets::Config many = one;
+        many.threadNum = 4;
+        auto a = Meshlets::Build(indices.data(), indices.size(), positions.data(), positions.size(), sizeof(Float3), one);
+        auto b = Meshlets::Build(indices.data(), indices.size(), positions.data(), positions.size(), sizeof(Float3), many);
+        UDXR_CHECK(a.vertices == b.vertices);
+        UDXR_CHECK(a.primitives == b.primitives);
+        UDXR_CHECK(a.meshlets.size() == b.meshlets.size());
+    }
+
+    void TestFrustumPlanes() {
+        // identity: clip space is the space of the mesh
+        float identity[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+        float planes[6][4];
+        Meshlets::ExtractFrustumPlanes(identity, planes);
+        UDXR_CHECK(planes[0][0] == 1.f && planes[0][3] == 1.f);  // x >= -1
+        UDXR_CHECK(planes[1][0] == -1.f && planes[1][3] == 1.f); // x <= 1
+        UDXR_CHECK(planes[4][2] == 1.f && planes[4][3] == 0.f);  // z >= 0
+        UDXR_CHECK(planes[5][2] == -1.f && planes[5][3] == 1.f); // z <= 1
+    }
+
+    void TestCull(const vector<Float3>& positions, const Meshlets::MeshletMesh& mesh) {
+        // planes far away: nothing is frustum culled
+        float open[6][4] = {
+            { 1, 0, 0, 100 }, { -1, 0, 0, 100 }, { 0, 1, 0, 100 },
+            { 0, -1, 0, 100 }, { 0, 0, 1, 100 }, { 0, 0, -1, 100 } };
+        const float eye[3] = { 0.f, 0.f, -10.f };
+        vector<uint32_t> visible;
+        auto stats = Meshlets::Cull(mesh, open, eye, visible);
+        UDXR_CHECK(stats.meshletNum == mesh.meshlets.size());
+        UDXR_CHECK(stats.frustumCulledNum == 0);
+        cout << "sphere: " << stats.meshletNum << " meshlets, " << stats.backfaceCulledNum
+            << " backface culled from outside" << endl;
+        // the far hemisphere faces away
+        UDXR_CHECK(stats.backfaceCulledNum > 0);
+        UDXR_CHECK(stats.backfaceCulledNum + visible.size() == mesh.meshlets.size());
+        UDXR_CHECK(is_sorted(visible.begin(), visible.end()));
+
+        // conservative: a culled meshlet has no triangle facing the eye
+        size_t visibleTriangleNum = 0;
+        Float3 eyePos{ eye[0], eye[1], eye[2] };
+        for (uint32_t m = 0; m < mesh.meshlets.size(); m++) {
+            const auto& meshlet = mesh.meshlets[m];
+            bool isVisible = binary_search(visible.begin(), visible.end(), m);
+            if (isVisible) {
+                visibleTriangleNum += meshlet.primitiveNum;
+                continue;
+            }
+            for (uint32_t t = 0; t < meshlet.primitiveNum; t++) {
+                uint32_t i0, i1, i2;
+                Meshlets::UnpackTriangle(mesh.primitives[meshlet.primitiveOffset + t], i0, i1, i2);
+                Float3 a = MeshVertex(mesh, positions, meshlet, i0);
+                Float3 n = Cross(Sub(MeshVertex(mesh, positions, meshlet, i1), a),
+                    Sub(MeshVertex(mesh, positions, meshlet, i2), a));
+                UDXR_CHECK(Dot(Sub(a, eyePos), n) >= 0.f);
+            }
+        }
+        UDXR_CHECK(stats.visibleTriangleNum == visibleTriangleNum);
+
+        // the sphere is behind the left plane x >= 5
+        float shifted[6][4];
+        copy(&open[0][0], &open[0][0] + 24, &shifted[0][0]);
+        shifted[0][3] = -5.f;
+        stats = Meshlets::Cull(mesh, shifted, eye, visible);
+        UDXR_CHECK(stats.frustumCulledNum == mesh.meshlets.size());
+        UDXR_CHECK(visible.empty());
+        UDXR_CHECK(stats.visibleTriangleNum == 0);
+    }
+}
+
+int main() {
+    vector<Float3> positions;
+    vector<uint32_t> indices;
+    CreateSphere(64, 48, positions, indices);
+    auto mesh = Meshlets::Build(indices.data(), indices.size(), positions.data(), positions.size(), sizeof(Float3));
+
+    TestPack();
+    TestBuild(positions, indices, mesh);
+    TestDeterministic(positions, indices);
+    TestFrustumPlanes();
+    TestCull(positions, mesh);
+    cout << "Meshlets: ok" << endl;
+    return 0;
+}
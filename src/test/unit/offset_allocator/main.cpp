@@ -0,0 +1,159 @@
+#include "../Check.h"
+
+#include <UDXRenderer/OffsetAllocator.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace Ubpa;
+using namespace std;
+
+namespace {
+    void TestBins() {
+        // small sizes are exact
+        for (uint32_t size = 0; size < 8; size++) {
+            UDXR_CHECK(OffsetAllocator::SizeToBinRoundDown(size) == size);
+            UDXR_CHECK(OffsetAllocator::BinToSize(size) == size);
+        }
+        // a bin's size maps back to the bin, round down <= size <= round up
+        for (uint32_t size = 1; size < (1u << 20); size += 1 + size / 64) {
+            uint32_t down = OffsetAllocator::SizeToBinRoundDown(size);
+            uint32_t up = OffsetAllocator::SizeToBinRoundUp(size);
+            UDXR_CHECK(OffsetAllocator::BinToSize(down) <= size);
+            UDXR_CHECK(OffsetAllocator::BinToSize(up) >= size);
+            UDXR_CHECK(up == down || up == down + 1);
+            UDXR_CHECK(OffsetAllocator::SizeToBinRoundDown(OffsetAllocator::BinToSize(down)) == down);
+        }
+    }
+
+    void TestAllocateFree() {
+        OffsetAllocator allocator(1000);
+        auto a = allocator.Allocate(100);
+        auto b = allocator.Allocate(200);
+        auto c = allocator.Allocate(300);
+        UDXR_CHECK(!a.IsNull() && !b.IsNull() && !c.IsNull());
+        UDXR_CHECK(a.offset == 0 && b.offset == 100 && c.offset == 300);
+        UDXR_CHECK(allocator.GetSize(b) == 200);
+
+        auto stats = allocator.GetStats();
+        UDXR_CHECK(stats.size == 1000);
+        UDXR_CHECK(stats.freeNum == 400);
+        UDXR_CHECK(stats.allocationNum == 3);
+        UDXR_CHECK(stats.freeRangeNum == 1);
+        UDXR_CHECK(stats.largestFreeRange == 400);
+
+        // zero and oversized requests fail without side effects
+        UDXR_CHECK(allocator.Allocate(0).IsNull());
+        UDXR_CHECK(allocator.Allocate(401).IsNull());
+        UDXR_CHECK(allocator.GetStats().allocationNum == 3);
+
+        // a hole between used ranges is reused
+        allocator.Free(b);
+        UDXR_CHECK(allocator.GetStats().freeRangeNum == 2);
+        auto d = allocator.Allocate(150);
+        UDXR_CHECK(d.offset == 100);
+        allocator.Free(d);
+
+        // freeing everything merges back into one range
+        allocator.Free(a);
+        allocator.Free(c);
+        allocator.Free(OffsetAllocator::Allocation{}); // null is ignored
+        stats = allocator.GetStats();
+        UDXR_CHECK(stats.freeNum == 1000);
+        UDXR_CHECK(stats.allocationNum == 0);
+        UDXR_CHECK(stats.freeRangeNum == 1);
+        UDXR_CHECK(stats.largestFreeRange == 1000);
+        UDXR_CHECK(allocator.Allocate(1000).offset == 0);
+    }
+
+    void TestMerge() {
+        // free the middle last so that it merges with both neighbours
+        OffsetAllocator allocator(30);
+        auto a = allocator.Allocate(10);
+        auto b = allocator.Allocate(10);
+        auto c = allocator.Allocate(10);
+        UDXR_CHECK(allocator.Allocate(1).IsNull()); // full
+        allocator.Free(a);
+        allocator.Free(c);
+        UDXR_CHECK(allocator.GetStats().freeRangeNum == 2);
+        UDXR_CHECK(allocator.Allocate(20).IsNull()); // fragmented
+        allocator.Free(b);
+        UDXR_CHECK(allocator.GetStats().freeRangeNum == 1);
+        UDXR_CHECK(allocator.Allocate(30).offset == 0);
+    }
+
+    void TestExactFitOfOwnBin() {
+        // 9 rounds up to a bin with no range, the last resort finds the range of size 9
+        OffsetAllocator allocator(19);
+        auto a = allocator.Allocate(9);
+        auto b = allocator.Allocate(10);
+        allocator.Free(a);
+        auto c = allocator.Allocate(9);
+        UDXR_CHECK(!c.IsNull() && c.offset == 0);
+        allocator.Free(b);
+        allocator.Free(c);
+    }
+
+    // random allocations against a byte map: ranges never overlap, stats stay consistent
+    void TestRandom() {
+        constexpr uint32_t size = 1 << 16;
+        OffsetAllocator allocator(size);
+        vector<uint8_t> owner(size, 0);
+        vector<OffsetAllocator::Allocation> live;
+        mt19937 rng(42);
+        uint32_t used = 0;
+
+        for (int step = 0; step < 20000; step++) {
+            bool allocate = live.empty() || rng() % 3 != 0;
+            if (allocate) {
+                uint32_t num = 1 + rng() % (rng() % 8 == 0 ? 4096 : 64);
+                auto a = allocator.Allocate(num);
+                if (a.IsNull()) {
+                    // fails only if no free range fits
+                    UDXR_CHECK(allocator.GetStats().largestFreeRange < num);
+                    continue;
+                }
+                UDXR_CHECK(a.offset + num <= size);
+                UDXR_CHECK(allocator.GetSize(a) == num);
+                for (uint32_t i = a.offset; i < a.offset + num; i++) {
+                    UDXR_CHECK(owner[i] == 0);
+                    owner[i] = 1;
+                }
+                used += num;
+                live.push_back(a);
+            }
+            else {
+                size_t i = rng() % live.size();
+                auto a = live[i];
+                uint32_t num = allocator.GetSize(a);
+                fill(owner.begin() + a.offset, owner.begin() + a.offset + num, uint8_t(0));
+                used -= num;
+                allocator.Free(a);
+                live[i] = live.back();
+                live.pop_back();
+            }
+            auto stats = allocator.GetStats();
+            UDXR_CHECK(stats.freeNum == size - used);
+            UDXR_CHECK(stats.allocationNum == live.size());
+        }
+
+        for (const auto& a : live)
+            allocator.Free(a);
+        auto stats = allocator.GetStats();
+        UDXR_CHECK(stats.freeNum == size);
+        UDXR_CHECK(stats.freeRangeNum == 1);
+    }
+}
+
+int main() {
+    TestBins();
+    TestAllocateFree();
+    TestMerge();
+    TestExactFitOfOwnBin();
+    TestRandom();
+    cout << "OffsetAllocator: ok" << endl;
+    return 0;
+}
@@ -0,0 +1,293 @@
+#include "../Check.h"
+
+#include <UDXRenderer/PackArchive.h>
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace Ubpa;
+using namespace std;
+
+namespace {
+    constexpr uint32_t BlockSize = 1024;
+
+    struct File {
+        string path;
+        vector<uint8_t> data;
+        PackArchive::Codec codec;
+    };
+
+    vector<uint8_t> Text(size_t num, uint32_t seed) {
+        const string words[] = { "vertex ", "index ", "buffer ", "texture ", "mip ", "root ", "signature " };
+        mt19937 rng(seed);
+        vector<uint8_t> text;
+        while (text.size() < num) {
+            const auto& word = words[rng() % size(words)];
+            text.insert(text.end(), word.begin(), word.end());
+        }
+        text.resize(num);
+        return text;
+    }
+
+    vector<uint8_t> Noise(size_t num) {
+        mt19937 rng(7);
+        vector<uint8_t> noise(num);
+        for (auto& b : noise)
+            b = static_cast<uint8_t>(rng());
+        return noise;
+    }
+
+    vector<File> Files() {
+        return {
+            { "Shaders/Common.hlsl", Text(3000, 1), PackArchive::Codec::LZ },        // 3 blocks, the last one short
+            { "textures\\Bricks.dds", Text(4 * BlockSize, 2), PackArchive::Codec::LZ }, // whole blocks
+            { "textures/noise.dds", Noise(2500), PackArchive::Codec::LZ },          // doesn't shrink, stored raw
+            { "raw.bin", Text(500, 3), PackArchive::Codec::None },
+            { "empty.txt", {}, PackArchive::Codec::LZ },
+        };
+    }
+
+    filesystem::path TempPath(const char* name) {
+        return filesystem::temp_directory_path() / name;
+    }
+
+    void Write(const filesystem::path& path, const vector<File>& files) {
+        PackWriter writer;
+        UDXR_CHECK(writer.Open(path, BlockSize));
+        for (const auto& f : files)
+            UDXR_CHECK(writer.Add(f.path, f.data.data(), f.data.size(), f.codec));
+        // the same path after normalization
+        UDXR_CHECK(!writer.Add("./SHADERS/common.hlsl", "x", 1));
+        UDXR_CHECK(writer.Finish());
+    }
+
+    vector<uint8_t> Load(const filesystem::path& path) {
+        ifstream in(path, ios::binary);
+        return { istreambuf_iterator<char>(in), istreambuf_iterator<char>() };
+    }
+
+    void Store(const filesystem::path& path, const vector<uint8_t>& bytes) {
+        ofstream out(path, ios::binary | ios::trunc);
+        out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<streamsize>(bytes.size()));
+    }
+
+    void TestNormalizePath() {
+        UDXR_CHECK(PackArchive::NormalizePath("Textures\\Bricks.DDS") == "textures/bricks.dds");
+        UDXR_CHECK(PackArchive::NormalizePath("./a//b/../c/") == "a/c");
+        UDXR_CHECK(PackArchive::NormalizePath("../../a") == "a");
+        UDXR_CHECK(PackArchive::NormalizePath("") == "");
+        UDXR_CHECK(PackArchive::HashPath("a/c") == PackArchive::HashPath(PackArchive::NormalizePath("A\\b\\..\\C")));
+        UDXR_CHECK(PackArchive::HashPath("a") != PackArchive::HashPath("b"));
+    }
+
+    void TestToc() {
+        auto files = Files();
+        auto path = TempPath("udxrenderer_pack_archive_test.upak");
+        Write(path, files);
+
+        PackArchive archive;
+        UDXR_CHECK(archive.Open(path));
+        UDXR_CHECK(archive.GetEntryNum() == files.size());
+
+        // sorted by (hash, name), the order Find searches in
+        for (uint32_t i = 1; i < archive.GetEntryNum(); i++)
+            UDXR_CHECK(archive.GetEntry(i - 1).hash <= archive.GetEntry(i).hash);
+
+        for (const auto& f : files) {
+            uint32_t entry = archive.Find(f.path);
+            UDXR_CHECK(entry != PackArchive::InvalidEntry);
+            const auto& e = archive.GetEntry(entry);
+            UDXR_CHECK(archive.GetName(entry) == PackArchive::NormalizePath(f.path));
+            UDXR_CHECK(e.hash == PackArchive::HashPath(archive.GetName(entry)));
+            UDXR_CHECK(archive.GetSize(entry) == f.data.size());
+            UDXR_CHECK(e.dataOffset >= sizeof(PackArchive::Header));
+        }
+        UDXR_CHECK(archive.Find("TEXTURES/./bricks.dds") == archive.Find("textures/Bricks.dds"));
+        UDXR_CHECK(archive.Find("textures/missing.dds") == PackArchive::InvalidEntry);
+        UDXR_CHECK(archive.Find("") == PackArchive::InvalidEntry);
+
+        // codecs and block tables as written
+        const auto& common = archive.GetEntry(archive.Find("shaders/common.hlsl"));
+        UDXR_CHECK(common.codec == PackArchive::Codec::LZ && common.blockNum == 3);
+        UDXR_CHECK(common.storedSize < common.size);
+        UDXR_CHECK(archive.GetEntry(archive.Find("textures/bricks.dds")).blockNum == 4);
+        const auto& noise = archive.GetEntry(archive.Find("textures/noise.dds"));
+        UDXR_CHECK(noise.codec == PackArchive::Codec::None && noise.blockNum == 0 && noise.storedSize == noise.size);
+        UDXR_CHECK(archive.GetEntry(archive.Find("raw.bin")).codec == PackArchive::Codec::None);
+        UDXR_CHECK(archive.GetEntry(archive.Find("empty.txt")).blockNum == 0);
+
+        archive.Close();
+        UDXR_CHECK(!archive.IsOpen() && archive.GetEntryNum() == 0);
+        filesystem::remove(path);
+        UDXR_CHECK(!archive.Open(path));
+    }
+
+    void TestRead() {
+        auto files = Files();
+        auto path = TempPath("udxrenderer_pack_archive_test.upak");
+        Write(path, files);
+
+        PackArchive archive;
+        UDXR_CHECK(archive.Open(path));
+        for (const auto& f : files) {
+            vector<uint8_t> data;
+            UDXR_CHECK(archive.Read(archive.Find(f.path), data));
+            UDXR_CHECK(data == f.data);
+        }
+
+        // ranges inside a block, across blocks, to the short last block
+        uint32_t common = archive.Find("shaders/common.hlsl");
+        const auto& commonData = files[0].data;
+        for (auto [offset, size] : { pair<size_t, size_t>{ 10, 20 }, { 1000, 100 }, { 500, 2000 },
+            { 2048, 952 }, { 0, 3000 }, { 3000, 0 } })
+        {
+            vector<uint8_t> range(size + 1);
+            UDXR_CHECK(archive.ReadRange(common, offset, size, range.data()));
+            UDXR_CHECK(equal(range.begin(), range.begin() + size, commonData.begin() + offset));
+        }
+        vector<uint8_t> range(16);
+        UDXR_CHECK(!archive.ReadRange(common, 2990, 16, range.data()));
+        UDXR_CHECK(!archive.ReadRange(common, 3001, 0, range.data()));
+        UDXR_CHECK(!archive.ReadRange(PackArchive::InvalidEntry, 0, 1, range.data()));
+        uint32_t raw = archive.Find("raw.bin");
+        UDXR_CHECK(archive.ReadRange(raw, 100, 16, range.data()));
+        UDXR_CHECK(equal(range.begin(), range.end(), files[3].data.begin() + 100));
+
+        // a batch of neighbours is one read of the file
+        archive.Close();
+        UDXR_CHECK(archive.Open(path));
+        UDXR_CHECK(archive.GetStats().readNum == 2); // the header and the TOC
+        vector<vector<uint8_t>> dsts(files.size());
+        vector<PackArchive::ReadRequest> requests;
+        for (size_t i = 0; i < files.size(); i++) {
+            dsts[i].resize(files[i].data.size());
+            requests.push_back({ archive.Find(files[i].path), dsts[i].data() });
+        }
+        requests.push_back({ PackArchive::InvalidEntry, nullptr });
+        UDXR_CHECK(!archive.ReadBatch(requests.data(), requests.size())); // the invalid request fails alone
+        for (size_t i = 0; i < files.size(); i++)
+            UDXR_CHECK(requests[i].succeeded && dsts[i] == files[i].data);
+        UDXR_CHECK(!requests.back().succeeded);
+        auto stats = archive.GetStats();
+        UDXR_CHECK(stats.readNum == 3);
+        UDXR_CHECK(stats.decodedBytes == files[0].data.size() + files[1].data.size());
+
+        // a merged read stays within stagingSize, larger entries are read alone
+        PackArchive::Config config;
+        config.stagingSize = 1024;
+        PackArchive small(config);
+        UDXR_CHECK(small.Open(path));
+        requests.pop_back();
+        UDXR_CHECK(small.ReadBatch(requests.data(), requests.size()));
+        for (size_t i = 0; i < files.size(); i++)
+            UDXR_CHECK(dsts[i] == files[i].data);
+        UDXR_CHECK(small.GetStats().readNum - 2 > 1);
+
+        archive.Close();
+        small.Close();
+        filesystem::remove(path);
+    }
+
+    // copies the T at offset out of bytes, lets f change it and copies it back, the TOC isn't aligned
+    template<typename T, typename F>
+    vector<uint8_t> Patch(vector<uint8_t> bytes, uint64_t offset, F f) {
+        T value;
+        memcpy(&value, bytes.data() + offset, sizeof(T));
+        f(value);
+        memcpy(bytes.data() + offset, &value, sizeof(T));
+        return bytes;
+    }
+
+    void TestCorrupt() {
+        auto files = Files();
+        auto path = TempPath("udxrenderer_pack_archive_test.upak");
+        auto corruptPath = TempPath("udxrenderer_pack_archive_corrupt.upak");
+        Write(path, files);
+        const auto bytes = Load(path);
+
+        PackArchive archive;
+        UDXR_CHECK(archive.Open(path));
+        PackArchive::Header h;
+        memcpy(&h, bytes.data(), sizeof(h));
+        const uint32_t common = archive.Find("shaders/common.hlsl");
+        const auto commonEntry = archive.GetEntry(common);
+        const uint32_t raw = archive.Find("raw.bin");
+        archive.Close();
+
+        const uint64_t entryOffset = h.tocOffset + uint64_t{ common } * sizeof(PackArchive::Entry);
+        const uint64_t blockOffset = h.tocOffset + uint64_t{ h.entryNum } * sizeof(PackArchive::Entry)
+            + uint64_t{ commonEntry.blockOffset } * sizeof(PackArchive::Block);
+
+        auto opens = [&](const vector<uint8_t>& corrupt) {
+            Store(corruptPath, corrupt);
+            PackArchive archive;
+            bool rst = archive.Open(corruptPath);
+            UDXR_CHECK(rst == archive.IsOpen());
+            return rst;
+        };
+        auto header = [&](auto f) { return Patch<PackArchive::Header>(bytes, 0, f); };
+        auto entry = [&](auto f) { return Patch<PackArchive::Entry>(bytes, entryOffset, f); };
+        auto block = [&](uint32_t b, auto f) {
+            return Patch<PackArchive::Block>(bytes, blockOffset + b * sizeof(PackArchive::Block), f);
+        };
+
+        UDXR_CHECK(opens(bytes));
+
+        // header
+        UDXR_CHECK(!opens({ bytes.begin(), bytes.begin() + sizeof(PackArchive::Header) - 1 }));
+        UDXR_CHECK(!opens({ bytes.begin(), bytes.end() - 1 })); // truncated TOC
+        UDXR_CHECK(!opens(header([](auto& h) { h.magic++; })));
+        UDXR_CHECK(!opens(header([](auto& h) { h.version++; })));
+        UDXR_CHECK(!opens(header([](auto& h) { h.blockSize = 0; })));
+        UDXR_CHECK(!opens(header([](auto& h) { h.entryNum++; })));
+        UDXR_CHECK(!opens(header([](auto& h) { h.nameSize++; })));
+        UDXR_CHECK(!opens(header([&](auto& h) { h.tocOffset = bytes.size(); })));
+
+        // entries
+        UDXR_CHECK(!opens(Patch<PackArchive::Entry>(bytes, h.tocOffset, [](auto& e) { e.hash = ~0ull; }))); // out of order
+        UDXR_CHECK(!opens(entry([&](auto& e) { e.storedSize = h.tocOffset; })));
+        UDXR_CHECK(!opens(entry([&](auto& e) { e.dataOffset = 0; })));
+        UDXR_CHECK(!opens(entry([&](auto& e) { e.nameLength = h.nameSize + 1; })));
+        UDXR_CHECK(!opens(entry([](auto& e) { e.blockNum++; })));
+        UDXR_CHECK(!opens(entry([](auto& e) { e.codec = PackArchive::Codec::None; })));
+        UDXR_CHECK(!opens(entry([](auto& e) { e.codec = static_cast<PackArchive::Codec>(2); })));
+
+        // block tables
+        UDXR_CHECK(!opens(block(1, [](auto& b) { b.storedOffset++; }))); // gap between blocks
+        UDXR_CHECK(!opens(block(0, [](auto& b) { b.storedSize = BlockSize + 1; }))); // larger than the raw block
+
+        // damaged compressed data opens, but fails to read instead of returning garbage
+        PackArchive::Block first;
+        memcpy(&first, bytes.data() + blockOffset, sizeof(first));
+        UDXR_CHECK(first.storedSize < BlockSize);
+        auto corrupt = bytes;
+        // token without literals, then match offset 0
+        memset(corrupt.data() + commonEntry.dataOffset + first.storedOffset, 0, 3);
+        Store(corruptPath, corrupt);
+        UDXR_CHECK(archive.Open(corruptPath));
+        vector<uint8_t> data;
+        UDXR_CHECK(!archive.Read(common, data));
+        UDXR_CHECK(!archive.ReadRange(common, 0, 16, data.data()));
+        UDXR_CHECK(archive.ReadRange(common, BlockSize, 16, data.data())); // the other blocks are fine
+        UDXR_CHECK(archive.Read(raw, data) && data == files[3].data);
+        archive.Close();
+
+        filesystem::remove(path);
+        filesystem::remove(corruptPath);
+    }
+}
+
+int main() {
+    TestNormalizePath();
+    TestToc();
+    TestRead();
+    TestCorrupt();
+    cout << "PackArchive: ok" << endl;
+    return 0;
+}
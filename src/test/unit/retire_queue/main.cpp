@@ -0,0 +1,123 @@
+#include "../Check.h"
+
+#include <UDXRenderer/RetireQueue.h>
+
+#include <cstdint>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace Ubpa;
+using namespace std;
+
+namespace {
+    // stands in for an ID3D12Fence: the "GPU" completes frames when the test says so
+    struct SimulatedFence {
+        uint64_t signaled{ 0 };
+        uint64_t completed{ 0 };
+
+        uint64_t Signal() { return ++signaled; }
+        void CompleteUpTo(uint64_t value) { completed = value; }
+    };
+
+    void TestReleaseOrder() {
+        SimulatedFence fence;
+        RetireQueue queue;
+        vector<int> released;
+
+        // objects last used by frames 1, 1, 2 and 3
+        uint64_t f1 = fence.Signal();
+        queue.Retire(f1, [&]() { released.push_back(0); });
+        queue.Retire(f1, [&]() { released.push_back(1); });
+        uint64_t f2 = fence.Signal();
+        queue.Retire(f2, [&]() { released.push_back(2); });
+        uint64_t f3 = fence.Signal();
+        queue.Retire(f3, [&]() { released.push_back(3); });
+        UDXR_CHECK(queue.GetPendingNum() == 4);
+
+        // nothing completed: nothing released
+        UDXR_CHECK(queue.Collect(fence.completed) == 0);
+        UDXR_CHECK(released.empty());
+
+        fence.CompleteUpTo(f1);
+        UDXR_CHECK(queue.Collect(fence.completed) == 2);
+        UDXR_CHECK((released == vector<int>{ 0, 1 }));
+
+        // collecting again at the same fence is a no-op
+        UDXR_CHECK(queue.Collect(fence.completed) == 0);
+
+        // the GPU jumps ahead several frames at once
+        fence.CompleteUpTo(f3);
+        UDXR_CHECK(queue.Collect(fence.completed) == 2);
+        UDXR_CHECK((released == vector<int>{ 0, 1, 2, 3 }));
+        UDXR_CHECK(queue.GetPendingNum() == 0);
+        UDXR_CHECK(queue.GetReleasedNum() == 4);
+    }
+
+    void TestOutOfOrderWaits() {
+        RetireQueue queue;
+        vector<int> released;
+
+        // retired with a later fence first: the one behind it waits, never runs early
+        queue.Retire(5, [&]() { released.push_back(5); });
+        queue.Retire(3, [&]() { released.push_back(3); });
+
+        UDXR_CHECK(queue.Collect(4) == 0);
+        UDXR_CHECK(released.empty());
+        UDXR_CHECK(queue.Collect(5) == 2);
+        UDXR_CHECK((released == vector<int>{ 5, 3 }));
+    }
+
+    void TestFlush() {
+        RetireQueue queue;
+        vector<int> released;
+
+        queue.Retire(10, [&]() { released.push_back(10); });
+        // a release that retires more objects, e.g. a texture retiring its SRV page
+        queue.Retire(20, [&]() {
+            released.push_back(20);
+            queue.Retire(30, [&]() {
+                released.push_back(30);
+                queue.Retire(40, [&]() { released.push_back(40); });
+            });
+        });
+
+        UDXR_CHECK(queue.Flush() == 4);
+        UDXR_CHECK((released == vector<int>{ 10, 20, 30, 40 }));
+        UDXR_CHECK(queue.GetPendingNum() == 0);
+        UDXR_CHECK(queue.Flush() == 0);
+    }
+
+    void TestConcurrentRetire() {
+        SimulatedFence fence;
+        RetireQueue queue;
+        const int threadNum = 4;
+        const int perThread = 1000;
+
+        // loader threads retire at the fence of the frame being recorded
+        uint64_t frame = fence.Signal();
+        vector<thread> threads;
+        for (int t = 0; t < threadNum; t++) {
+            threads.emplace_back([&]() {
+                for (int i = 0; i < perThread; i++)
+                    queue.Retire(frame, []() {});
+            });
+        }
+        for (auto& t : threads)
+            t.join();
+
+        UDXR_CHECK(queue.GetPendingNum() == threadNum * perThread);
+        fence.CompleteUpTo(frame);
+        UDXR_CHECK(queue.Collect(fence.completed) == threadNum * perThread);
+        UDXR_CHECK(queue.GetReleasedNum() == threadNum * perThread);
+    }
+}
+
+int main() {
+    TestReleaseOrder();
+    TestOutOfOrderWaits();
+    TestFlush();
+    TestConcurrentRetire();
+    cout << "RetireQueue: ok" << endl;
+    return 0;
+}
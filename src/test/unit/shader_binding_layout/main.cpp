@@ -0,0 +1,251 @@
+#include "../Check.h"
+
+#include <UDXRenderer/D3D12ShaderBindingLayout.h>
+
+#include <d3dcompiler.h>
+
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace Ubpa;
+using namespace std;
+
+// reflects the defer demo's shaders, stored as compiled blobs in blobs/
+// a missing blob is compiled from data/shaders/01_defer and stored, --record recompiles all of them
+namespace {
+    using Binding = ShaderBindingLayout::Binding;
+    using BuildResult = ShaderBindingLayout::BuildResult;
+    using ParamType = ShaderBindingLayout::ParamType;
+    using ResourceType = ShaderBindingLayout::ResourceType;
+    using Visibility = ShaderBindingLayout::Visibility;
+
+    constexpr uint32_t Unbounded = ShaderBindingLayout::UnboundedCount;
+    constexpr uint32_t Invalid = ShaderBindingLayout::InvalidIndex;
+
+    bool record = false;
+
+    const filesystem::path testDir = filesystem::path(__FILE__).parent_path();
+    const filesystem::path blobDir = testDir / "blobs";
+    const filesystem::path shaderDir = testDir / ".." / ".." / ".." / ".." / "data" / "shaders" / "01_defer";
+
+    // as DeferApp::BuildShadersAndInputLayout registers them
+    vector<Binding> Reflect(const char* name, const char* file, const char* entrypoint, const char* target) {
+        auto blobPath = blobDir / (string(name) + ".cso");
+        ID3DBlob* shader = nullptr;
+        if (record || FAILED(D3DReadFileToBlob(blobPath.c_str(), &shader))) {
+            shader = UDX12::Util::CompileShader((shaderDir / file).wstring(), nullptr, entrypoint, target);
+            filesystem::create_directories(blobDir);
+            ThrowIfFailed(D3DWriteBlobToFile(shader, blobPath.c_str(), TRUE));
+            cout << "recorded " << blobPath.string() << endl;
+        }
+        auto bindings = D3D12ShaderBindingLayout::Reflect(shader);
+        shader->Release();
+        return bindings;
+    }
+
+    const Binding* Find(const vector<Binding>& bindings, const char* name) {
+        for (const auto& binding : bindings) {
+            if (binding.name == name)
+                return &binding;
+        }
+        return nullptr;
+    }
+
+    bool Is(const Binding* binding, ResourceType type, uint32_t reg, uint32_t space, uint32_t count, Visibility visibility) {
+        return binding && binding->type == type && binding->reg == reg && binding->space == space
+            && binding->count == count && binding->visibility == visibility;
+    }
+
+    bool IsSlot(const ShaderBindingLayout& layout, const char* name, uint32_t rootIndex, uint32_t tableOffset) {
+        auto slot = layout.GetSlot(name);
+        return slot.rootIndex == rootIndex && slot.tableOffset == tableOffset;
+    }
+
+    struct Stages {
+        vector<Binding> geometry[2];
+        vector<Binding> deferLighting[2];
+    };
+
+    Stages ReflectStages() {
+        Stages stages;
+        stages.geometry[0] = Reflect("geometryVS", "Geometry.hlsl", "VS", "vs_5_1");
+        stages.geometry[1] = Reflect("geometryPS", "Geometry.hlsl", "PS", "ps_5_1");
+        stages.deferLighting[0] = Reflect("deferLightingVS", "deferLighting.hlsl", "VS", "vs_5_0");
+        stages.deferLighting[1] = Reflect("deferLightingPS", "deferLighting.hlsl", "PS", "ps_5_0");
+        return stages;
+    }
+
+    // only what the entry point uses is bound
+    void TestReflect(const Stages& stages) {
+        const auto& vs = stages.geometry[0];
+        UDXR_CHECK(vs.size() == 3);
+        UDXR_CHECK(Is(Find(vs, "cbPerObject"), ResourceType::CBV, 0, 0, 1, Visibility::Vertex));
+        UDXR_CHECK(Is(Find(vs, "cbPass"), ResourceType::CBV, 1, 0, 1, Visibility::Vertex));
+        UDXR_CHECK(Is(Find(vs, "gMaterials"), ResourceType::BufferSRV, 0, 2, 1, Visibility::Vertex));
+
+        const auto& ps = stages.geometry[1];
+        UDXR_CHECK(ps.size() == 4);
+        UDXR_CHECK(Is(Find(ps, "gTextures"), ResourceType::SRV, 0, 1, Unbounded, Visibility::Pixel));
+        UDXR_CHECK(Is(Find(ps, "gsamLinear"), ResourceType::Sampler, 0, 0, 1, Visibility::Pixel));
+        UDXR_CHECK(Is(Find(ps, "cbPerObject"), ResourceType::CBV, 0, 0, 1, Visibility::Pixel));
+        UDXR_CHECK(Is(Find(ps, "gMaterials"), ResourceType::BufferSRV, 0, 2, 1, Visibility::Pixel));
+
+        // the full screen quad reads no resources
+        UDXR_CHECK(stages.deferLighting[0].empty());
+
+        const auto& lighting = stages.deferLighting[1];
+        UDXR_CHECK(lighting.size() == 5);
+        UDXR_CHECK(Is(Find(lighting, "gbuffer0"), ResourceType::SRV, 0, 0, 1, Visibility::Pixel));
+        UDXR_CHECK(Is(Find(lighting, "gbuffer1"), ResourceType::SRV, 1, 0, 1, Visibility::Pixel));
+        UDXR_CHECK(Is(Find(lighting, "gbuffer2"), ResourceType::SRV, 2, 0, 1, Visibility::Pixel));
+        UDXR_CHECK(Is(Find(lighting, "gsamLinear"), ResourceType::Sampler, 0, 0, 1, Visibility::Pixel));
+        UDXR_CHECK(Is(Find(lighting, "cbPass"), ResourceType::CBV, 1, 0, 1, Visibility::Pixel));
+        // declared, unused
+        UDXR_CHECK(!Find(lighting, "cbPerObject") && !Find(lighting, "cbMaterial"));
+    }
+
+    void TestGeometry(const Stages& stages) {
+        ShaderBindingLayout layout;
+        UDXR_CHECK(layout.Build(stages.geometry, 2) == BuildResult::Success);
+
+        // root descriptors, then the bindless table, s0 is static
+        const auto& params = layout.GetParams();
+        UDXR_CHECK(params.size() == 4 && layout.GetSize() == 7);
+        UDXR_CHECK(params[0].type == ParamType::CBV && params[0].reg == 0 && params[0].visibility == Visibility::All);
+        UDXR_CHECK(params[1].type == ParamType::CBV && params[1].reg == 1 && params[1].visibility == Visibility::Vertex);
+        UDXR_CHECK(params[2].type == ParamType::SRV && params[2].reg == 0 && params[2].space == 2);
+        UDXR_CHECK(params[2].visibility == Visibility::All);
+        UDXR_CHECK(params[3].type == ParamType::Table && params[3].visibility == Visibility::Pixel);
+        UDXR_CHECK(params[3].ranges.size() == 1 && params[3].ranges[0].count == Unbounded && params[3].ranges[0].space == 1);
+        UDXR_CHECK(layout.GetStaticSamplers() == vector<uint32_t>{ 0 });
+
+        // the slots DeferApp::BuildRootSignature looks up
+        UDXR_CHECK(IsSlot(layout, "cbPerObject", 0, 0));
+        UDXR_CHECK(IsSlot(layout, "cbPass", 1, 0));
+        UDXR_CHECK(IsSlot(layout, "gMaterials", 2, 0));
+        UDXR_CHECK(IsSlot(layout, "gTextures", 3, 0));
+        UDXR_CHECK(IsSlot(layout, "gsamLinear", Invalid, 0));
+        UDXR_CHECK(IsSlot(layout, "gDiffuseMap", Invalid, 0));
+
+        // the D3D12 desc of it, no device needed
+        vector<D3D12_STATIC_SAMPLER_DESC> samplers;
+        for (UINT i = 0; i < 6; i++)
+            samplers.push_back(CD3DX12_STATIC_SAMPLER_DESC(i));
+        D3D12ShaderBindingLayout d3d12Layout(layout, samplers.data(), D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
+        const auto& desc = d3d12Layout.GetDesc();
+        UDXR_CHECK(desc.Version == D3D_ROOT_SIGNATURE_VERSION_1_1);
+        UDXR_CHECK(desc.Desc_1_1.NumParameters == 4 && desc.Desc_1_1.NumStaticSamplers == 1);
+        UDXR_CHECK(desc.Desc_1_1.pParameters[0].ParameterType == D3D12_ROOT_PARAMETER_TYPE_CBV);
+        UDXR_CHECK(desc.Desc_1_1.pParameters[2].ParameterType == D3D12_ROOT_PARAMETER_TYPE_SRV);
+        const auto& table = desc.Desc_1_1.pParameters[3];
+        UDXR_CHECK(table.ParameterType == D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE);
+        UDXR_CHECK(table.ShaderVisibility == D3D12_SHADER_VISIBILITY_PIXEL);
+        UDXR_CHECK(table.DescriptorTable.NumDescriptorRanges == 1);
+        UDXR_CHECK(table.DescriptorTable.pDescriptorRanges[0].NumDescriptors == UINT_MAX);
+        UDXR_CHECK(table.DescriptorTable.pDescriptorRanges[0].Flags == D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE);
+        UDXR_CHECK(desc.Desc_1_1.pStaticSamplers[0].ShaderRegister == 0);
+    }
+
+    void TestDeferLighting(const Stages& stages) {
+        ShaderBindingLayout layout;
+        UDXR_CHECK(layout.Build(stages.deferLighting, 2) == BuildResult::Success);
+
+        const auto& params = layout.GetParams();
+        UDXR_CHECK(params.size() == 2 && layout.GetSize() == 3);
+        UDXR_CHECK(params[0].type == ParamType::CBV && params[0].reg == 1 && params[0].visibility == Visibility::Pixel);
+        UDXR_CHECK(params[1].type == ParamType::Table && params[1].ranges.size() == 3);
+
+        // one table, in register order, DeferApp::Draw fills it from descriptor 0 on
+        UDXR_CHECK(IsSlot(layout, "cbPass", 0, 0));
+        UDXR_CHECK(IsSlot(layout, "gbuffer0", 1, 0));
+        UDXR_CHECK(IsSlot(layout, "gbuffer1", 1, 1));
+        UDXR_CHECK(IsSlot(layout, "gbuffer2", 1, 2));
+        for (uint32_t i = 0; i < 3; i++)
+            UDXR_CHECK(params[1].ranges[i].reg == i && params[1].ranges[i].offset == i && params[1].ranges[i].count == 1);
+        UDXR_CHECK(IsSlot(layout, "cbMaterial", Invalid, 0));
+
+        // without root descriptors cbPass joins the table
+        ShaderBindingLayout::Config config;
+        config.useRootDescriptors = false;
+        UDXR_CHECK(layout.Build(stages.deferLighting, 2, config) == BuildResult::Success);
+        UDXR_CHECK(layout.GetParams().size() == 1 && layout.GetSize() == 1);
+        UDXR_CHECK(IsSlot(layout, "cbPass", 0, 0) && IsSlot(layout, "gbuffer0", 0, 1));
+    }
+
+    void TestConflict(const Stages& stages) {
+        ShaderBindingLayout layout;
+
+        // the same register with another array size
+        vector<Binding> conflicting[] = { stages.deferLighting[1], stages.deferLighting[1] };
+        for (auto& binding : conflicting[1]) {
+            if (binding.name == "gbuffer1")
+                binding.count = 2;
+        }
+        UDXR_CHECK(layout.Build(conflicting, 2) == BuildResult::Conflict);
+        UDXR_CHECK(layout.GetParams().empty() && layout.GetBindings().empty());
+        UDXR_CHECK(IsSlot(layout, "gbuffer0", Invalid, 0));
+
+        // the same register with another type
+        conflicting[1] = stages.deferLighting[1];
+        for (auto& binding : conflicting[1]) {
+            if (binding.name == "gbuffer2")
+                binding.type = ResourceType::BufferSRV;
+        }
+        UDXR_CHECK(layout.Build(conflicting, 2) == BuildResult::Conflict);
+
+        // the pixel shaders of both passes merge, an array over t1..t4 overlaps gbuffer1 and gbuffer2
+        vector<Binding> shared[] = { stages.geometry[1], stages.deferLighting[1],
+            { { "gShadowMaps", ResourceType::SRV, 1, 0, 4, Visibility::Pixel } } };
+        UDXR_CHECK(layout.Build(shared, 2) == BuildResult::Success);
+        UDXR_CHECK(layout.Build(shared, 3) == BuildResult::Conflict);
+    }
+
+    void TestTooLarge(const Stages& stages) {
+        // unbounded arrays, each in a table of its own
+        auto withArrays = [&](uint32_t num) {
+            vector<Binding> ps = stages.geometry[1];
+            for (uint32_t i = 0; i < num; i++)
+                ps.push_back({ "gArray" + to_string(i), ResourceType::SRV, 0, 10 + i, Unbounded, Visibility::Pixel });
+            return ps;
+        };
+        ShaderBindingLayout layout;
+
+        // 3 root descriptors and 58 tables
+        vector<Binding> fits[] = { stages.geometry[0], withArrays(57) };
+        UDXR_CHECK(layout.Build(fits, 2) == BuildResult::Success);
+        UDXR_CHECK(layout.GetSize() == 64 && layout.GetSlot("gMaterials").rootIndex == 2);
+
+        // the last root descriptor moves into a table
+        vector<Binding> demoted[] = { stages.geometry[0], withArrays(58) };
+        UDXR_CHECK(layout.Build(demoted, 2) == BuildResult::Success);
+        UDXR_CHECK(layout.GetSize() == 64);
+        UDXR_CHECK(IsSlot(layout, "cbPerObject", 0, 0) && IsSlot(layout, "cbPass", 1, 0));
+        auto materials = layout.GetSlot("gMaterials");
+        UDXR_CHECK(materials.rootIndex != Invalid && layout.GetParams()[materials.rootIndex].type == ParamType::Table);
+
+        // two tables for the demoted descriptors (All and Vertex) and 63 for the arrays
+        vector<Binding> tooLarge[] = { stages.geometry[0], withArrays(62) };
+        UDXR_CHECK(layout.Build(tooLarge, 2) == BuildResult::TooLarge);
+        UDXR_CHECK(layout.GetParams().empty() && layout.GetSize() == 0);
+        UDXR_CHECK(IsSlot(layout, "gTextures", Invalid, 0));
+    }
+}
+
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; i++)
+        record |= strcmp(argv[i], "--record") == 0;
+
+    auto stages = ReflectStages();
+    TestReflect(stages);
+    TestGeometry(stages);
+    TestDeferLighting(stages);
+    TestConflict(stages);
+    TestTooLarge(stages);
+    cout << "ShaderBindingLayout: ok" << endl;
+    return 0;
+}
@@ -0,0 +1,150 @@
+#include "../Check.h"
+
+#include <UDXRenderer/ShaderDependencyGraph.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace Ubpa;
+using namespace std;
+
+namespace {
+    using Names = vector<string>;
+
+    const filesystem::path dir = filesystem::temp_directory_path() / "udxrenderer_shader_dependency_graph_test";
+
+    filesystem::path Write(const string& name, const string& source) {
+        auto path = dir / name;
+        filesystem::create_directories(path.parent_path());
+        ofstream(path, ios::binary) << source;
+        return path;
+    }
+
+    bool HasFile(const ShaderDependencyGraph& graph, const string& name) {
+        auto files = graph.GetFiles();
+        return find(files.begin(), files.end(), ShaderDependencyGraph::Normalize(dir / name)) != files.end();
+    }
+
+    vector<string> Affected(const ShaderDependencyGraph& graph, const string& name) {
+        return graph.GetAffectedShaders({ dir / name });
+    }
+
+    void TestScanIncludes() {
+        UDXR_CHECK(ShaderDependencyGraph::ScanIncludes(
+            "#include \"a.hlsl\"\n"
+            "  #  include\t<b.hlsl>\r\n"
+            "#include \"sub/c.hlsl\" // trailing comment\n"
+            "#define X 1\n"
+            "float4 f; #include \"d.hlsl\"\n"   // not at the start of the line
+            "#include e.hlsl\n"                 // no quotes
+            "#include \"open\n"                 // not closed
+            "#includes \"f.hlsl\"\n"
+        ) == (Names{ "a.hlsl", "b.hlsl", "sub/c.hlsl" }));
+
+        // commented out, also across lines, the line after a comment still counts
+        UDXR_CHECK(ShaderDependencyGraph::ScanIncludes(
+            "// #include \"line.hlsl\"\n"
+            "/* #include \"block.hlsl\"\n"
+            "#include \"inside.hlsl\"\n"
+            "*/ #include \"after.hlsl\"\n"
+            "/**/#include \"glued.hlsl\"\n"
+            "#include \"next.hlsl\"\n"
+            "/* not closed\n"
+            "#include \"unterminated.hlsl\"\n"
+        ) == (Names{ "after.hlsl", "glued.hlsl", "next.hlsl" }));
+
+        // a line comment ending the source, no newline
+        UDXR_CHECK(ShaderDependencyGraph::ScanIncludes("#include \"last.hlsl\"\n// end") == Names{ "last.hlsl" });
+        UDXR_CHECK(ShaderDependencyGraph::ScanIncludes("").empty());
+    }
+
+    void TestTransitive() {
+        auto geometry = Write("Geometry.hlsl", "#include \"common/Lighting.hlsl\"\nVS PS");
+        Write("common/Lighting.hlsl", "#include \"Math.hlsl\"\n#include \"../Missing.hlsl\"\n");
+        Write("common/Math.hlsl", "float pi;\n");
+        auto screen = Write("Screen.hlsl", "#include \"common/Math.hlsl\"\n");
+
+        ShaderDependencyGraph graph;
+        graph.AddShader("geometryVS", geometry);
+        graph.AddShader("geometryPS", geometry);
+        graph.AddShader("screenPS", screen);
+        UDXR_CHECK(graph.HasShader("geometryVS") && !graph.HasShader("screenVS"));
+
+        // relative to the including file, missing includes are kept
+        UDXR_CHECK(graph.GetIncludes(dir / "common" / "Lighting.hlsl") == (vector<filesystem::path>{
+            ShaderDependencyGraph::Normalize(dir / "common" / "Math.hlsl"),
+            ShaderDependencyGraph::Normalize(dir / "Missing.hlsl") }));
+        UDXR_CHECK(graph.GetFiles().size() == 5 && HasFile(graph, "Missing.hlsl"));
+        UDXR_CHECK(graph.GetIncludes(dir / "Unknown.hlsl").empty());
+
+        // through every level of includes, in name order
+        UDXR_CHECK(Affected(graph, "common/Math.hlsl") == (Names{ "geometryPS", "geometryVS", "screenPS" }));
+        UDXR_CHECK(Affected(graph, "common/Lighting.hlsl") == (Names{ "geometryPS", "geometryVS" }));
+        UDXR_CHECK(Affected(graph, "Missing.hlsl") == (Names{ "geometryPS", "geometryVS" }));
+        UDXR_CHECK(Affected(graph, "Screen.hlsl") == Names{ "screenPS" });
+        UDXR_CHECK(graph.GetAffectedShaders({ dir / "common" / ".." / "Screen.hlsl" }) == Names{ "screenPS" });
+        UDXR_CHECK(Affected(graph, "Other.hlsl").empty());
+
+        // an include dropped by an edit is forgotten, a new one is scanned
+        Write("common/Lighting.hlsl", "#include \"Brdf.hlsl\"\n");
+        Write("common/Brdf.hlsl", "#include \"Math.hlsl\"\n");
+        graph.Rescan(dir / "common" / "Lighting.hlsl");
+        UDXR_CHECK(!HasFile(graph, "Missing.hlsl") && HasFile(graph, "common/Brdf.hlsl"));
+        UDXR_CHECK(Affected(graph, "Missing.hlsl").empty());
+        UDXR_CHECK(Affected(graph, "common/Math.hlsl") == (Names{ "geometryPS", "geometryVS", "screenPS" }));
+        UDXR_CHECK(Affected(graph, "common/Brdf.hlsl") == (Names{ "geometryPS", "geometryVS" }));
+        // files that weren't scanned are ignored
+        graph.Rescan(dir / "Missing.hlsl");
+        UDXR_CHECK(graph.GetFiles().size() == 5);
+
+        // the files of a removed shader are forgotten, shared ones stay
+        graph.RemoveShader("geometryVS");
+        UDXR_CHECK(graph.GetFiles().size() == 5);
+        graph.RemoveShader("geometryPS");
+        UDXR_CHECK(graph.GetFiles().size() == 2);
+        UDXR_CHECK(HasFile(graph, "Screen.hlsl") && HasFile(graph, "common/Math.hlsl") && !HasFile(graph, "Geometry.hlsl"));
+        UDXR_CHECK(Affected(graph, "common/Math.hlsl") == Names{ "screenPS" });
+        graph.RemoveShader("unknown");
+        graph.RemoveShader("screenPS");
+        UDXR_CHECK(graph.GetFiles().empty());
+    }
+
+    void TestCycles() {
+        auto a = Write("cycle/A.hlsl", "#include \"B.hlsl\"\n");
+        Write("cycle/B.hlsl", "#include \"C.hlsl\"\n");
+        Write("cycle/C.hlsl", "#include \"A.hlsl\"\n#include \"C.hlsl\"\n");
+        auto d = Write("cycle/D.hlsl", "#include \"C.hlsl\"\n");
+
+        ShaderDependencyGraph graph;
+        graph.AddShader("a", a);
+        graph.AddShader("d", d);
+        UDXR_CHECK(graph.GetFiles().size() == 4);
+        UDXR_CHECK(Affected(graph, "cycle/A.hlsl") == (Names{ "a", "d" }));
+        UDXR_CHECK(Affected(graph, "cycle/B.hlsl") == (Names{ "a", "d" }));
+        UDXR_CHECK(Affected(graph, "cycle/D.hlsl") == Names{ "d" });
+
+        // the cycle is still reached from d
+        graph.RemoveShader("a");
+        UDXR_CHECK(graph.GetFiles().size() == 4);
+
+        // a cycle no shader reaches is forgotten as a whole
+        Write("cycle/D.hlsl", "float d;\n");
+        graph.Rescan(d);
+        UDXR_CHECK(graph.GetFiles().size() == 1 && HasFile(graph, "cycle/D.hlsl"));
+        UDXR_CHECK(Affected(graph, "cycle/A.hlsl").empty());
+    }
+}
+
+int main() {
+    filesystem::remove_all(dir);
+    TestScanIncludes();
+    TestTransitive();
+    TestCycles();
+    filesystem::remove_all(dir);
+    cout << "ShaderDependencyGraph: ok" << endl;
+    return 0;
+}
@@ -0,0 +1,239 @@
+#include "../Check.h"
+
+#include <UDXRenderer/TextureStreamer.h>
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+using namespace Ubpa;
+using namespace std;
+
+namespace {
+    using OpType = TextureStreamer::OpType;
+
+    // three mips, resident from mip 2 on when registered
+    TextureStreamer::Desc Desc() {
+        TextureStreamer::Desc desc;
+        desc.residentBytes = { 40, 10, 1 };
+        return desc;
+    }
+
+    TextureStreamer::Config Config(uint64_t budget) {
+        TextureStreamer::Config config;
+        config.budget = budget;
+        config.maxStreamInBytesPerUpdate = 1000;
+        return config;
+    }
+
+    bool IsOp(const TextureStreamer::Op& op, OpType type, TextureStreamer::TextureID id, uint32_t mip, uint32_t previousMip) {
+        return op.type == type && op.texture == id && op.mip == mip && op.previousMip == previousMip;
+    }
+
+    void TestStreamIn() {
+        TextureStreamer streamer(Config(100));
+        auto id = streamer.Register(Desc());
+        const auto& state = streamer.GetState(id);
+        UDXR_CHECK(state.mipNum == 3 && state.minResidentMip == 2);
+        UDXR_CHECK(state.residentMip == 2 && state.pendingMip == 2 && state.wantedMip == 2);
+        UDXR_CHECK(streamer.GetStats().residentBytes == 1 && streamer.GetStats().textureNum == 1);
+
+        UDXR_CHECK(streamer.Update().empty());
+
+        // the finest request of an update counts
+        streamer.Request(id, 1.5f);
+        streamer.Request(id, 0.7f);
+        const auto& ops = streamer.Update();
+        UDXR_CHECK(ops.size() == 1 && IsOp(ops[0], OpType::StreamIn, id, 0, 2));
+        UDXR_CHECK(state.wantedMip == 0 && state.pendingMip == 0 && state.residentMip == 2);
+        auto stats = streamer.GetStats();
+        UDXR_CHECK(stats.residentBytes == 1 && stats.pendingBytes == 40 && stats.pendingNum == 1 && stats.streamInNum == 1);
+
+        // nothing new while it is in flight
+        streamer.Request(id, 0.f);
+        UDXR_CHECK(streamer.Update().empty());
+
+        streamer.OnStreamedIn(id);
+        UDXR_CHECK(state.residentMip == 0 && state.pendingMip == 0);
+        stats = streamer.GetStats();
+        UDXR_CHECK(stats.residentBytes == 40 && stats.pendingBytes == 0 && stats.pendingNum == 0);
+
+        // coarser requests don't evict while the budget isn't needed
+        streamer.Request(id, 2.5f);
+        UDXR_CHECK(streamer.Update().empty());
+        UDXR_CHECK(state.wantedMip == 2 && state.residentMip == 0);
+        UDXR_CHECK(streamer.GetStats().wantedBytes == 1);
+
+        // a lowered budget does
+        streamer.SetBudget(20);
+        streamer.Request(id, 2.5f);
+        UDXR_CHECK(streamer.Update().size() == 1 && IsOp(ops[0], OpType::Evict, id, 2, 0));
+        UDXR_CHECK(state.residentMip == 2 && streamer.GetStats().residentBytes == 1 && streamer.GetStats().evictNum == 1);
+    }
+
+    void TestBudget() {
+        // the finest mip that fits
+        TextureStreamer streamer(Config(30));
+        auto id = streamer.Register(Desc());
+        streamer.Request(id, 0.f);
+        const auto& ops = streamer.Update();
+        UDXR_CHECK(ops.size() == 1 && IsOp(ops[0], OpType::StreamIn, id, 1, 2));
+        UDXR_CHECK(streamer.GetStats().pendingBytes == 10);
+        streamer.OnStreamedIn(id);
+        // it stays there, mip 0 doesn't fit
+        streamer.Request(id, 0.f);
+        UDXR_CHECK(streamer.Update().empty());
+        UDXR_CHECK(streamer.GetState(id).residentMip == 1);
+
+        // the budget counts both chains of a stream-in in flight
+        TextureStreamer tight(Config(41));
+        id = tight.Register(Desc());
+        tight.Request(id, 0.f);
+        UDXR_CHECK(tight.Update().size() == 1 && tight.GetState(id).pendingMip == 0);
+        UDXR_CHECK(tight.GetStats().residentBytes + tight.GetStats().pendingBytes == 41);
+    }
+
+    void TestEvictOrder() {
+        TextureStreamer streamer(Config(100));
+        auto a = streamer.Register(Desc());
+        auto b = streamer.Register(Desc());
+        auto c = streamer.Register(Desc());
+
+        for (auto id : { a, b }) {
+            streamer.Request(id, 0.f);
+            UDXR_CHECK(streamer.Update().size() == 1);
+            streamer.OnStreamedIn(id);
+        }
+        UDXR_CHECK(streamer.GetStats().residentBytes == 81);
+
+        // b is wanted smaller first, a later, no memory is needed yet
+        streamer.Request(b, 2.f);
+        UDXR_CHECK(streamer.Update().empty());
+        streamer.Request(a, 2.f);
+        streamer.Request(c, 0.f);
+        // c needs 40 bytes: the least recently requested texture goes first, a stays
+        const auto& ops = streamer.Update();
+        UDXR_CHECK(ops.size() == 2);
+        UDXR_CHECK(IsOp(ops[0], OpType::Evict, b, 2, 0));
+        UDXR_CHECK(IsOp(ops[1], OpType::StreamIn, c, 0, 2));
+        UDXR_CHECK(streamer.GetState(a).residentMip == 0 && streamer.GetState(b).residentMip == 2);
+        auto stats = streamer.GetStats();
+        UDXR_CHECK(stats.residentBytes == 42 && stats.pendingBytes == 40);
+
+        // a failed evict is rolled back, the next update evicts again
+        streamer.CancelEvict(b, ops[0].previousMip);
+        UDXR_CHECK(streamer.GetState(b).residentMip == 0 && streamer.GetState(b).pendingMip == 0);
+        stats = streamer.GetStats();
+        UDXR_CHECK(stats.residentBytes == 81 && stats.evictNum == 0);
+        streamer.Request(a, 2.f);
+        streamer.Request(b, 2.f);
+        streamer.Request(c, 0.f);
+        // 81 resident and 40 pending, both were requested in this update and free as much, the lower ID goes
+        UDXR_CHECK(streamer.Update().size() == 1 && IsOp(ops[0], OpType::Evict, a, 2, 0));
+        UDXR_CHECK(streamer.GetStats().residentBytes + streamer.GetStats().pendingBytes == 82);
+        streamer.OnStreamedIn(c);
+        UDXR_CHECK(streamer.GetStats().residentBytes == 81);
+    }
+
+    void TestLimits() {
+        // one stream-in in flight at a time
+        auto config = Config(1000);
+        config.maxPendingNum = 1;
+        TextureStreamer pending(config);
+        auto a = pending.Register(Desc());
+        auto b = pending.Register(Desc());
+        pending.Request(a, 0.f);
+        pending.Request(b, 1.f);
+        const auto& ops = pending.Update();
+        // the most missing mips first
+        UDXR_CHECK(ops.size() == 1 && IsOp(ops[0], OpType::StreamIn, a, 0, 2));
+        pending.Request(b, 1.f);
+        UDXR_CHECK(pending.Update().empty());
+        pending.OnStreamedIn(a);
+        pending.Request(b, 1.f);
+        UDXR_CHECK(pending.Update().size() == 1 && IsOp(ops[0], OpType::StreamIn, b, 1, 2));
+
+        // bytes started per update, the first stream-in is always started
+        config = Config(1000);
+        config.maxStreamInBytesPerUpdate = 30;
+        TextureStreamer bytes(config);
+        a = bytes.Register(Desc());
+        b = bytes.Register(Desc());
+        bytes.Request(a, 0.f);
+        bytes.Request(b, 0.f);
+        UDXR_CHECK(bytes.Update().size() == 1);
+        bytes.Request(a, 0.f);
+        bytes.Request(b, 0.f);
+        UDXR_CHECK(bytes.Update().size() == 1);
+        UDXR_CHECK(bytes.GetStats().pendingNum == 2);
+
+        // without requests a texture is wanted at its smallest mips after requestLifetime updates
+        config = Config(1000);
+        config.requestLifetime = 2;
+        TextureStreamer lifetime(config);
+        a = lifetime.Register(Desc());
+        lifetime.Request(a, 0.f);
+        lifetime.Update();
+        for (int i = 0; i < 2; i++) {
+            lifetime.Update();
+            UDXR_CHECK(lifetime.GetState(a).wantedMip == 0);
+        }
+        lifetime.Update();
+        UDXR_CHECK(lifetime.GetState(a).wantedMip == 2);
+    }
+
+    void TestCancel() {
+        TextureStreamer streamer(Config(100));
+        auto a = streamer.Register(Desc());
+        streamer.Request(a, 0.f);
+        UDXR_CHECK(streamer.Update().size() == 1);
+
+        // the load failed: the reservation is released, the request is retried
+        streamer.CancelStreamIn(a);
+        UDXR_CHECK(streamer.GetState(a).pendingMip == 2 && streamer.GetState(a).residentMip == 2);
+        auto stats = streamer.GetStats();
+        UDXR_CHECK(stats.pendingBytes == 0 && stats.pendingNum == 0 && stats.residentBytes == 1);
+        streamer.CancelStreamIn(a); // nothing in flight
+        streamer.Request(a, 0.f);
+        UDXR_CHECK(streamer.Update().size() == 1);
+
+        // unregistering drops the stream-in in flight, the ID is reused
+        auto b = streamer.Register(Desc());
+        UDXR_CHECK(streamer.GetStats().residentBytes == 2);
+        streamer.Unregister(a);
+        stats = streamer.GetStats();
+        UDXR_CHECK(stats.textureNum == 1 && stats.residentBytes == 1 && stats.pendingBytes == 0 && stats.pendingNum == 0);
+        UDXR_CHECK(streamer.Register(Desc()) == a);
+        UDXR_CHECK(streamer.GetState(a).residentMip == 2);
+        streamer.Unregister(b);
+        UDXR_CHECK(streamer.Update().empty());
+    }
+
+    void TestEstimates() {
+        // 2 * distance texels per pixel with these values
+        UDXR_CHECK(TextureStreamer::EstimateMip(1024, 1.f, 0.5f, 1.f, 1024.f) == 0.f);
+        UDXR_CHECK(fabs(TextureStreamer::EstimateMip(1024, 1.f, 2.f, 1.f, 1024.f) - 2.f) < 1e-5f);
+        UDXR_CHECK(fabs(TextureStreamer::EstimateMip(2048, 1.f, 2.f, 1.f, 1024.f) - 3.f) < 1e-5f);
+        UDXR_CHECK(TextureStreamer::EstimateMip(1024, 1.f, 0.f, 1.f, 1024.f) == 0.f);
+        UDXR_CHECK(TextureStreamer::EstimateMip(1024, 0.f, 2.f, 1.f, 1024.f) == 0.f);
+
+        // a 2 x 2 quad mapped to the unit uv square
+        const float positions[] = { 0, 0, 0, 2, 0, 0, 2, 2, 0, 0, 2, 0 };
+        const float uvs[] = { 0, 0, 1, 0, 1, 1, 0, 1 };
+        const uint32_t indices[] = { 0, 1, 2, 0, 2, 3 };
+        float density = TextureStreamer::ComputeUVDensity(indices, 6, positions, 12, uvs, 8);
+        UDXR_CHECK(fabs(density - 0.5f) < 1e-6f);
+        UDXR_CHECK(TextureStreamer::ComputeUVDensity(indices, 0, positions, 12, uvs, 8) == 0.f);
+    }
+}
+
+int main() {
+    TestStreamIn();
+    TestBudget();
+    TestEvictOrder();
+    TestLimits();
+    TestCancel();
+    TestEstimates();
+    cout << "TextureStreamer: ok" << endl;
+    return 0;
+}
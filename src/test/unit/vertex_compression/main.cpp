@@ -0,0 +1,197 @@
+#include "../Check.h"
+
+#include <UDXRenderer/VertexCompression.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace Ubpa;
+using namespace std;
+
+namespace {
+    struct Vertex {
+        float position[3];
+        float normal[3];
+        float tangent[3];
+        float uv[2];
+    };
+
+    float AngleDeg(const float a[3], const float b[3]) {
+        float d = a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+        float la = sqrtf(a[0] * a[0] + a[1] * a[1] + a[2] * a[2]);
+        float lb = sqrtf(b[0] * b[0] + b[1] * b[1] + b[2] * b[2]);
+        return acosf(clamp(d / (la * lb), -1.f, 1.f)) * 57.2957795f;
+    }
+
+    void RandomDirection(mt19937& rng, float n[3]) {
+        normal_distribution<float> dist;
+        float len;
+        do {
+            n[0] = dist(rng);
+            n[1] = dist(rng);
+            n[2] = dist(rng);
+            len = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        } while (len < 1e-3f);
+        n[0] /= len;
+        n[1] /= len;
+        n[2] /= len;
+    }
+
+    vector<Vertex> RandomVertices(size_t num) {
+        mt19937 rng(3);
+        uniform_real_distribution<float> pos(-5.f, 20.f);
+        uniform_real_distribution<float> uv(-2.f, 2.f);
+        vector<Vertex> vertices(num);
+        for (auto& v : vertices) {
+            for (auto& p : v.position)
+                p = pos(rng);
+            RandomDirection(rng, v.normal);
+            RandomDirection(rng, v.tangent);
+            v.uv[0] = uv(rng);
+            v.uv[1] = uv(rng);
+        }
+        // the axis directions and the octahedron's folded edges
+        const float axes[6][3] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+        for (size_t i = 0; i < 6; i++)
+            copy(axes[i], axes[i] + 3, vertices[i].normal);
+        return vertices;
+    }
+
+    VertexCompression::SourceMesh ToSource(const vector<Vertex>& vertices) {
+        VertexCompression::SourceMesh source;
+        source.vertexNum = vertices.size();
+        source.positions = { vertices[0].position, sizeof(Vertex) };
+        source.normals = { vertices[0].normal, sizeof(Vertex) };
+        source.tangents = { vertices[0].tangent, sizeof(Vertex) };
+        source.uvs = { vertices[0].uv, sizeof(Vertex) };
+        return source;
+    }
+
+    void TestHalf() {
+        // every finite half survives half -> float -> half
+        for (uint32_t h = 0; h < 0x10000; h++) {
+            if ((h & 0x7c00) == 0x7c00)
+                continue; // inf, nan
+            float f = VertexCompression::HalfToFloat(static_cast<uint16_t>(h));
+            UDXR_CHECK(VertexCompression::FloatToHalf(f) == h);
+        }
+        UDXR_CHECK(VertexCompression::FloatToHalf(1.f) == 0x3c00);
+        UDXR_CHECK(VertexCompression::FloatToHalf(-2.f) == 0xc000);
+        UDXR_CHECK(VertexCompression::FloatToHalf(65504.f) == 0x7bff);
+        UDXR_CHECK(VertexCompression::FloatToHalf(1e6f) == 0x7c00); // overflows to inf
+        UDXR_CHECK(VertexCompression::HalfToFloat(0x0001) == ldexpf(1.f, -24)); // smallest subnormal
+        // round to nearest even between 1 and the next half (1 + 2^-10)
+        UDXR_CHECK(VertexCompression::FloatToHalf(1.f + ldexpf(1.f, -11)) == 0x3c00);
+        UDXR_CHECK(VertexCompression::FloatToHalf(1.f + 3.f * ldexpf(1.f, -11)) == 0x3c02);
+    }
+
+    void TestOct() {
+        mt19937 rng(5);
+        for (int i = 0; i < 10000; i++) {
+            float n[3], e[2], d[3];
+            RandomDirection(rng, n);
+            VertexCompression::OctEncode(n, e);
+            // the upper hemisphere maps into the diamond, the lower one folds over its corners
+            UDXR_CHECK(fabsf(e[0]) <= 1.f && fabsf(e[1]) <= 1.f);
+            UDXR_CHECK(n[2] < 0.f || fabsf(e[0]) + fabsf(e[1]) <= 1.f + 1e-5f);
+            VertexCompression::OctDecode(e, d);
+            // acosf resolves about 0.02 degrees near 1
+            UDXR_CHECK(AngleDeg(n, d) < 0.05f);
+        }
+    }
+
+    void TestLayout() {
+        VertexCompression::Desc desc;
+        desc.position = VertexCompression::PositionFormat::Unorm16;
+        desc.normal = VertexCompression::DirectionFormat::Oct8;
+        desc.tangent = VertexCompression::DirectionFormat::Oct8;
+        desc.uv = VertexCompression::UVFormat::Half2;
+        auto layout = VertexCompression::MakeLayout(desc);
+        UDXR_CHECK(layout.stride == 16);
+        UDXR_CHECK(layout.packedNormalTangent);
+        for (const auto& e : layout.elements)
+            UDXR_CHECK(e.offset % 4 == 0);
+
+        desc.position = VertexCompression::PositionFormat::Float3;
+        desc.normal = VertexCompression::DirectionFormat::Float3;
+        desc.tangent = VertexCompression::DirectionFormat::None;
+        desc.uv = VertexCompression::UVFormat::Float2;
+        layout = VertexCompression::MakeLayout(desc);
+        UDXR_CHECK(layout.stride == 32);
+        UDXR_CHECK(!layout.packedNormalTangent);
+    }
+
+    // quantize with Encode, dequantize with Decode, the errors stay within the format's step
+    void TestRoundTrip(const VertexCompression::Desc& desc, float maxDirectionErrorDeg) {
+        auto vertices = RandomVertices(4096);
+        auto mesh = VertexCompression::Encode(ToSource(vertices), desc);
+        UDXR_CHECK(mesh.vertexNum == vertices.size());
+        UDXR_CHECK(mesh.vertices.size() == vertices.size() * mesh.layout.stride);
+
+        // unorm16: at most half a step of the bounds per axis
+        float maxPositionError = 0.f;
+        if (desc.position == VertexCompression::PositionFormat::Unorm16) {
+            float sumSq = 0.f;
+            for (size_t k = 0; k < 3; k++) {
+                float halfStep = mesh.quantization.extent[k] / 65535.f * 0.5f;
+                sumSq += halfStep * halfStep;
+            }
+            maxPositionError = sqrtf(sumSq) * 1.01f;
+        }
+
+        float maxPosition = 0.f, maxNormal = 0.f, maxTangent = 0.f, maxUV = 0.f;
+        for (size_t i = 0; i < vertices.size(); i++) {
+            auto d = VertexCompression::Decode(mesh, i);
+            const auto& v = vertices[i];
+            float d2 = 0.f;
+            for (size_t k = 0; k < 3; k++)
+                d2 += (d.position[k] - v.position[k]) * (d.position[k] - v.position[k]);
+            maxPosition = max(maxPosition, sqrtf(d2));
+            if (desc.normal != VertexCompression::DirectionFormat::None)
+                maxNormal = max(maxNormal, AngleDeg(d.normal, v.normal));
+            if (desc.tangent != VertexCompression::DirectionFormat::None)
+                maxTangent = max(maxTangent, AngleDeg(d.tangent, v.tangent));
+            if (desc.uv != VertexCompression::UVFormat::None) {
+                for (size_t k = 0; k < 2; k++)
+                    maxUV = max(maxUV, fabsf(d.uv[k] - v.uv[k]));
+            }
+        }
+
+        UDXR_CHECK(maxPosition <= maxPositionError + 1e-6f);
+        UDXR_CHECK(maxNormal <= maxDirectionErrorDeg);
+        UDXR_CHECK(maxTangent <= maxDirectionErrorDeg);
+        // half: 11 significant bits, |uv| < 2
+        UDXR_CHECK(maxUV <= (desc.uv == VertexCompression::UVFormat::Half2 ? ldexpf(1.f, -10) : 0.f));
+
+        // the reported metrics are the measured ones
+        UDXR_CHECK(fabsf(mesh.error.maxPositionError - maxPosition) <= 1e-5f);
+        UDXR_CHECK(fabsf(mesh.error.maxNormalErrorDeg - maxNormal) <= 1e-2f);
+        UDXR_CHECK(fabsf(mesh.error.maxTangentErrorDeg - maxTangent) <= 1e-2f);
+        UDXR_CHECK(fabsf(mesh.error.maxUVError - maxUV) <= 1e-6f);
+    }
+}
+
+int main() {
+    TestHalf();
+    TestOct();
+    TestLayout();
+
+    using VertexCompression::DirectionFormat;
+    using VertexCompression::PositionFormat;
+    using VertexCompression::UVFormat;
+    // full precision: exact up to the normalization of the directions
+    TestRoundTrip({ PositionFormat::Float3, DirectionFormat::Float3, DirectionFormat::Float3, UVFormat::Float2 }, 0.05f);
+    // 2x8-bit octahedral: about a degree
+    TestRoundTrip({ PositionFormat::Unorm16, DirectionFormat::Oct8, DirectionFormat::Oct8, UVFormat::Half2 }, 1.5f);
+    // 2x16-bit octahedral: below the resolution of acosf
+    TestRoundTrip({ PositionFormat::Unorm16, DirectionFormat::Oct16, DirectionFormat::Oct16, UVFormat::Half2 }, 0.05f);
+    // mixed formats are not packed together
+    TestRoundTrip({ PositionFormat::Unorm16, DirectionFormat::Oct16, DirectionFormat::Oct8, UVFormat::None }, 1.5f);
+
+    cout << "VertexCompression: ok" << endl;
+    return 0;
+}
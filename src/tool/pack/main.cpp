@@ -0,0 +1,58 @@
+#include <UDXRenderer/PackArchive.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+using namespace Ubpa;
+using namespace std;
+
+// packs every file under <root> into <archive>, named by their paths relative to root
+// e.g. pack ../data ../data/01_defer.upak
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        cerr << "usage: " << argv[0] << " <root> <archive> [block size in KB]" << endl;
+        return 1;
+    }
+    const filesystem::path root = argv[1];
+    const filesystem::path archivePath = argv[2];
+    const uint32_t blockSize = argc > 3 ? static_cast<uint32_t>(stoul(argv[3])) * 1024 : 64 * 1024;
+
+    // sorted, so that the data order (and the batched reads) follow the directory layout
+    vector<filesystem::path> files;
+    for (const auto& entry : filesystem::recursive_directory_iterator(root)) {
+        if (entry.is_regular_file() && entry.path().extension() != ".upak")
+            files.push_back(entry.path());
+    }
+    sort(files.begin(), files.end());
+
+    PackWriter writer;
+    if (!writer.Open(archivePath, blockSize)) {
+        cerr << "can't write " << archivePath << endl;
+        return 1;
+    }
+
+    uint64_t rawSize = 0;
+    for (const auto& file : files) {
+        ifstream in(file, ios::binary);
+        vector<char> data((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+        string name = filesystem::relative(file, root).generic_u8string();
+        if (!in.is_open() || in.bad() || !writer.Add(name, data.data(), data.size())) {
+            cerr << "can't add " << file << endl;
+            return 1;
+        }
+        rawSize += data.size();
+    }
+    if (!writer.Finish()) {
+        cerr << "can't write " << archivePath << endl;
+        return 1;
+    }
+
+    cout << files.size() << " files, " << rawSize << " -> "
+        << filesystem::file_size(archivePath) << " bytes" << endl;
+    return 0;
+}